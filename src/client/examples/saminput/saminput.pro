@@ -31,6 +31,7 @@ SOURCES += main.cpp
 
 INCLUDEPATH += /usr/local/include $$ParentDirectory/src/client
 LIBS += -L$$ParentDirectory/lib -lsac -ljack
+unix:!macx: LIBS += -lrt # for shm_open (libsac SharedAudioRing)
 QT += network
 
 target.path = /usr/local/bin
@@ -32,6 +32,7 @@ HEADERS += \
 
 INCLUDEPATH += /usr/local/include $$ParentDirectory/src/client
 LIBS += -L$$ParentDirectory/lib -lsac
+unix:!macx: LIBS += -lrt # for shm_open (libsac SharedAudioRing)
 QT += network
 
 target.path = /usr/local/bin
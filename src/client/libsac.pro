@@ -46,19 +46,23 @@ else {
 
 SOURCES += \
     sam_client.cpp \
+    sam_client_group.cpp \
     sac_audio_interface.cpp \
     rtpsender.cpp \
     ../rtp.cpp \
     ../rtcp.cpp \
+    ../shared_audio_ring.cpp \
     ../osc.cpp
 
 HEADERS +=\
     libsac_global.h \
     sam_client.h \
+    sam_client_group.h \
     sac_audio_interface.h \
     rtpsender.h \
     ../rtp.h \
     ../rtcp.h \
+    ../shared_audio_ring.h \
     ../osc.h \
     ../sam_shared.h
 
@@ -41,35 +41,119 @@
  * MODIFICATIONS.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
 #include <QDebug>
 #include <QTime>
+#include <QTimer>
 #include <QtEndian>
-#include <QUdpSocket>
 
 #include "rtpsender.h"
 
 namespace sam
 {
 
+static const int MULTICAST_TTL = 8; // hops a multicast RTP packet may travel (enough for a campus network)
+static const int RTCP_POLL_MILLIS = 10; // how often to check for sender reports captured by the audio thread
+
+// adaptive payload: lower the bit depth when the network is congested, and raise it again once it has been clean for a while
+static const quint8 LOSS_LOWER = 5;         // loss fraction (in 256ths) at which to lower the bit depth (about 2%)
+static const int JITTER_LOWER_PACKETS = 1;  // jitter (in packets) at which to lower the bit depth
+static const int JITTER_CLEAN_DIVISOR = 4;  // jitter must be below a quarter of a packet for a report to count as clean
+static const int CLEAN_REPORTS_TO_RAISE = 10; // consecutive clean receiver reports needed to raise the bit depth
+static const int HOLD_REPORTS = 1;          // receiver reports to ignore after a change (they may cover time before it)
+static const int QUEUEING_LOWER_PACKETS = 2; // round-trip time above the lowest seen (queueing delay), in packets, at which to lower the bit depth
+
+#ifdef Q_OS_LINUX
+struct RtpBatchMessage : public mmsghdr {};
+#else
+struct RtpBatchMessage
+{
+    msghdr msg_hdr;
+    unsigned int msg_len;
+};
+#endif
+
+/**
+ * Open a non-blocking UDP socket.
+ * @param family AF_INET or AF_INET6
+ * @return the socket descriptor, or -1 on failure
+ */
+static int open_socket(int family)
+{
+    int fd = ::socket(family, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Check whether an address is a multicast group address.
+ * @param host the address to check
+ * @return true if host is an IPv4 or IPv6 multicast address, false otherwise
+ */
+static bool is_multicast(const QHostAddress& host)
+{
+    return host.isInSubnet(QHostAddress("224.0.0.0"), 4) || host.isInSubnet(QHostAddress("ff00::"), 8);
+}
+
 RtpSender::RtpSender(const QString& host, quint16 portRtp, quint16 portRtcpLocal, quint16 portRtcpRemote, int reportInterval, int sampleRate, int channels, int bufferSize, quint32 ssrc, quint8 payloadType, QObject *parent) :
-    m_socketRtp(NULL),
-    m_remotePortRtp(portRtp),
-    m_remotePortRtcp(portRtcpRemote),
+    m_socket4(-1),
+    m_socket6(-1),
+    m_stagedDestinations(NULL),
+    m_retiredDestinations(NULL),
     m_sampleRate(sampleRate),
     m_ssrc(ssrc),
     m_payloadType(payloadType),
+    m_payloadTypeControl(payloadType),
+    m_payloadTypeNext(payloadType),
+    m_adaptivePayload(false),
+    m_lastReportSeqNum(0),
+    m_minRoundTripMicros(-1),
+    m_cleanReports(0),
+    m_holdReports(0),
+    m_bufferSize(bufferSize),
     m_timestamp(0),
     m_sequenceNum(0),
     m_reportInterval(0),
     m_nextReportTick(0),
     m_packetsSent(0),
     m_octetsSent(0),
+    m_rtcpTickPending(0),
+    m_sendErrors(0),
+    m_roundTripMicros(-1),
+    m_rtcpTimer(NULL),
     m_rtcpHandler(NULL)
 {
-    m_socketRtp = new QUdpSocket(this);
-    m_socketRtp->bind();
+    m_socket4 = open_socket(AF_INET);
+    m_socket6 = open_socket(AF_INET6);
+    if (m_socket4 < 0)
+    {
+        qWarning("RtpSender::RtpSender couldn't open RTP socket: %s", strerror(errno));
+    }
 
-    m_remoteHost.setAddress(host);
+    RtpDestination dest;
+    dest.host.setAddress(host);
+    dest.portRtp = portRtp;
+    dest.portRtcp = portRtcpRemote;
+    if (!set_sockaddr(dest))
+    {
+        QByteArray hostBytes = host.toLocal8Bit();
+        qWarning("RtpSender::RtpSender unsupported host address %s", hostBytes.constData());
+    }
+    m_destinations.append(dest);
+    m_destinationsControl.append(dest);
 
     // random initialization of timestamp and sequence number
     m_timestamp = qrand() * 4294967296.0f / RAND_MAX; // random unsigned 32-bit int
@@ -80,59 +164,434 @@ RtpSender::RtpSender(const QString& host, quint16 portRtp, quint16 portRtcpLocal
     m_reportInterval = (m_sampleRate  * reportInterval) / 1000.0;
     m_nextReportTick = m_timestamp + m_reportInterval;
     
+    // allocate the datagram buffer once, for the largest packet this sender will send
+    int payloadSize = RtpPacket::getPayloadSize(m_payloadType, channels, bufferSize);
+    m_packetData.resize(RTP_HEADER_BYTES + (payloadSize > 0 ? payloadSize : 0));
+
     m_rtcpHandler = new RtcpHandler(portRtcpLocal, ssrc, host, portRtcpRemote, this);
-    connect(this, SIGNAL(sendRtcpTick(qint64, quint32, quint32, quint32, quint32)), m_rtcpHandler, SLOT(sendSenderReport(qint64, quint32, quint32, quint32, quint32)));
+    connect(this, SIGNAL(sendRtcpTick(quint32, quint32, quint32, quint32, quint32)), m_rtcpHandler, SLOT(sendSenderReport(quint32, quint32, quint32, quint32, quint32)));
+    connect(m_rtcpHandler, SIGNAL(receiverReportReceived()), this, SLOT(handleReceiverReport()));
+
+    m_rtcpTimer = new QTimer(this);
+    connect(m_rtcpTimer, SIGNAL(timeout()), this, SLOT(checkRtcpTick()));
 }
 
 RtpSender::~RtpSender()
 {
-    // socket will be destroyed by parent
+    // timer will be destroyed by parent
     
     delete m_rtcpHandler;
     m_rtcpHandler = NULL;
+
+    delete m_stagedDestinations.fetchAndStoreOrdered(NULL);
+    delete m_retiredDestinations.fetchAndStoreOrdered(NULL);
     
-    m_socketRtp->close();
+    if (m_socket4 >= 0) ::close(m_socket4);
+    if (m_socket6 >= 0) ::close(m_socket6);
 }
 
 bool RtpSender::init()
 {
+    if (m_socket4 < 0) return false;
+
+    m_rtcpTimer->start(RTCP_POLL_MILLIS);
+
     // start RTCP receiver
     return m_rtcpHandler->start();
 }
 
 bool RtpSender::sendAudio(int numChannels, int numSamples, float** data)
 {
-    // construct RTP packet
-    m_packet.init(m_timestamp, m_sequenceNum, m_payloadType, m_ssrc);
-    m_packet.setPayload(numChannels, numSamples, data);
+    int packetSize = prepare_audio(numChannels, numSamples, data);
+    if (packetSize < 0) return false;
+
+    // send RTP packet (written once, sent to each destination)
+    bool success = true;
+    for (int i = 0; i < m_destinations.size(); i++)
+    {
+        const RtpDestination& dest = m_destinations.at(i);
+        int fd = (dest.addr.ss_family == AF_INET6) ? m_socket6 : m_socket4;
+        if (fd < 0 || ::sendto(fd, m_packetData.constData(), packetSize, 0, (const sockaddr*)&dest.addr, dest.addrLen) < 0)
+        {
+            // can't print from the audio thread: checkRtcpTick reports the errors
+            m_sendErrors.fetchAndAddOrdered(1);
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool RtpSender::queueAudio(int numChannels, int numSamples, float** data, RtpSendBatch& batch)
+{
+    int packetSize = prepare_audio(numChannels, numSamples, data);
+    if (packetSize < 0) return false;
+
+    bool success = true;
+    for (int i = 0; i < m_destinations.size(); i++)
+    {
+        const RtpDestination& dest = m_destinations.at(i);
+        if (!batch.add(m_packetData.constData(), packetSize, dest.addr, dest.addrLen))
+        {
+            m_sendErrors.fetchAndAddOrdered(1);
+            success = false;
+        }
+    }
+    return success;
+}
+
+int RtpSender::prepare_audio(int numChannels, int numSamples, float** data)
+{
+    // encode RTP packet straight into the preallocated datagram buffer (which is big enough for any payload type
+    // the rate control can choose, since it never goes above m_payloadType)
+    quint8 payloadType = (quint8)m_payloadTypeNext.fetchAndAddRelaxed(0);
+    int packetSize = RtpPacket::writeAudio(m_packetData.data(), m_packetData.size(), m_timestamp, m_sequenceNum, payloadType, m_ssrc, numChannels, numSamples, data);
     //qDebug() <<  "RtpSender::sendAudio timestamp = " << m_timestamp << " samples, sequence number = " << m_sequenceNum << endl;
 
     m_timestamp += numSamples;
     m_sequenceNum++;
+    if (packetSize < 0)
+    {
+        // more audio than the buffer was allocated for (can't reallocate on the audio thread)
+        m_sendErrors.fetchAndAddOrdered(1);
+        return -1;
+    }
 
-    // send RTP packet
-    m_packetData.clear();
-    m_packet.write(m_packetData);
-    if (m_socketRtp->writeDatagram(m_packetData, m_remoteHost, m_remotePortRtp) < 0)
+    // pick up any destination changes (the replaced list is deleted by the owning thread, so only swap once
+    // it has deleted the last one: otherwise that list would be overwritten and leak)
+    if (m_retiredDestinations.testAndSetOrdered(NULL, NULL))
     {
-        qWarning("RtpSender::sendAudio couldn't write datagram");
-        return false;
+        QVector<RtpDestination>* staged = m_stagedDestinations.fetchAndStoreOrdered(NULL);
+        if (staged)
+        {
+            m_destinations.swap(*staged);
+            m_retiredDestinations.fetchAndStoreOrdered(staged);
+        }
     }
     
     // check for sending RTCP report
     if (((m_timestamp - m_nextReportTick) & 0x80000000) == 0) // is offset >= m_timestampOffset with unsigned comparison
     {
-        QDateTime currentTime = QDateTime::currentDateTimeUtc();
-        qint64 currentTimeMillis = currentTime.toMSecsSinceEpoch();
-        quint32 currentTimeSecs = currentTimeMillis / 1000;
-        emit sendRtcpTick(currentTimeMillis, currentTimeSecs, m_timestamp, m_packetsSent, m_octetsSent);
+        // capture the report for the owning thread to send (if the last one hasn't been sent yet, skip this one)
+        if (m_rtcpTickPending.testAndSetOrdered(0, 0))
+        {
+            // m_timestamp is now the end of the buffer just captured, i.e. the media clock at this callback
+            timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            m_rtcpTick.monotonicNanos = (qint64)now.tv_sec * 1000000000 + now.tv_nsec;
+            m_rtcpTick.timestamp = m_timestamp;
+            m_rtcpTick.packetsSent = m_packetsSent;
+            m_rtcpTick.octetsSent = m_octetsSent;
+            m_rtcpTickPending.fetchAndStoreOrdered(1);
+        }
         m_nextReportTick += m_reportInterval;
     }
     
     m_packetsSent++;
-    m_octetsSent += m_packet.m_payload.length();
+    m_octetsSent += packetSize - RTP_HEADER_BYTES;
+
+    return packetSize;
+}
+
+bool RtpSender::addDestination(const QString& host, quint16 portRtp, quint16 portRtcp)
+{
+    RtpDestination dest;
+    if (!dest.host.setAddress(host))
+    {
+        QByteArray hostBytes = host.toLocal8Bit();
+        qWarning("RtpSender::addDestination invalid host address %s", hostBytes.constData());
+        return false;
+    }
+    dest.portRtp = portRtp;
+    dest.portRtcp = portRtcp;
+    if (!set_sockaddr(dest) || (dest.addr.ss_family == AF_INET6 && m_socket6 < 0))
+    {
+        QByteArray hostBytes = host.toLocal8Bit();
+        qWarning("RtpSender::addDestination unsupported host address %s", hostBytes.constData());
+        return false;
+    }
+
+    for (int i = 0; i < m_destinationsControl.size(); i++)
+    {
+        if (m_destinationsControl[i].host == dest.host && m_destinationsControl[i].portRtp == portRtp)
+        {
+            qWarning("RtpSender::addDestination already sending to port %u of this host", portRtp);
+            return false;
+        }
+    }
+
+    if (is_multicast(dest.host))
+    {
+        int ttl = MULTICAST_TTL;
+        int result = (dest.addr.ss_family == AF_INET6) ?
+                    setsockopt(m_socket6, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &ttl, sizeof(ttl)) :
+                    setsockopt(m_socket4, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        if (result < 0)
+        {
+            qWarning("RtpSender::addDestination couldn't set multicast TTL: %s", strerror(errno));
+        }
+    }
+
+    m_destinationsControl.append(dest);
+    stage_destinations();
+    m_rtcpHandler->addRemoteHost(dest.host, portRtcp);
+    return true;
+}
+
+int RtpSender::removeDestination(const QString& host)
+{
+    QHostAddress address(host);
+    int removed = 0;
+    for (int i = m_destinationsControl.size() - 1; i >= 0; i--)
+    {
+        if (m_destinationsControl[i].host == address)
+        {
+            m_destinationsControl.remove(i);
+            removed++;
+        }
+    }
+    if (removed > 0)
+    {
+        stage_destinations();
+    }
+    m_rtcpHandler->removeRemoteHost(address);
+    return removed;
+}
+
+void RtpSender::checkRtcpTick()
+{
+    if (m_rtcpTickPending.testAndSetOrdered(1, 1))
+    {
+        RtcpTick tick = m_rtcpTick;
+        m_rtcpTickPending.fetchAndStoreOrdered(0);
+
+        // the report goes out a little after the audio thread captured it, so advance the RTP timestamp by the
+        // time elapsed on the monotonic clock, and pair it with the wall clock read at the same moment
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        quint64 ntp = RtcpHandler::ntpNow();
+        qint64 elapsedNanos = (qint64)now.tv_sec * 1000000000 + now.tv_nsec - tick.monotonicNanos;
+        quint32 timestamp = tick.timestamp + (quint32)((elapsedNanos * m_sampleRate) / 1000000000);
+        emit sendRtcpTick((quint32)(ntp >> 32), (quint32)ntp, timestamp, tick.packetsSent, tick.octetsSent);
+    }
 
+    // free the destinations the audio thread replaced, so it can pick up the next change
+    delete m_retiredDestinations.fetchAndStoreOrdered(NULL);
+
+    int errors = m_sendErrors.fetchAndStoreOrdered(0);
+    if (errors > 0)
+    {
+        qWarning("RtpSender::sendAudio couldn't send %d datagram(s)", errors);
+    }
+
+    if (m_adaptivePayload)
+    {
+        adapt_payload();
+    }
+}
+
+void RtpSender::handleReceiverReport()
+{
+    RtcpReceiverSummary summary;
+    qint32 roundTripMicros = m_rtcpHandler->getReceiverSummary(summary) ? summary.maxRoundTripMicros : -1;
+    m_roundTripMicros.fetchAndStoreOrdered(roundTripMicros);
+}
+
+void RtpSender::setAdaptivePayload(bool enabled)
+{
+    m_adaptivePayload = enabled;
+    m_cleanReports = 0;
+    m_holdReports = 0;
+    if (!enabled && m_payloadTypeControl != m_payloadType)
+    {
+        set_payload_type(m_payloadType);
+    }
+}
+
+void RtpSender::adapt_payload()
+{
+    // act on each receiver report once (from the slowest receiver if there are several)
+    RtcpReceiverSummary summary;
+    if (!m_rtcpHandler->getReceiverSummary(summary)) return;
+    if (summary.minExtendedSeqNum == m_lastReportSeqNum) return;
+    m_lastReportSeqNum = summary.minExtendedSeqNum;
+
+    if (m_holdReports > 0)
+    {
+        m_holdReports--;
+        return;
+    }
+
+    // queues building up along the path show as a round-trip time above the lowest one seen, before packets are lost
+    qint64 queueingSamples = 0;
+    if (summary.maxRoundTripMicros >= 0)
+    {
+        if (m_minRoundTripMicros < 0 || summary.maxRoundTripMicros < m_minRoundTripMicros)
+        {
+            m_minRoundTripMicros = summary.maxRoundTripMicros;
+        }
+        queueingSamples = ((qint64)(summary.maxRoundTripMicros - m_minRoundTripMicros) * m_sampleRate) / 1000000;
+    }
+
+    // jitter is reported in timestamp units, i.e. samples
+    bool congested = summary.maxLossFraction >= LOSS_LOWER || summary.maxJitter >= (quint32)(JITTER_LOWER_PACKETS * m_bufferSize)
+                     || queueingSamples >= QUEUEING_LOWER_PACKETS * m_bufferSize;
+    bool clean = summary.maxLossFraction == 0 && summary.maxJitter < (quint32)(m_bufferSize / JITTER_CLEAN_DIVISOR)
+                 && queueingSamples < m_bufferSize / JITTER_CLEAN_DIVISOR;
+    if (congested)
+    {
+        m_cleanReports = 0;
+        if (m_payloadTypeControl > PAYLOAD_MIN)
+        {
+            qWarning("RtpSender::adapt_payload receivers report %.1f%% loss, jitter of %u samples and round-trip time of %d us: lowering payload type to %d",
+                     summary.maxLossFraction * 100.0f / 256.0f, summary.maxJitter, summary.maxRoundTripMicros, m_payloadTypeControl - 1);
+            set_payload_type(m_payloadTypeControl - 1);
+        }
+    }
+    else if (clean)
+    {
+        m_cleanReports++;
+        if (m_cleanReports >= CLEAN_REPORTS_TO_RAISE && m_payloadTypeControl < m_payloadType)
+        {
+            qDebug("RtpSender::adapt_payload network is clean again: raising payload type to %d", m_payloadTypeControl + 1);
+            set_payload_type(m_payloadTypeControl + 1);
+        }
+    }
+    else
+    {
+        m_cleanReports = 0;
+    }
+}
+
+void RtpSender::set_payload_type(quint8 payloadType)
+{
+    // the payload type goes in every packet header, so receivers decode each packet as whatever it is
+    m_payloadTypeControl = payloadType;
+    m_payloadTypeNext.fetchAndStoreOrdered(payloadType);
+    m_cleanReports = 0;
+    m_holdReports = HOLD_REPORTS;
+}
+
+void RtpSender::stage_destinations()
+{
+    // delete the list the audio thread replaced last time (it only retires a list after one has been staged)
+    delete m_retiredDestinations.fetchAndStoreOrdered(NULL);
+
+    // if the audio thread hasn't picked up the last staged list yet, replace it
+    delete m_stagedDestinations.fetchAndStoreOrdered(new QVector<RtpDestination>(m_destinationsControl));
+}
+
+bool RtpSender::set_sockaddr(RtpDestination& dest)
+{
+    memset(&dest.addr, 0, sizeof(dest.addr));
+    if (dest.host.protocol() == QAbstractSocket::IPv4Protocol)
+    {
+        sockaddr_in* addr = (sockaddr_in*)&dest.addr;
+        addr->sin_family = AF_INET;
+        addr->sin_port = htons(dest.portRtp);
+        addr->sin_addr.s_addr = htonl(dest.host.toIPv4Address());
+        dest.addrLen = sizeof(sockaddr_in);
+        return true;
+    }
+    else if (dest.host.protocol() == QAbstractSocket::IPv6Protocol)
+    {
+        sockaddr_in6* addr = (sockaddr_in6*)&dest.addr;
+        addr->sin6_family = AF_INET6;
+        addr->sin6_port = htons(dest.portRtp);
+        Q_IPV6ADDR ip6 = dest.host.toIPv6Address();
+        memcpy(&addr->sin6_addr, &ip6, sizeof(addr->sin6_addr));
+        dest.addrLen = sizeof(sockaddr_in6);
+        return true;
+    }
+    dest.addrLen = 0;
+    return false;
+}
+
+RtpSendBatch::RtpSendBatch(int maxDatagrams) :
+    m_maxDatagrams(maxDatagrams)
+{
+    const int families[2] = {AF_INET, AF_INET6};
+    for (int f = 0; f < 2; f++)
+    {
+        m_sockets[f] = open_socket(families[f]);
+        m_messages[f] = new RtpBatchMessage[m_maxDatagrams];
+        m_iovecs[f] = new iovec[m_maxDatagrams];
+        memset(m_messages[f], 0, m_maxDatagrams * sizeof(RtpBatchMessage));
+        m_counts[f] = 0;
+    }
+    if (m_sockets[0] < 0)
+    {
+        qWarning("RtpSendBatch::RtpSendBatch couldn't open RTP socket: %s", strerror(errno));
+    }
+
+    // destinations may include multicast groups
+    int ttl = MULTICAST_TTL;
+    if (m_sockets[0] >= 0) setsockopt(m_sockets[0], IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    if (m_sockets[1] >= 0) setsockopt(m_sockets[1], IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &ttl, sizeof(ttl));
+}
+
+RtpSendBatch::~RtpSendBatch()
+{
+    for (int f = 0; f < 2; f++)
+    {
+        if (m_sockets[f] >= 0) ::close(m_sockets[f]);
+        delete[] m_messages[f];
+        delete[] m_iovecs[f];
+    }
+}
+
+bool RtpSendBatch::add(const char* data, int size, const sockaddr_storage& addr, socklen_t addrLen)
+{
+    int f = (addr.ss_family == AF_INET6) ? 1 : 0;
+    if ((f == 0 && addr.ss_family != AF_INET) || m_sockets[f] < 0 || m_counts[f] >= m_maxDatagrams) return false;
+
+    int i = m_counts[f]++;
+    m_iovecs[f][i].iov_base = (void*)data;
+    m_iovecs[f][i].iov_len = size;
+    msghdr& hdr = m_messages[f][i].msg_hdr;
+    hdr.msg_name = (void*)&addr;
+    hdr.msg_namelen = addrLen;
+    hdr.msg_iov = &m_iovecs[f][i];
+    hdr.msg_iovlen = 1;
     return true;
 }
 
+int RtpSendBatch::send()
+{
+    return send_family(0) + send_family(1);
+}
+
+int RtpSendBatch::send_family(int family)
+{
+    int count = m_counts[family];
+    m_counts[family] = 0;
+    int failed = 0;
+
+#ifdef Q_OS_LINUX
+    int sent = 0;
+    while (sent < count)
+    {
+        int n = sendmmsg(m_sockets[family], m_messages[family] + sent, count - sent, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+
+            // the first remaining datagram couldn't be sent (e.g. the socket buffer is full): drop it and go on
+            failed++;
+            sent++;
+            continue;
+        }
+        sent += n;
+    }
+#else
+    for (int i = 0; i < count; i++)
+    {
+        if (sendmsg(m_sockets[family], &m_messages[family][i].msg_hdr, 0) < 0)
+        {
+            failed++;
+        }
+    }
+#endif
+    return failed;
+}
+
 } // end of namespace SAM
@@ -44,20 +44,130 @@
 #ifndef RTPSENDER_H
 #define RTPSENDER_H
 
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QVector>
+
 #include "../rtcp.h"
 #include "../rtp.h"
 
-class QUdpSocket;
+class QTimer;
 
 namespace sam
 {
 
+/**
+ * @struct RtpDestination
+ * An RtpDestination is a receiver (or multicast group of receivers) that an RtpSender sends to.
+ */
+struct RtpDestination
+{
+    QHostAddress host;  ///< receiver or multicast group address
+    quint16 portRtp;    ///< receiver RTP port
+    quint16 portRtcp;   ///< receiver RTCP port
+    sockaddr_storage addr;  ///< receiver RTP address, ready to pass to sendto
+    socklen_t addrLen;      ///< length of addr
+};
+
+/**
+ * @struct RtcpTick
+ * The state captured by the audio thread when an RTCP sender report is due.
+ */
+struct RtcpTick
+{
+    qint64 monotonicNanos;      ///< monotonic clock time when the report was due (in nanoseconds)
+    quint32 timestamp;          ///< RTP timestamp at that time
+    quint32 packetsSent;        ///< number of RTP packets sent so far
+    quint32 octetsSent;         ///< number of payload bytes sent so far
+};
+
+struct RtpBatchMessage;
+
+/**
+ * @class RtpSendBatch
+ * @author agent
+ * @date October 2026
+ *
+ * An RtpSendBatch collects datagrams encoded by any number of RtpSenders during one audio period so they can
+ * be sent together, with one sendmmsg call per address family on Linux (and a sendto per datagram elsewhere).
+ * All datagrams are sent from the batch's own non-blocking sockets.  The datagram data isn't copied, so it
+ * must stay unchanged until send() is called.  A batch is meant to be used only by the audio thread.
+ */
+class RtpSendBatch
+{
+public:
+    /**
+     * Constructor.
+     * @param maxDatagrams the maximum number of datagrams per batch
+     */
+    RtpSendBatch(int maxDatagrams);
+
+    /**
+     * Destructor.
+     */
+    ~RtpSendBatch();
+
+    /**
+     * Copy constructor (not used).
+     */
+    RtpSendBatch(const RtpSendBatch&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    RtpSendBatch& operator=(const RtpSendBatch&);
+
+    /**
+     * Check that the batch's sockets were opened.
+     * @return true if datagrams can be sent, false otherwise
+     */
+    bool isValid() const { return m_sockets[0] >= 0; }
+
+    /**
+     * Add a datagram to the batch.
+     * @param data the datagram data (not copied)
+     * @param size the size of the datagram in bytes
+     * @param addr the address to send to
+     * @param addrLen the length of addr
+     * @return true on success, false if the batch is full or the address family isn't supported
+     */
+    bool add(const char* data, int size, const sockaddr_storage& addr, socklen_t addrLen);
+
+    /**
+     * Send all datagrams in the batch and empty it.
+     * @return the number of datagrams that couldn't be sent
+     */
+    int send();
+
+protected:
+
+    /**
+     * Send the datagrams for one address family.
+     * @param family 0 for IPv4 or 1 for IPv6
+     * @return the number of datagrams that couldn't be sent
+     */
+    int send_family(int family);
+
+    int m_maxDatagrams;                 ///< capacity of each address family's message array
+    int m_sockets[2];                   ///< non-blocking UDP sockets for IPv4 and IPv6 (-1 if unavailable)
+    RtpBatchMessage* m_messages[2];     ///< messages waiting to be sent for IPv4 and IPv6
+    iovec* m_iovecs[2];                 ///< data pointers for the messages
+    int m_counts[2];                    ///< number of messages waiting for IPv4 and IPv6
+};
+
 /**
  * @class RtpSender
  * @author Michelle Daniels
  * @date 2012
  *
  * An RtpSender sends RTP packets to an RtpReceiver
+ *
+ * sendAudio is called from the audio thread and is real-time safe: it sends with non-blocking sendto
+ * on its own sockets, picks up destination changes without locking, and hands RTCP sender reports
+ * to the thread that owns the RtpSender instead of emitting signals itself.
  */
 class RtpSender : public QObject
 {
@@ -104,6 +214,7 @@ public:
     
     /**
      * Send the given audio buffer.
+     * Datagrams that can't be sent without blocking are dropped and reported later from the owning thread.
      * @param numChannels number of audio channels to send
      * @param numSamples number of samples to send (per channel)
      * @param data audio sample data in the form data[channel][sample]
@@ -111,36 +222,154 @@ public:
      */
     bool sendAudio(int numChannels, int numSamples, float** data);
 
+    /**
+     * Encode the given audio buffer and add it to a batch to be sent later, instead of sending it right away.
+     * The packet is encoded into this sender's datagram buffer, so the batch must be sent before this
+     * sender encodes its next packet.
+     * @param numChannels number of audio channels to send
+     * @param numSamples number of samples to send (per channel)
+     * @param data audio sample data in the form data[channel][sample]
+     * @param batch the batch to add this sender's datagrams to
+     * @return true on success, false on failure
+     */
+    bool queueAudio(int numChannels, int numSamples, float** data, RtpSendBatch& batch);
+
+    /**
+     * Send to another receiver (or multicast group) as well, e.g. a second SAM.
+     * Each packet is written once and sent to every destination.
+     * @param host the receiver's address (or a multicast group address)
+     * @param portRtp the receiver's RTP port
+     * @param portRtcp the receiver's RTCP port
+     * @return true on success, false on failure
+     */
+    bool addDestination(const QString& host, quint16 portRtp, quint16 portRtcp);
+
+    /**
+     * Stop sending to a receiver (or multicast group).
+     * @param host the receiver's address
+     * @return the number of destinations removed
+     */
+    int removeDestination(const QString& host);
+
+    /**
+     * Get a summary of the latest RTCP receiver reports from all destinations.
+     * @param summary the summary to fill in
+     * @return true if at least one receiver has reported recently, false otherwise
+     */
+    bool getReceiverSummary(RtcpReceiverSummary& summary) { return m_rtcpHandler->getReceiverSummary(summary); }
+
+    /**
+     * Adapt the payload type to the network: lower the bit depth a step at a time (e.g. 32-bit float to 24-bit
+     * to 16-bit) while receivers report loss, high jitter or a round-trip time well above the lowest seen, and raise
+     * it again, up to the payload type this sender was created with, once they have reported a clean network for a
+     * while.  Samples outside [-1.0, 1.0] are clipped when sent as 24-bit or 16-bit.
+     * @param enabled true to adapt the payload type, false to always send the payload type this sender was created with
+     */
+    void setAdaptivePayload(bool enabled);
+
+    /**
+     * Get the payload type currently being sent.
+     * @return the payload type
+     */
+    quint8 getPayloadType() const { return m_payloadTypeControl; }
+
+    /**
+     * Get the round-trip time to the receivers, measured from the sender report timestamps they echo back.
+     * Can be called from any thread.
+     * @return the worst round-trip time of the receivers that have reported recently (in microseconds), or -1 if unknown
+     */
+    qint32 getRoundTripMicros() { return m_roundTripMicros.fetchAndAddRelaxed(0); }
+
 signals:
     /**
      * Signal that a RTCP sender report is ready to be sent.
-     * @param currentTimeMillis millisecond part of current time
-     * @param currentTimeSecs second part of current time
-     * @param timestamp current RTP timestamp
+     * @param ntpSeconds seconds part of the NTP timestamp (seconds since 1900)
+     * @param ntpFraction fraction part of the NTP timestamp (in units of 1/2^32 seconds)
+     * @param timestamp RTP timestamp at the time given by the NTP timestamp
      * @param packetsSent number of RTP packets sent since sender started sending
      * @param octetsSent number of bytes sent since sender started sending
      */
-    void sendRtcpTick(qint64 currentTimeMillis, quint32 currentTimeSecs, quint32 timestamp, quint32 packetsSent, quint32 octetsSent);
+    void sendRtcpTick(quint32 ntpSeconds, quint32 ntpFraction, quint32 timestamp, quint32 packetsSent, quint32 octetsSent);
+
+protected slots:
+
+    /**
+     * Emit sendRtcpTick for a sender report captured by the audio thread, free destinations it replaced, and report send errors.
+     */
+    void checkRtcpTick();
+
+    /**
+     * Update the round-trip time when a receiver report is received.
+     */
+    void handleReceiverReport();
     
 protected:
 
-    QUdpSocket* m_socketRtp;    ///< UDP socket used to send packets
-    QHostAddress m_remoteHost;  ///< address of remote host (receiver)
-    quint16 m_remotePortRtp;    ///< RTP port for receiver
-    quint16 m_remotePortRtcp;   ///< RTCP port for receiver
+    /**
+     * Encode the next RTP packet into m_packetData and update the sequence number, timestamp,
+     * destinations and sender report state.
+     * @param numChannels number of audio channels to send
+     * @param numSamples number of samples to send (per channel)
+     * @param data audio sample data in the form data[channel][sample]
+     * @return the size of the packet in bytes, or -1 on failure
+     */
+    int prepare_audio(int numChannels, int numSamples, float** data);
+
+    /**
+     * Stage a copy of the current destinations for the audio thread to pick up at its next send.
+     */
+    void stage_destinations();
+
+    /**
+     * Act on the latest receiver reports, if there are new ones, by lowering or raising the payload type.
+     */
+    void adapt_payload();
+
+    /**
+     * Switch the payload type the audio thread sends.
+     * @param payloadType the new payload type
+     */
+    void set_payload_type(quint8 payloadType);
+
+    /**
+     * Fill in the socket address of a destination.
+     * @param dest the destination, with host and portRtp set
+     * @return true on success, false if the address family isn't supported
+     */
+    static bool set_sockaddr(RtpDestination& dest);
+
+    int m_socket4;              ///< non-blocking UDP socket used to send packets to IPv4 destinations
+    int m_socket6;              ///< non-blocking UDP socket used to send packets to IPv6 destinations (-1 if unavailable)
+    QVector<RtpDestination> m_destinations;         ///< receivers to send to, used only by the audio thread (the first is the SAM this sender registered with)
+    QVector<RtpDestination> m_destinationsControl;  ///< receivers to send to, as changed by addDestination and removeDestination
+    QAtomicPointer<QVector<RtpDestination> > m_stagedDestinations;  ///< new destinations waiting for the audio thread
+    QAtomicPointer<QVector<RtpDestination> > m_retiredDestinations; ///< destinations replaced by the audio thread, to be deleted by the owning thread
     qint32 m_sampleRate;        ///< audio sample rate
     quint32 m_ssrc;             ///< sender SSRC
-    quint8 m_payloadType;       ///< audio payload type
+    quint8 m_payloadType;       ///< audio payload type (the highest bit depth sent when adapting)
+    quint8 m_payloadTypeControl; ///< payload type chosen by the owning thread
+    QAtomicInt m_payloadTypeNext; ///< payload type for the audio thread to send
+    bool m_adaptivePayload;     ///< whether to adapt the payload type to receiver reports
+    quint32 m_lastReportSeqNum; ///< extended sequence number of the receiver report last acted on
+    qint32 m_minRoundTripMicros; ///< lowest round-trip time reported so far (-1 if none), the baseline for queueing delay
+    int m_cleanReports;         ///< number of consecutive receiver reports without loss or high jitter
+    int m_holdReports;          ///< number of receiver reports to ignore before acting again
+    int m_bufferSize;           ///< number of samples per packet
     quint32 m_timestamp;        ///< current packet timestamp
     quint16 m_sequenceNum;      ///< current packet sequence number
-    QByteArray m_packetData;    ///< bytes of RTP packet to be sent
-    RtpPacket m_packet;         ///< RTP packet to be sent
+    QByteArray m_packetData;    ///< preallocated buffer the RTP packet to be sent is encoded into
 
     quint32 m_reportInterval;   ///< milliseconds between RTCP sender reports
     quint32 m_nextReportTick;   ///< timestamp when next sender report should be sent (in milliseconds)
     
     quint32 m_packetsSent;      ///< total number of packets sent
     quint32 m_octetsSent;       ///< total number of bytes sent
+
+    RtcpTick m_rtcpTick;        ///< sender report captured by the audio thread
+    QAtomicInt m_rtcpTickPending;   ///< set by the audio thread when m_rtcpTick is ready, cleared once it has been emitted
+    QAtomicInt m_sendErrors;    ///< number of datagrams the audio thread couldn't send since the last check
+    QAtomicInt m_roundTripMicros; ///< worst round-trip time to the receivers (in microseconds, -1 if unknown)
+    QTimer* m_rtcpTimer;        ///< polls for sender reports captured by the audio thread
     
     RtcpHandler* m_rtcpHandler; ///< RTCP report handler
 };
@@ -42,6 +42,11 @@
  * MODIFICATIONS.
  */
 
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <QCoreApplication>
@@ -55,8 +60,8 @@ namespace sam
 static const int MAX_PORT_NAME = 64;
 static const int MAX_CMD_LEN = 64;
 
-static const int SLEEP_BUFFER_MILLIS = 2;
-static const int SHORT_SLEEP_MICROS = 500;
+static const qint64 NANOS_PER_SECOND = 1000000000LL;
+static const int LATE_CALLBACK_DIVISOR = 4; // a callback is late if it starts more than 1/LATE_CALLBACK_DIVISOR of a buffer after its deadline
 
 
 // ------------------- SacAudioInterface implementation -------------------
@@ -123,12 +128,15 @@ bool SacAudioInterface::setAudioCallback(AudioInterfaceCallback callback, void*
 
 VirtualAudioInterface::VirtualAudioInterface(unsigned int channels, unsigned int bufferSamples, unsigned int sampleRate) :
     SacAudioInterface(channels, bufferSamples, sampleRate),
-    m_audioInterval(0.0),
+    m_startNanos(0),
     m_nextAudioTick(0),
+    m_realtimePriority(0),
+    m_callbacks(0),
+    m_lateCallbacks(0),
+    m_maxLatenessNanos(0),
     m_shouldQuit(false)
 {
-    m_audioInterval = m_bufferSamples * 1000.0 / (double)m_sampleRate;
-    qDebug("VirtualAudioInterface::VirtualAudioInterface audio interval = %f", m_audioInterval);
+    qDebug("VirtualAudioInterface::VirtualAudioInterface audio interval = %f ms", m_bufferSamples * 1000.0 / (double)m_sampleRate);
 }
 
 VirtualAudioInterface::~VirtualAudioInterface()
@@ -138,32 +146,73 @@ VirtualAudioInterface::~VirtualAudioInterface()
 
 void VirtualAudioInterface::run()
 {
-    m_timer.start();
+    if (m_realtimePriority > 0)
+    {
+        sched_param param;
+        param.sched_priority = m_realtimePriority;
+        int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (result != 0)
+        {
+            qWarning("VirtualAudioInterface::run() couldn't use SCHED_FIFO priority %d: %s", m_realtimePriority, strerror(result));
+        }
+    }
+
+    qint64 lateNanos = tick_nanos(m_bufferSamples) / LATE_CALLBACK_DIVISOR;
+    m_startNanos = now_nanos();
+    m_nextAudioTick = 0;
     m_shouldQuit = false;
     while (!m_shouldQuit)
     {
+        // measure how late this callback is
+        qint64 lateness = now_nanos() - (m_startNanos + tick_nanos(m_nextAudioTick));
+        if (lateness > (qint64)m_maxLatenessNanos) m_maxLatenessNanos = lateness;
+        if (lateness > lateNanos) m_lateCallbacks++;
+        m_callbacks++;
+
         // call registered callback with NULL input data
         if (!m_audioCallback(m_channels, m_bufferSamples, NULL, NULL, m_audioCallbackArg))
         {
             qWarning("VirtualAudioInterface::run() error occurred calling registered audio callback");
         }
         
-        m_nextAudioTick += m_bufferSamples; // TODO: could this ever wrap around??
+        // sleep until the next tick (if running behind, callbacks are made back to back until caught up)
+        m_nextAudioTick += m_bufferSamples;
+        sleep_until(m_startNanos + tick_nanos(m_nextAudioTick));
+    }
 
-        // sleep for almost the full tick time
-        if (m_audioInterval > SLEEP_BUFFER_MILLIS) msleep(m_audioInterval - SLEEP_BUFFER_MILLIS);
+    qDebug("VirtualAudioInterface::run finished: %llu callbacks, %llu late, max lateness = %u us",
+           m_callbacks, m_lateCallbacks, getMaxLatenessMicros());
+}
 
-        // sleep in shorter intervals until tick time
-        while (true)
-        {
-            qint64 elapsedMillis = m_timer.elapsed();
-            quint64 elapsedSamples = (elapsedMillis * m_sampleRate) / 1000;
-            if (elapsedSamples >= m_nextAudioTick) break;
-            usleep(SHORT_SLEEP_MICROS);
-        }
-    }
+qint64 VirtualAudioInterface::tick_nanos(quint64 tick) const
+{
+    // split into whole seconds and a remainder so the multiplication can't overflow
+    return (qint64)(tick / m_sampleRate) * NANOS_PER_SECOND + (qint64)((tick % m_sampleRate) * NANOS_PER_SECOND / m_sampleRate);
+}
 
-    qDebug("VirtualAudioInterface::run finished");
+void VirtualAudioInterface::sleep_until(qint64 deadlineNanos)
+{
+#if defined __APPLE__
+    // no clock_nanosleep: sleep for the remaining time instead
+    qint64 remaining = deadlineNanos - now_nanos();
+    if (remaining <= 0) return;
+    timespec ts;
+    ts.tv_sec = remaining / NANOS_PER_SECOND;
+    ts.tv_nsec = remaining % NANOS_PER_SECOND;
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR && !m_shouldQuit) {}
+#else
+    timespec ts;
+    ts.tv_sec = deadlineNanos / NANOS_PER_SECOND;
+    ts.tv_nsec = deadlineNanos % NANOS_PER_SECOND;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !m_shouldQuit) {}
+#endif
+}
+
+qint64 VirtualAudioInterface::now_nanos()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (qint64)ts.tv_sec * NANOS_PER_SECOND + ts.tv_nsec;
 }
 
 bool VirtualAudioInterface::go()
@@ -190,11 +239,14 @@ bool VirtualAudioInterface::stop()
 JackAudioInterface::JackAudioInterface(unsigned int channels, unsigned int bufferSamples, unsigned int sampleRate, const char* clientName) :
         SacAudioInterface(channels, bufferSamples, sampleRate),
         m_client(NULL),
-        m_inputPorts(NULL)
+        m_inputPorts(NULL),
+        m_portBuffers(NULL)
 {
     int len = strlen(clientName) + 1;
     m_clientName = new char[len];
     strncpy(m_clientName, clientName, len); 
+
+    m_portBuffers = new float*[m_channels];
 }
 
 JackAudioInterface::~JackAudioInterface()
@@ -206,6 +258,11 @@ JackAudioInterface::~JackAudioInterface()
         delete[] m_clientName;
         m_clientName = NULL;
     }
+    if (m_portBuffers)
+    {
+        delete[] m_portBuffers;
+        m_portBuffers = NULL;
+    }
 }
 
 bool JackAudioInterface::go()
@@ -378,37 +435,41 @@ bool JackAudioInterface::setPhysicalInputs(unsigned int* inputChannels)
 
 int JackAudioInterface::process_audio(jack_nframes_t nframes)
 { 
-    // TODO: need error-checking to make sure nframes is not > buffer size?
-    
+    // the callback always processes m_bufferSamples frames, so if JACK's period doesn't match
+    // (e.g. after a buffer size change), the input is copied and zero-padded or truncated
+    bool copyInput = (nframes != m_bufferSamples);
+    unsigned int framesToCopy = (nframes < m_bufferSamples) ? nframes : m_bufferSamples;
     
     if (m_inputPorts)
     {
         // grab input audio if physical inputs enabled
+        // (the callback reads the JACK port buffers directly when the sizes match, so they aren't copied)
         for (unsigned int ch = 0; ch < m_channels; ch++)
         {
             jack_port_t* inPort = m_inputPorts[ch];
-            if (inPort)
+            jack_default_audio_sample_t* portBuffer = inPort ? (jack_default_audio_sample_t*) jack_port_get_buffer(inPort, nframes) : NULL;
+            if (portBuffer && !copyInput)
             {
-                jack_default_audio_sample_t* in = (jack_default_audio_sample_t*) jack_port_get_buffer(inPort, nframes);
-                for (unsigned int n = 0; n < nframes; n++)
-                {
-                    m_audioIn[ch][n] = in[n];
-                }
+                m_portBuffers[ch] = portBuffer;
+            }
+            else if (portBuffer)
+            {
+                memcpy(m_audioIn[ch], portBuffer, framesToCopy * sizeof(float));
+                memset(m_audioIn[ch] + framesToCopy, 0, (m_bufferSamples - framesToCopy) * sizeof(float));
+                m_portBuffers[ch] = m_audioIn[ch];
             }
             else
             {
                 qDebug("JackAudioInterface::process_audio input buffer was null!");
                 // use zeros if an error occurred
                 // TODO: handle this error differently??
-                for (unsigned int ch = 0; ch < m_channels; ch++)
-                {
-                    memset(m_audioIn[ch], 0, nframes * sizeof(float));
-                }
+                memset(m_audioIn[ch], 0, m_bufferSamples * sizeof(float));
+                m_portBuffers[ch] = m_audioIn[ch];
             }   
         }
         
         // call registered callback with input data
-        if (!m_audioCallback(m_channels, nframes, m_audioIn, NULL, m_audioCallbackArg))
+        if (!m_audioCallback(m_channels, m_bufferSamples, m_portBuffers, NULL, m_audioCallbackArg))
         {
             qDebug("JackAudioInterface::process_audio error occurred calling registered audio callback with input data");
         }
@@ -416,7 +477,7 @@ int JackAudioInterface::process_audio(jack_nframes_t nframes)
     else
     {
         // call registered callback with NULL input data
-        if (!m_audioCallback(m_channels, nframes, NULL, NULL, m_audioCallbackArg))
+        if (!m_audioCallback(m_channels, m_bufferSamples, NULL, NULL, m_audioCallbackArg))
         {
             qDebug("JackAudioInterface::process_audio error occurred calling registered audio callback");
         }
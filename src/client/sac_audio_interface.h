@@ -50,7 +50,6 @@
 #include <errno.h>
 #endif
 
-#include <QElapsedTimer>
 #include <QThread>
 
 namespace sam
@@ -145,6 +144,8 @@ protected:
  * @date 2012
  * 
  * This SacAudioInterface encapsulates a virtual sound card where an internal clock drives audio.
+ * Each callback is scheduled for an absolute deadline on the monotonic clock, computed in samples
+ * from when the interface started, so timing errors don't accumulate.
  */
 class VirtualAudioInterface : public SacAudioInterface, public QThread
 {
@@ -190,12 +191,61 @@ public:
      * Run the qthread.
      */
     virtual void run();
+
+    /**
+     * Run the interface thread with the SCHED_FIFO real-time scheduling policy.
+     * Must be called before go().  If the policy can't be set (e.g. without the needed privileges),
+     * a warning is printed and the thread runs with the default policy.
+     * @param priority the SCHED_FIFO priority (1-99), or 0 to use the default policy
+     */
+    void setRealtimePriority(int priority) { m_realtimePriority = priority; }
+
+    /**
+     * Get the number of callbacks made since the interface started.
+     * @return the number of callbacks
+     */
+    quint64 getCallbacks() const { return m_callbacks; }
+
+    /**
+     * Get the number of callbacks that started late by more than a quarter of a buffer.
+     * @return the number of late callbacks
+     */
+    quint64 getLateCallbacks() const { return m_lateCallbacks; }
+
+    /**
+     * Get the latest any callback has started after its deadline.
+     * @return the maximum lateness, in microseconds
+     */
+    quint32 getMaxLatenessMicros() const { return m_maxLatenessNanos / 1000; }
     
 protected:
+
+    /**
+     * Get the time of a clock tick.
+     * @param tick the tick time, in samples since the interface started
+     * @return the tick time on the monotonic clock, in nanoseconds
+     */
+    qint64 tick_nanos(quint64 tick) const;
+
+    /**
+     * Sleep until the given time on the monotonic clock.
+     * @param deadlineNanos the time to wake up, in nanoseconds
+     */
+    void sleep_until(qint64 deadlineNanos);
+
+    /**
+     * Get the current time on the monotonic clock.
+     * @return the current time, in nanoseconds
+     */
+    static qint64 now_nanos();
    
-    QElapsedTimer m_timer;      ///< virtual clock
-    double m_audioInterval;     ///< time between clock ticks, in milliseconds
+    qint64 m_startNanos;        ///< monotonic clock time when the interface started, in nanoseconds
     quint64 m_nextAudioTick;    ///< time of next clock tick, in samples
+    int m_realtimePriority;     ///< SCHED_FIFO priority of the interface thread (0 for the default policy)
+
+    volatile quint64 m_callbacks;       ///< number of callbacks made
+    volatile quint64 m_lateCallbacks;   ///< number of callbacks that started more than a quarter of a buffer late
+    volatile quint64 m_maxLatenessNanos;///< latest a callback has started after its deadline, in nanoseconds
     
     bool m_shouldQuit;          ///< flag: true if the interface thread should stop running
 };
@@ -356,6 +406,7 @@ protected:
     // for JACK
     jack_client_t* m_client;          ///< local JACK client
     jack_port_t** m_inputPorts;       ///< array of JACK input ports for this app
+    float** m_portBuffers;            ///< JACK input port buffers for the current period, passed to the audio callback without copying
     char* m_clientName;               ///< JACK client name
    
 };
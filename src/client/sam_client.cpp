@@ -52,12 +52,45 @@
 #include "sac_audio_interface.h"
 #include "sam_client.h"
 #include "../sam_shared.h"
+#include "../shared_audio_ring.h"
 
 namespace sam
 {
 
 static const int MAX_CLIENT_NAME = 64;
 static const quint32 REPORT_INTERVAL_MILLIS = 1000;
+static const int FAILOVER_CONNECT_MILLIS = 1000; // how long to wait to connect to the standby SAM
+
+// OSC method ids for m_oscDispatcher
+static const int OSC_REGCONFIRM = 0;
+static const int OSC_REGDENY = 1;
+static const int OSC_TYPE_CONFIRM = 2;
+static const int OSC_TYPE_DENY = 3;
+static const int OSC_VAL_MUTE = 4;
+static const int OSC_VAL_SOLO = 5;
+static const int OSC_VAL_TYPE = 6;
+
+/**
+ * Find the value for one app in a /sam/val message of repeated (id, value) int pairs
+ * (a single pair, or the array form SAM sends after a bulk set).
+ * @param msg the /sam/val message
+ * @param id the app id to look for
+ * @param value set to the value for id, if found
+ * @return true if the message contained a value for id
+ */
+static bool find_app_value(OscMessage* msg, int id, int& value)
+{
+    OscArg arg;
+    for (int i = 0; i + 1 < msg->getNumArgs(); i += 2)
+    {
+        msg->getArg(i, arg);
+        if (arg.val.i != id) continue;
+        msg->getArg(i + 1, arg);
+        value = arg.val.i;
+        return true;
+    }
+    return false;
+}
 
 StreamingAudioClient::StreamingAudioClient() :
     QObject(),
@@ -72,6 +105,12 @@ StreamingAudioClient::StreamingAudioClient() :
     m_samPort(0),
     m_payloadType(PAYLOAD_PCM_16),
     m_packetQueueSize(-1),
+    m_realtimePriority(0),
+    m_sharedMemory(true),
+    m_adaptivePayload(false),
+    m_standbyIP(NULL),
+    m_standbyPort(0),
+    m_failingOver(false),
     m_replyIP(NULL),
     m_replyPort(0),
     m_responseReceived(false),
@@ -79,6 +118,9 @@ StreamingAudioClient::StreamingAudioClient() :
     m_driveExternally(false),
     m_interface(NULL),
     m_sender(NULL),
+    m_ring(NULL),
+    m_ringActive(0),
+    m_ringOnly(false),
     m_audioCallback(NULL),
     m_audioCallbackArg(NULL),
     m_audioOut(NULL),
@@ -89,6 +131,14 @@ StreamingAudioClient::StreamingAudioClient() :
     m_disconnectCallback(NULL),
     m_disconnectCallbackArg(NULL)
 {
+    m_oscDispatcher.addMethod("/sam/app/regconfirm", "iiii", OSC_REGCONFIRM);
+    m_oscDispatcher.addMethod("/sam/app/regconfirm", "iiiis", OSC_REGCONFIRM);
+    m_oscDispatcher.addMethod("/sam/app/regdeny", "i", OSC_REGDENY);
+    m_oscDispatcher.addMethod("/sam/type/confirm", "iii", OSC_TYPE_CONFIRM);
+    m_oscDispatcher.addMethod("/sam/type/deny", "iiii", OSC_TYPE_DENY);
+    m_oscDispatcher.addMethod("/sam/val/mute", "ii+", OSC_VAL_MUTE);
+    m_oscDispatcher.addMethod("/sam/val/solo", "ii+", OSC_VAL_SOLO);
+    m_oscDispatcher.addMethod("/sam/val/type", "iii", OSC_VAL_TYPE);
 }
 
 StreamingAudioClient::~StreamingAudioClient()
@@ -134,6 +184,12 @@ StreamingAudioClient::~StreamingAudioClient()
         delete m_sender;
         m_sender = NULL;
     }
+
+    if (m_ring)
+    {
+        delete m_ring; // detaches from SAM's ring
+        m_ring = NULL;
+    }
     
     if (m_audioOut)
     {
@@ -166,6 +222,12 @@ StreamingAudioClient::~StreamingAudioClient()
         delete[] m_replyIP;
         m_replyIP = NULL;
     }
+
+    if (m_standbyIP)
+    {
+        delete[] m_standbyIP;
+        m_standbyIP = NULL;
+    }
 }
 
 int StreamingAudioClient::init(const SacParams& params)
@@ -173,6 +235,9 @@ int StreamingAudioClient::init(const SacParams& params)
     // init params that are not initialized in original init()
     m_preset = params.preset;
     m_packetQueueSize = params.packetQueueSize;
+    m_realtimePriority = params.realtimePriority;
+    m_sharedMemory = params.sharedMemory;
+    m_adaptivePayload = params.adaptivePayload;
 
     // copy reply IP address
     if (params.replyIP)
@@ -187,6 +252,20 @@ int StreamingAudioClient::init(const SacParams& params)
         strncpy(m_replyIP, params.replyIP, len + 1);
     }
 
+    // copy standby IP address
+    if (params.standbyIP)
+    {
+        if (m_standbyIP)
+        {
+            delete[] m_standbyIP;
+            m_standbyIP = NULL;
+        }
+        size_t len = strlen(params.standbyIP);
+        m_standbyIP = new char[len + 1];
+        strncpy(m_standbyIP, params.standbyIP, len + 1);
+        m_standbyPort = params.standbyPort;
+    }
+
     // init everything else with original init()
     return init(params.numChannels,
                 params.type,
@@ -296,7 +375,7 @@ int StreamingAudioClient::start(int x, int y, int width, int height, int depth,
     connect(&m_socket, SIGNAL(disconnected()), this, SLOT(samDisconnected()));
     
     OscMessage msg;
-    msg.init("/sam/app/register", "siiiiiiiiiiiiii", m_name, m_channels,
+    msg.init("/sam/app/register", "siiiiiiiiiiiiiii", m_name, m_channels,
                                                        x,
                                                        y,
                                                        width,
@@ -309,7 +388,8 @@ int StreamingAudioClient::start(int x, int y, int width, int height, int depth,
                                                        VERSION_MAJOR,
                                                        VERSION_MINOR,
                                                        VERSION_PATCH,
-                                                       m_replyPort);
+                                                       m_replyPort,
+                                                       m_sharedMemory ? 1 : 0); // request shared memory if SAM is on this host
     if (!OscClient::sendFromSocket(&msg, &m_socket))
     {
         qWarning("StreamingAudioClient::start() Couldn't send OSC message");
@@ -501,6 +581,45 @@ int StreamingAudioClient::setDisconnectCallback(SACDisconnectCallback callback,
     return SAC_SUCCESS;
 }
 
+int StreamingAudioClient::addRtpDestination(const char* host, quint16 portRtp, quint16 portRtcp)
+{
+    if (m_port < 0 || !m_sender) return SAC_NOT_REGISTERED;
+    if (!m_sender->addDestination(QString(host), portRtp, portRtcp))
+    {
+        return SAC_ERROR;
+    }
+    return SAC_SUCCESS;
+}
+
+int StreamingAudioClient::removeRtpDestination(const char* host)
+{
+    if (m_port < 0 || !m_sender) return SAC_NOT_REGISTERED;
+    if (m_sender->removeDestination(QString(host)) == 0)
+    {
+        return SAC_ERROR;
+    }
+    return SAC_SUCCESS;
+}
+
+float StreamingAudioClient::getLatency()
+{
+    if (m_port < 0 || !m_sender || m_sampleRate == 0) return 0.0f;
+
+    float latency = m_bufferSize / (float)m_sampleRate;
+    qint32 roundTripMicros = m_sender->getRoundTripMicros();
+    if (roundTripMicros > 0)
+    {
+        latency += roundTripMicros / 2000000.0f;
+    }
+    return latency;
+}
+
+int StreamingAudioClient::getRoundTripMicros()
+{
+    if (m_port < 0 || !m_sender) return -1;
+    return m_sender->getRoundTripMicros();
+}
+
 int StreamingAudioClient::setPhysicalInputs(unsigned int* inputChannels)
 {
     if (m_port < 0) return SAC_NOT_REGISTERED;
@@ -519,6 +638,14 @@ int StreamingAudioClient::setPhysicalInputs(unsigned int* inputChannels)
 void StreamingAudioClient::samDisconnected()
 {
     qWarning("StreamingAudioClient SAM was disconnected");
+
+    // try the standby SAM before giving up (only once)
+    if (m_port >= 0 && m_standbyIP && !m_failingOver)
+    {
+        if (fail_over()) return;
+    }
+    m_failingOver = false;
+
     if (m_disconnectCallback)
     {
         m_disconnectCallback(m_disconnectCallbackArg);
@@ -527,186 +654,161 @@ void StreamingAudioClient::samDisconnected()
 
 void StreamingAudioClient::handleOscMessage(OscMessage* msg, const char* sender, QAbstractSocket* socket)
 {
-    // check prefix
-    int prefixLen = 5; // prefix is "/sam/"
-    const char* address = msg->getAddress();
-    qDebug("address = %s", address);
-    if (qstrncmp(address, "/sam/", prefixLen) != 0)
+    qDebug("address = %s", msg->getAddress());
+    QVector<int> methods = m_oscDispatcher.match(msg);
+    if (methods.isEmpty())
     {
         printf("Unknown OSC message:\n");
         msg->print();
-        delete msg;
-        return;
     }
 
-    // check second level of address
-    if (qstrncmp(address + prefixLen, "app", 3) == 0)
+    for (int i = 0; i < methods.size(); i++)
     {
-        // check third level of address
-        if (qstrcmp(address + prefixLen + 3, "/regconfirm") == 0) // /sam/app/regconfirm
+        switch (methods[i])
         {
-            if (msg->typeMatches("iiii"))
-            {
-                OscArg arg;
-                msg->getArg(0, arg);
-                int port = arg.val.i;
-                msg->getArg(1, arg);
-                int sampleRate = arg.val.i;
-                msg->getArg(2, arg);
-                int bufferSize = arg.val.i;
-                msg->getArg(3, arg);
-                int rtpPort  = arg.val.i;
-                qDebug("Received regconfirm from SAM, id = %d, sample rate = %d, buffer size = %d, base RTP port = %d", port, sampleRate, bufferSize, rtpPort);
-                handle_regconfirm(port, sampleRate, bufferSize, (quint16)rtpPort);
-            }
-            else
-            {
-                printf("Unknown OSC message:\n");
-                msg->print();
-            }
-        }
-        else if (qstrcmp(address + prefixLen + 3, "/regdeny") == 0) // /sam/app/regdeny)
+        case OSC_REGCONFIRM: // /sam/app/regconfirm
         {
-            if (msg->typeMatches("i"))
+            OscArg arg;
+            msg->getArg(0, arg);
+            int port = arg.val.i;
+            msg->getArg(1, arg);
+            int sampleRate = arg.val.i;
+            msg->getArg(2, arg);
+            int bufferSize = arg.val.i;
+            msg->getArg(3, arg);
+            int rtpPort  = arg.val.i;
+            const char* ringName = NULL;
+            if (msg->getNumArgs() > 4)
             {
-                OscArg arg;
-                msg->getArg(0, arg);
-                int errorCode = arg.val.i;
-                qWarning("SAM registration DENIED: error code = %d", errorCode);
-                handle_regdeny(errorCode);
+                msg->getArg(4, arg);
+                ringName = arg.val.s;
             }
-            else
-            {
-                printf("Unknown OSC message:\n");
-                msg->print();
-            }
-        }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
+            qDebug("Received regconfirm from SAM, id = %d, sample rate = %d, buffer size = %d, base RTP port = %d", port, sampleRate, bufferSize, rtpPort);
+            handle_regconfirm(port, sampleRate, bufferSize, (quint16)rtpPort, ringName);
+            break;
         }
-    }
-    else if (qstrncmp(address + prefixLen, "type", 4) == 0)
-    {
-        // check third level of address
-        if (qstrcmp(address + prefixLen + 4, "/confirm") == 0) // /sam/type/confirm
+
+        case OSC_REGDENY: // /sam/app/regdeny
         {
-            if (msg->typeMatches("iii"))
-            {
-                OscArg arg;
-                msg->getArg(1, arg);
-                int type = arg.val.i; // for now ignore arg 0 (id)
-                msg->getArg(2, arg);
-                int preset = arg.val.i;
-                qDebug("Received typeconfirm from SAM, type = %d, preset = %d", type, preset);
-                handle_typeconfirm(type, preset);
-            }
-            else
-            {
-                printf("Unknown OSC message:\n");
-                msg->print();
-            }
+            OscArg arg;
+            msg->getArg(0, arg);
+            int errorCode = arg.val.i;
+            qWarning("SAM registration DENIED: error code = %d", errorCode);
+            handle_regdeny(errorCode);
+            break;
         }
-        else if (qstrcmp(address + prefixLen + 4, "/deny") == 0) // /sam/type/deny
+
+        case OSC_TYPE_CONFIRM: // /sam/type/confirm
         {
-            if (msg->typeMatches("iiii"))
-            {
-                OscArg arg;
-                msg->getArg(3, arg);
-                int errorCode = arg.val.i; // for now ignore args 0 and 1 (id, type, and preset)
-                qDebug("Type change DENIED, error code = %d", errorCode);
-                handle_typedeny(errorCode);
-            }
-            else
-            {
-                printf("Unknown OSC message:\n");
-                msg->print();
-            }
+            OscArg arg;
+            msg->getArg(1, arg);
+            int type = arg.val.i; // for now ignore arg 0 (id)
+            msg->getArg(2, arg);
+            int preset = arg.val.i;
+            qDebug("Received typeconfirm from SAM, type = %d, preset = %d", type, preset);
+            handle_typeconfirm(type, preset);
+            break;
         }
-        else
+
+        case OSC_TYPE_DENY: // /sam/type/deny
         {
-            printf("Unknown OSC message:\n");
-            msg->print();
+            OscArg arg;
+            msg->getArg(3, arg);
+            int errorCode = arg.val.i; // for now ignore args 0 and 1 (id, type, and preset)
+            qDebug("Type change DENIED, error code = %d", errorCode);
+            handle_typedeny(errorCode);
+            break;
         }
-    }
-    else if (qstrncmp(address + prefixLen, "val", 3) == 0)
-    {
-        // check third level of address
-        if (qstrcmp(address + prefixLen + 3, "/mute") == 0) // /sam/val/mute
+
+        case OSC_VAL_MUTE: // /sam/val/mute
         {
-            if (msg->typeMatches("ii"))
-            {
-                OscArg arg;
-                msg->getArg(1, arg);
-                int mute = arg.val.i; // for now ignore arg 0 (id)
-                qDebug("Received message from SAM that client mute status is %d", mute);
-                // call mute callback
-                if (m_muteCallback)
-                {
-                    m_muteCallback(mute, m_muteCallbackArg);
-                }
-            }
-            else
+            int mute = 0;
+            if (!find_app_value(msg, m_port, mute)) break;
+            qDebug("Received message from SAM that client mute status is %d", mute);
+            // call mute callback
+            if (m_muteCallback)
             {
-                printf("Unknown OSC message:\n");
-                msg->print();
+                m_muteCallback(mute, m_muteCallbackArg);
             }
+            break;
         }
-        else if (qstrcmp(address + prefixLen + 3, "/solo") == 0) // /sam/val/solo
+
+        case OSC_VAL_SOLO: // /sam/val/solo
         {
-            if (msg->typeMatches("ii"))
+            int solo = 0;
+            if (!find_app_value(msg, m_port, solo)) break;
+            qDebug("Received message from SAM that client solo status is %d", solo);
+            // call solo callback
+            if (m_soloCallback)
             {
-                OscArg arg;
-                msg->getArg(1, arg);
-                int solo = arg.val.i; // for now ignore arg 0 (id)
-                qDebug("Received message from SAM that client solo status is %d", solo);
-                // call solo callback
-                if (m_soloCallback)
-                {
-                    m_soloCallback(solo, m_soloCallbackArg);
-                }
-            }
-            else
-            {
-                printf("Unknown OSC message:\n");
-                msg->print();
+                m_soloCallback(solo, m_soloCallbackArg);
             }
+            break;
         }
-        else if (qstrcmp(address + prefixLen + 3, "/type") == 0) // /sam/val/type
+
+        case OSC_VAL_TYPE: // /sam/val/type
         {
-            if (msg->typeMatches("iii"))
-            {
-                OscArg arg;
-                msg->getArg(1, arg);
-                int type = arg.val.i; // for now ignore arg 0 (id)
-                msg->getArg(2, arg);
-                int preset = arg.val.i;
-                qDebug("Received message from SAM that client type is %d, preset is %d", type, preset);
-                // TODO: call type callback
-            }
-            else
-            {
-                printf("Unknown OSC message:\n");
-                msg->print();
-            }
+            OscArg arg;
+            msg->getArg(1, arg);
+            int type = arg.val.i; // for now ignore arg 0 (id)
+            msg->getArg(2, arg);
+            int preset = arg.val.i;
+            qDebug("Received message from SAM that client type is %d, preset is %d", type, preset);
+            // TODO: call type callback
+            break;
         }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
         }
     }
-    else
+    delete msg;
+}
+
+bool StreamingAudioClient::fail_over()
+{
+    printf("Failing over to standby SAM at IP %s, port %d\n", m_standbyIP, m_standbyPort);
+    m_failingOver = true;
+
+    // start the new connection from a clean slate
+    m_socket.abort();
+    m_oscReader->reset();
+
+    QString standbyIPStr(m_standbyIP);
+    m_socket.connectToHost(standbyIPStr, m_standbyPort);
+    if (!m_socket.waitForConnected(FAILOVER_CONNECT_MILLIS))
     {
-        printf("Unknown OSC message:\n");
-        msg->print();
+        qWarning("StreamingAudioClient::fail_over couldn't connect to standby SAM");
+        m_failingOver = false;
+        return false;
     }
-    delete msg;
+    m_replyPort = m_socket.localPort();
+
+    OscMessage msg;
+    msg.init("/sam/app/resume", "iiiii", m_port, VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH, m_replyPort);
+    if (!OscClient::sendFromSocket(&msg, &m_socket))
+    {
+        qWarning("StreamingAudioClient::fail_over Couldn't send OSC message");
+        m_failingOver = false;
+        return false;
+    }
+    return true;
 }
 
-void StreamingAudioClient::handle_regconfirm(int port, unsigned int sampleRate, unsigned int bufferSize, quint16 rtpBasePort)
+void StreamingAudioClient::handle_regconfirm(int port, unsigned int sampleRate, unsigned int bufferSize, quint16 rtpBasePort, const char* ringName)
 {
+    if (m_failingOver)
+    {
+        // the standby SAM has resumed our stream and is now the only SAM: stop sending to the old primary
+        // (the ring stays mapped until the audio interface has stopped, in case the audio thread is writing to it)
+        printf("StreamingAudioClient resumed on standby SAM: unique id = %d\n", port);
+        m_ringActive.fetchAndStoreOrdered(0);
+        m_sender->removeDestination(QString(m_samIP));
+        delete[] m_samIP;
+        m_samIP = m_standbyIP;
+        m_samPort = m_standbyPort;
+        m_standbyIP = NULL;
+        m_failingOver = false;
+        return;
+    }
+
     printf("StreamingAudioClient registration confirmed: unique id = %d, rtpBasePort = %d", port, rtpBasePort);
 
     m_bufferSize = bufferSize;
@@ -727,6 +829,32 @@ void StreamingAudioClient::handle_regconfirm(int port, unsigned int sampleRate,
         }
         return;
     }
+    m_sender->setAdaptivePayload(m_adaptivePayload);
+
+    // also stream to the standby SAM (which mirrors our registration on the same RTP ports)
+    if (m_standbyIP && !m_sender->addDestination(QString(m_standbyIP), portOffset + rtpBasePort, portOffset + rtpBasePort + 1))
+    {
+        qWarning("StreamingAudioClient::handle_regconfirm couldn't stream to standby SAM at %s", m_standbyIP);
+    }
+
+    // SAM is on this host: hand it the audio through shared memory instead of RTP
+    if (ringName)
+    {
+        m_ring = new SharedAudioRing();
+        if (m_ring->attach(ringName, m_channels, sampleRate))
+        {
+            printf(", using shared memory %s", ringName);
+            m_sender->removeDestination(QString(m_samIP));
+            m_ringOnly = (m_standbyIP == NULL);
+            m_ringActive.fetchAndStoreOrdered(1);
+        }
+        else
+        {
+            qWarning("StreamingAudioClient::handle_regconfirm couldn't attach to shared memory: using RTP");
+            delete m_ring;
+            m_ring = NULL;
+        }
+    }
     
     // allocate audio buffer
     m_audioOut = new float*[m_channels];
@@ -739,7 +867,9 @@ void StreamingAudioClient::handle_regconfirm(int port, unsigned int sampleRate,
     if (!m_driveExternally)
     {
 #ifdef SAC_NO_JACK
-        m_interface = new VirtualAudioInterface(m_channels, bufferSize, sampleRate);
+        VirtualAudioInterface* virtualInterface = new VirtualAudioInterface(m_channels, bufferSize, sampleRate);
+        virtualInterface->setRealtimePriority(m_realtimePriority);
+        m_interface = virtualInterface;
 #else
         // write the JACK client name
         char clientName[MAX_CLIENT_NAME];
@@ -772,6 +902,17 @@ void StreamingAudioClient::handle_regconfirm(int port, unsigned int sampleRate,
 void StreamingAudioClient::handle_regdeny(int errorCode)
 {
     qWarning("SAM registration DENIED: error = %d", errorCode);
+
+    if (m_failingOver)
+    {
+        // the standby couldn't resume our stream
+        m_failingOver = false;
+        if (m_disconnectCallback)
+        {
+            m_disconnectCallback(m_disconnectCallbackArg);
+        }
+        return;
+    }
    
     // check to see if we timed out
     // TODO: what if we tried re-registering after a time-out, and then received a regconfirm/regdeny??
@@ -799,6 +940,43 @@ void StreamingAudioClient::handle_typedeny(int errorCode)
 
 int StreamingAudioClient::sendAudio(float** in)
 { 
+    float** audio = get_audio(in);
+
+    // write to SAM's shared-memory ring if SAM is on this host
+    bool success = true;
+    if (m_ring && m_ringActive.testAndSetOrdered(1, 1))
+    {
+        success = m_ring->write(audio, m_channels, m_bufferSize);
+        if (m_ringOnly) return success ? SAC_SUCCESS : SAC_ERROR;
+    }
+
+    // send audio data
+    if (m_sender->sendAudio(m_channels, m_bufferSize, audio) && success)
+    {
+        return SAC_SUCCESS;
+    }
+    else
+    {
+        return SAC_ERROR;
+    }
+}
+
+int StreamingAudioClient::queueAudio(float** in, RtpSendBatch& batch)
+{
+    if (!m_sender) return SAC_NOT_REGISTERED;
+    float** audio = get_audio(in);
+
+    bool success = true;
+    if (m_ring && m_ringActive.testAndSetOrdered(1, 1))
+    {
+        success = m_ring->write(audio, m_channels, m_bufferSize);
+        if (m_ringOnly) return success ? SAC_SUCCESS : SAC_ERROR;
+    }
+    return (m_sender->queueAudio(m_channels, m_bufferSize, audio, batch) && success) ? SAC_SUCCESS : SAC_ERROR;
+}
+
+float** StreamingAudioClient::get_audio(float** in)
+{
     if (m_audioCallback)
     {
         // call audio callback function if registered
@@ -815,15 +993,10 @@ int StreamingAudioClient::sendAudio(float** in)
     }
     else if (in)
     {
-        // otherwise grab input audio if physical inputs enabled (or SAC is driven externally)
-        for (unsigned int ch = 0; ch < m_channels; ch++)
-        {
-            // TODO: check that in[ch] is non-NULL?
-            for (unsigned int n = 0; n < m_bufferSize; n++)
-            {
-                m_audioOut[ch][n] = in[ch][n];
-            }
-        }
+        // otherwise send input audio if physical inputs enabled (or SAC is driven externally),
+        // encoding it straight from the caller's buffers
+        // TODO: check that in[ch] is non-NULL?
+        return in;
     }
     else
     {
@@ -833,22 +1006,16 @@ int StreamingAudioClient::sendAudio(float** in)
             memset(m_audioOut[ch], 0, m_bufferSize * sizeof (float));
         }
     }
-
-    // send audio data
-    if (m_sender->sendAudio(m_channels, m_bufferSize, m_audioOut))
-    {
-        return SAC_SUCCESS;
-    }
-    else
-    {
-        return SAC_ERROR;
-    }
+    return m_audioOut;
 }
 
 bool StreamingAudioClient::interface_callback(unsigned int nchannels, unsigned int nframes, float** in, float** out, void* sac)
 {
-    // TODO: nchannels should match m_channels and nframes should match m_bufferSize
-    return ((StreamingAudioClient*)sac)->sendAudio(in);
+    StreamingAudioClient* client = (StreamingAudioClient*)sac;
+
+    // sendAudio sends m_bufferSize frames of m_channels channels
+    if (nchannels != client->m_channels || nframes != client->m_bufferSize) return false;
+    return client->sendAudio(in) == SAC_SUCCESS;
 }
 
 } // end of namespace sam
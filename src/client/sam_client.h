@@ -45,8 +45,10 @@
 #ifndef SAM_CLIENT_H
 #define	SAM_CLIENT_H
 
+#include <QAtomicInt>
 #include <QObject>
 #include <QTcpSocket>
+#include "../osc.h" // for OscDispatcher
 #include "../rtp.h" // for PAYLOAD_PCM_16
 #include "../sam_shared.h"
 
@@ -91,7 +93,12 @@ struct SacParams
         replyPort(0),
         payloadType(PAYLOAD_PCM_16),
         driveExternally(false),
-        packetQueueSize(-1)
+        packetQueueSize(-1),
+        standbyIP(NULL),
+        standbyPort(0),
+        realtimePriority(0),
+        sharedMemory(true),
+        adaptivePayload(false)
     {}
 
     unsigned int numChannels;   ///< number of channels of audio to send to SAM
@@ -105,6 +112,11 @@ struct SacParams
     quint8 payloadType;         ///< RTP payload type (16, 24, or 32-bit PCM)
     bool driveExternally;       ///< whether audio sending will be driven by external clock
     int packetQueueSize;        ///< number of packets that will be queued on SAM's end before playback, or -1 to use SAM's internal default
+    const char* standbyIP;      ///< IP address of a standby SAM to fail over to, or NULL for none
+    quint16 standbyPort;        ///< Port on which the standby SAM receives OSC messages
+    int realtimePriority;       ///< SCHED_FIFO priority of SAC's own audio thread when built without JACK (or 0 for the default policy)
+    bool sharedMemory;          ///< whether to send audio through shared memory instead of RTP when SAM is on the same host
+    bool adaptivePayload;       ///< whether to lower the bit depth below payloadType while SAM reports loss or high jitter
 };
 
 /**
@@ -151,8 +163,10 @@ typedef void(*SACDisconnectCallback)(void* arg);
 
 class OscMessage;
 class OscTcpSocketReader;
+class RtpSendBatch;
 class RtpSender;
 class SacAudioInterface;
+class SharedAudioRing;
 
 /**
  * @class StreamingAudioClient
@@ -243,6 +257,16 @@ public:
      */
     int sendAudio(float** in);
 
+    /**
+     * Encode audio for SAM and add it to a batch of datagrams to be sent later.
+     * Like sendAudio, but used when one thread drives many clients (see StreamingAudioClientGroup).
+     * If SAM is on the same host the audio goes through shared memory instead, as for sendAudio.
+     * @param in a buffer of input audio samples to send (NULL if no input), as for sendAudio
+     * @param batch the batch to add this client's datagrams to
+     * @return 0 on success, a non-zero ::SACReturn code on failure
+     */
+    int queueAudio(float** in, RtpSendBatch& batch);
+
     /**
      * Get the buffer size that should be used when driving audio sending from outside SAC.
      * This can only be called after start() has returned successfully.
@@ -380,13 +404,41 @@ public:
      * @return 0 on success, a non-zero ::SACReturn code on failure
      */
     int setPhysicalInputs(unsigned int* inputChannels);
+
+    /**
+     * Also stream this client's audio to another receiver, e.g. a second SAM for redundancy or another room.
+     * The audio is only encoded once, and each packet is sent to every destination.  The host may be a
+     * multicast group joined by several SAMs (see RtpMulticastGroup in sam.conf).
+     * NOTE: this method must be called AFTER registering otherwise it will fail.  The receiving SAM must
+     * already expect a stream on the given port (e.g. an app registered there with a matching id).
+     * @param host IP address of the receiver or multicast group
+     * @param portRtp the receiver's RTP port
+     * @param portRtcp the receiver's RTCP port
+     * @return 0 on success, a non-zero ::SACReturn code on failure
+     */
+    int addRtpDestination(const char* host, quint16 portRtp, quint16 portRtcp);
+
+    /**
+     * Stop streaming this client's audio to a receiver.
+     * @param host IP address of the receiver or multicast group
+     * @return 0 on success, a non-zero ::SACReturn code on failure
+     */
+    int removeRtpDestination(const char* host);
             
-    /** 
-     * Get audio latency (in sec?)
-     * TODO: not yet implemented
-     * @return the estimated audio latency
+    /**
+     * Get the estimated one-way latency from this client's audio to SAM receiving it: one buffer of audio
+     * plus half the round-trip time measured with RTCP (once SAM has echoed a sender report, a few seconds
+     * after registering).  SAM's own playout buffering is not included.
+     * @return the estimated latency in seconds, or 0 if not registered
+     */
+    float getLatency();
+
+    /**
+     * Get the round-trip time to SAM (and any other receivers), measured from the RTCP sender report
+     * timestamps they echo back in their receiver reports.
+     * @return the worst round-trip time of the receivers in microseconds, or -1 if not yet known
      */
-    float getLatency() { return 0.0f; }
+    int getRoundTripMicros();
     
     /**
      * Check if this StreamingAudioClient is running.
@@ -419,14 +471,21 @@ private:
     
     /**
      * Handle a /sam/regconfirm OSC message.
+     * @param ringName the name of the shared-memory ring SAM created for this client, or NULL to use RTP
      */
-    void handle_regconfirm(int port, unsigned int sampleRate, unsigned int bufferSize, quint16 rtpBasePort);
+    void handle_regconfirm(int port, unsigned int sampleRate, unsigned int bufferSize, quint16 rtpBasePort, const char* ringName = NULL);
 
     /**
      * Handle a /sam/regdeny OSC message.
      */
     void handle_regdeny(int errorCode);
     
+    /**
+     * Reconnect to the standby SAM and resume streaming there after losing the primary SAM.
+     * @return true if the resume request was sent, false otherwise
+     */
+    bool fail_over();
+
     /**
      * Handle a /sam/typeconfirm OSC message.
      */
@@ -437,6 +496,13 @@ private:
      */
     void handle_typedeny(int errorCode);
     
+    /**
+     * Get the audio to send for the current period, calling the audio callback if one is registered.
+     * @param in input audio samples (NULL if no input)
+     * @return the audio to send
+     */
+    float** get_audio(float** in);
+
     /**
      * Audio interface process callback.
      */
@@ -453,6 +519,14 @@ private:
     quint16 m_samPort;
     quint8 m_payloadType;
     int m_packetQueueSize;
+    int m_realtimePriority;           ///< SCHED_FIFO priority of the virtual audio interface thread (0 for the default policy)
+    bool m_sharedMemory;              ///< whether to ask SAM for shared-memory transport
+    bool m_adaptivePayload;           ///< whether the RTP sender adapts its payload type to receiver reports
+
+    // for failover
+    char* m_standbyIP;                ///< IP address of the standby SAM (NULL if none)
+    quint16 m_standbyPort;            ///< OSC port of the standby SAM
+    bool m_failingOver;               ///< true while waiting for the standby SAM to confirm a resume
 
     // for OSC
     char* m_replyIP;
@@ -460,6 +534,7 @@ private:
     QTcpSocket m_socket;              ///< Socket for sending and receiving OSC messages
     bool m_responseReceived;          ///< whether or not SAM responded to register request
     OscTcpSocketReader* m_oscReader;  ///< OSC-reading helper
+    OscDispatcher m_oscDispatcher;    ///< routes incoming OSC messages to handlers
 
     // for audio interface
     bool m_driveExternally;           ///< true to drive with an external clock tick, false to use internal SAC driver.
@@ -468,6 +543,11 @@ private:
     // for RTP
     RtpSender* m_sender;              ///< RTP streamer
 
+    // for shared-memory transport
+    SharedAudioRing* m_ring;          ///< ring shared with SAM on the same host (NULL if using RTP)
+    QAtomicInt m_ringActive;          ///< 1 while audio is sent through m_ring (cleared on fail-over)
+    bool m_ringOnly;                  ///< true if nothing is sent by RTP while m_ring is active (no standby SAM)
+
     // for audio callback
     SACAudioCallback m_audioCallback; ///< the audio callback function
     void* m_audioCallbackArg;         ///< user-supplied data for audio callback
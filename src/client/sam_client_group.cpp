@@ -0,0 +1,230 @@
+/**
+ * @file sam_client_group.cpp
+ * StreamingAudioClientGroup implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "rtpsender.h"
+#include "sac_audio_interface.h"
+#include "sam_client_group.h"
+
+namespace sam
+{
+
+static const int MAX_CLIENT_NAME = 64;
+static const int BATCH_DATAGRAMS_PER_STREAM = 4;   // room for each stream's extra destinations (standby SAM, relays, etc.)
+
+StreamingAudioClientGroup::StreamingAudioClientGroup(bool driveExternally) :
+    m_driveExternally(driveExternally),
+    m_channels(0),
+    m_bufferSize(0),
+    m_sampleRate(0),
+    m_realtimePriority(0),
+    m_started(false),
+    m_interface(NULL),
+    m_batch(NULL),
+    m_datagramsDropped(0)
+{
+}
+
+StreamingAudioClientGroup::~StreamingAudioClientGroup()
+{
+    if (m_interface) // need to stop interface before deleting streams
+    {
+        m_interface->stop();
+        delete m_interface;
+        m_interface = NULL;
+    }
+
+    for (int i = 0; i < m_streams.size(); i++)
+    {
+        delete m_streams[i];
+        m_streams[i] = NULL;
+    }
+    m_streams.clear();
+
+    if (m_batch)
+    {
+        delete m_batch;
+        m_batch = NULL;
+    }
+}
+
+int StreamingAudioClientGroup::addStream(const SacParams& params, int x, int y, int width, int height, int depth)
+{
+    if (m_started)
+    {
+        qWarning("StreamingAudioClientGroup::addStream can't add streams after starting");
+        return -1;
+    }
+
+    SacParams streamParams = params;
+    streamParams.driveExternally = true;
+    StreamingAudioClient* stream = new StreamingAudioClient();
+    if (stream->init(streamParams) != SAC_SUCCESS)
+    {
+        qWarning("StreamingAudioClientGroup::addStream couldn't initialize stream %d", m_streams.size());
+        delete stream;
+        return -1;
+    }
+
+    StreamPosition pos;
+    pos.x = x;
+    pos.y = y;
+    pos.width = width;
+    pos.height = height;
+    pos.depth = depth;
+
+    m_streams.append(stream);
+    m_positions.append(pos);
+    m_channelOffsets.append(m_channels);
+    m_channels += params.numChannels;
+    if (params.realtimePriority > m_realtimePriority) m_realtimePriority = params.realtimePriority;
+    return m_streams.size() - 1;
+}
+
+int StreamingAudioClientGroup::start(unsigned int timeout)
+{
+    if (m_started) return SAC_SUCCESS;
+    if (m_streams.isEmpty())
+    {
+        qWarning("StreamingAudioClientGroup::start no streams to start");
+        return SAC_ERROR;
+    }
+
+    // register each stream
+    for (int i = 0; i < m_streams.size(); i++)
+    {
+        const StreamPosition& pos = m_positions[i];
+        int result = m_streams[i]->start(pos.x, pos.y, pos.width, pos.height, pos.depth, timeout);
+        if (result != SAC_SUCCESS)
+        {
+            qWarning("StreamingAudioClientGroup::start couldn't register stream %d", i);
+            return result;
+        }
+
+        if (i == 0)
+        {
+            m_bufferSize = m_streams[i]->getBufferSize();
+            m_sampleRate = m_streams[i]->getSampleRate();
+        }
+        else if (m_streams[i]->getBufferSize() != m_bufferSize || m_streams[i]->getSampleRate() != m_sampleRate)
+        {
+            qWarning("StreamingAudioClientGroup::start stream %d has a different buffer size or sample rate than stream 0", i);
+            return SAC_ERROR;
+        }
+    }
+
+    m_batch = new RtpSendBatch(m_streams.size() * BATCH_DATAGRAMS_PER_STREAM);
+    if (!m_batch->isValid())
+    {
+        qWarning("StreamingAudioClientGroup::start couldn't open RTP sockets");
+        return SAC_ERROR;
+    }
+
+    // initialize and start one interface for all streams if not driving sending externally
+    if (!m_driveExternally)
+    {
+#ifdef SAC_NO_JACK
+        VirtualAudioInterface* virtualInterface = new VirtualAudioInterface(m_channels, m_bufferSize, m_sampleRate);
+        virtualInterface->setRealtimePriority(m_realtimePriority);
+        m_interface = virtualInterface;
+#else
+        // write the JACK client name
+        char clientName[MAX_CLIENT_NAME];
+        snprintf(clientName, MAX_CLIENT_NAME, "SAC-group-%d", (int)getpid());
+
+        m_interface = new JackAudioInterface(m_channels, m_bufferSize, m_sampleRate, clientName);
+#endif
+        m_interface->setAudioCallback(StreamingAudioClientGroup::interface_callback, this);
+
+        // start interface (start sending audio)
+        if (!m_interface->go())
+        {
+            qWarning("StreamingAudioClientGroup::start ERROR: couldn't start audio interface");
+            delete m_interface;
+            m_interface = NULL;
+            return SAC_ERROR;
+        }
+    }
+
+    m_started = true;
+    return SAC_SUCCESS;
+}
+
+int StreamingAudioClientGroup::sendAudio(float*** in)
+{
+    if (!m_started) return SAC_NOT_REGISTERED;
+    return send_all(NULL, in) ? SAC_SUCCESS : SAC_ERROR;
+}
+
+bool StreamingAudioClientGroup::send_all(float** in, float*** streamIn)
+{
+    bool success = true;
+    for (int i = 0; i < m_streams.size(); i++)
+    {
+        // each stream's channels are a slice of the interface's channels, so nothing is copied
+        float** audio = streamIn ? streamIn[i] : (in ? in + m_channelOffsets[i] : NULL);
+        if (m_streams[i]->queueAudio(audio, *m_batch) != SAC_SUCCESS) success = false;
+    }
+
+    int dropped = m_batch->send();
+    if (dropped > 0)
+    {
+        m_datagramsDropped += dropped;
+        success = false;
+    }
+    return success;
+}
+
+bool StreamingAudioClientGroup::interface_callback(unsigned int nchannels, unsigned int nframes, float** in, float** out, void* group)
+{
+    StreamingAudioClientGroup* clientGroup = (StreamingAudioClientGroup*)group;
+
+    // the streams' channels are sliced out of the interface's, and each sends m_bufferSize frames
+    if (nchannels != clientGroup->m_channels || nframes != clientGroup->m_bufferSize) return false;
+    return clientGroup->send_all(in, NULL);
+}
+
+} // end of namespace sam
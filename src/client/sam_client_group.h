@@ -0,0 +1,208 @@
+/**
+ * @file sam_client_group.h
+ * SAM client library interface for sending many streams from one thread
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef SAM_CLIENT_GROUP_H
+#define SAM_CLIENT_GROUP_H
+
+#include <QList>
+#include <QObject>
+
+#include "sam_client.h"
+
+namespace sam
+{
+
+class RtpSendBatch;
+class SacAudioInterface;
+
+/**
+ * @class StreamingAudioClientGroup
+ * @author agent
+ * @date October 2026
+ *
+ * This class lets one process send many independent streams to SAM from a single audio thread.
+ * Each stream is a StreamingAudioClient with its own registration, RTP ports and callbacks, but
+ * instead of each client running its own audio interface thread, the group runs one interface
+ * and, in each period, encodes every stream's packet and sends them all as one batch (see RtpSendBatch).
+ */
+class StreamingAudioClientGroup : public QObject
+{
+    Q_OBJECT
+public:
+
+    /**
+     * StreamingAudioClientGroup constructor.
+     * @param driveExternally false to have the group drive the audio sending or true to drive
+     *      the audio sending externally by calling sendAudio().
+     */
+    StreamingAudioClientGroup(bool driveExternally = false);
+
+    /**
+     * StreamingAudioClientGroup destructor.
+     * Stops sending and unregisters all streams.
+     */
+    ~StreamingAudioClientGroup();
+
+    /**
+     * Copy constructor (not used).
+     */
+    StreamingAudioClientGroup(const StreamingAudioClientGroup&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    StreamingAudioClientGroup& operator=(const StreamingAudioClientGroup&);
+
+    /**
+     * Add a stream to this group.
+     * This must be called before calling start().  The driveExternally parameter is ignored:
+     * streams are always driven by the group.
+     * @param params SacParams struct of parameters for the stream
+     * @param x the initial x position of the stream's app window
+     * @param y the initial y position of the stream's app window
+     * @param width the initial width of the stream's app window
+     * @param height the initial height of the stream's app window
+     * @param depth the initial depth of the stream's app window
+     * @return the index of the new stream on success, or -1 on failure
+     */
+    int addStream(const SacParams& params, int x, int y, int width, int height, int depth);
+
+    /**
+     * Register all streams with SAM (blocking until each registration is answered) and start sending.
+     * All streams must be given the same buffer size and sample rate by SAM.
+     * @param timeout response timeout time in milliseconds, for each stream
+     * @return 0 on success, a non-zero ::SACReturn code on failure
+     */
+    int start(unsigned int timeout = SAC_DEFAULT_TIMEOUT);
+
+    /**
+     * Send one period of audio for every stream.
+     * Should only be called if driving the sending from outside the group.
+     * @param in input audio samples for each stream, in the form in[stream][ch][frame]
+     *      (NULL, or NULL for a stream, if there is no input)
+     * @return 0 on success, a non-zero ::SACReturn code if any stream failed
+     */
+    int sendAudio(float*** in);
+
+    /**
+     * Get a stream, e.g. to set its callbacks or change its parameters.
+     * The stream is owned by the group and must not be deleted.
+     * @param stream the index of the stream
+     * @return the stream, or NULL if the index is invalid
+     */
+    StreamingAudioClient* getStream(int stream) { return (stream >= 0 && stream < m_streams.size()) ? m_streams[stream] : NULL; }
+
+    /**
+     * Get the number of streams in this group.
+     * @return the number of streams
+     */
+    int getNumStreams() const { return m_streams.size(); }
+
+    /**
+     * Get the buffer size that should be used when driving audio sending from outside the group.
+     * This can only be called after start() has returned successfully.
+     * @return buffer size (number of samples per channel sent in each packet) or 0 if unitialized
+     */
+    unsigned int getBufferSize() const { return m_bufferSize; }
+
+    /**
+     * Get the sample rate that should be used when driving audio sending from outside the group.
+     * This can only be called after start() has returned successfully.
+     * @return the current sampling rate or zero if uninitialized
+     */
+    unsigned int getSampleRate() const { return m_sampleRate; }
+
+    /**
+     * Get the number of datagrams that couldn't be sent.
+     * @return the number of datagrams dropped since the group started
+     */
+    quint32 getDatagramsDropped() const { return m_datagramsDropped; }
+
+private:
+
+    /**
+     * Send one period of audio for every stream.
+     * @param in input audio samples for all streams' channels in order, in the form in[ch][frame] (or NULL)
+     * @param streamIn input audio samples for each stream, in the form streamIn[stream][ch][frame]
+     *      (or NULL to use in instead)
+     * @return true if every stream's audio was sent, false otherwise
+     */
+    bool send_all(float** in, float*** streamIn);
+
+    /**
+     * Audio interface process callback.
+     */
+    static bool interface_callback(unsigned int nchannels, unsigned int nframes, float** in, float** out, void* group);
+
+    /**
+     * @struct StreamPosition
+     * The initial window position of a stream.
+     */
+    struct StreamPosition
+    {
+        int x;          ///< x position
+        int y;          ///< y position
+        int width;      ///< width
+        int height;     ///< height
+        int depth;      ///< depth
+    };
+
+    bool m_driveExternally;                 ///< true to drive with an external clock tick, false to use the group's audio interface
+    QList<StreamingAudioClient*> m_streams; ///< the streams
+    QList<StreamPosition> m_positions;      ///< initial window positions of the streams
+    QList<int> m_channelOffsets;            ///< index of each stream's first channel in the audio interface's channels
+    unsigned int m_channels;                ///< total number of channels of all streams
+    unsigned int m_bufferSize;              ///< buffer size given by SAM
+    unsigned int m_sampleRate;              ///< sample rate given by SAM
+    int m_realtimePriority;                 ///< SCHED_FIFO priority of the virtual audio interface thread (highest requested by any stream)
+    bool m_started;                         ///< true once start() has succeeded
+
+    SacAudioInterface* m_interface;         ///< audio interface driving all streams (NULL if driven externally)
+    RtpSendBatch* m_batch;                  ///< datagrams of all streams for the current period
+    volatile quint32 m_datagramsDropped;    ///< number of datagrams that couldn't be sent
+};
+
+} // end of namespace sam
+
+#endif // SAM_CLIENT_GROUP_H
@@ -42,8 +42,9 @@
  * MODIFICATIONS.
  */
 
-#include <QDataStream>
 #include <QDebug>
+#include <QThreadStorage>
+#include <QtEndian>
 
 #include "osc.h"
 
@@ -53,30 +54,121 @@ namespace sam
 static const int CONNECT_TIMEOUT_MILLIS = 5000;
 static const int DISCONNECT_TIMEOUT_MILLIS = 1000;
 
-OscMessage::OscMessage() :
-    QObject()
+/**
+ * @struct OscSocketCache
+ * The sockets used by OscClient's static send methods in one thread.
+ * Sockets belong to the thread that created them, so each thread gets its own cache.
+ */
+struct OscSocketCache
+{
+    OscSocketCache() : udpSocket(NULL) {}
+    ~OscSocketCache()
+    {
+        delete udpSocket;
+        qDeleteAll(tcpSockets);
+    }
+
+    QUdpSocket* udpSocket;                      ///< unconnected socket for sending to any UDP destination
+    QHash<QString, QTcpSocket*> tcpSockets;     ///< open TCP connections, keyed by "host:port"
+};
+
+static QThreadStorage<OscSocketCache*> g_socketCache;
+
+/**
+ * Get the calling thread's socket cache, creating it if necessary.
+ * @return the socket cache
+ */
+static OscSocketCache* socket_cache()
+{
+    if (!g_socketCache.hasLocalData())
+    {
+        g_socketCache.setLocalData(new OscSocketCache());
+    }
+    return g_socketCache.localData();
+}
+
+/**
+ * Get an open TCP connection to the given destination from the calling thread's cache,
+ * connecting (or reconnecting if the connection has been closed) as necessary.
+ * @param dest the remote host and port
+ * @return the connected socket, or NULL if the connection failed
+ */
+static QTcpSocket* cached_tcp_socket(OscAddress* dest)
+{
+    OscSocketCache* cache = socket_cache();
+    QString key = QString("%1:%2").arg(dest->host.toString()).arg(dest->port);
+    QTcpSocket* socket = cache->tcpSockets.value(key, NULL);
+    if (socket && socket->state() == QAbstractSocket::ConnectedState) return socket;
+
+    if (!socket)
+    {
+        socket = new QTcpSocket();
+        cache->tcpSockets.insert(key, socket);
+    }
+    else
+    {
+        socket->abort();
+    }
+
+    socket->connectToHost(dest->host, dest->port, QIODevice::WriteOnly);
+    if (socket->state() != QAbstractSocket::ConnectedState && !socket->waitForConnected(CONNECT_TIMEOUT_MILLIS))
+    {
+        QByteArray errArray = socket->errorString().toLocal8Bit();
+        qWarning("OscClient::SendTcp Couldn't connect to host: %s", errArray.constData());
+        cache->tcpSockets.remove(key);
+        delete socket;
+        return NULL;
+    }
+    return socket;
+}
+
+/**
+ * Get the number of bytes an OSC string occupies when written, including its null terminator and padding.
+ * @param len the length of the string, not including the null terminator
+ * @return the padded length
+ */
+static inline int osc_padded_size(int len)
+{
+    return (len + 4) & ~3;
+}
+
+/**
+ * Write a 32-bit value into a buffer in network byte order.
+ * @param dest the buffer to write to
+ * @param val the value to write
+ */
+static inline void osc_write_int(char* dest, qint32 val)
+{
+    qToBigEndian<qint32>(val, (uchar*)dest);
+}
+
+/**
+ * Read a 32-bit value in network byte order from a buffer.
+ * @param src the buffer to read from
+ * @return the value read
+ */
+static inline qint32 osc_read_int(const char* src)
+{
+    return qFromBigEndian<qint32>((const uchar*)src);
+}
+
+OscMessage::OscMessage()
 {
 
 }
 
 OscMessage::~OscMessage()
 {
-    clear();
+
 }
 
 void OscMessage::clear()
 {
-    m_address.clear();
-    m_type.clear();
-    for (int n = 0; n < m_args.size(); n++)
-    {
-        if (m_args[n].type == 's')
-        {
-            delete[] m_args[n].val.s;
-            m_args[n].val.s = NULL;
-        }
-    }
-    m_args.clear();
+    // QVarLengthArray keeps its capacity when resized, so a reused message doesn't allocate
+    m_address.resize(0);
+    m_type.resize(0);
+    m_args.resize(0);
+    m_argData.resize(0);
 }
 
 bool OscMessage::init(const char* address, const char* types, ...)
@@ -84,7 +176,7 @@ bool OscMessage::init(const char* address, const char* types, ...)
     if (!address) return false;
     clear();
 
-    m_address.append(address);
+    m_address.append(address, qstrlen(address) + 1);
 
     if (types)
     {
@@ -115,19 +207,16 @@ bool OscMessage::init(const char* address, const char* types, ...)
             case 's':
             {
                 const char* s = va_arg(args, char*);
-                int len = strlen(s);
-                arg.val.s = new char[len + 1];
-                strncpy(arg.val.s, s, len);
-                arg.val.s[len] = '\0';
-                break;
+                add_string_arg(s, qstrlen(s));
+                continue;
             }
             default:
                 qDebug("Unrecognized argument type %c", arg.type);
+                va_end(args);
                 return false;
             }
 
-            m_args.push_back(arg);
-            m_type.append(arg.type);
+            add_arg(arg);
         }
 
         va_end(args);
@@ -140,8 +229,7 @@ bool OscMessage::addIntArg(OSC_INT val)
     OscArg arg;
     arg.type = 'i';
     arg.val.i = val;
-    m_args.push_back(arg);
-    m_type.append(arg.type);
+    add_arg(arg);
     return true;
 }
 
@@ -150,53 +238,84 @@ bool OscMessage::addFloatArg(OSC_FLOAT val)
     OscArg arg;
     arg.type = 'f';
     arg.val.f = val;
-    m_args.push_back(arg);
-    m_type.append(arg.type);
+    add_arg(arg);
     return true;
 }
 
 bool OscMessage::addStringArg(const OSC_STRING val)
 {
+    if (!val) return false;
+    return add_string_arg(val, qstrlen(val));
+}
+
+bool OscMessage::addBlobArg(const void* data, int size)
+{
+    if (size < 0 || (!data && size > 0)) return false;
     OscArg arg;
-    arg.type = 's';
-    int len = strlen(val);
-    arg.val.s = new char[len + 1];
-    strncpy(arg.val.s, val, len);
-    arg.val.s[len] = '\0';
-    m_args.push_back(arg);
+    arg.type = 'b';
+    arg.val.i = m_argData.size(); // offset of the blob in m_argData
+    arg.size = size;
+    m_argData.append((const char*)data, size);
+    add_arg(arg);
+    return true;
+}
+
+void OscMessage::add_arg(const OscArg& arg)
+{
+    m_args.append(arg);
     m_type.append(arg.type);
+}
+
+bool OscMessage::add_string_arg(const char* val, int len)
+{
+    OscArg arg;
+    arg.type = 's';
+    arg.val.i = m_argData.size(); // offset of the string in m_argData
+    arg.size = 0;
+    m_argData.append(val, len);
+    m_argData.append('\0');
+    add_arg(arg);
     return true;
 }
 
-bool OscMessage::read(QByteArray& data)
+bool OscMessage::read(const QByteArray& data)
+{
+    return read(data.constData(), data.length());
+}
+
+bool OscMessage::read(const char* data, int len)
 {
-    if (data.isEmpty()) return false;
-    if (!data.startsWith('/')) return false;
+    if (!data || len <= 0) return false;
+    if (data[0] != '/') return false;
 
     clear();
 
-    int addrEnd = data.indexOf('\0');
-    m_address.append(data.left(addrEnd));
-    //qDebug() << "OscMessage::Read address = " << m_address;
+    const char* addrEnd = (const char*)memchr(data, '\0', len);
+    if (!addrEnd)
+    {
+        qWarning("OscMessage::Read Invalid OSC message: address not null-terminated");
+        return false;
+    }
+    int addrLen = addrEnd - data;
+    m_address.append(data, addrLen + 1);
 
-    int delim = data.indexOf(',', addrEnd);
-    if (delim < 0)
+    int typesStart = osc_padded_size(addrLen);
+    if (typesStart >= len || data[typesStart] != ',')
     {
-        //qDebug() << "OscMessage::Read no arguments";
         return true; // no arguments
     }
-    int typesStart = delim + 1;
-    int typesEnd = data.indexOf('\0', typesStart);
+    typesStart++;
+    const char* typesEndPtr = (const char*)memchr(data + typesStart, '\0', len - typesStart);
+    if (!typesEndPtr)
+    {
+        qWarning("OscMessage::Read Invalid OSC message: type string not null-terminated");
+        return false;
+    }
+    int typesEnd = typesEndPtr - data;
 
     // advance to start of args
     int argStart = typesEnd + (4 - typesEnd % 4);
 
-    int len = data.length();
-    QDataStream in(&data, QIODevice::ReadOnly);
-    in.setByteOrder(QDataStream::BigEndian);
-    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
-    // advance to start of args
-    in.skipRawData(argStart);
     for (int n = typesStart; n < typesEnd; n++)
     {
         if (argStart >= len)
@@ -214,55 +333,83 @@ bool OscMessage::read(QByteArray& data)
                 qWarning("OscMessage::Read Invalid OSC message: missing part of int argument %d", n);
                 return false;
             }
-            in >> arg.val.i;
+            arg.val.i = osc_read_int(data + argStart);
             argStart += 4;
-            //qDebug("Argument %d has type %c, value %d", n - typesStart, arg.type, arg.val.i);
+            add_arg(arg);
             break;
 
         case 'f': // float32
+        {
             if (argStart + 4 > len)
             {
                 qWarning("OscMessage::Read Invalid OSC message: missing part of float argument %d", n);
                 return false;
             }
-            in >> arg.val.f;
+            qint32 bits = osc_read_int(data + argStart);
+            memcpy(&arg.val.f, &bits, 4);
             argStart += 4;
-            //qDebug("Argument %d has type %c, value %f", n - typesStart, arg.type, arg.val.f);
+            add_arg(arg);
             break;
+        }
 
         case 's': // string
         {
-            int strEnd = data.indexOf('\0', argStart);
-            if (strEnd < 0)
+            const char* strEndPtr = (const char*)memchr(data + argStart, '\0', len - argStart);
+            if (!strEndPtr)
             {
                 qWarning("OscMessage::Read Invalid OSC message: string argument %d not null-terminated", n);
                 return false;
             }
-            arg.val.s = new char[strEnd - argStart + 1];
-            in.readRawData(arg.val.s, strEnd - argStart + 1);
-            while (strEnd % 4 != 3)
+            int strLen = strEndPtr - (data + argStart);
+            int paddedEnd = argStart + osc_padded_size(strLen);
+            if (paddedEnd > len)
             {
-                if (data[strEnd] != '\0')
+                qWarning("OscMessage::Read Invalid OSC message: string argument %d not null-padded", n);
+                return false;
+            }
+            for (int i = argStart + strLen; i < paddedEnd; i++)
+            {
+                if (data[i] != '\0')
                 {
                     qWarning("OscMessage::Read Invalid OSC message: string argument %d not null-padded", n);
-                    delete[] arg.val.s;
                     return false;
                 }
-                strEnd++;
-                in.skipRawData(1);
             }
-            argStart = strEnd + 1;
-            //qDebug("Argument %d has type %c, value %s", n - typesStart, arg.type, arg.val.s);
+            add_string_arg(data + argStart, strLen);
+            argStart = paddedEnd;
             break;
         }
-        case 'b':
-            qWarning("OscMessage::Read OSC blob type not supported at this time");
+        case 'b': // blob
+        {
+            if (argStart + 4 > len)
+            {
+                qWarning("OscMessage::Read Invalid OSC message: missing size of blob argument %d", n);
+                return false;
+            }
+            int blobSize = osc_read_int(data + argStart);
+            argStart += 4;
+            if (blobSize < 0 || blobSize > len - argStart)
+            {
+                qWarning("OscMessage::Read Invalid OSC message: blob argument %d has invalid size %d", n, blobSize);
+                return false;
+            }
+            int paddedEnd = argStart + ((blobSize + 3) & ~3);
+            if (paddedEnd > len)
+            {
+                qWarning("OscMessage::Read Invalid OSC message: blob argument %d not padded", n);
+                return false;
+            }
+            addBlobArg(data + argStart, blobSize);
+            argStart = paddedEnd;
+            break;
+        }
+
+        default:
+            qWarning("OscMessage::Read OSC type %c not supported", arg.type);
             return false;
         }
-        m_args.push_back(arg);
-        m_type.append(arg.type);
     }
-    if (argStart < data.length())
+    if (argStart < len)
     {
         qWarning("OscMessage::Read more arguments than there are types in the type string");
         return false;
@@ -271,88 +418,132 @@ bool OscMessage::read(QByteArray& data)
     return true;
 }
 
-bool OscMessage::write(QByteArray& data)
+int OscMessage::getSize()
 {
-    if (m_address.isEmpty()) return false;
+    if (m_address.isEmpty()) return 0;
 
-    data.clear();
-
-    // write address
-    data.append(m_address);
-    data.append('\0');
-    // pad with zeros
-    while (data.length() % 4 != 0)
+    int size = osc_padded_size(m_address.size() - 1);
+    size += osc_padded_size(m_type.size() + 1); // type tag starts with ','
+    int numArgs = m_args.size();
+    for (int n = 0; n < numArgs; n++)
     {
-        data.append('\0');
+        if (m_args[n].type == 's')
+        {
+            size += osc_padded_size(qstrlen(m_argData.constData() + m_args[n].val.i));
+        }
+        else if (m_args[n].type == 'b')
+        {
+            size += 4 + ((m_args[n].size + 3) & ~3);
+        }
+        else
+        {
+            size += 4;
+        }
     }
+    return size;
+}
+
+bool OscMessage::write(QByteArray& data)
+{
+    int size = getSize();
+    if (size <= 0) return false;
 
-    // write type tag
-    data.append(',');
-    data.append(m_type);
-    data.append('\0');
+    data.resize(size);
+    return (write(data.data(), size) == size);
+}
 
-    // pad with zeros
-    while (data.length() % 4 != 0)
+int OscMessage::write(char* data, int maxLen)
+{
+    if (m_address.isEmpty() || !data) return -1;
+    if (getSize() > maxLen)
     {
-        data.append('\0');
+        qWarning("OscMessage::write buffer too small (%d bytes) for message with address %s", maxLen, m_address.constData());
+        return -1;
     }
 
-    if (m_args.isEmpty()) return true; // no arguments
+    // write address, padded with zeros
+    int pos = 0;
+    int addrSize = osc_padded_size(m_address.size() - 1);
+    memcpy(data, m_address.constData(), m_address.size());
+    memset(data + m_address.size(), '\0', addrSize - m_address.size());
+    pos += addrSize;
+
+    // write type tag, padded with zeros
+    int typeSize = osc_padded_size(m_type.size() + 1);
+    data[pos] = ',';
+    memcpy(data + pos + 1, m_type.constData(), m_type.size());
+    memset(data + pos + 1 + m_type.size(), '\0', typeSize - m_type.size() - 1);
+    pos += typeSize;
 
     // write args
-    QDataStream out(&data, QIODevice::WriteOnly);
-    out.setByteOrder(QDataStream::BigEndian);
-    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
-    out.skipRawData(data.length());
     int numArgs = m_args.size();
     for (int n = 0; n < numArgs; n++)
     {
         switch (m_args[n].type)
         {
         case 'i':
-            out << m_args[n].val.i;
+            osc_write_int(data + pos, m_args[n].val.i);
+            pos += 4;
             break;
 
         case 'f':
-            out << m_args[n].val.f;
+        {
+            qint32 bits;
+            memcpy(&bits, &m_args[n].val.f, 4);
+            osc_write_int(data + pos, bits);
+            pos += 4;
             break;
+        }
 
         case 's':
         {
-            // TODO: check that s isn't NULL?
-            int stringLength = strlen(m_args[n].val.s);
-            int result = out.writeRawData(m_args[n].val.s, stringLength);
-            if (result != stringLength)
-            {
-                qDebug("could only write %d out of %d bytes", result, stringLength);
-            }
-            result = out.writeRawData("\0", 1);
-            // pad with zeros
-            while (data.length() % 4 != 0)
-            {
-                result = out.writeRawData("\0", 1);
-            }
+            const char* s = m_argData.constData() + m_args[n].val.i;
+            int stringLength = qstrlen(s);
+            int paddedLength = osc_padded_size(stringLength);
+            memcpy(data + pos, s, stringLength);
+            memset(data + pos + stringLength, '\0', paddedLength - stringLength);
+            pos += paddedLength;
+            break;
+        }
+
+        case 'b':
+        {
+            int blobSize = m_args[n].size;
+            int paddedSize = (blobSize + 3) & ~3;
+            osc_write_int(data + pos, blobSize);
+            pos += 4;
+            memcpy(data + pos, m_argData.constData() + m_args[n].val.i, blobSize);
+            memset(data + pos + blobSize, '\0', paddedSize - blobSize);
+            pos += paddedSize;
             break;
         }
         default:
             qWarning("Unknown argument type %c", m_args[n].type);
-            return false;
+            return -1;
         }
     }
 
-    return true;
+    return pos;
 }
 
-bool OscMessage::getArg(int index, OscArg& arg) // TODO: caller must not free string!!
+bool OscMessage::getArg(int index, OscArg& arg)
 {
     if (index < 0 || index >= m_args.size()) return false;
     arg = m_args[index];
+    if (arg.type == 's')
+    {
+        arg.val.s = m_argData.data() + m_args[index].val.i;
+    }
+    else if (arg.type == 'b')
+    {
+        arg.val.b = m_argData.data() + m_args[index].val.i;
+    }
     return true;
 }
 
 void OscMessage::print()
 {
-    printf("OscMessage: address = %s, %d arguments\n", m_address.data(), m_args.size());
+    printf("OscMessage: address = %s, %d arguments\n", getAddress(), m_args.size());
     for (int n = 0; n < m_args.size(); n++)
     {
         switch (m_args[n].type)
@@ -367,10 +558,14 @@ void OscMessage::print()
 
         case 's':
         {
-            printf("Argument %d has type %c, value %s\n", n, m_args[n].type, m_args[n].val.s);
+            printf("Argument %d has type %c, value %s\n", n, m_args[n].type, m_argData.constData() + m_args[n].val.i);
             break;
 
         }
+        case 'b':
+            printf("Argument %d has type %c, %d bytes\n", n, m_args[n].type, m_args[n].size);
+            break;
+
         default:
             printf("Argument %d has type %c, value unknown (unrecognized type)\n", n, m_args[n].type);
             break;
@@ -381,12 +576,25 @@ void OscMessage::print()
 bool OscMessage::typeMatches(const char* type)
 {
     if ((int)qstrlen(type) != m_type.size()) return false;
-    return m_type.startsWith(type);
+    return typeStartsWith(type);
 }
 
 bool OscMessage::typeStartsWith(const char* type)
 {
-    return m_type.startsWith(type);
+    int len = qstrlen(type);
+    if (len > m_type.size()) return false;
+    return (memcmp(m_type.constData(), type, len) == 0);
+}
+
+bool OscMessage::typeRepeats(const char* type)
+{
+    int len = qstrlen(type);
+    if (len == 0 || m_type.isEmpty() || (m_type.size() % len) != 0) return false;
+    for (int i = 0; i < m_type.size(); i += len)
+    {
+        if (memcmp(m_type.constData() + i, type, len) != 0) return false;
+    }
+    return true;
 }
 
 void OscMessage::slipEncode(QByteArray& data)
@@ -449,27 +657,25 @@ bool OscClient::send(OscMessage* msg)
 
 bool OscClient::sendTcp(OscMessage* msg, OscAddress* dest)
 {
-    QTcpSocket socket;
-    socket.connectToHost(dest->host, dest->port, QIODevice::WriteOnly);
-    if (socket.state() != QAbstractSocket::ConnectedState && !socket.waitForConnected(CONNECT_TIMEOUT_MILLIS))
-    {
-        QByteArray errArray = socket.errorString().toLocal8Bit();
-        qWarning("OscClient::SendTcp Couldn't connect to host: %s", errArray.constData());
-        return false;
-    }
+    if (!msg || !dest) return false;
 
-    if (!sendFromSocket(msg, &socket))
+    QByteArray msgBytes;
+    if (!msg->write(msgBytes))
     {
-        qWarning("OscClient::SendTcp Couldn't send message");
+        qWarning("OscClient::SendTcp Couldn't write OSC message");
         return false;
     }
 
-    socket.disconnectFromHost();
+    QTcpSocket* socket = cached_tcp_socket(dest);
+    if (!socket) return false;
+    if (sendFromSocket(msgBytes, socket)) return true;
 
-    if (socket.state() != QAbstractSocket::UnconnectedState && !socket.waitForDisconnected(DISCONNECT_TIMEOUT_MILLIS))
+    // the remote host may have closed the connection since the last message: reconnect once and retry
+    socket->abort();
+    socket = cached_tcp_socket(dest);
+    if (!socket || !sendFromSocket(msgBytes, socket))
     {
-        QByteArray errArray = socket.errorString().toLocal8Bit();
-        qWarning("OscClient::SendTcp Couldn't disconnect from host: %s", errArray.constData());
+        qWarning("OscClient::SendTcp Couldn't send message");
         return false;
     }
     return true;
@@ -477,26 +683,32 @@ bool OscClient::sendTcp(OscMessage* msg, OscAddress* dest)
 
 bool OscClient::sendUdp(OscMessage* msg, OscAddress* dest)
 {
-    QUdpSocket socket;
-    socket.connectToHost(dest->host, dest->port, QIODevice::WriteOnly);
-    if (!socket.waitForConnected(CONNECT_TIMEOUT_MILLIS))
+    if (!msg) return false;
+
+    QByteArray msgBytes;
+    if (!msg->write(msgBytes))
     {
-        QByteArray errArray = socket.errorString().toLocal8Bit();
-        qWarning("OscClient::SendUdp Couldn't connect to host: %s", errArray.constData());
+        qWarning("OscClient::SendUdp Couldn't write OSC message");
         return false;
     }
-    
-    if (!sendFromSocket(msg, &socket))
+    return sendUdp(msgBytes, dest);
+}
+
+bool OscClient::sendUdp(const QByteArray& msgBytes, OscAddress* dest)
+{
+    if (!dest || msgBytes.isEmpty()) return false;
+
+    OscSocketCache* cache = socket_cache();
+    if (!cache->udpSocket)
     {
-        qWarning("OscClient::SendUdp Couldn't send message");
-        return false;
+        cache->udpSocket = new QUdpSocket();
     }
-    
-    socket.disconnectFromHost();
-    if (socket.state() != QAbstractSocket::UnconnectedState && !socket.waitForDisconnected(DISCONNECT_TIMEOUT_MILLIS))
+
+    qint64 n = cache->udpSocket->writeDatagram(msgBytes, dest->host, dest->port);
+    if (n != msgBytes.length())
     {
-        QByteArray errArray = socket.errorString().toLocal8Bit();
-        qWarning("OscClient::SendUdp Couldn't disconnect from host: %s", errArray.constData());
+        QByteArray errArray = cache->udpSocket->errorString().toLocal8Bit();
+        qWarning("OscClient::SendUdp Couldn't send message: %s", errArray.constData());
         return false;
     }
     return true;
@@ -513,35 +725,338 @@ bool OscClient::sendFromSocket(OscMessage* msg, QAbstractSocket* socket)
         qWarning("OscClient::sendFromSocket Couldn't write OSC message");
         return false;
     }
-    //qDebug() << "OscClient::sendFromSocket Message to send has " << msgBytes.length() << " bytes: " << msgBytes;
+    return sendFromSocket(msgBytes, socket);
+}
 
-    /*printf("message bytes:\n");
-    for (int i = 0; i < msgBytes.length(); i++)
-    {
-        printf("char %d = %c\n", i, msgBytes.at(i));
-    }*/
+bool OscClient::sendFromSocket(const QByteArray& msgBytes, QAbstractSocket* socket)
+{
+    if (!socket || msgBytes.isEmpty()) return false;
 
+    qint64 n = 0;
+    qint64 expected = msgBytes.length();
     if (socket->socketType() == QAbstractSocket::TcpSocket)
     {
         //qDebug("OscClient::sendFromSocket slipifying TCP message");
-        OscMessage::slipEncode(msgBytes);
-        msgBytes.prepend(SLIP_END);
-        msgBytes.append(SLIP_END);
+        QByteArray slipBytes = msgBytes;
+        OscMessage::slipEncode(slipBytes);
+        slipBytes.prepend(SLIP_END);
+        slipBytes.append(SLIP_END);
+        expected = slipBytes.length();
+        n = socket->write(slipBytes);
     }
-    qint64 n = socket->write(msgBytes);
-    if (n != msgBytes.length())
+    else
     {
-        qWarning("OscClient::sendFromSocket Only %lld out of %d bytes written", n, msgBytes.length());
-        return false;
+        n = socket->write(msgBytes);
     }
-    /*else
+    if (n != expected)
     {
-        qDebug("OscClient::sendFromSocket Message written successfully");
-    }*/
+        qWarning("OscClient::sendFromSocket Only %lld out of %lld bytes written", n, expected);
+        return false;
+    }
     socket->flush();  
     return true;
 }
 
+OscDispatcher::OscDispatcher()
+{
+
+}
+
+OscDispatcher::~OscDispatcher()
+{
+
+}
+
+bool OscDispatcher::addMethod(const char* address, const char* types, int id, bool allowPattern)
+{
+    if (!address || isPattern(address))
+    {
+        qWarning("OscDispatcher::addMethod invalid method address %s", address ? address : "(null)");
+        return false;
+    }
+
+    OscMethod method;
+    method.address = address;
+    method.id = id;
+    method.allowPattern = allowPattern;
+    method.typeMode = '?';
+    if (types)
+    {
+        method.types = types;
+        method.typeMode = '\0';
+        if (method.types.endsWith('+') || method.types.endsWith('*'))
+        {
+            method.typeMode = method.types.at(method.types.size() - 1);
+            method.types.chop(1);
+        }
+    }
+
+    m_index[method.address].append(m_methods.size());
+    m_methods.append(method);
+    return true;
+}
+
+const QVector<int>& OscDispatcher::match(OscMessage* msg)
+{
+    m_matches.resize(0);
+    const char* address = msg->getAddress();
+
+    if (!isPattern(address))
+    {
+        // look up the address directly (without copying it)
+        QHash<QByteArray, QVector<int> >::const_iterator it = m_index.constFind(QByteArray::fromRawData(address, qstrlen(address)));
+        if (it == m_index.constEnd()) return m_matches;
+
+        const QVector<int>& indices = it.value();
+        for (int i = 0; i < indices.size(); i++)
+        {
+            if (types_match(m_methods[indices[i]], msg))
+            {
+                m_matches.append(m_methods[indices[i]].id);
+                break;
+            }
+        }
+        return m_matches;
+    }
+
+    // address pattern: check every registered method in order, choosing only
+    // the first method with matching types for each address (methods that didn't opt in are skipped)
+    for (int i = 0; i < m_methods.size(); i++)
+    {
+        const OscMethod& method = m_methods[i];
+        if (!method.allowPattern || !patternMatches(address, method.address.constData())) continue;
+
+        const QVector<int>& indices = m_index[method.address];
+        for (int j = 0; j < indices.size(); j++)
+        {
+            if (!m_methods[indices[j]].allowPattern) continue;
+            if (types_match(m_methods[indices[j]], msg))
+            {
+                if (indices[j] == i) m_matches.append(method.id);
+                break;
+            }
+        }
+    }
+    return m_matches;
+}
+
+bool OscDispatcher::isPattern(const char* address)
+{
+    return strpbrk(address, "?*[]{}") != NULL;
+}
+
+bool OscDispatcher::patternMatches(const char* pattern, const char* address)
+{
+    while (*pattern)
+    {
+        switch (*pattern)
+        {
+        case '?':
+            // any single character within one part of the address
+            if (*address == '\0' || *address == '/') return false;
+            pattern++;
+            address++;
+            break;
+
+        case '*':
+        {
+            // any sequence of zero or more characters within one part of the address
+            while (*pattern == '*') pattern++;
+            for (const char* a = address; ; a++)
+            {
+                if (patternMatches(pattern, a)) return true;
+                if (*a == '\0' || *a == '/') return false;
+            }
+        }
+
+        case '[':
+        {
+            // any character in the bracketed set
+            if (*address == '\0' || *address == '/') return false;
+            const char* end = NULL;
+            if (!bracket_matches(pattern + 1, *address, end)) return false;
+            pattern = end;
+            address++;
+            break;
+        }
+
+        case '{':
+        {
+            // any of the comma-separated strings
+            const char* close = strchr(pattern, '}');
+            if (!close) return false;
+            const char* alt = pattern + 1;
+            while (alt <= close)
+            {
+                const char* altEnd = alt;
+                while (*altEnd != ',' && *altEnd != '}') altEnd++;
+                int len = altEnd - alt;
+                if (qstrncmp(alt, address, len) == 0 && patternMatches(close + 1, address + len)) return true;
+                alt = altEnd + 1;
+            }
+            return false;
+        }
+
+        default:
+            if (*pattern != *address) return false;
+            pattern++;
+            address++;
+        }
+    }
+    return *address == '\0';
+}
+
+bool OscDispatcher::types_match(const OscMethod& method, OscMessage* msg)
+{
+    switch (method.typeMode)
+    {
+    case '?':
+        return true;
+    case '+':
+        return msg->typeRepeats(method.types.constData());
+    case '*':
+        return msg->typeStartsWith(method.types.constData());
+    default:
+        return msg->typeMatches(method.types.constData());
+    }
+}
+
+bool OscDispatcher::bracket_matches(const char* pattern, char c, const char*& end)
+{
+    bool negate = false;
+    if (*pattern == '!')
+    {
+        negate = true;
+        pattern++;
+    }
+
+    bool matched = false;
+    while (*pattern && *pattern != ']')
+    {
+        if (pattern[1] == '-' && pattern[2] && pattern[2] != ']')
+        {
+            // range of characters
+            if (c >= pattern[0] && c <= pattern[2]) matched = true;
+            pattern += 3;
+        }
+        else
+        {
+            if (c == *pattern) matched = true;
+            pattern++;
+        }
+    }
+
+    if (*pattern != ']')
+    {
+        // unterminated set
+        end = pattern;
+        return false;
+    }
+    end = pattern + 1;
+    return matched != negate;
+}
+
+OscSlipDecoder::OscSlipDecoder() :
+    m_state(SLIP_IDLE),
+    m_ready(false),
+    m_discarded(0)
+{
+}
+
+bool OscSlipDecoder::decode(const char*& data, const char* end)
+{
+    if (m_ready)
+    {
+        m_packet.resize(0);
+        m_ready = false;
+    }
+
+    while (data < end)
+    {
+        if (m_state == SLIP_PACKET)
+        {
+            // copy the run of plain bytes up to the next special character in one go
+            const char* run = data;
+            while (run < end && *run != SLIP_END && *run != SLIP_ESC) run++;
+            append_packet(data, run - data);
+            data = run;
+            if (data == end) break;
+        }
+
+        char c = *data++;
+        switch (m_state)
+        {
+        case SLIP_IDLE:
+        case SLIP_OVERFLOW:
+            if (c == SLIP_END)
+            {
+                m_state = SLIP_PACKET;
+            }
+            else
+            {
+                m_discarded++;
+            }
+            break;
+        case SLIP_PACKET:
+            if (c == SLIP_ESC)
+            {
+                m_state = SLIP_ESCAPE;
+            }
+            else if (!m_packet.isEmpty())
+            {
+                // SLIP_END ends this packet and also starts the next one
+                m_ready = true;
+                return true;
+            }
+            // otherwise skip empty packets (e.g. back-to-back SLIP_END)
+            break;
+        case SLIP_ESCAPE:
+            if (c == SLIP_END)
+            {
+                qWarning("OscSlipDecoder::decode packet ended inside an escape sequence, discarding %d bytes", m_packet.size());
+                m_discarded += m_packet.size() + 1;
+                m_packet.resize(0);
+                m_state = SLIP_PACKET;
+                break;
+            }
+            if (c == SLIP_ESC_END[1])
+            {
+                c = SLIP_END;
+            }
+            else if (c == SLIP_ESC_ESC[1])
+            {
+                c = SLIP_ESC;
+            }
+            // any other escaped byte is kept as-is, as RFC 1055 suggests
+            m_state = SLIP_PACKET;
+            append_packet(&c, 1);
+            break;
+        }
+    }
+    return false;
+}
+
+void OscSlipDecoder::reset()
+{
+    m_packet.resize(0);
+    m_ready = false;
+    m_state = SLIP_IDLE;
+}
+
+void OscSlipDecoder::append_packet(const char* data, int len)
+{
+    if (m_state == SLIP_OVERFLOW) return;
+    if (m_packet.size() + len > OSC_SLIP_MAX_PACKET)
+    {
+        qWarning("OscSlipDecoder::append_packet packet larger than %d bytes, discarding", OSC_SLIP_MAX_PACKET);
+        m_discarded += m_packet.size() + len;
+        m_packet.resize(0);
+        m_state = SLIP_OVERFLOW;
+        return;
+    }
+    m_packet.append(data, len);
+}
+
 OscTcpSocketReader::OscTcpSocketReader(QTcpSocket* socket) :
     QObject(),
     m_socket(socket)
@@ -564,64 +1079,28 @@ void OscTcpSocketReader::readFromSocket()
     {
         qWarning("OscTcpSocketReader::readFromSocket socket mismatch!");
     }
-    //int available = m_socket->bytesAvailable();
-    //qDebug() << "reading from TCP socket " << m_socket << ", " << available << " bytes available";
-
-    QByteArray block = m_socket->readAll();
-    int start = block.startsWith(SLIP_END) ? 1 : 0;
-    if (m_data.isEmpty() && (start == 0))
-    {
-        qWarning("Invalid message fragment received: %s", block.constData());
-        return; // valid OSC messages must start with SLIP_END
-    }
-
-    if (start > 0)
-    {
-        m_data.clear();
-    }
 
-    int len = block.length();
-    while (start < len)
+    QByteArray address;
+    char block[OSC_TCP_READ_SIZE];
+    qint64 len = 0;
+    while ((len = m_socket->read(block, OSC_TCP_READ_SIZE)) > 0)
     {
-        int end = block.indexOf(SLIP_END, start);
-        //qDebug() << "start = " << start << ", end = " << end;
-        if (start == end)
-        {
-            start++;
-            continue;
-        }
-        if (end < 0)
-        {
-            // partial OSC message
-            QByteArray msg = block.right(len - start);
-            OscMessage::slipDecode(msg);
-            m_data.append(msg);
-            qDebug() << "TCP partial message received = " << QString(m_data);
-            break;
-        }
-        else
+        const char* data = block;
+        const char* end = block + len;
+        while (m_decoder.decode(data, end))
         {
-            // end of an OSC message
-            QByteArray msg = block.mid(start, end - start);
-            OscMessage::slipDecode(msg);
-            m_data.append(msg);
-            
             OscMessage* oscMsg = new OscMessage();
-            bool success = oscMsg->read(m_data);
-            if (!success)
+            if (!oscMsg->read(m_decoder.getPacket(), m_decoder.getPacketSize()))
             {
                 qDebug("Couldn't read OSC message");
+                delete oscMsg;
+                continue;
             }
-            else
+            if (address.isEmpty())
             {
-                QHostAddress hostAddress =  m_socket->peerAddress();
-                QString addressString = hostAddress.toString();
-                QByteArray address = addressString.toLocal8Bit();
-                emit messageReady(oscMsg, address.constData(), socket);
+                address = m_socket->peerAddress().toString().toLocal8Bit();
             }
-
-            start = end + 1;
-            m_data.clear(); // prepare for new message
+            emit messageReady(oscMsg, address.constData(), socket);
         }
     }
 }
@@ -47,10 +47,12 @@
 
 #include <QAbstractSocket>
 #include <QByteArray>
+#include <QHash>
 #include <QObject>
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QUdpSocket>
+#include <QVarLengthArray>
 #include <QVector>
 
 namespace sam
@@ -67,6 +69,13 @@ static const char SLIP_ESC = 219;                    ///< SLIP escape character
 static const char SLIP_ESC_END[2] = {SLIP_ESC, 220}; ///< the escaped SLIP end character
 static const char SLIP_ESC_ESC[2] = {SLIP_ESC, 221}; ///< the escaped SLIP escape character
 
+static const int OSC_INLINE_ADDRESS_SIZE = 64;  ///< bytes of OSC address stored inside an OscMessage before spilling to the heap
+static const int OSC_INLINE_ARGS = 32;          ///< number of OSC arguments stored inside an OscMessage before spilling to the heap
+static const int OSC_INLINE_DATA_SIZE = 128;    ///< bytes of string and blob argument data stored inside an OscMessage before spilling to the heap
+static const int OSC_SLIP_INLINE_SIZE = 1024;   ///< bytes of a SLIP-decoded packet stored inside an OscSlipDecoder before spilling to the heap
+static const int OSC_SLIP_MAX_PACKET = 65536;   ///< largest SLIP-decoded packet accepted (larger packets are discarded)
+static const int OSC_TCP_READ_SIZE = 4096;      ///< bytes read from a TCP socket at a time
+
 
 /**
  * @union OscArgVal
@@ -77,6 +86,7 @@ union OscArgVal
     OSC_INT i;      ///< An OSC 32-bit integer type
     OSC_FLOAT f;    ///< An OSC 32-bit floating point type
     OSC_STRING s;   ///< An OSC string
+    OSC_BLOB b;     ///< An OSC blob
 };
 
 
@@ -88,6 +98,7 @@ struct OscArg
 {
     char type;      ///< The argument's type
     OscArgVal val;  ///< The argument's value
+    int size;       ///< The size of a blob argument in bytes (unused for other types)
 };
 
 
@@ -110,10 +121,13 @@ struct OscAddress
  * type string, and argument list), and functionality including reading
  * and writing messages to byte arrays.
  *
+ * The address, type string, arguments and string argument data are stored in
+ * inline buffers that only spill to the heap for unusually large messages, and
+ * clearing a message keeps any capacity it has grown to.  An OscMessage that is
+ * reused for many reads or writes therefore does not allocate in steady state.
  */
-class OscMessage : public QObject
+class OscMessage
 {
-    Q_OBJECT
 public:
     /**
      * Default constructor.
@@ -137,6 +151,7 @@ public:
 
     /**
      * Clear all of this OscMessage's data.
+     * Storage is kept for reuse.
      */
     void clear();
 
@@ -172,27 +187,61 @@ public:
      */
     bool addStringArg(const OSC_STRING val);
 
+    /**
+     * Add an OSC blob argument to this OscMessage.
+     * Makes a deep copy of the given data
+     * @param data the blob data to be added
+     * @param size the size of the blob in bytes
+     * @return true on success, false on failure
+     */
+    bool addBlobArg(const void* data, int size);
+
     /**
      * Read an OSC message from a byte array.
      * @param data the array of bytes containing the OscMessage data
      * @return true on success, false on failure
-     * @see read
+     * @see write
      */
-    bool read(QByteArray& data);
+    bool read(const QByteArray& data);
+
+    /**
+     * Read an OSC message from a buffer.
+     * @param data the buffer containing the OscMessage data
+     * @param len the number of bytes in the buffer
+     * @return true on success, false on failure
+     * @see write
+     */
+    bool read(const char* data, int len);
 
     /**
      * Write an OSC message to a byte array.
+     * The array is resized to fit the message, reusing its existing storage when possible.
      * @param data the array of bytes to which the message data will be written
      * @return true on success, false on failure
-     * @see write
+     * @see read
      */
     bool write(QByteArray& data);
 
+    /**
+     * Write an OSC message directly into a buffer.
+     * @param data the buffer to which the message data will be written
+     * @param maxLen the size of the buffer in bytes
+     * @return the number of bytes written, or -1 on failure (including a buffer that is too small)
+     * @see getSize
+     */
+    int write(char* data, int maxLen);
+
+    /**
+     * Get the number of bytes this message occupies when written.
+     * @return the size of the written message in bytes
+     */
+    int getSize();
+
     /**
      * Get this OscMessage's OSC address string.
      * @return A pointer to the OSC address string (must not be modified!)
      */
-    const char* getAddress() { return m_address.data(); }
+    const char* getAddress() { return m_address.isEmpty() ? "" : m_address.constData(); }
 
     /**
      * Get the number of OSC arguments this message contains.
@@ -204,11 +253,12 @@ public:
      * Get one of this message's OSC arguments.
      * @param index the index of the desired argument
      * @param arg the OscArg struct that will be populated
-     * Note - no deep copy is made of OSC string data, so the caller
-     * must not free a returned OSC_STRING argument.
+     * Note - no deep copy is made of OSC string or blob data, so the caller
+     * must not free a returned OSC_STRING or OSC_BLOB argument, and it is only
+     * valid until this message is cleared, modified or deleted.
      * @return true on success, false on failure
      */
-    bool getArg(int index, OscArg& arg); // TODO: caller must not free string!!
+    bool getArg(int index, OscArg& arg);
 
     /**
      * Print the contents of the OSC message to the console.
@@ -230,6 +280,14 @@ public:
      */
     bool typeStartsWith(const char* type);
 
+    /**
+     * Check if this OscMessage's type string is one or more repetitions of a given string.
+     * Used to recognize array-form messages (e.g. "ifif" for two (id, value) pairs).
+     * @param type the type string to be repeated
+     * @return true if this message's type string is made up only of repetitions of the given string, false otherwise.
+     */
+    bool typeRepeats(const char* type);
+
     /**
      * Encodes a byte array using double-ended SLIP (RFC 1055).
      * SLIP is used to signify the end of a serially-transmitted message
@@ -245,9 +303,25 @@ public:
     static void slipDecode(QByteArray& data);
     
 private:
-    QByteArray m_address;   ///< The OSC address string
-    QByteArray m_type;      ///< The OSC type string (provided for convenience only, since the types are also represented in the OscArgs)
-    QVector<OscArg> m_args; ///< The OSC arguments
+
+    /**
+     * Add an argument to this message's argument list and type string.
+     * @param arg the argument to add (string and blob arguments hold an offset into m_argData)
+     */
+    void add_arg(const OscArg& arg);
+
+    /**
+     * Copy a string argument into this message's argument data storage.
+     * @param val the string to copy
+     * @param len the length of the string, not including the null terminator
+     * @return true on success, false on failure
+     */
+    bool add_string_arg(const char* val, int len);
+
+    QVarLengthArray<char, OSC_INLINE_ADDRESS_SIZE> m_address; ///< The null-terminated OSC address string
+    QVarLengthArray<char, OSC_INLINE_ARGS> m_type;            ///< The OSC type string, not null-terminated (provided for convenience only, since the types are also represented in the OscArgs)
+    QVarLengthArray<OscArg, OSC_INLINE_ARGS> m_args;          ///< The OSC arguments (string and blob arguments hold an offset into m_argData)
+    QVarLengthArray<char, OSC_INLINE_DATA_SIZE> m_argData;    ///< Storage for null-terminated string argument data and blob data
 };
 
 /**
@@ -304,9 +378,8 @@ public:
     
     /**
      * Send an OSC message to the remote host using TCP.
-     * This method connects to the remote host, sends the message, and disconnects.
-     * Calling it multiple times results in new connections each time.  To maintain
-     * a connection across multiple messages, use the non-static functionality of OscClient.
+     * Connections are kept open and reused by later messages to the same host and port
+     * sent from the same thread, and are reopened if the remote host has closed them.
      * @param msg the OscMessage to send
      * @param dest the remote host and port to send to
      * @return true on success, false otherwise
@@ -316,12 +389,22 @@ public:
     
     /**
      * Send an OSC message to the remote host using UDP.
+     * Messages are sent from one unconnected socket shared by all destinations within a thread.
      * @param msg the OscMessage to send
      * @param dest the remote host and port to send to
      * @return true on success, false otherwise
      * @see sendTcp
      */
     static bool sendUdp(OscMessage* msg, OscAddress* dest);
+
+    /**
+     * Send an already-written OSC message to the remote host using UDP.
+     * Lets a message sent to many destinations be written only once.
+     * @param msgBytes the message data, as written by OscMessage::write
+     * @param dest the remote host and port to send to
+     * @return true on success, false otherwise
+     */
+    static bool sendUdp(const QByteArray& msgBytes, OscAddress* dest);
     
     /**
      * Send an OSC message to the remote host.
@@ -330,12 +413,201 @@ public:
      * @return true on success, false otherwise
      */
     static bool sendFromSocket(OscMessage* msg, QAbstractSocket* socket);
+
+    /**
+     * Send an already-written OSC message to the remote host.
+     * @param msgBytes the message data, as written by OscMessage::write (SLIP-encoded here for TCP sockets)
+     * @param socket the socket to send from (must already be connected to the remote host)
+     * @return true on success, false otherwise
+     */
+    static bool sendFromSocket(const QByteArray& msgBytes, QAbstractSocket* socket);
     
 private:
 
     QAbstractSocket* m_socket; ///< a TCP or UDP socket used to send messages
 };
 
+/**
+ * @struct OscMethod
+ * This struct represents an OSC method registered with an OscDispatcher.
+ */
+struct OscMethod
+{
+    QByteArray address; ///< The OSC address of the method
+    QByteArray types;   ///< The type signature of the method, without any trailing modifier
+    char typeMode;      ///< '\0' for an exact type match, '+' for one or more repetitions, '*' for a prefix match, '?' for any types
+    bool allowPattern;  ///< true if the method can also be reached through an address pattern
+    int id;             ///< The caller's identifier for the method
+};
+
+/**
+ * @class OscDispatcher
+ * An OscDispatcher routes OSC messages to registered methods.
+ *
+ * Methods are registered once with an address and a type signature, and are then looked
+ * up by a hash of the address instead of by comparing strings level by level.  Messages
+ * whose address contains OSC 1.0 pattern characters ('?', '*', '[]' and '{}') are matched
+ * against every registered address.  For each matching address, the first method registered
+ * for that address whose type signature matches the message is chosen, so handlers can
+ * decode their arguments without checking types again.  Methods are only reached through an
+ * address pattern if they opt in when registered, so control methods (e.g. quitting or
+ * registering) added later can't be triggered by a wildcard by accident.
+ */
+class OscDispatcher
+{
+public:
+    /**
+     * Constructor.
+     */
+    OscDispatcher();
+
+    /**
+     * Destructor.
+     */
+    ~OscDispatcher();
+
+    /**
+     * Copy constructor (not used).
+     */
+    OscDispatcher(const OscDispatcher&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    OscDispatcher& operator=(const OscDispatcher&);
+
+    /**
+     * Register an OSC method.
+     * @param address the OSC address of the method (must not contain pattern characters)
+     * @param types the type signature to match: an exact type string (e.g. "if"), a type string
+     * followed by '+' to match one or more repetitions of it (e.g. "if+"), a type string followed
+     * by '*' to match any type string starting with it (e.g. "iiii*"), or NULL to match any types
+     * @param id the identifier to be returned when this method matches
+     * @param allowPattern true if messages sent to an address pattern matching this address should also match
+     * (otherwise only messages sent to exactly this address match)
+     * @return true on success, false on failure
+     */
+    bool addMethod(const char* address, const char* types, int id, bool allowPattern = false);
+
+    /**
+     * Find the methods that match a message.
+     * @param msg the message to match
+     * @return the ids of all matching methods, in registration order (valid until the next call)
+     */
+    const QVector<int>& match(OscMessage* msg);
+
+    /**
+     * Check if an OSC address contains pattern characters.
+     * @param address the OSC address to check
+     * @return true if the address is a pattern, false otherwise
+     */
+    static bool isPattern(const char* address);
+
+    /**
+     * Check if an OSC address matches an OSC 1.0 address pattern.
+     * @param pattern the address pattern, which may contain '?', '*', '[]' and '{}'
+     * @param address the OSC address to compare against
+     * @return true if the address matches the pattern, false otherwise
+     */
+    static bool patternMatches(const char* pattern, const char* address);
+
+private:
+
+    /**
+     * Check if a message's types match a method's type signature.
+     * @param method the method to check
+     * @param msg the message to check
+     * @return true if the types match, false otherwise
+     */
+    static bool types_match(const OscMethod& method, OscMessage* msg);
+
+    /**
+     * Match a character against an OSC pattern bracket expression.
+     * @param pattern pointer to the character after the opening '['
+     * @param c the character to match
+     * @param end set to point to the character after the closing ']'
+     * @return true if the character is in the set, false otherwise
+     */
+    static bool bracket_matches(const char* pattern, char c, const char*& end);
+
+    QVector<OscMethod> m_methods;            ///< all registered methods
+    QHash<QByteArray, QVector<int> > m_index; ///< indices into m_methods, by address
+    QVector<int> m_matches;                  ///< ids returned from the last call to match
+};
+
+/**
+ * @class OscSlipDecoder
+ * An OscSlipDecoder incrementally decodes a SLIP-encoded byte stream into packets.
+ * The stream may be split at any point (e.g. into arbitrary TCP segments): decoding
+ * state is kept between calls, and each packet is decoded directly into a reusable
+ * buffer without intermediate copies.
+ */
+class OscSlipDecoder
+{
+public:
+    /**
+     * Constructor.
+     */
+    OscSlipDecoder();
+
+    /**
+     * Decode bytes until a complete packet is found or the input runs out.
+     * A complete packet stays available through getPacket() until the next call.
+     * @param data the next byte to decode; advanced past the bytes consumed
+     * @param end one past the last byte available
+     * @return true if a complete packet is ready, false if more bytes are needed
+     */
+    bool decode(const char*& data, const char* end);
+
+    /**
+     * Get the most recently completed packet.
+     * @return pointer to the decoded packet bytes
+     */
+    const char* getPacket() const { return m_packet.constData(); }
+
+    /**
+     * Get the size of the most recently completed packet.
+     * @return the packet size in bytes
+     */
+    int getPacketSize() const { return m_packet.size(); }
+
+    /**
+     * Get the number of bytes discarded so far (bytes outside a packet, damaged or oversized packets).
+     * @return the number of bytes discarded
+     */
+    quint64 getNumDiscarded() const { return m_discarded; }
+
+    /**
+     * Discard any partial packet and wait for the start of a new one.
+     */
+    void reset();
+
+protected:
+
+    /**
+     * States of the decoder.
+     */
+    enum SlipState
+    {
+        SLIP_IDLE,      ///< waiting for SLIP_END to start a packet
+        SLIP_PACKET,    ///< inside a packet
+        SLIP_ESCAPE,    ///< inside a packet, just after SLIP_ESC
+        SLIP_OVERFLOW   ///< inside a packet that is too big, discarding until SLIP_END
+    };
+
+    /**
+     * Append decoded bytes to the current packet, switching to SLIP_OVERFLOW if it gets too big.
+     * @param data the bytes to append
+     * @param len the number of bytes to append
+     */
+    void append_packet(const char* data, int len);
+
+    SlipState m_state;                                       ///< current decoder state
+    bool m_ready;                                            ///< true if m_packet holds a complete packet
+    QVarLengthArray<char, OSC_SLIP_INLINE_SIZE> m_packet;    ///< the packet being decoded
+    quint64 m_discarded;                                     ///< number of bytes discarded
+};
+
 /**
  * @class OscTcpSocketReader
  * An OscTcpSocketReader reads OCS messages from a TCP socket.
@@ -364,6 +636,11 @@ public:
      */
     OscTcpSocketReader& operator=(const OscTcpSocketReader);
 
+    /**
+     * Discard any partially-received message (e.g. before reusing the socket for a new connection).
+     */
+    void reset() { m_decoder.reset(); }
+
 signals:
     /**
      * Signals when a complete OSC message has been received.
@@ -381,8 +658,8 @@ public slots:
 
 protected:
 
-    QTcpSocket* m_socket; ///< The TCP socket to read from
-    QByteArray m_data;    ///< temporary storage for received data
+    QTcpSocket* m_socket;       ///< The TCP socket to read from
+    OscSlipDecoder m_decoder;   ///< decoder for the SLIP-encoded stream
 };
 
 /**
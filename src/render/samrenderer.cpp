@@ -51,6 +51,14 @@
 namespace sam
 {
 
+// OSC method ids for m_oscDispatcher
+static const int OSC_REGCONFIRM = 0;
+static const int OSC_REGDENY = 1;
+static const int OSC_STREAM_ADD = 2;
+static const int OSC_STREAM_REMOVE = 3;
+static const int OSC_VAL_POSITION = 4;
+static const int OSC_VAL_TYPE = 5;
+
 SamRenderer::SamRenderer() :
     QObject(),
     m_samIP(NULL),
@@ -71,6 +79,12 @@ SamRenderer::SamRenderer() :
     m_disconnectCallback(NULL),
     m_disconnectCallbackArg(NULL)
 {
+    m_oscDispatcher.addMethod("/sam/render/regconfirm", "", OSC_REGCONFIRM);
+    m_oscDispatcher.addMethod("/sam/render/regdeny", "i", OSC_REGDENY);
+    m_oscDispatcher.addMethod("/sam/stream/add", "iiii*", OSC_STREAM_ADD);
+    m_oscDispatcher.addMethod("/sam/stream/remove", "i", OSC_STREAM_REMOVE);
+    m_oscDispatcher.addMethod("/sam/val/position", "iiiiii", OSC_VAL_POSITION);
+    m_oscDispatcher.addMethod("/sam/val/type", "iii", OSC_VAL_TYPE);
 }
 
 SamRenderer::~SamRenderer()
@@ -342,209 +356,143 @@ void SamRenderer::samDisconnected()
 
 void SamRenderer::handleOscMessage(OscMessage* msg, const char*, QAbstractSocket*)
 {
-    // check prefix
-    int prefixLen = 5; // prefix is "/sam/"
-    const char* address = msg->getAddress();
-    if (qstrncmp(address, "/sam/", prefixLen) != 0)
+    QVector<int> methods = m_oscDispatcher.match(msg);
+    if (methods.isEmpty())
     {
         printf("Unknown OSC message:\n");
         msg->print();
-        delete msg;
-        return;
     }
 
-    // check second level of address
-    if (qstrncmp(address + prefixLen, "render", 6) == 0)
+    for (int i = 0; i < methods.size(); i++)
     {
-        // check third level of address
-        if (qstrcmp(address + prefixLen + 6, "/regconfirm") == 0) // /sam/render/regconfirm
+        switch (methods[i])
         {
-            if (msg->typeMatches(""))
-            {
-                qDebug("Renderer received regconfirm from SAM");
-                handle_regconfirm();
-            }
-            else
-            {
-                printf("Unknown OSC message:\n");
-                msg->print();
-            }
-        }
-        else if (qstrcmp(address + prefixLen + 6, "/regdeny") == 0) // /sam/render/regdeny)
+        case OSC_REGCONFIRM: // /sam/render/regconfirm
         {
-            if (msg->typeMatches("i"))
-            {
-                OscArg arg;
-                msg->getArg(0, arg);
-                int errorCode = arg.val.i;
-                qWarning("Renderer SAM registration DENIED: error code = %d", errorCode);
-                handle_regdeny(errorCode);
-            }
-            else
-            {
-                printf("Unknown OSC message:\n");
-                msg->print();
-            }
+            qDebug("Renderer received regconfirm from SAM");
+            handle_regconfirm();
+            break;
         }
-        else
+
+        case OSC_REGDENY: // /sam/render/regdeny
         {
-            printf("Unknown OSC message:\n");
-            msg->print();
+            OscArg arg;
+            msg->getArg(0, arg);
+            int errorCode = arg.val.i;
+            qWarning("Renderer SAM registration DENIED: error code = %d", errorCode);
+            handle_regdeny(errorCode);
+            break;
         }
-    }
-    else if (qstrncmp(address + prefixLen, "stream", 6) == 0)
-    {
-        // check third level of address
-        if (qstrcmp(address + prefixLen + 6, "/add") == 0) // /sam/stream/add
+
+        case OSC_STREAM_ADD: // /sam/stream/add
         {
-            if (msg->typeStartsWith("iiii"))
+            SamRenderStream stream;
+            OscArg arg;
+            msg->getArg(0, arg);
+            stream.id = arg.val.i;
+            msg->getArg(1, arg);
+            stream.renderType = arg.val.i;
+            msg->getArg(2, arg);
+            stream.renderPreset = arg.val.i;
+            msg->getArg(3, arg);
+            stream.numChannels = arg.val.i;
+            stream.channels = new int[stream.numChannels];
+            for (int ch = 0; ch < stream.numChannels; ch++)
             {
-                SamRenderStream stream;
-                OscArg arg;
-                msg->getArg(0, arg);
-                stream.id = arg.val.i;
-                msg->getArg(1, arg);
-                stream.renderType = arg.val.i;
-                msg->getArg(2, arg);
-                stream.renderPreset = arg.val.i;
-                msg->getArg(3, arg);
-                stream.numChannels = arg.val.i;
-                stream.channels = new int[stream.numChannels];
-                for (int ch = 0; ch < stream.numChannels; ch++)
+                if (!msg->getArg(ch + 4, arg))
                 {
-                    if (!msg->getArg(ch + 4, arg))
-                    {
-                        qWarning("Couldn't parse channel %d from stream added OSC message:", ch);
-                        msg->print();
-                        delete msg;
-                        return;
-                    }
-                    else if (arg.type != 'i')
-                    {
-                        qWarning("Channel %d from stream added OSC message had type %c instead of i", ch, arg.type);
-                        msg->print();
-                        delete msg;
-                        return;
-                    }
-                    stream.channels[ch] = arg.val.i;
-                }
-                qDebug("Received request to add stream with id = %d, type = %d, preset = %d, numChannels = %d", stream.id, stream.renderType, stream.renderPreset, stream.numChannels);
-
-                // call stream added callback
-                if (m_streamAddedCallback)
-                {
-                    m_streamAddedCallback(stream, m_streamAddedCallbackArg);
+                    qWarning("Couldn't parse channel %d from stream added OSC message:", ch);
+                    msg->print();
+                    delete[] stream.channels;
+                    delete msg;
+                    return;
                 }
-
-                if (stream.channels)
+                else if (arg.type != 'i')
                 {
+                    qWarning("Channel %d from stream added OSC message had type %c instead of i", ch, arg.type);
+                    msg->print();
                     delete[] stream.channels;
-                    stream.channels = NULL;
+                    delete msg;
+                    return;
                 }
+                stream.channels[ch] = arg.val.i;
             }
-            else
+            qDebug("Received request to add stream with id = %d, type = %d, preset = %d, numChannels = %d", stream.id, stream.renderType, stream.renderPreset, stream.numChannels);
+
+            // call stream added callback
+            if (m_streamAddedCallback)
             {
-                printf("Unknown OSC message:\n");
-                msg->print();
+                m_streamAddedCallback(stream, m_streamAddedCallbackArg);
             }
-        }
-        else if (qstrcmp(address + prefixLen + 6, "/remove") == 0) // /sam/stream/remove)
-        {
-            if (msg->typeMatches("i"))
-            {
-                OscArg arg;
-                msg->getArg(0, arg);
-                int id = arg.val.i;
-                qDebug("Received request to remove stream with id = %d", id);
 
-                // call stream removed callback
-                if (m_streamRemovedCallback)
-                {
-                    m_streamRemovedCallback(id, m_streamRemovedCallbackArg);
-                }
-            }
-            else
+            if (stream.channels)
             {
-                printf("Unknown OSC message:\n");
-                msg->print();
+                delete[] stream.channels;
+                stream.channels = NULL;
             }
+            break;
         }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-        }
-    }
-    else if (qstrncmp(address + prefixLen, "val", 3) == 0)
-    {
-        // check third level of address
-        if (qstrcmp(address + prefixLen + 3, "/position") == 0) // /sam/val/position
+
+        case OSC_STREAM_REMOVE: // /sam/stream/remove
         {
-            if (msg->typeMatches("iiiiii"))
-            {
-                OscArg arg;
-                msg->getArg(0, arg);
-                int id = arg.val.i;
-                msg->getArg(1, arg);
-                int x = arg.val.i;
-                msg->getArg(2, arg);
-                int y = arg.val.i;
-                msg->getArg(3, arg);
-                int width = arg.val.i;
-                msg->getArg(4, arg);
-                int height = arg.val.i;
-                msg->getArg(5, arg);
-                int depth = arg.val.i;
-                qDebug("Received message from SAM that position of stream with ID %d changed.\nx = %d, y = %d, width = %d, height = %d, depth = %d", id, x, y, width, height, depth);
-
-                // call position callback
-                if (m_positionCallback)
-                {
-                    m_positionCallback(id, x, y, width, height, depth, m_positionCallbackArg);
-                }
-            }
-            else
+            OscArg arg;
+            msg->getArg(0, arg);
+            int id = arg.val.i;
+            qDebug("Received request to remove stream with id = %d", id);
+
+            // call stream removed callback
+            if (m_streamRemovedCallback)
             {
-                printf("Unknown OSC message:\n");
-                msg->print();
+                m_streamRemovedCallback(id, m_streamRemovedCallbackArg);
             }
+            break;
         }
-        else if (qstrcmp(address + prefixLen + 3, "/type") == 0) // /sam/val/type
+
+        case OSC_VAL_POSITION: // /sam/val/position
         {
-            if (msg->typeMatches("iii"))
+            OscArg arg;
+            msg->getArg(0, arg);
+            int id = arg.val.i;
+            msg->getArg(1, arg);
+            int x = arg.val.i;
+            msg->getArg(2, arg);
+            int y = arg.val.i;
+            msg->getArg(3, arg);
+            int width = arg.val.i;
+            msg->getArg(4, arg);
+            int height = arg.val.i;
+            msg->getArg(5, arg);
+            int depth = arg.val.i;
+            qDebug("Received message from SAM that position of stream with ID %d changed.\nx = %d, y = %d, width = %d, height = %d, depth = %d", id, x, y, width, height, depth);
+
+            // call position callback
+            if (m_positionCallback)
             {
-                OscArg arg;
-                msg->getArg(0, arg);
-                int id = arg.val.i;
-                msg->getArg(1, arg);
-                int type = arg.val.i;
-                msg->getArg(2, arg);
-                int preset = arg.val.i;
-                qDebug("Received message from SAM that stream %d has type %d, preset %d", id, type, preset);
-
-                // call type callback
-                if (m_typeCallback)
-                {
-                    m_typeCallback(id, type, preset, m_typeCallbackArg);
-                }
+                m_positionCallback(id, x, y, width, height, depth, m_positionCallbackArg);
             }
-            else
+            break;
+        }
+
+        case OSC_VAL_TYPE: // /sam/val/type
+        {
+            OscArg arg;
+            msg->getArg(0, arg);
+            int id = arg.val.i;
+            msg->getArg(1, arg);
+            int type = arg.val.i;
+            msg->getArg(2, arg);
+            int preset = arg.val.i;
+            qDebug("Received message from SAM that stream %d has type %d, preset %d", id, type, preset);
+
+            // call type callback
+            if (m_typeCallback)
             {
-                printf("Unknown OSC message:\n");
-                msg->print();
+                m_typeCallback(id, type, preset, m_typeCallbackArg);
             }
+            break;
         }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
         }
     }
-    else
-    {
-        printf("Unknown OSC message:\n");
-        msg->print();
-    }
     delete msg;
 }
 
@@ -325,6 +325,7 @@ private:
     QTcpSocket m_socket;              ///< Socket for sending and receiving OSC messages
     bool m_responseReceived;          ///< whether or not SAM responded to request
     OscTcpSocketReader* m_oscReader;  ///< OSC-reading helper
+    OscDispatcher m_oscDispatcher;    ///< routes incoming OSC messages to handlers
 
     // for callbacks
     StreamAddedCallback m_streamAddedCallback;      ///< the /sam/stream/add callback function
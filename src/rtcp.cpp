@@ -42,7 +42,11 @@
  * MODIFICATIONS.
  */
 
+#include <string.h>
+#include <time.h>
+
 #include <QDataStream>
+#include <QDateTime>
 #include <QUdpSocket>
 #include <QtEndian>
 #include <QDebug>
@@ -60,6 +64,7 @@ RtcpHandler::RtcpHandler(quint16 localPort, quint32 ssrc, const QString& remoteA
     m_remotePort(remotePort)
 {
     m_remoteHost.setAddress(remoteAddress);
+    memset(&m_senderReport, 0, sizeof(m_senderReport));
 }
 
 RtcpHandler::~RtcpHandler() 
@@ -72,7 +77,8 @@ bool RtcpHandler::start()
 {
     // init RTCP socket
     m_socket = new QUdpSocket(this);
-    if (!m_socket->bind(m_localPort))
+    bool bound = m_multicastGroup.isNull() ? m_socket->bind(m_localPort) : bindMulticast(m_socket, m_localPort, m_multicastGroup);
+    if (!bound)
     {
         QByteArray errArray = m_socket->errorString().toLocal8Bit();
         qWarning("RtcpHandler::start RTCP socket couldn't bind to port %d: %s", m_localPort, errArray.constData());
@@ -89,9 +95,9 @@ bool RtcpHandler::start()
     return true;
 }
 
-void RtcpHandler::sendSenderReport(qint64 currentTimeMillis, quint32 currentTimeSecs, quint32 timestamp, quint32 packetsSent, quint32 octetsSent)
+void RtcpHandler::sendSenderReport(quint32 ntpSeconds, quint32 ntpFraction, quint32 timestamp, quint32 packetsSent, quint32 octetsSent)
 {
-    if (m_remoteHost.isNull())
+    if (m_remoteHost.isNull() && m_remotes.isEmpty())
     {
         qWarning("RtcpHandler::sendSenderReport NOT sending RTCP sender report: remote host is NULL!  ssrc = %u, local port = %u", m_ssrc, m_localPort);
         return;
@@ -118,15 +124,11 @@ void RtcpHandler::sendSenderReport(qint64 currentTimeMillis, quint32 currentTime
     stream << m_ssrc;
     
     // write NTP timestamp (64 bits)
-    quint32 millisDiff = currentTimeMillis - (currentTimeSecs * 1000);
-    float currentTimeMillisFloat = millisDiff / (float)1000.0f;
-    quint32 currentTimeMillisFixed = currentTimeMillisFloat * 4294967295ul; // convert from [0.0, 1.0] to [0 (2^32)-1]
-    currentTimeSecs += 2208988800ul; // add 2,208,988,800 to convert seconds since 1970 to seconds since 1900
-    stream << currentTimeSecs; 
-    stream << currentTimeMillisFixed;
-    qDebug("RtcpHandler::sendSenderReport NTP timestamp seconds = %u, millis float = %0.4f, fixed = %u", currentTimeSecs, currentTimeMillisFloat, currentTimeMillisFixed);
+    stream << ntpSeconds;
+    stream << ntpFraction;
+    qDebug("RtcpHandler::sendSenderReport NTP timestamp seconds = %u, fraction = %u", ntpSeconds, ntpFraction);
     
-    // write rtp timestamp (32 bits) // TODO: this should be actual media clock time synchronized with NTP time above
+    // write rtp timestamp (32 bits), the sender's media clock at the time of the NTP timestamp
     stream << timestamp;
     qDebug("RtcpHandler::sendSenderReport RTP timestamp = %u", timestamp);
     
@@ -140,14 +142,14 @@ void RtcpHandler::sendSenderReport(qint64 currentTimeMillis, quint32 currentTime
     
     qDebug("RtcpHandler::sendSenderReport sending packet with length %d bytes", data.length());
     
-    // send packet
-    if (m_socket->writeDatagram(data, m_remoteHost, m_remotePort) < 0)
+    // send packet to every receiver
+    if (!send_to_remotes(data))
     {
         qWarning("RtcpHandler::sendSenderReport couldn't write datagram");
     }
 }
 
-void RtcpHandler::sendReceiverReport(quint32 senderSsrc, qint64 firstSeqNumThisInt, qint64 maxSeqNumThisInt, quint64 packetsThisInt, quint32 firstSeqNum, quint64 maxExtendedSeqNum, quint64 packets, quint32 jitter, quint32 lastSenderTimestamp, qint64 delayMillis)
+void RtcpHandler::sendReceiverReport(quint32 senderSsrc, qint64 firstSeqNumThisInt, qint64 maxSeqNumThisInt, quint64 packetsThisInt, quint32 firstSeqNum, quint64 maxExtendedSeqNum, quint64 packets, quint32 jitter, quint32 lastSenderTimestamp, qint64 delayMicros)
 {
     if (m_remoteHost.isNull())
     {
@@ -209,11 +211,11 @@ void RtcpHandler::sendReceiverReport(quint32 senderSsrc, qint64 firstSeqNumThisI
     // write last sender report timestamp
     stream << lastSenderTimestamp;
     
-    // write last sender report delay
-    quint32 lastSenderDelay = (delayMillis * 65536) / 1000; // units of 1/65536 seconds
+    // write last sender report delay (zero if no sender report has been received yet)
+    quint32 lastSenderDelay = (lastSenderTimestamp == 0) ? 0 : (delayMicros * 65536) / 1000000; // units of 1/65536 seconds
     stream << lastSenderDelay;
     
-    //qDebug() << "RtcpHandler::sendReceiverReport last sender timestamp = " << lastSenderTimestamp << ", last sender delay in millis = " << delayMillis << ", last sender delay = " << lastSenderDelay;
+    //qDebug() << "RtcpHandler::sendReceiverReport last sender timestamp = " << lastSenderTimestamp << ", last sender delay in micros = " << delayMicros << ", last sender delay = " << lastSenderDelay;
     
     //qDebug() << "RtcpHandler::sendReceiverReport sending packet with length " << data.length() << " bytes, to host " << m_remoteHost << ", port " << m_remotePort;
     
@@ -265,10 +267,15 @@ void RtcpHandler::readPendingDatagrams()
         {
         case RTCP_RR_PACKET_TYPE:
             //qDebug("RtcpHandler::readPendingDatagrams: received RTCP RECEIVER REPORT");
-            read_receiver_report(stream);
+            read_receiver_report(stream, sender);
             break;
         case RTCP_SR_PACKET_TYPE:
             //qDebug("RtcpHandler::readPendingDatagrams: received RTCP SENDER REPORT");
+            if (!m_remoteHost.isNull() && sender == m_remoteHost)
+            {
+                // reply to the port the sender reports from, which may not match ours (e.g. a stream fanned out to several SAMs)
+                m_remotePort = senderPort;
+            }
             read_sender_report(stream);
             break;
         default:
@@ -278,7 +285,7 @@ void RtcpHandler::readPendingDatagrams()
     }
 }
 
-void RtcpHandler::read_receiver_report(QDataStream& stream)
+void RtcpHandler::read_receiver_report(QDataStream& stream, const QHostAddress& sender)
 {
     // TODO: gracefully handle malformed packet (not enough data to read), or validate datagram size before reading
     
@@ -339,9 +346,146 @@ void RtcpHandler::read_receiver_report(QDataStream& stream)
 
     qDebug("RtcpHandler::read_receiver_report last sender timestamp = %u, last sender delay = %u", m_receiverReport.lastSenderTimestamp, m_receiverReport.lastSenderDelay);
 
+    // round-trip time (RFC 3550 section 6.4.1): arrival time - LSR - DLSR, all in units of 1/65536 seconds
+    // taken from the middle 32 bits of our own NTP clock, so the receiver's clock doesn't need to be synchronized
+    qint32 roundTripMicros = -1;
+    if (m_receiverReport.lastSenderTimestamp != 0)
+    {
+        qint32 roundTrip = ntpMiddle(ntpNow()) - m_receiverReport.lastSenderTimestamp - m_receiverReport.lastSenderDelay;
+        if (roundTrip >= 0)
+        {
+            roundTripMicros = ((qint64)roundTrip * 1000000) >> 16;
+        }
+        qDebug("RtcpHandler::read_receiver_report round-trip time = %d microseconds", roundTripMicros);
+    }
+
+    aggregate_receiver_report(sender, roundTripMicros);
     emit receiverReportReceived();
 }
 
+void RtcpHandler::addRemoteHost(const QHostAddress& host, quint16 port)
+{
+    RtcpRemote remote;
+    remote.host = host;
+    remote.port = port;
+    m_remotes.append(remote);
+}
+
+int RtcpHandler::removeRemoteHost(const QHostAddress& host)
+{
+    int removed = 0;
+    if (m_remoteHost == host)
+    {
+        m_remoteHost.clear();
+        removed++;
+    }
+    for (int i = m_remotes.size() - 1; i >= 0; i--)
+    {
+        if (m_remotes[i].host == host)
+        {
+            m_remotes.remove(i);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+bool RtcpHandler::bindMulticast(QUdpSocket* socket, quint16 port, const QHostAddress& group)
+{
+#if QT_VERSION >= 0x050000
+    // a dual-stack socket can't join an IPv4 group, so bind to the group's protocol
+    QHostAddress any = (group.protocol() == QAbstractSocket::IPv6Protocol) ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4;
+#else
+    QHostAddress any = QHostAddress::Any;
+#endif
+    if (!socket->bind(any, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint))
+    {
+        return false;
+    }
+    return socket->joinMulticastGroup(group);
+}
+
+bool RtcpHandler::getReceiverSummary(RtcpReceiverSummary& summary)
+{
+    summary.numReceivers = 0;
+    summary.maxLossFraction = 0;
+    summary.maxPacketsLost = 0;
+    summary.maxJitter = 0;
+    summary.minExtendedSeqNum = 0;
+    summary.maxRoundTripMicros = -1;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < m_reporters.size(); i++)
+    {
+        if (now - m_reporters[i].lastReportMillis > RTCP_REPORTER_TIMEOUT_MILLIS) continue;
+        const RtcpReceiverReport& report = m_reporters[i].report;
+        if (summary.numReceivers == 0 || (qint32)(report.maxExtendedSeqNum - summary.minExtendedSeqNum) < 0)
+        {
+            summary.minExtendedSeqNum = report.maxExtendedSeqNum;
+        }
+        summary.maxLossFraction = qMax(summary.maxLossFraction, report.lossFraction);
+        summary.maxPacketsLost = qMax(summary.maxPacketsLost, report.packetsLost);
+        summary.maxJitter = qMax(summary.maxJitter, report.jitter);
+        summary.maxRoundTripMicros = qMax(summary.maxRoundTripMicros, m_reporters[i].roundTripMicros);
+        summary.numReceivers++;
+    }
+    return summary.numReceivers > 0;
+}
+
+quint64 RtcpHandler::ntpNow()
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    quint64 seconds = (quint64)now.tv_sec + NTP_UNIX_OFFSET_SECS;
+    quint64 fraction = ((quint64)now.tv_nsec << 32) / 1000000000; // convert from [0, 10^9) to [0, 2^32)
+    return (seconds << 32) | fraction;
+}
+
+void RtcpHandler::aggregate_receiver_report(const QHostAddress& sender, qint32 roundTripMicros)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = m_reporters.size() - 1; i >= 0; i--)
+    {
+        if (m_reporters[i].host == sender && m_reporters[i].report.reporterSsrc == m_receiverReport.reporterSsrc)
+        {
+            m_reporters[i].report = m_receiverReport;
+            m_reporters[i].lastReportMillis = now;
+            m_reporters[i].roundTripMicros = roundTripMicros;
+            return;
+        }
+        if (now - m_reporters[i].lastReportMillis > RTCP_REPORTER_TIMEOUT_MILLIS)
+        {
+            // forget receivers that have stopped reporting
+            m_reporters.remove(i);
+        }
+    }
+
+    RtcpReporter reporter;
+    reporter.host = sender;
+    reporter.report = m_receiverReport;
+    reporter.lastReportMillis = now;
+    reporter.roundTripMicros = roundTripMicros;
+    m_reporters.append(reporter);
+    qDebug("RtcpHandler::aggregate_receiver_report now receiving reports from %d receivers", m_reporters.size());
+}
+
+bool RtcpHandler::send_to_remotes(const QByteArray& data)
+{
+    bool success = true;
+    if (!m_remoteHost.isNull() && m_socket->writeDatagram(data, m_remoteHost, m_remotePort) < 0)
+    {
+        success = false;
+    }
+    for (int i = 0; i < m_remotes.size(); i++)
+    {
+        if (m_socket->writeDatagram(data, m_remotes[i].host, m_remotes[i].port) < 0)
+        {
+            success = false;
+        }
+    }
+    return success;
+}
+
 void RtcpHandler::read_sender_report(QDataStream& stream)
 {
     // TODO: gracefully handle malformed packet (not enough data to read), or validate datagram size before reading
@@ -362,9 +506,8 @@ void RtcpHandler::read_sender_report(QDataStream& stream)
 
     // read NTP timestamp (64 bits)
     stream >> m_senderReport.ntpSeconds; 
-    stream >> m_senderReport.ntpMillis;
-    //float ntpMillis = m_senderReport.ntpMillis / (float)4294967296.0f; // convert from [0 2^32]to [0.0, 1.0]
-    //qDebug("RtcpHandler::read_sender_report NTP timestamp seconds = %u, millis float = %0.4f, fixed = %u", m_senderReport.ntpSeconds, ntpMillis, m_senderReport.ntpMillis);
+    stream >> m_senderReport.ntpFraction;
+    //qDebug("RtcpHandler::read_sender_report NTP timestamp seconds = %u, fraction = %u", m_senderReport.ntpSeconds, m_senderReport.ntpFraction);
 
     // read rtp timestamp (32 bits)
     stream >> m_senderReport.rtpTimestamp;
@@ -378,7 +521,7 @@ void RtcpHandler::read_sender_report(QDataStream& stream)
 
     //qDebug("RtcpHandler::read_sender_report packets sent = %u, octets sent = %u", m_senderReport.packetsSent, m_senderReport.octetsSent);
 
-    quint32 lastSenderTimestamp = (( m_senderReport.ntpSeconds & 0xFF00) << 16) | ( m_senderReport.ntpMillis >> 16); // middle 32 bits from NTP timestamp
+    quint32 lastSenderTimestamp = ntpMiddle(((quint64)m_senderReport.ntpSeconds << 32) | m_senderReport.ntpFraction);
 
     emit senderReportReceived(lastSenderTimestamp);
 }
@@ -47,6 +47,7 @@
 
 #include <QObject>
 #include <QHostAddress>
+#include <QVector>
 
 class QUdpSocket;
 
@@ -55,6 +56,8 @@ namespace sam
 
 static const quint8 RTCP_SR_PACKET_TYPE = 200; // sender report packet type
 static const quint8 RTCP_RR_PACKET_TYPE = 201; // receiver report packet type
+static const qint64 RTCP_REPORTER_TIMEOUT_MILLIS = 30000; // milliseconds without a report before a receiver is no longer counted
+static const quint32 NTP_UNIX_OFFSET_SECS = 2208988800ul; // seconds from 1900 (NTP epoch) to 1970 (Unix epoch)
 
 /**
  * @struct RtcpReceiverReport
@@ -72,6 +75,43 @@ struct RtcpReceiverReport
     quint32 lastSenderDelay;        ///< delay since last received sender report
 };
 
+/**
+ * @struct RtcpReporter
+ * An RtcpReporter holds the latest receiver report from one receiver of a stream.
+ */
+struct RtcpReporter
+{
+    QHostAddress host;              ///< address the reports come from
+    RtcpReceiverReport report;      ///< most recent receiver report
+    qint64 lastReportMillis;        ///< time the most recent report was received (milliseconds since the epoch)
+    qint32 roundTripMicros;         ///< round-trip time computed from the most recent report (-1 if unknown)
+};
+
+/**
+ * @struct RtcpReceiverSummary
+ * An RtcpReceiverSummary aggregates the latest receiver reports from all receivers of a stream
+ * (e.g. several SAMs receiving the same multicast or fanned-out stream).
+ */
+struct RtcpReceiverSummary
+{
+    int numReceivers;               ///< number of receivers that have reported recently
+    quint8 maxLossFraction;         ///< worst loss fraction reported for the last interval
+    qint32 maxPacketsLost;          ///< worst cumulative number of packets lost
+    quint32 maxJitter;              ///< worst interarrival jitter
+    quint32 minExtendedSeqNum;      ///< highest extended sequence number received by the slowest receiver
+    qint32 maxRoundTripMicros;      ///< worst round-trip time (-1 if no receiver has echoed a sender report yet)
+};
+
+/**
+ * @struct RtcpRemote
+ * An RtcpRemote is an additional host that RTCP reports are sent to.
+ */
+struct RtcpRemote
+{
+    QHostAddress host;  ///< remote address (may be a multicast group)
+    quint16 port;       ///< remote RTCP port
+};
+
 /**
  * @struct RtcpSenderReport
  * An RtcpSenderReport encapsulates an RTCP sender report.
@@ -80,8 +120,8 @@ struct RtcpSenderReport
 {
     quint32 reporterSsrc;   ///< SSRC of reporter (sender)
     quint32 ntpSeconds;     ///< timestamp seconds (in NTP format)
-    quint32 ntpMillis;      ///< timestamp milliseconds (in NTP format)
-    quint32 rtpTimestamp;   ///< RTP timestamp
+    quint32 ntpFraction;    ///< timestamp fraction of a second (in NTP format)
+    quint32 rtpTimestamp;   ///< RTP timestamp corresponding to the NTP timestamp
     quint32 packetsSent;    ///< cumulative number of packets sent by this sender
     quint32 octetsSent;     ///< cumulative number of bytes sent by this sender
 };
@@ -129,6 +169,69 @@ public:
      * @param host the remote host address
      */
     void setRemoteHost(QHostAddress& host) { m_remoteHost = host; }
+
+    /**
+     * Add another remote host to send reports to, e.g. a second receiver of a fanned-out stream.
+     * @param host the remote host address (may be a multicast group)
+     * @param port the remote host's RTCP port
+     */
+    void addRemoteHost(const QHostAddress& host, quint16 port);
+
+    /**
+     * Stop sending reports to a remote host.
+     * @param host the remote host address
+     * @return the number of remote hosts removed
+     */
+    int removeRemoteHost(const QHostAddress& host);
+
+    /**
+     * Set a multicast group to join when started, so that reports sent to the group are received.
+     * @param group the multicast group address
+     */
+    void setMulticastGroup(const QHostAddress& group) { m_multicastGroup = group; }
+
+    /**
+     * Bind a UDP socket so that it can share its port and join a multicast group.
+     * @param socket the socket to bind
+     * @param port the port to bind to
+     * @param group the multicast group to join
+     * @return true on success, false on failure
+     */
+    static bool bindMulticast(QUdpSocket* socket, quint16 port, const QHostAddress& group);
+
+    /**
+     * Get a summary of the latest receiver reports from all receivers that have reported recently.
+     * @param summary the summary to fill in
+     * @return true if at least one receiver has reported recently, false otherwise
+     */
+    bool getReceiverSummary(RtcpReceiverSummary& summary);
+
+    /**
+     * Get the most recently received sender report.
+     * @return the sender report (all zero if none has been received)
+     */
+    const RtcpSenderReport& getSenderReport() const { return m_senderReport; }
+
+    /**
+     * Get the current wall clock time as a 64-bit NTP timestamp (seconds since 1900 in the upper 32 bits,
+     * fraction of a second in the lower 32 bits), with the full resolution of the system clock.
+     * @return the NTP timestamp
+     */
+    static quint64 ntpNow();
+
+    /**
+     * Get the middle 32 bits of an NTP timestamp, as used for the LSR field of receiver reports.
+     * @param ntp the NTP timestamp
+     * @return the middle 32 bits (in units of 1/65536 seconds)
+     */
+    static quint32 ntpMiddle(quint64 ntp) { return (quint32)(ntp >> 16); }
+
+    /**
+     * Convert a difference between two NTP timestamps to microseconds.
+     * @param ntpDiff the difference (may be negative)
+     * @return the difference in microseconds
+     */
+    static qint64 ntpToMicros(qint64 ntpDiff) { return (qint64)(ntpDiff * (1000000.0 / 4294967296.0)); }
     
 signals:
     /**
@@ -150,13 +253,13 @@ protected slots:
 
     /**
      * Send a sender report.
-     * @param currentTimeMillis millisecond part of current time
-     * @param currentTimeSecs second part of current time
-     * @param timestamp current RTP timestamp
+     * @param ntpSeconds seconds part of the NTP timestamp (seconds since 1900)
+     * @param ntpFraction fraction part of the NTP timestamp (in units of 1/2^32 seconds)
+     * @param timestamp RTP timestamp of the sender's media clock at the time given by the NTP timestamp
      * @param packetsSent number of RTP packets sent since sender started sending
      * @param octetsSent number of bytes sent since sender started sending
      */
-    void sendSenderReport(qint64 currentTimeMillis, quint32 currentTimeSecs, quint32 timestamp, quint32 packetsSent, quint32 octetsSent);
+    void sendSenderReport(quint32 ntpSeconds, quint32 ntpFraction, quint32 timestamp, quint32 packetsSent, quint32 octetsSent);
     
     /**
      * Send a receiver report.
@@ -168,18 +271,33 @@ protected slots:
      * @param maxExtendedSeqNum the maximum extended sequence number received from this receiver's source
      * @param packets total number of packets received from this receiver's source
      * @param jitter current jitter measure for this receiver's source
-     * @param lastSenderTimestamp timestamp of last packet received from this receiver's source
-     * @param delayMillis number of milliseconds since last sender report was received from this receiver's source
+     * @param lastSenderTimestamp middle 32 bits of the NTP timestamp of the last sender report received from this receiver's source
+     * @param delayMicros number of microseconds since last sender report was received from this receiver's source
      */
-    void sendReceiverReport(quint32 senderSsrc, qint64 firstSeqNumThisInt, qint64 maxSeqNumThisInt, quint64 packetsThisInt, quint32 firstSeqNum, quint64 maxExtendedSeqNum, quint64 packets, quint32 jitter, quint32 lastSenderTimestamp, qint64 delayMillis);
+    void sendReceiverReport(quint32 senderSsrc, qint64 firstSeqNumThisInt, qint64 maxSeqNumThisInt, quint64 packetsThisInt, quint32 firstSeqNum, quint64 maxExtendedSeqNum, quint64 packets, quint32 jitter, quint32 lastSenderTimestamp, qint64 delayMicros);
 
 protected:
     
     /**
      * Read a receiver report.
      * @param stream the data stream to read the report from
+     * @param sender the address the report came from
+     */
+    void read_receiver_report(QDataStream& stream, const QHostAddress& sender);
+
+    /**
+     * Store the current receiver report with the latest reports from all receivers.
+     * @param sender the address the report came from
+     * @param roundTripMicros the round-trip time computed from the report (-1 if unknown)
+     */
+    void aggregate_receiver_report(const QHostAddress& sender, qint32 roundTripMicros);
+
+    /**
+     * Send an RTCP packet to all remote hosts.
+     * @param data the packet to send
+     * @return true if the packet was sent to every remote host, false otherwise
      */
-    void read_receiver_report(QDataStream& stream);
+    bool send_to_remotes(const QByteArray& data);
 
     /**
      * Read a sender report.
@@ -192,6 +310,9 @@ protected:
     quint32 m_ssrc;                     ///< SSRC of this sender or receiver
     QHostAddress m_remoteHost;          ///< address of remote host to send reports to
     quint16 m_remotePort;               ///< port of remote host to send reports to
+    QVector<RtcpRemote> m_remotes;      ///< additional remote hosts to send reports to
+    QHostAddress m_multicastGroup;      ///< multicast group to join (null if none)
+    QVector<RtcpReporter> m_reporters;  ///< latest receiver report from each receiver
     
     RtcpReceiverReport m_receiverReport; ///< current RTCP receiver report
     RtcpSenderReport m_senderReport;     ///< current RTCP sender report
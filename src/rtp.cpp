@@ -42,6 +42,8 @@
  * MODIFICATIONS.
  */
 
+#include <string.h>
+
 #include <QDataStream>
 #include <QtEndian>
 
@@ -51,6 +53,27 @@ namespace sam
 {
 static const float Q_16BIT = 32768.5;
 static const float Q_24BIT = 8388607.5;
+static const qint32 MAX_16BIT = 32767;
+static const qint32 MAX_24BIT = 8388607;
+
+/**
+ * Clip a sample to [-1.0, 1.0] and quantize it.
+ * @param x the sample
+ * @param scale the quantization scale (Q_16BIT or Q_24BIT)
+ * @param maxValue the largest value the quantized sample can hold
+ * @return the quantized sample
+ */
+static inline qint32 quantize(float x, float scale, qint32 maxValue)
+{
+    // hard clipping (NaN becomes silence rather than undefined behavior in the conversion)
+    if (x > 1.0f) x = 1.0f;
+    else if (x < -1.0f) x = -1.0f;
+    else if (x != x) x = 0.0f;
+
+    // full scale rounds to one past the largest value with the half-step scales, so clip that too
+    qint32 sample = (qint32)(x * scale);
+    return (sample > maxValue) ? maxValue : sample;
+}
 
 /* ----- RtpPacket implementation ----- */
 RtpPacket::RtpPacket() :
@@ -208,12 +231,8 @@ bool RtpPacket::setPayload(int numChannels, int numSamples, float** data)
         {
             for (int n = 0; n < numSamples; n++)
             {
-                // hard clipping
-                float floatSample = data[ch][n] > 1.0f ? 1.0f : data[ch][n];
-                floatSample = floatSample < -1.0f ? -1.0f : floatSample;
-
-                // quantization
-                qint16 sample = (qint16)(data[ch][n] * Q_16BIT);
+                // hard clipping and quantization
+                qint16 sample = (qint16)quantize(data[ch][n], Q_16BIT, MAX_16BIT);
                 stream << sample;
             }
         }
@@ -225,12 +244,8 @@ bool RtpPacket::setPayload(int numChannels, int numSamples, float** data)
         {
             for (int n = 0; n < numSamples; n++)
             {
-                // hard clipping
-                float floatSample = data[ch][n] > 1.0f ? 1.0f : data[ch][n];
-                floatSample = floatSample < -1.0f ? -1.0f : floatSample;
-
-                // quantization
-                qint32 sample = (qint32)(data[ch][n] * Q_24BIT);
+                // hard clipping and quantization
+                qint32 sample = quantize(data[ch][n], Q_24BIT, MAX_24BIT);
 
                 // convert to network byte order
                 quint8 sampleBytes[4];
@@ -338,4 +353,85 @@ bool RtpPacket::getPayload(int numChannels, int numSamples, float** data)
     return true;
 }
 
+int RtpPacket::getPayloadSize(quint8 payloadType, int numChannels, int numSamples)
+{
+    switch (payloadType)
+    {
+    case PAYLOAD_PCM_16:
+        return numChannels * numSamples * 2;
+    case PAYLOAD_PCM_24:
+        return numChannels * numSamples * 3;
+    case PAYLOAD_PCM_32:
+        return numChannels * numSamples * 4;
+    default:
+        return -1;
+    }
+}
+
+int RtpPacket::writeAudio(char* packet, int capacity, quint32 timestamp, quint16 sequenceNum, quint8 payloadType, quint32 ssrc, int numChannels, int numSamples, float** data)
+{
+    int payloadSize = getPayloadSize(payloadType, numChannels, numSamples);
+    if (payloadSize < 0 || RTP_HEADER_BYTES + payloadSize > capacity) return -1;
+
+    // write header (version 2, no padding, extensions or CSRCs)
+    uchar* out = (uchar*)packet;
+    out[0] = 128;
+    out[1] = payloadType & 127;
+    qToBigEndian(sequenceNum, out + 2);
+    qToBigEndian(timestamp, out + 4);
+    qToBigEndian(ssrc, out + 8);
+    out += RTP_HEADER_BYTES;
+
+    // write payload, quantizing exactly as setPayload does
+    switch (payloadType)
+    {
+    case PAYLOAD_PCM_16:
+    {
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            const float* in = data[ch];
+            for (int n = 0; n < numSamples; n++)
+            {
+                qint16 sample = (qint16)quantize(in[n], Q_16BIT, MAX_16BIT);
+                qToBigEndian(sample, out);
+                out += 2;
+            }
+        }
+        break;
+    }
+    case PAYLOAD_PCM_24:
+    {
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            const float* in = data[ch];
+            for (int n = 0; n < numSamples; n++)
+            {
+                qint32 sample = quantize(in[n], Q_24BIT, MAX_24BIT);
+                out[0] = (sample >> 16) & 0xFF;
+                out[1] = (sample >> 8) & 0xFF;
+                out[2] = sample & 0xFF;
+                out += 3;
+            }
+        }
+        break;
+    }
+    case PAYLOAD_PCM_32:
+    {
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            const float* in = data[ch];
+            for (int n = 0; n < numSamples; n++)
+            {
+                quint32 sampleBits;
+                memcpy(&sampleBits, &in[n], sizeof(sampleBits));
+                qToBigEndian(sampleBits, out);
+                out += 4;
+            }
+        }
+        break;
+    }
+    }
+    return RTP_HEADER_BYTES + payloadSize;
+}
+
 } // end of namespace SAM
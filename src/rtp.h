@@ -55,6 +55,7 @@ static const quint8 PAYLOAD_PCM_24 = 97; ///< signed 24-bit int
 static const quint8 PAYLOAD_PCM_32 = 98; ///< 32-bit float
 static const quint8 PAYLOAD_MIN = PAYLOAD_PCM_16;
 static const quint8 PAYLOAD_MAX = PAYLOAD_PCM_32;
+static const int RTP_HEADER_BYTES = 12; ///< size of an RTP header without CSRCs or extensions
 
 /**
  * @class RtpPacket
@@ -127,6 +128,32 @@ public:
      */
     bool getPayload(int numChannels, int numSamples, float** data);
 
+    /**
+     * Get the size of the payload for the given audio.
+     * @param payloadType the payload type
+     * @param numChannels the number of channels of audio data
+     * @param numSamples the number of samples of audio data
+     * @return the payload size in bytes, or -1 if the payload type is unknown
+     */
+    static int getPayloadSize(quint8 payloadType, int numChannels, int numSamples);
+
+    /**
+     * Write an RTP packet straight from audio data into a buffer in a single pass.
+     * The bytes written are the same as those written by init, setPayload and write, without
+     * any intermediate copies or allocation, so this can be called from an audio callback.
+     * @param packet the buffer to write to
+     * @param capacity the size of the buffer in bytes
+     * @param timestamp sending timestamp
+     * @param sequenceNum sequence number
+     * @param payloadType payload type
+     * @param ssrc sender SSRC
+     * @param numChannels the number of channels of audio data
+     * @param numSamples the number of samples of audio data
+     * @param data the audio data indexed as data[channel][sample]
+     * @return the number of bytes written, or -1 if the payload type is unknown or the buffer is too small
+     */
+    static int writeAudio(char* packet, int capacity, quint32 timestamp, quint16 sequenceNum, quint8 payloadType, quint32 ssrc, int numChannels, int numSamples, float** data);
+
     RtpPacket* m_next;          ///< pointer to next packet in queue
     quint32 m_arrivalTime;      ///< arrival time
     quint32 m_timestamp;        ///< timestamp
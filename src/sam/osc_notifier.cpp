@@ -0,0 +1,372 @@
+/**
+ * @file osc_notifier.cpp
+ * OSC notification fan-out implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <string.h>
+
+#include <QDebug>
+
+#include "osc_notifier.h"
+
+#ifdef Q_OS_LINUX
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace sam
+{
+
+static const int FLUSH_INTERVAL_MILLIS = 5;             // how long notifications are coalesced before being sent
+static const qint64 MAX_TCP_BACKLOG_BYTES = 64 * 1024;  // unsent bytes at which a TCP subscriber is considered backed up
+static const int UDP_BATCH_SIZE = 64;                   // maximum number of datagrams per sendmmsg call
+static const int MAX_TCP_DEFERRED = 256;                // deferred messages at which a backed-up TCP subscriber is dropped
+
+#ifdef Q_OS_LINUX
+/**
+ * Fill in the socket address of a subscriber, in the address family of the socket it will be sent from.
+ * @param dest the subscriber
+ * @param family the address family of the sending socket
+ * @param v6Only true if an AF_INET6 sending socket can't send to IPv4 (IPv4-mapped) addresses
+ * @param addr the socket address to fill in
+ * @return the length of the socket address, or 0 if the subscriber can't be sent to from that socket
+ */
+static socklen_t make_sockaddr(const OscAddress& dest, int family, bool v6Only, struct sockaddr_storage& addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    bool isIPv4 = (dest.host.protocol() == QAbstractSocket::IPv4Protocol);
+    if (family == AF_INET)
+    {
+        if (!isIPv4) return 0;
+        struct sockaddr_in* addr4 = (struct sockaddr_in*)&addr;
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(dest.port);
+        addr4->sin_addr.s_addr = htonl(dest.host.toIPv4Address());
+        return sizeof(struct sockaddr_in);
+    }
+    if (family == AF_INET6)
+    {
+        struct sockaddr_in6* addr6 = (struct sockaddr_in6*)&addr;
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(dest.port);
+        if (isIPv4)
+        {
+            // a dual-stack socket (Qt 5 binds QHostAddress::Any this way) sends to IPv4 through mapped addresses
+            if (v6Only) return 0;
+            quint32 ip = htonl(dest.host.toIPv4Address());
+            addr6->sin6_addr.s6_addr[10] = 0xff;
+            addr6->sin6_addr.s6_addr[11] = 0xff;
+            memcpy(&addr6->sin6_addr.s6_addr[12], &ip, sizeof(ip));
+        }
+        else
+        {
+            // leave scoped (link-local) addresses to QUdpSocket
+            if (dest.host.protocol() != QAbstractSocket::IPv6Protocol || !dest.host.scopeId().isEmpty()) return 0;
+            Q_IPV6ADDR ip = dest.host.toIPv6Address();
+            memcpy(addr6->sin6_addr.s6_addr, &ip, sizeof(ip));
+        }
+        return sizeof(struct sockaddr_in6);
+    }
+    return 0;
+}
+#endif
+
+OscNotifier::OscNotifier(QObject* parent) :
+    QObject(parent),
+    m_udpSocket(NULL),
+    m_udpFamily(-1),
+    m_udpV6Only(false),
+    m_tcpDeferred(0),
+    m_tcpDropped(0)
+{
+    m_udpSocket = new QUdpSocket(this);
+    if (!m_udpSocket->bind())
+    {
+        QByteArray errArray = m_udpSocket->errorString().toLocal8Bit();
+        qWarning("OscNotifier::OscNotifier couldn't bind UDP socket: %s", errArray.constData());
+    }
+#ifdef Q_OS_LINUX
+    else
+    {
+        // sendmmsg needs socket addresses in the family the socket was actually bound with
+        // (AF_INET under Qt 4, usually a dual-stack AF_INET6 socket under Qt 5)
+        int fd = (int)m_udpSocket->socketDescriptor();
+        struct sockaddr_storage local;
+        socklen_t localLen = sizeof(local);
+        if (fd >= 0 && getsockname(fd, (struct sockaddr*)&local, &localLen) == 0)
+        {
+            m_udpFamily = local.ss_family;
+        }
+        int v6Only = 0;
+        socklen_t optLen = sizeof(v6Only);
+        if (m_udpFamily == AF_INET6 && getsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, &optLen) == 0)
+        {
+            m_udpV6Only = (v6Only != 0);
+        }
+    }
+#endif
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_INTERVAL_MILLIS);
+    connect(&m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+OscNotifier::~OscNotifier()
+{
+    flush();
+}
+
+bool OscNotifier::notify(quint32 key, OscMessage* msg, const QVector<OscAddress*>& subscribers, const QVector<QTcpSocket*>& subscribersTcp)
+{
+    if (!msg) return false;
+    if (subscribers.isEmpty() && subscribersTcp.isEmpty()) return true;
+
+    // replace an unsent message with the same key, or queue a new one
+    int index = -1;
+    if (key != NO_COALESCE)
+    {
+        index = m_pendingIndex.value(key, -1);
+    }
+    else
+    {
+        // later values must not be coalesced into messages queued before this one
+        m_pendingIndex.clear();
+    }
+    if (index < 0)
+    {
+        index = m_pending.size();
+        m_pending.resize(index + 1);
+        if (key != NO_COALESCE) m_pendingIndex.insert(key, index);
+    }
+
+    OscNotification& notification = m_pending[index];
+    notification.key = key;
+    if (!msg->write(notification.bytes))
+    {
+        qWarning("OscNotifier::notify couldn't write OSC message");
+        notification.udpDests.clear();
+        notification.tcpDests.clear();
+        return false;
+    }
+    notification.slipBytes.clear();
+
+    notification.udpDests.resize(subscribers.size());
+    for (int i = 0; i < subscribers.size(); i++)
+    {
+        notification.udpDests[i] = *subscribers[i];
+    }
+    notification.tcpDests.resize(subscribersTcp.size());
+    for (int i = 0; i < subscribersTcp.size(); i++)
+    {
+        notification.tcpDests[i] = subscribersTcp[i];
+    }
+
+    if (!m_flushTimer.isActive())
+    {
+        m_flushTimer.start();
+    }
+    return true;
+}
+
+void OscNotifier::flush()
+{
+    if (m_pending.isEmpty()) return;
+
+    QVector<OscNotification> deferred;
+    for (int i = 0; i < m_pending.size(); i++)
+    {
+        OscNotification& notification = m_pending[i];
+        send_udp(notification);
+        send_tcp(notification);
+        if (!notification.tcpDests.isEmpty())
+        {
+            // keep the message for subscribers that were backed up
+            notification.udpDests.clear();
+            deferred.append(notification);
+        }
+    }
+
+    QVector<QPointer<QTcpSocket> > dropped = drop_backed_up(deferred);
+
+    m_pending = deferred;
+    m_pendingIndex.clear();
+    for (int i = 0; i < m_pending.size(); i++)
+    {
+        if (m_pending[i].key != NO_COALESCE) m_pendingIndex.insert(m_pending[i].key, i);
+    }
+    if (!m_pending.isEmpty())
+    {
+        m_flushTimer.start();
+    }
+
+    // disconnect last, since that may queue more notifications (e.g. a client being unregistered)
+    for (int i = 0; i < dropped.size(); i++)
+    {
+        if (dropped[i]) dropped[i]->abort();
+    }
+}
+
+void OscNotifier::send_udp(const OscNotification& notification)
+{
+    int numDests = notification.udpDests.size();
+    if (numDests == 0) return;
+
+    int sent = 0;
+#ifdef Q_OS_LINUX
+    // send to subscribers in batches with a single system call each
+    int fd = (int)m_udpSocket->socketDescriptor();
+    if (fd >= 0 && (m_udpFamily == AF_INET || m_udpFamily == AF_INET6))
+    {
+        struct sockaddr_storage addrs[UDP_BATCH_SIZE];
+        struct iovec iov;
+        struct mmsghdr msgs[UDP_BATCH_SIZE];
+        iov.iov_base = (void*)notification.bytes.constData();
+        iov.iov_len = notification.bytes.size();
+
+        while (sent < numDests)
+        {
+            int batch = 0;
+            while (sent + batch < numDests && batch < UDP_BATCH_SIZE)
+            {
+                const OscAddress& dest = notification.udpDests[sent + batch];
+                socklen_t addrLen = make_sockaddr(dest, m_udpFamily, m_udpV6Only, addrs[batch]);
+                if (addrLen == 0) break;
+                memset(&msgs[batch], 0, sizeof(msgs[batch]));
+                msgs[batch].msg_hdr.msg_name = &addrs[batch];
+                msgs[batch].msg_hdr.msg_namelen = addrLen;
+                msgs[batch].msg_hdr.msg_iov = &iov;
+                msgs[batch].msg_hdr.msg_iovlen = 1;
+                batch++;
+            }
+            if (batch == 0) break; // subscriber the socket can't address directly: fall back below
+
+            int result = sendmmsg(fd, msgs, batch, 0);
+            if (result <= 0)
+            {
+                qWarning("OscNotifier::send_udp sendmmsg failed");
+                break;
+            }
+            sent += result;
+        }
+    }
+#endif
+
+    // send any remaining datagrams individually
+    for (int i = sent; i < numDests; i++)
+    {
+        const OscAddress& dest = notification.udpDests[i];
+        if (m_udpSocket->writeDatagram(notification.bytes, dest.host, dest.port) != notification.bytes.size())
+        {
+            qWarning("Couldn't send OSC message");
+        }
+    }
+}
+
+void OscNotifier::send_tcp(OscNotification& notification)
+{
+    if (notification.tcpDests.isEmpty()) return;
+
+    if (notification.slipBytes.isEmpty())
+    {
+        notification.slipBytes = notification.bytes;
+        OscMessage::slipEncode(notification.slipBytes);
+        notification.slipBytes.prepend(SLIP_END);
+        notification.slipBytes.append(SLIP_END);
+    }
+
+    QVector<QPointer<QTcpSocket> > backedUp;
+    for (int i = 0; i < notification.tcpDests.size(); i++)
+    {
+        QTcpSocket* socket = notification.tcpDests[i];
+        if (!socket || socket->state() != QAbstractSocket::ConnectedState) continue; // subscriber has gone away
+
+        if (socket->bytesToWrite() > MAX_TCP_BACKLOG_BYTES)
+        {
+            backedUp.append(notification.tcpDests[i]);
+            m_tcpDeferred++;
+            continue;
+        }
+        if (socket->write(notification.slipBytes) != notification.slipBytes.size())
+        {
+            qWarning("Couldn't send OSC message");
+        }
+    }
+    notification.tcpDests = backedUp;
+}
+
+QVector<QPointer<QTcpSocket> > OscNotifier::drop_backed_up(QVector<OscNotification>& deferred)
+{
+    // count the messages each backed-up subscriber is still owed
+    QHash<QTcpSocket*, int> counts;
+    for (int i = 0; i < deferred.size(); i++)
+    {
+        for (int j = 0; j < deferred[i].tcpDests.size(); j++)
+        {
+            QTcpSocket* socket = deferred[i].tcpDests[j];
+            if (socket) counts[socket]++;
+        }
+    }
+
+    QVector<QPointer<QTcpSocket> > dropped;
+    for (QHash<QTcpSocket*, int>::const_iterator it = counts.constBegin(); it != counts.constEnd(); ++it)
+    {
+        if (it.value() <= MAX_TCP_DEFERRED) continue;
+        qWarning("OscNotifier::drop_backed_up dropping TCP subscriber that hasn't drained %d messages", it.value());
+        dropped.append(it.key());
+        m_tcpDropped++;
+    }
+    if (dropped.isEmpty()) return dropped;
+
+    // forget the dropped subscribers' messages
+    for (int i = deferred.size() - 1; i >= 0; i--)
+    {
+        QVector<QPointer<QTcpSocket> >& dests = deferred[i].tcpDests;
+        for (int j = dests.size() - 1; j >= 0; j--)
+        {
+            if (dropped.contains(dests[j])) dests.remove(j);
+        }
+        if (dests.isEmpty()) deferred.remove(i);
+    }
+    return dropped;
+}
+
+} // end of namespace sam
@@ -0,0 +1,196 @@
+/**
+ * @file osc_notifier.h
+ * OSC notification fan-out interface
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef OSC_NOTIFIER_H
+#define OSC_NOTIFIER_H
+
+#include <QHash>
+#include <QPointer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+
+#include "osc.h"
+
+namespace sam
+{
+
+/**
+ * @struct OscNotification
+ * This struct represents a written OSC message waiting to be sent to a set of subscribers.
+ */
+struct OscNotification
+{
+    quint32 key;                            ///< coalescing key (OscNotifier::NO_COALESCE if the message must always be sent)
+    QByteArray bytes;                       ///< the written OSC message
+    QByteArray slipBytes;                   ///< the SLIP-encoded message for TCP subscribers (encoded on first use)
+    QVector<OscAddress> udpDests;           ///< UDP subscribers still to be sent the message
+    QVector<QPointer<QTcpSocket> > tcpDests; ///< TCP subscribers still to be sent the message
+};
+
+/**
+ * @class OscNotifier
+ * @author agent
+ * @date October 2026
+ *
+ * An OscNotifier fans out OSC notifications (/sam/val/*, /sam/app/*, etc.) to subscribers.
+ *
+ * Each message is written once when it is queued, no matter how many subscribers it has.
+ * Queued messages are sent together on the next tick of a short timer, so a value that
+ * changes several times within a tick (e.g. while a volume fader is dragged) is only sent
+ * once, with its latest value.  UDP messages are sent from a single socket, batched with
+ * sendmmsg where available.  TCP subscribers whose send buffers are backed up are skipped
+ * until they drain, so a slow subscriber can't stall SAM's main thread; if a newer value
+ * replaces a message a slow subscriber hasn't been sent yet, that subscriber only gets the
+ * newer value.  A subscriber that stays backed up while messages that can't be replaced
+ * keep arriving is disconnected rather than holding them forever.
+ */
+class OscNotifier : public QObject
+{
+    Q_OBJECT
+public:
+
+    static const quint32 NO_COALESCE = 0xFFFFFFFF; ///< key for messages that must never be replaced (e.g. registration events)
+
+    /**
+     * Constructor.
+     * @param parent this notifier's parent QObject
+     */
+    OscNotifier(QObject* parent = NULL);
+
+    /**
+     * Destructor.
+     */
+    virtual ~OscNotifier();
+
+    /**
+     * Copy constructor (not used).
+     */
+    OscNotifier(const OscNotifier&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    OscNotifier& operator=(const OscNotifier&);
+
+    /**
+     * Make a coalescing key for a parameter of an app.
+     * @param param the parameter (a SamClientSubscription value, or another small number unique to the message type)
+     * @param id the app id, or -1 for global parameters
+     * @return the key
+     */
+    static quint32 makeKey(int param, int id) { return ((quint32)param << 16) | ((quint32)id & 0xFFFF); }
+
+    /**
+     * Queue a message to be sent to subscribers on the next tick.
+     * The message is written immediately, so the caller may reuse or delete it afterwards.
+     * @param key the coalescing key: an unsent message with the same key is replaced by this one
+     * (use NO_COALESCE for messages that must all be sent in order)
+     * @param msg the message to send
+     * @param subscribers the UDP subscribers to send to
+     * @param subscribersTcp the TCP subscribers to send to
+     * @return true on success, false if the message couldn't be written
+     */
+    bool notify(quint32 key, OscMessage* msg, const QVector<OscAddress*>& subscribers, const QVector<QTcpSocket*>& subscribersTcp = QVector<QTcpSocket*>());
+
+    /**
+     * Get the number of messages waiting to be sent.
+     * @return the number of queued messages
+     */
+    int getNumPending() const { return m_pending.size(); }
+
+    /**
+     * Get the number of TCP sends deferred because a subscriber was backed up.
+     * @return the number of deferred sends since this notifier was created
+     */
+    quint64 getNumTcpDeferred() const { return m_tcpDeferred; }
+
+    /**
+     * Get the number of TCP subscribers disconnected because they stopped draining.
+     * @return the number of dropped subscribers since this notifier was created
+     */
+    quint64 getNumTcpDropped() const { return m_tcpDropped; }
+
+public slots:
+
+    /**
+     * Send all queued messages.
+     */
+    void flush();
+
+protected:
+
+    /**
+     * Send a batch of UDP datagrams.
+     * @param notification the message to send
+     */
+    void send_udp(const OscNotification& notification);
+
+    /**
+     * Send a message to the TCP subscribers that aren't backed up.
+     * @param notification the message to send (sent subscribers are removed from it)
+     */
+    void send_tcp(OscNotification& notification);
+
+    /**
+     * Find TCP subscribers that are owed too many deferred messages, and forget those messages.
+     * @param deferred the messages kept for backed-up subscribers (updated)
+     * @return the subscribers to disconnect
+     */
+    QVector<QPointer<QTcpSocket> > drop_backed_up(QVector<OscNotification>& deferred);
+
+    QUdpSocket* m_udpSocket;            ///< socket all UDP notifications are sent from
+    int m_udpFamily;                    ///< address family m_udpSocket is bound with (-1 if unknown)
+    bool m_udpV6Only;                   ///< true if m_udpSocket is AF_INET6 and can't send to IPv4
+    QTimer m_flushTimer;                ///< single-shot timer for the next tick
+    QVector<OscNotification> m_pending; ///< queued messages, in the order they were first queued
+    QHash<quint32, int> m_pendingIndex; ///< index in m_pending of the queued message for each coalescing key
+    quint64 m_tcpDeferred;              ///< number of TCP sends deferred because a subscriber was backed up
+    quint64 m_tcpDropped;               ///< number of TCP subscribers disconnected because they stopped draining
+};
+
+} // end of namespace sam
+
+#endif // OSC_NOTIFIER_H
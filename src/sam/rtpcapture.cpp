@@ -0,0 +1,247 @@
+/**
+ * @file rtpcapture.cpp
+ * RTP packet capture implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rtpcapture.h"
+
+namespace sam
+{
+
+static const char CAPTURE_MAGIC[8] = {'S', 'A', 'M', 'R', 'T', 'P', 'C', '1'};
+static const int CAPTURE_HEADER_BYTES = 8 + 6 * 4;
+static const int RECORD_HEADER_BYTES = 4 + 2;
+static const qint64 MAP_CHUNK_BYTES = 16 << 20; // how much the file grows each time the mapped window fills
+
+static void put_le32(uchar* dest, quint32 val)
+{
+    dest[0] = val & 0xFF;
+    dest[1] = (val >> 8) & 0xFF;
+    dest[2] = (val >> 16) & 0xFF;
+    dest[3] = (val >> 24) & 0xFF;
+}
+
+static quint32 get_le32(const uchar* src)
+{
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((quint32)src[3] << 24);
+}
+
+RtpCapture::RtpCapture() :
+    m_writing(false),
+    m_map(NULL),
+    m_mapOffset(0),
+    m_mapSize(0),
+    m_mapPos(0),
+    m_numDatagrams(0)
+{
+}
+
+RtpCapture::~RtpCapture()
+{
+    close();
+}
+
+bool RtpCapture::create(const QString& path, const RtpCaptureInfo& info)
+{
+    close();
+
+    // never overwrite (or follow a link to) an existing file
+    QByteArray pathBytes = QFile::encodeName(path);
+    int fd = ::open(pathBytes.constData(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        qWarning("RtpCapture::create couldn't create %s: %s", pathBytes.constData(), strerror(errno));
+        return false;
+    }
+    m_file.setFileName(path);
+    if (!m_file.open(fd, QIODevice::ReadWrite, QFile::AutoCloseHandle))
+    {
+        qWarning("RtpCapture::create couldn't open %s", pathBytes.constData());
+        ::close(fd);
+        return false;
+    }
+    m_writing = true;
+    m_info = info;
+    m_numDatagrams = 0;
+
+    uchar header[CAPTURE_HEADER_BYTES];
+    memcpy(header, CAPTURE_MAGIC, 8);
+    put_le32(header + 8, info.channels);
+    put_le32(header + 12, info.sampleRate);
+    put_le32(header + 16, info.bufferSize);
+    put_le32(header + 20, info.packetQueueSize);
+    put_le32(header + 24, (quint32)info.clockSkewThreshold);
+    put_le32(header + 28, info.periodOrigin);
+    if (m_file.write((const char*)header, CAPTURE_HEADER_BYTES) != CAPTURE_HEADER_BYTES)
+    {
+        qWarning("RtpCapture::create couldn't write header");
+        close();
+        return false;
+    }
+
+    m_mapOffset = CAPTURE_HEADER_BYTES;
+    return grow_map(MAP_CHUNK_BYTES);
+}
+
+bool RtpCapture::open(const QString& path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        QByteArray pathBytes = path.toLocal8Bit();
+        qWarning("RtpCapture::open couldn't open %s", pathBytes.constData());
+        return false;
+    }
+    m_writing = false;
+    m_numDatagrams = 0;
+
+    m_mapSize = m_file.size();
+    m_map = (m_mapSize >= CAPTURE_HEADER_BYTES) ? m_file.map(0, m_mapSize) : NULL;
+    if (!m_map || memcmp(m_map, CAPTURE_MAGIC, 8) != 0)
+    {
+        qWarning("RtpCapture::open not a capture file");
+        close();
+        return false;
+    }
+    m_info.channels = get_le32(m_map + 8);
+    m_info.sampleRate = get_le32(m_map + 12);
+    m_info.bufferSize = get_le32(m_map + 16);
+    m_info.packetQueueSize = get_le32(m_map + 20);
+    m_info.clockSkewThreshold = (qint32)get_le32(m_map + 24);
+    m_info.periodOrigin = get_le32(m_map + 28);
+    m_mapOffset = 0;
+    m_mapPos = CAPTURE_HEADER_BYTES;
+    return true;
+}
+
+void RtpCapture::close()
+{
+    if (!m_file.isOpen()) return;
+
+    if (m_map)
+    {
+        m_file.unmap(m_map);
+        m_map = NULL;
+    }
+    if (m_writing)
+    {
+        // drop the unused part of the last chunk
+        m_file.resize(m_mapOffset + m_mapPos);
+    }
+    m_file.close();
+    m_mapOffset = 0;
+    m_mapSize = 0;
+    m_mapPos = 0;
+}
+
+bool RtpCapture::append(quint32 arrivalTime, const QByteArray& datagram)
+{
+    if (!m_writing || !m_file.isOpen()) return false;
+
+    qint64 bytes = RECORD_HEADER_BYTES + datagram.size();
+    if (datagram.size() > 0xFFFF) return false;
+    if (m_mapPos + bytes > m_mapSize && !grow_map(bytes)) return false;
+
+    uchar* record = m_map + m_mapPos;
+    put_le32(record, arrivalTime);
+    record[4] = datagram.size() & 0xFF;
+    record[5] = (datagram.size() >> 8) & 0xFF;
+    memcpy(record + RECORD_HEADER_BYTES, datagram.constData(), datagram.size());
+    m_mapPos += bytes;
+    m_numDatagrams++;
+    return true;
+}
+
+bool RtpCapture::next(quint32& arrivalTime, QByteArray& datagram)
+{
+    if (m_writing || !m_map) return false;
+    if (m_mapPos + RECORD_HEADER_BYTES > m_mapSize) return false;
+
+    const uchar* record = m_map + m_mapPos;
+    int size = record[4] | (record[5] << 8);
+    if (m_mapPos + RECORD_HEADER_BYTES + size > m_mapSize)
+    {
+        qWarning("RtpCapture::next capture file is truncated");
+        return false;
+    }
+    arrivalTime = get_le32(record);
+    datagram = QByteArray((const char*)record + RECORD_HEADER_BYTES, size);
+    m_mapPos += RECORD_HEADER_BYTES + size;
+    m_numDatagrams++;
+    return true;
+}
+
+bool RtpCapture::grow_map(qint64 bytes)
+{
+    if (m_map)
+    {
+        m_file.unmap(m_map);
+        m_map = NULL;
+    }
+
+    // start the new window where the data ends
+    m_mapOffset += m_mapPos;
+    m_mapPos = 0;
+    m_mapSize = (bytes > MAP_CHUNK_BYTES) ? bytes : MAP_CHUNK_BYTES;
+    if (!m_file.resize(m_mapOffset + m_mapSize))
+    {
+        qWarning("RtpCapture::grow_map couldn't grow capture file");
+        m_mapSize = 0;
+        return false;
+    }
+    m_map = m_file.map(m_mapOffset, m_mapSize);
+    if (!m_map)
+    {
+        qWarning("RtpCapture::grow_map couldn't map capture file");
+        m_mapSize = 0;
+        return false;
+    }
+    return true;
+}
+
+} // end of namespace sam
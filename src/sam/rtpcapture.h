@@ -0,0 +1,183 @@
+/**
+ * @file rtpcapture.h
+ * RTP packet capture interface
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef RTPCAPTURE_H
+#define RTPCAPTURE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+namespace sam
+{
+
+/**
+ * @struct RtpCaptureInfo
+ * This struct describes the receiver a capture was recorded from.
+ */
+struct RtpCaptureInfo
+{
+    RtpCaptureInfo() :
+        channels(0),
+        sampleRate(0),
+        bufferSize(0),
+        packetQueueSize(0),
+        clockSkewThreshold(0),
+        periodOrigin(0)
+    {}
+
+    quint32 channels;            ///< number of audio channels in the stream
+    quint32 sampleRate;          ///< receiver sample rate
+    quint32 bufferSize;          ///< receiver buffer size (JACK period)
+    quint32 packetQueueSize;     ///< receiver packet queue size
+    qint32 clockSkewThreshold;   ///< receiver clock skew threshold, in samples
+    quint32 periodOrigin;        ///< JACK frame time at the start of a period when the capture began
+};
+
+/**
+ * @class RtpCapture
+ * @author agent
+ * @date October 2026
+ *
+ * An RtpCapture is a compact log of RTP datagrams as they were received, each with its
+ * arrival time in JACK frames, for replaying a stream offline.  Datagrams are appended
+ * through a memory-mapped window that grows in large chunks, so capturing costs a copy
+ * per datagram rather than a system call.
+ *
+ * File format (little-endian): the 8-byte magic "SAMRTPC1", then the RtpCaptureInfo fields
+ * as 32-bit integers, then one record per datagram: arrival time (32 bits), datagram size
+ * (16 bits), datagram bytes.
+ */
+class RtpCapture
+{
+public:
+    /**
+     * Constructor.
+     */
+    RtpCapture();
+
+    /**
+     * Destructor.  Closes the capture file.
+     */
+    virtual ~RtpCapture();
+
+    /**
+     * Copy constructor (not used).
+     */
+    RtpCapture(const RtpCapture&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    RtpCapture& operator=(const RtpCapture&);
+
+    /**
+     * Create a capture file for writing.
+     * @param path the file to write (must not exist yet)
+     * @param info the receiver parameters to store in the file
+     * @return true on success, false on failure (including if the file already exists)
+     */
+    bool create(const QString& path, const RtpCaptureInfo& info);
+
+    /**
+     * Open a capture file for reading.
+     * @param path the file to read
+     * @return true on success, false on failure
+     */
+    bool open(const QString& path);
+
+    /**
+     * Close the capture file (trimming it to the data written, if writing).
+     */
+    void close();
+
+    /**
+     * Append a datagram to a capture file opened with create().
+     * @param arrivalTime the datagram's arrival time, in JACK frames
+     * @param datagram the datagram
+     * @return true on success, false on failure
+     */
+    bool append(quint32 arrivalTime, const QByteArray& datagram);
+
+    /**
+     * Read the next datagram from a capture file opened with open().
+     * @param arrivalTime set to the datagram's arrival time, in JACK frames
+     * @param datagram set to the datagram
+     * @return true if a datagram was read, false at the end of the file
+     */
+    bool next(quint32& arrivalTime, QByteArray& datagram);
+
+    /**
+     * Get the receiver parameters stored in the file.
+     * @return the receiver parameters
+     */
+    const RtpCaptureInfo& getInfo() const { return m_info; }
+
+    /**
+     * Get the number of datagrams appended or read so far.
+     * @return the number of datagrams
+     */
+    quint64 getNumDatagrams() const { return m_numDatagrams; }
+
+protected:
+    /**
+     * Map a new window at the end of the data written, large enough for at least the given number of bytes.
+     * @param bytes the number of bytes needed
+     * @return true on success, false on failure
+     */
+    bool grow_map(qint64 bytes);
+
+    QFile m_file;               ///< the capture file
+    RtpCaptureInfo m_info;      ///< receiver parameters
+    bool m_writing;             ///< true if opened with create(), false if opened with open()
+    uchar* m_map;               ///< mapped window of the file
+    qint64 m_mapOffset;         ///< file offset of the mapped window
+    qint64 m_mapSize;           ///< size of the mapped window
+    qint64 m_mapPos;            ///< read/write position within the mapped window
+    quint64 m_numDatagrams;     ///< datagrams appended or read
+};
+
+} // end of namespace sam
+
+#endif // RTPCAPTURE_H
@@ -69,7 +69,7 @@ RtpReceiver::RtpReceiver(quint16 portRtp,
                          qint32 bufferSize, 
                          quint32 packetQueueSize, 
                          qint32 clockSkewThreshold,
-                         jack_client_t* jackClient, 
+                         SamAudioBackend* audio, 
                          QObject *parent) :
     QObject(parent),
     m_socketRtp(NULL),
@@ -104,9 +104,16 @@ RtpReceiver::RtpReceiver(quint16 portRtp,
     m_packetsReceivedThisInt(0),
     m_reportInterval(reportInterval),
     m_lastSenderTimestamp(0),
+    m_latencyValid(false),
+    m_transitMicros(0),
+    m_playoutMicros(0),
+    m_periodsMissed(0),
+    m_packetsLate(0),
+    m_packetsSkipped(0),
     m_rtcpHandler(NULL),
-    m_jackClient(jackClient),
-    m_zeros(NULL)
+    m_audio(audio),
+    m_zeros(NULL),
+    m_capture(NULL)
 {
     // init RTP socket
     m_socketRtp = new QUdpSocket(this);
@@ -127,6 +134,8 @@ RtpReceiver::~RtpReceiver()
 {
     // sockets will be destroyed by parent
 
+    stopCapture();
+
     if (m_zeros)
     {
         delete[] m_zeros;
@@ -146,9 +155,16 @@ RtpReceiver::~RtpReceiver()
     }
 }
 
+void RtpReceiver::setMulticastGroup(const QHostAddress& group)
+{
+    m_multicastGroup = group;
+    m_rtcpHandler->setMulticastGroup(group);
+}
+
 bool RtpReceiver::start()
 {
-    if (!m_socketRtp->bind(m_portRtp))
+    bool bound = m_multicastGroup.isNull() ? m_socketRtp->bind(m_portRtp) : RtcpHandler::bindMulticast(m_socketRtp, m_portRtp, m_multicastGroup);
+    if (!bound)
     {
         QByteArray errArray = m_socketRtp->errorString().toLocal8Bit();
         qWarning("RtpReceiver::start() RTP socket couldn't bind to port %d: %s", m_portRtp, errArray.constData());
@@ -173,76 +189,138 @@ bool RtpReceiver::start()
     return m_rtcpHandler->start();
 }
 
+bool RtpReceiver::startCapture(const QString& path, int channels)
+{
+    if (m_capture)
+    {
+        qWarning("RtpReceiver::startCapture already capturing, RTP port = %d", m_portRtp);
+        return false;
+    }
+
+    RtpCaptureInfo info;
+    info.channels = channels;
+    info.sampleRate = m_sampleRate;
+    info.bufferSize = m_bufferSamples;
+    info.packetQueueSize = m_packetQueueSize;
+    info.clockSkewThreshold = m_clockSkewThreshold;
+    info.periodOrigin = m_audio ? m_audio->getLastFrameTime() : 0;
+
+    RtpCapture* capture = new RtpCapture();
+    if (!capture->create(path, info))
+    {
+        delete capture;
+        return false;
+    }
+    m_capture = capture;
+    return true;
+}
+
+void RtpReceiver::stopCapture()
+{
+    if (!m_capture) return;
+
+    qDebug("RtpReceiver::stopCapture captured %llu datagrams, RTP port = %d", m_capture->getNumDatagrams(), m_portRtp);
+    delete m_capture; // trims the file
+    m_capture = NULL;
+}
+
 // ---------- SLOTS ----------
 void RtpReceiver::readPendingDatagramsRtp()
 {
     while (m_socketRtp->hasPendingDatagrams())
     {
-        RtpPacket* packet = read_datagram();
-        if (!packet)
+        QByteArray datagram;
+        datagram.resize(m_socketRtp->pendingDatagramSize());
+        quint16 senderPort;
+        m_socketRtp->readDatagram(datagram.data(), datagram.size(), &m_sender, &senderPort);
+
+        // Get current timestamp from the audio backend
+        if (!m_audio)
         {
             qWarning("RtpReceiver::readPendingDatagramsRtp received invalid RTP packet, ssrc = %u, RTP port = %d", m_ssrc, m_portRtp);
             break;
         }
-        
-        m_senderSsrc = packet->m_ssrc; // TODO: check that this sender SSRC doesn't change (not receiving from multiple senders?)
-
-        // update timestamp offset
-        quint32 currentOffset = update_timestamp_offset(packet);
+        jack_nframes_t arrivalTime = m_audio->getFrameTime();
 
-        // set extended sequence number
-        if (!set_extended_seq_num(packet, currentOffset))
+        if (m_capture && !m_capture->append(arrivalTime, datagram))
         {
-            qWarning("RtpReceiver::readPendingDatagramsRtp couldn't set extended sequence number, ssrc = %u, RTP port = %d", m_ssrc, m_portRtp);
-            delete packet;
-            break;
+            qWarning("RtpReceiver::readPendingDatagramsRtp couldn't write to capture file, stopping capture: RTP port = %d", m_portRtp);
+            stopCapture();
         }
 
-        // set packet playtime
-        quint32 basePlayoutTime = packet->m_timestamp + m_timestampOffset;
-        qint32 clockOffset = adjust_for_clock_skew(packet);
-        qint32 jitterOffset = adjust_for_jitter(packet);
-        packet->m_playoutTime = basePlayoutTime + clockOffset + jitterOffset; // TODO: make sure this can't try to go negative??
-        //qWarning("RtpReceiver::readPendingDatagramsRtp received packet with sequence number %u, timestamp %u, arrival time %u, set playtime to %u, clockOffset = %d, jitterOffset = %d, current playtime = %u", packet->m_sequenceNum, packet->m_timestamp, packet->m_arrivalTime, packet->m_playoutTime, clockOffset, jitterOffset, m_playtime);
+        if (!handleDatagram(datagram, arrivalTime)) break;
+    }
+}
 
-        
-        // filter out late packets (take into account wrapping of playtime
-        if (((qint32)(packet->m_playoutTime) - (qint32)m_playtime) < 0) //if (packet->m_playoutTime < m_playtime)
-        {
-            qWarning("RtpReceiver::readPendingDatagramsRtp LATE packet received: sequence number = %u, packet m_playoutTime = %u, current playtime = %u, ssrc = %u, RTP port = %d", packet->m_sequenceNum, packet->m_playoutTime, m_playtime, m_ssrc, m_portRtp);
-            m_numLate++;
-            if (m_numLate > MAX_LATE)
-            {
-                m_firstPacket = true; // force a reset with the next packet
-                QDateTime currentTime = QDateTime::currentDateTime();
-                QString currentTimeString = currentTime.toString();
-                QByteArray currentTimeBytes = currentTimeString.toLocal8Bit();
-                qWarning("[%s] RtpReceiver::readPendingDatagramsRtp TOO MANY LATE PACKETS received, forcing reset: ssrc = %u, RTP port = %d", currentTimeBytes.constData(), m_ssrc, m_portRtp);
-            }
-            delete packet;
-            break;
-        }
-        else
-        {
-            m_numLate = 0;
-        }
+bool RtpReceiver::handleDatagram(const QByteArray& datagram, quint32 arrivalTime)
+{
+    RtpPacket* packet = read_datagram(datagram, arrivalTime);
+    if (!packet)
+    {
+        qWarning("RtpReceiver::handleDatagram received invalid RTP packet, ssrc = %u, RTP port = %d", m_ssrc, m_portRtp);
+        return false;
+    }
+    
+    m_senderSsrc = packet->m_ssrc; // TODO: check that this sender SSRC doesn't change (not receiving from multiple senders?)
 
-        if (clockOffset >= 0)
-        {
-            // insert in queue based on sequence number
-            insert_packet_in_queue(packet);
-        }
-        else
+    // update timestamp offset
+    quint32 currentOffset = update_timestamp_offset(packet);
+
+    // set extended sequence number
+    if (!set_extended_seq_num(packet, currentOffset))
+    {
+        qWarning("RtpReceiver::handleDatagram couldn't set extended sequence number, ssrc = %u, RTP port = %d", m_ssrc, m_portRtp);
+        delete packet;
+        return false;
+    }
+
+    // set packet playtime
+    quint32 basePlayoutTime = packet->m_timestamp + m_timestampOffset;
+    qint32 clockOffset = adjust_for_clock_skew(packet);
+    qint32 jitterOffset = adjust_for_jitter(packet);
+    packet->m_playoutTime = basePlayoutTime + clockOffset + jitterOffset; // TODO: make sure this can't try to go negative??
+    //qWarning("RtpReceiver::readPendingDatagramsRtp received packet with sequence number %u, timestamp %u, arrival time %u, set playtime to %u, clockOffset = %d, jitterOffset = %d, current playtime = %u", packet->m_sequenceNum, packet->m_timestamp, packet->m_arrivalTime, packet->m_playoutTime, clockOffset, jitterOffset, m_playtime);
+
+    
+    // filter out late packets (take into account wrapping of playtime
+    if (((qint32)(packet->m_playoutTime) - (qint32)m_playtime) < 0) //if (packet->m_playoutTime < m_playtime)
+    {
+        qWarning("RtpReceiver::handleDatagram LATE packet received: sequence number = %u, packet m_playoutTime = %u, current playtime = %u, ssrc = %u, RTP port = %d", packet->m_sequenceNum, packet->m_playoutTime, m_playtime, m_ssrc, m_portRtp);
+        m_numLate++;
+        m_packetsLate++;
+        if (m_numLate > MAX_LATE)
         {
-            qWarning("RtpReceiver::readPendingDatagramsRtp skipping inserting packet in queue after clock skew compensation");
-            delete packet;
+            m_firstPacket = true; // force a reset with the next packet
+            QDateTime currentTime = QDateTime::currentDateTime();
+            QString currentTimeString = currentTime.toString();
+            QByteArray currentTimeBytes = currentTimeString.toLocal8Bit();
+            qWarning("[%s] RtpReceiver::handleDatagram TOO MANY LATE PACKETS received, forcing reset: ssrc = %u, RTP port = %d", currentTimeBytes.constData(), m_ssrc, m_portRtp);
         }
+        delete packet;
+        return false;
+    }
+    else
+    {
+        m_numLate = 0;
+    }
+
+    if (clockOffset >= 0)
+    {
+        // insert in queue based on sequence number
+        insert_packet_in_queue(packet);
+    }
+    else
+    {
+        qWarning("RtpReceiver::handleDatagram skipping inserting packet in queue after clock skew compensation");
+        delete packet;
     }
+
+    return true;
 }
 
 void RtpReceiver::sendRtcpReport()
 {
-    qint64 delayMillis = m_reportTimer.elapsed();
+    qint64 delayMicros = m_reportTimer.nsecsElapsed() / 1000;
     emit receiverReportReady(m_senderSsrc, 
                              m_firstSeqNumThisInt, 
                              m_maxSeqNumThisInt, 
@@ -252,7 +330,7 @@ void RtpReceiver::sendRtcpReport()
                              m_packetsReceived, 
                              m_jitter, 
                              m_lastSenderTimestamp, 
-                             delayMillis);
+                             delayMicros);
    
     // reset interval-specific stats
     m_firstSeqNumThisInt = 0; // TODO: this (and max) should be the sequence number of the next packet received
@@ -267,25 +345,38 @@ void RtpReceiver::handleSenderReport(quint32 lastSenderTimestamp)
     // restart timer for last sender delay
     // TODO: move this into RtcpHandler??
     m_reportTimer.restart();   
+
+    if (m_firstPacket || !m_audio) return;
+
+    // the report pairs the sender's wall clock with its media clock
+    const RtcpSenderReport& report = m_rtcpHandler->getSenderReport();
+    quint64 sent = ((quint64)report.ntpSeconds << 32) | report.ntpFraction;
+    m_transitMicros = RtcpHandler::ntpToMicros(RtcpHandler::ntpNow() - sent);
+
+    // audio at the report's RTP timestamp plays at the same offset from the sender's timestamps as its packets
+    quint32 playoutTime = report.rtpTimestamp + m_timestampOffset + m_packetQueueSize * m_bufferSamples;
+    qint32 playoutFrames = playoutTime - m_audio->getFrameTime();
+    m_playoutMicros = ((qint64)playoutFrames * 1000000) / m_sampleRate;
+    m_latencyValid = true;
 }
 
-// -------------- HELPERS ---------------
-RtpPacket* RtpReceiver::read_datagram()
+bool RtpReceiver::getLatency(qint32& transitMicros, qint32& playoutMicros) const
 {
-    QByteArray datagram;
-    datagram.resize(m_socketRtp->pendingDatagramSize());
-    quint16 senderPort;
-    m_socketRtp->readDatagram(datagram.data(), datagram.size(), &m_sender, &senderPort);
-
-    // Get current timestamp from JACK
-    if (!m_jackClient) return NULL;
-    jack_nframes_t elapsedSamples = jack_frame_time(m_jackClient);
+    if (!m_latencyValid) return false;
+    transitMicros = m_transitMicros;
+    playoutMicros = m_playoutMicros;
+    return true;
+}
 
-    //qDebug() << "\nDATAGRAM RECEIVED on RTP port: time elapsed = " << timeElapsed << "ms, " << elapsedSamples << "samples";
+// -------------- HELPERS ---------------
+RtpPacket* RtpReceiver::read_datagram(const QByteArray& datagram, quint32 arrivalTime)
+{
+    //qDebug() << "\nDATAGRAM RECEIVED on RTP port: " << arrivalTime << "samples";
     
     // handle RTP packet
     RtpPacket* packet = new RtpPacket();
-    packet->read(datagram, elapsedSamples); // TODO: this should return false if not valid RTP packet
+    QByteArray data(datagram); // shallow copy: RtpPacket::read only reads from it
+    packet->read(data, arrivalTime); // TODO: this should return false if not valid RTP packet
     m_packetsReceived++;
     m_packetsReceivedThisInt++; // includes late or duplicated packets
     
@@ -328,6 +419,7 @@ void RtpReceiver::init_stats(RtpPacket* packet, quint32 currentOffset)
     m_maxSeqNumThisInt = m_sequenceMax;
     m_packetsReceived = 1;
     m_packetsReceivedThisInt = 1;
+    m_latencyValid = false; // until the next sender report
 }
 
 bool RtpReceiver::set_extended_seq_num(RtpPacket* packet, quint32 currentOffset)
@@ -550,7 +642,12 @@ qint32 RtpReceiver::adjust_for_jitter(RtpPacket* packet)
 
 int RtpReceiver::receiveAudio(float** audio, int channels, int frames)
 {
-    m_playtime = jack_last_frame_time(m_jackClient);
+    return receiveAudio(audio, channels, frames, m_audio->getLastFrameTime());
+}
+
+int RtpReceiver::receiveAudio(float** audio, int channels, int frames, quint32 playtime)
+{
+    m_playtime = playtime;
     
     //qWarning("\nRtpReceiver::receiveAudio ssrc = %u, RTP port = %u, system playtime = %u, packet queue length = %d", m_ssrc, m_portRtp, m_playtime, packet_queue_length());
     
@@ -574,6 +671,7 @@ int RtpReceiver::receiveAudio(float** audio, int channels, int frames)
     if (!packetQueue || (((qint32) m_playtime - (qint32) (packetQueue->m_playoutTime) < 0)))
     {
         m_numMissed++;
+        m_periodsMissed++;
         if (!packetQueue)
         {
             if (!m_firstPacket)
@@ -620,6 +718,7 @@ int RtpReceiver::receiveAudio(float** audio, int channels, int frames)
 
             // flag skipped packet for removal from queue (to be done by network thread to avoid conflicts)
             packet->m_used = true;
+            m_packetsSkipped++;
 
             // advance to next packet in queue
             packet = next;  
@@ -640,6 +739,7 @@ int RtpReceiver::receiveAudio(float** audio, int channels, int frames)
         else
         {
             qWarning("RtpReceiver::receiveAudio NO UNUSED PACKETS ready to play: playing silence: playtime = %u, ssrc = %u, RTP port = %d", m_playtime, m_ssrc, m_portRtp);
+            m_periodsMissed++;
             // output silence
             // TODO: confirm that frames and m_bufferSamples are the same size?
             for (int ch = 0; ch < channels; ch++)
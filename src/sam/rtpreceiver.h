@@ -52,6 +52,8 @@
 
 #include "rtcp.h"
 #include "rtp.h"
+#include "rtpcapture.h"
+#include "sam_audio_backend.h"
 
 namespace sam
 {
@@ -78,7 +80,7 @@ public:
                 qint32 bufferSize,  
                 quint32 playqueueSize, 
                 qint32 clockSkewThreshold,
-                jack_client_t* jackClient, 
+                SamAudioBackend* audio, 
                 QObject *parent = 0);
 
     /**
@@ -102,6 +104,13 @@ public:
      */
     quint16 getPortRtp() const { return m_portRtp; }
 
+    /**
+     * Set a multicast group to receive from as well as unicast, e.g. when one client streams to several SAMs.
+     * Must be called before start().
+     * @param group the multicast group address
+     */
+    void setMulticastGroup(const QHostAddress& group);
+
     /**
      * Start receiving packets.
      * @return true on success, false on failure
@@ -115,6 +124,78 @@ public:
      * @param frames the number of audio frames
      */
     int receiveAudio(float** audio, int channels, int frames);
+
+    /**
+     * Return audio data for the given play time instead of the current JACK period, e.g. when replaying a capture.
+     * @param audio pointer to pre-allocated arrays of samples
+     * @param channels number of audio channels
+     * @param frames the number of audio frames
+     * @param playtime the play time, in JACK frames
+     */
+    int receiveAudio(float** audio, int channels, int frames, quint32 playtime);
+
+    /**
+     * Handle a received RTP datagram.
+     * Called for each datagram read from the RTP socket, or directly when replaying a capture.
+     * @param datagram the datagram
+     * @param arrivalTime the datagram's arrival time, in JACK frames
+     * @return true if the datagram was handled, false if it was invalid, late or badly misordered
+     */
+    bool handleDatagram(const QByteArray& datagram, quint32 arrivalTime);
+
+    /**
+     * Start capturing received RTP datagrams to a file for offline replay.
+     * @param path the capture file
+     * @param channels number of audio channels in the stream
+     * @return true on success, false on failure
+     */
+    bool startCapture(const QString& path, int channels);
+
+    /**
+     * Stop capturing received RTP datagrams.
+     */
+    void stopCapture();
+
+    /**
+     * Check if received RTP datagrams are being captured.
+     * @return true if capturing, false otherwise
+     */
+    bool isCapturing() const { return m_capture != NULL; }
+
+    /**
+     * Get the total number of packets received.
+     * @return the number of packets received
+     */
+    quint64 getPacketsReceived() const { return m_packetsReceived; }
+
+    /**
+     * Get the number of periods for which no packet was ready to play.
+     * @return the number of periods that played silence
+     */
+    quint64 getPeriodsMissed() const { return m_periodsMissed; }
+
+    /**
+     * Get the number of packets dropped because they arrived after their play time.
+     * @return the number of late packets
+     */
+    quint64 getPacketsLate() const { return m_packetsLate; }
+
+    /**
+     * Get the number of packets skipped because a later packet was also playable.
+     * @return the number of skipped packets
+     */
+    quint64 getPacketsSkipped() const { return m_packetsSkipped; }
+
+    /**
+     * Get the latency estimates made when the last RTCP sender report arrived.  The sender report pairs the
+     * sender's wall clock with its media clock, so the transit time is the report's arrival time on this host's
+     * wall clock minus its NTP timestamp (only meaningful if both hosts' clocks are synchronized, e.g. with NTP
+     * or PTP), and the playout delay is how long after the report's arrival the audio at its RTP timestamp plays.
+     * @param transitMicros set to the one-way network transit time (in microseconds, negative if clocks are off)
+     * @param playoutMicros set to the playout delay (in microseconds)
+     * @return true if a sender report has been received since the stream started, false otherwise
+     */
+    bool getLatency(qint32& transitMicros, qint32& playoutMicros) const;
     
 public slots:
     /**
@@ -134,10 +215,10 @@ signals:
      * @param maxExtendedSeqNum the maximum extended sequence number received from this receiver's source
      * @param packets total number of packets received from this receiver's source
      * @param jitter current jitter measure for this receiver's source
-     * @param lastSenderTimestamp timestamp of last packet received from this receiver's source
-     * @param delayMillis number of milliseconds since last sender report was received from this receiver's source
+     * @param lastSenderTimestamp middle 32 bits of the NTP timestamp of the last sender report received from this receiver's source
+     * @param delayMicros number of microseconds since last sender report was received from this receiver's source
      */
-    void receiverReportReady(quint32 senderSsrc, qint64 firstSeqNumThisInt, qint64 maxSeqNumThisInt, quint64 packetsThisInt, quint32 firstSeqNum, quint64 maxExtendedSeqNum, quint64 packets, quint32 jitter, quint32 lastSenderTimestamp, qint64 delayMillis);
+    void receiverReportReady(quint32 senderSsrc, qint64 firstSeqNumThisInt, qint64 maxSeqNumThisInt, quint64 packetsThisInt, quint32 firstSeqNum, quint64 maxExtendedSeqNum, quint64 packets, quint32 jitter, quint32 lastSenderTimestamp, qint64 delayMicros);
 
 protected slots:
 
@@ -153,7 +234,7 @@ protected slots:
     
     /**
      * Handle a received RTCP sender report.
-     * @param lastSenderTimestamp timestamp when sender report was received
+     * @param lastSenderTimestamp middle 32 bits of the sender report's NTP timestamp
      */
     void handleSenderReport(quint32 lastSenderTimestamp);
 
@@ -161,9 +242,11 @@ protected:
 
     /**
      * Read a UDP datagram.
+     * @param datagram the datagram
+     * @param arrivalTime the datagram's arrival time, in JACK frames
      * @return RTP packet read or NULL if no packet read.
      */
-    RtpPacket* read_datagram();
+    RtpPacket* read_datagram(const QByteArray& datagram, quint32 arrivalTime);
     
     /**
      * Update the timestamp offset between sender and receiver.
@@ -216,6 +299,7 @@ protected:
 
     QUdpSocket* m_socketRtp;        ///< The socket receiving incoming RTP UDP datagrams
     quint16 m_portRtp;              ///< The port to listen on
+    QHostAddress m_multicastGroup;  ///< multicast group to receive from (null if unicast only)
     quint16 m_remotePortRtcp;       ///< The remote port to send RTCP packets to
     QElapsedTimer m_reportTimer;    ///< Timer for measuring time since last sender report was received
     quint32 m_ssrc;                 ///< This receiver's SSRC
@@ -256,15 +340,23 @@ protected:
     quint64 m_packetsReceived;          ///< total number of packets received
     quint64 m_packetsReceivedThisInt;   ///< number of packets received in current RTCP reporting interval
     quint32 m_reportInterval;           ///< milliseconds between RTCP receiver report sending
-    quint32 m_lastSenderTimestamp;      ///< timestamp of last sender report received
+    quint32 m_lastSenderTimestamp;      ///< middle 32 bits of the NTP timestamp of the last sender report received
+    bool m_latencyValid;                ///< whether a sender report has been received since the stream started
+    qint32 m_transitMicros;             ///< one-way network transit time of the last sender report (needs synchronized clocks)
+    qint32 m_playoutMicros;             ///< time from the last sender report's arrival until audio at its RTP timestamp plays
+    quint64 m_periodsMissed;            ///< number of periods for which no packet was ready to play
+    quint64 m_packetsLate;              ///< number of packets dropped for arriving after their play time
+    quint64 m_packetsSkipped;           ///< number of packets skipped because a later packet was also playable
     
     RtcpHandler* m_rtcpHandler;         ///< RTCP handler
     
     QMutex m_queueMutex;                ///< mutex for safely adding/removing/playing from packet queue
 
-    jack_client_t* m_jackClient;        ///< pointer to parent's JACK client (do not delete!)
+    SamAudioBackend* m_audio;           ///< pointer to parent's audio backend, for frame times (do not delete!)
 
     float* m_zeros;                     ///< array of zeros for fast copying during audio callback
+
+    RtpCapture* m_capture;              ///< capture of received datagrams (NULL if not capturing)
 };
 
 } // end of namespace SAM
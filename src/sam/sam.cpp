@@ -43,24 +43,34 @@
  */
 
 #include <errno.h>
+#include <math.h>
 #include <signal.h> // needed for kill() on OS X but not in OpenSUSE for some reason
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <grp.h>
 #include <unistd.h>
 #include <sys/types.h>
 
 #include <QDebug>
+#include <QDir>
 #include <QHostInfo>
+#include <QNetworkInterface>
 #include <QThread>
 #include <QTimer>
+#include <QtEndian>
 
 #include "sam.h"
 #include "sam_app.h"
+#include "sam_port_pool.h"
 #include "sam_shared.h"
 #include "samparams.h"
-#include "jack_util.h"
 #include "osc.h"
+#include "osc_notifier.h"
+#include "sam_recorder.h"
+#include "sam_relay.h"
+#include "sam_standby.h"
 
 namespace sam
 {
@@ -71,6 +81,70 @@ static const int MAX_CMD_LEN = 64;
 static const int OUTPUT_ENABLED_DISCRETE = -2;
 static const int OUTPUT_DISABLED = -3;
 
+// flags for global parameters staged by a bulk change set
+static const int STAGED_VOLUME = 0x1;
+static const int STAGED_MUTE = 0x2;
+static const int STAGED_DELAY = 0x4;
+
+// how often to retry staging bulk change sets queued behind one the audio thread hasn't applied yet,
+// and how many can be queued before new ones are rejected
+static const int CHANGE_SET_RETRY_MILLIS = 2;
+static const int MAX_QUEUED_CHANGE_SETS = 32;
+
+// how often to check whether the audio thread has finished with replaced active app lists
+static const int RECLAIM_INTERVAL_MILLIS = 20;
+
+// hot standby
+static const int STANDBY_HEARTBEAT_MILLIS = 100;     // how often the primary sends heartbeats to standby SAMs
+static const int RESUME_TIMEOUT_MILLIS = 10000;      // how long after a takeover mirrored apps wait for their clients to resume
+static const int MIRROR_KEY_BASE = 0x100;            // offset of standby coalescing keys from subscriber keys
+
+static const int MAX_RELAYS = 16; // maximum number of simultaneous relays to downstream SAMs
+
+// OSC method ids for m_oscDispatcher: a group in the upper bits, and for
+// per-parameter groups, a SamClientSubscription parameter in the lower bits
+// (NUM_SUBSCRIPTIONS stands for "all" parameters)
+static const int OSC_PARAM_MASK = 0xFF;
+static const int OSC_GROUP_MASK = ~OSC_PARAM_MASK;
+static const int OSC_GROUP_MISC = 0x000;
+static const int OSC_GROUP_APP = 0x100;
+static const int OSC_GROUP_UI = 0x200;
+static const int OSC_GROUP_RENDER = 0x300;
+static const int OSC_GROUP_SET = 0x400;
+static const int OSC_GROUP_SET_BULK = 0x500;
+static const int OSC_GROUP_GET = 0x600;
+static const int OSC_GROUP_SUBSCRIBE = 0x700;
+static const int OSC_GROUP_UNSUBSCRIBE = 0x800;
+static const int OSC_GROUP_MIRROR = 0x900;
+
+static const int OSC_QUIT = OSC_GROUP_MISC | 0;
+static const int OSC_DEBUG = OSC_GROUP_MISC | 1;
+static const int OSC_TYPE_ADD = OSC_GROUP_MISC | 2;
+static const int OSC_TYPE_REMOVE = OSC_GROUP_MISC | 3;
+static const int OSC_METER_FRAME_SUBSCRIBE = OSC_GROUP_MISC | 4;
+static const int OSC_METER_FRAME_UNSUBSCRIBE = OSC_GROUP_MISC | 5;
+static const int OSC_STANDBY_REGISTER = OSC_GROUP_MISC | 6;
+static const int OSC_MIRROR_APP = OSC_GROUP_MISC | 7;
+static const int OSC_MIRROR_UNREGISTERED = OSC_GROUP_MISC | 8;
+static const int OSC_RELAY_ADD = OSC_GROUP_MISC | 9;
+static const int OSC_RELAY_REMOVE = OSC_GROUP_MISC | 10;
+static const int OSC_RECORD_START = OSC_GROUP_MISC | 11;
+static const int OSC_RECORD_STOP = OSC_GROUP_MISC | 12;
+static const int OSC_CAPTURE_START = OSC_GROUP_MISC | 13;
+static const int OSC_CAPTURE_STOP = OSC_GROUP_MISC | 14;
+static const int OSC_STATS = OSC_GROUP_MISC | 15;
+static const int OSC_LATENCY = OSC_GROUP_MISC | 16;
+static const int OSC_APP_REGISTER = OSC_GROUP_APP | 0;
+static const int OSC_APP_UNREGISTER = OSC_GROUP_APP | 1;
+static const int OSC_APP_RESUME = OSC_GROUP_APP | 2;
+static const int OSC_UI_REGISTER = OSC_GROUP_UI | 0;
+static const int OSC_UI_UNREGISTER = OSC_GROUP_UI | 1;
+static const int OSC_RENDER_REGISTER = OSC_GROUP_RENDER | 0;
+static const int OSC_RENDER_UNREGISTER = OSC_GROUP_RENDER | 1;
+
+// the last part of the OSC address for each SamClientSubscription parameter
+static const char* OSC_PARAM_NAMES[NUM_SUBSCRIPTIONS] = {"volume", "mute", "solo", "delay", "position", "type", "meter"};
+
 StreamingAudioManager::StreamingAudioManager(const SamParams& params) :
     QObject(),
     m_sampleRate(params.sampleRate),
@@ -78,8 +152,8 @@ StreamingAudioManager::StreamingAudioManager(const SamParams& params) :
     m_numBasicChannels(params.numBasicChannels),
     m_maxOutputChannels(params.maxOutputChannels),
     m_jackDriver(NULL),
-    m_jackPID(-1),
-    m_client(NULL),
+    m_audioBackendName(params.audioBackend),
+    m_audio(NULL),
     m_maxClients(params.maxClients),
     m_apps(NULL),
     m_appState(NULL),
@@ -88,7 +162,11 @@ StreamingAudioManager::StreamingAudioManager(const SamParams& params) :
     m_maxBasicOutputs(0),
     m_maxDiscreteOutputs(0),
     m_discreteOutputUsed(NULL),
+    m_outputPortPoolSize(params.outputPortPool),
+    m_portPool(NULL),
     m_rtpPort(params.rtpPort),
+    m_rtpMulticastGroup(params.rtpMulticastGroup),
+    m_sharedMemoryGid(-1),
     m_outJackClientNameBasic(NULL),
     m_outJackPortBaseBasic(NULL),
     m_outJackClientNameDiscrete(NULL),
@@ -108,19 +186,74 @@ StreamingAudioManager::StreamingAudioManager(const SamParams& params) :
     m_delayNext(0),
     m_delayMaxClient(0),
     m_delayMaxGlobal(0),
+    m_changeSetPending(0),
+    m_changeSetScheduled(false),
+    m_activeApps(NULL),
+    m_processEpoch(0),
+    m_soloCount(0),
+    m_reclaimScheduled(false),
+    m_volumeStaged(params.volume),
+    m_muteStaged(false),
+    m_delayStaged(0),
+    m_stagedFlags(0),
+    m_xruns(0),
+    m_processPeriods(0),
+    m_processNanos(0),
+    m_processNanosMax(0),
+    m_processMaxReset(0),
+    m_notifier(NULL),
     m_oscServerPort(params.oscPort),
     m_udpSocket(NULL),
     m_tcpServer(NULL),
     m_renderSocket(NULL),
-    m_verifyPatchVersion(params.verifyPatchVersion)
+    m_verifyPatchVersion(params.verifyPatchVersion),
+    m_primaryHost(params.primaryHost),
+    m_primaryPort(params.primaryPort),
+    m_standbyTimeoutMillis(params.standbyTimeoutMillis),
+    m_standbyLink(NULL),
+    m_standby(!params.primaryHost.isEmpty()),
+    m_standbyMuteCurrent(!params.primaryHost.isEmpty()),
+    m_standbyHeartbeatTimer(NULL),
+    m_relays(NULL),
+    m_relayHost(params.relayHost),
+    m_relayPort(params.relayPort),
+    m_relayChannels(params.relayChannels),
+    m_relayBitDepth(params.relayBitDepth),
+    m_masterRecorder(NULL),
+    m_recordDirectory(params.recordDirectory),
+    m_masterMix(NULL)
 {
+    m_notifier = new OscNotifier(this);
+
     m_apps = new StreamingAudioApp*[m_maxClients];
     m_appState = new SamAppState[m_maxClients];
+    m_discreteOwned.resize(m_maxClients);
     for (int i = 0; i < m_maxClients; i++)
     {
         m_apps[i] = NULL;
         m_appState[i] = AVAILABLE;
     }
+    m_activeApps.fetchAndStoreOrdered(new SamActiveApps());
+
+    m_relays = new SamRelay*[MAX_RELAYS];
+    for (int i = 0; i < MAX_RELAYS; i++)
+    {
+        m_relays[i] = NULL;
+    }
+
+    if (!params.sharedMemoryGroup.isEmpty())
+    {
+        QByteArray groupBytes = params.sharedMemoryGroup.toLocal8Bit();
+        group* sharedMemoryGroup = getgrnam(groupBytes.constData());
+        if (sharedMemoryGroup)
+        {
+            m_sharedMemoryGid = sharedMemoryGroup->gr_gid;
+        }
+        else
+        {
+            qWarning("StreamingAudioManager: unknown SharedMemoryGroup %s: shared-memory rings are for SAM's user only", groupBytes.constData());
+        }
+    }
     
     int len = params.jackDriver.length();
     m_jackDriver = new char[len + 1];
@@ -155,6 +288,11 @@ StreamingAudioManager::StreamingAudioManager(const SamParams& params) :
 
     connect(this, SIGNAL(meterTick()), this, SLOT(notifyMeter()));
 
+    m_standbyHeartbeatTimer = new QTimer(this);
+    connect(m_standbyHeartbeatTimer, SIGNAL(timeout()), this, SLOT(sendStandbyHeartbeat()));
+
+    init_osc_methods();
+
     if (!params.renderHost.isEmpty() && params.renderPort > 0)
     {
         // initialize renderer
@@ -183,6 +321,12 @@ StreamingAudioManager::StreamingAudioManager(const SamParams& params) :
         emit typeAdded(type.id);
     }
 
+    m_masterMix = new float*[m_basicChannels.size()];
+    for (int ch = 0; ch < m_basicChannels.size(); ch++)
+    {
+        m_masterMix[ch] = new float[m_bufferSize];
+    }
+
     if (params.hostAddress.isEmpty())
     {
         m_hostAddress = QHostAddress::Any;
@@ -199,6 +343,9 @@ StreamingAudioManager::~StreamingAudioManager()
 
     stop();
 
+    reclaim_active_apps(true);
+    delete m_activeApps.fetchAndStoreOrdered(NULL);
+
     if (m_outJackClientNameBasic)
     {
         delete[] m_outJackClientNameBasic;
@@ -246,6 +393,22 @@ StreamingAudioManager::~StreamingAudioManager()
         delete[] m_appState;
         m_appState = NULL;
     }
+
+    if (m_relays)
+    {
+        delete[] m_relays;
+        m_relays = NULL;
+    }
+
+    if (m_masterMix)
+    {
+        for (int ch = 0; ch < m_basicChannels.size(); ch++)
+        {
+            delete[] m_masterMix[ch];
+        }
+        delete[] m_masterMix;
+        m_masterMix = NULL;
+    }
 }
 
 int StreamingAudioManager::start()
@@ -278,65 +441,53 @@ int StreamingAudioManager::start()
         return false;
     }
 
-    // check for an already-running JACK server
-    if (JackServerIsRunning())
+    // open the audio backend (starting the JACK server if necessary)
+    if (!open_audio_backend())
     {
-        qWarning("*An instance of the JACK server (jackd or jackdmp) is already running.  SAM will try to use it.");
+        emit startupError();
+        return false;
     }
 
-    else
+    // register the output port pool before activating, so apps joining later don't change the port graph
+    if (m_outputPortPoolSize > 0)
     {
-        // start jackd
-        if (!start_jack(m_sampleRate, m_bufferSize, m_maxOutputChannels, m_jackDriver))
+        m_portPool = new SamPortPool(m_audio);
+        if (!m_portPool->init(m_outputPortPoolSize))
         {
-            qWarning("Couldn't start JACK server process");
-            emit startupError();
-            return false;
+            qWarning("StreamingAudioManager::run() couldn't register %d pooled output ports: apps will register their own", m_outputPortPoolSize);
+            delete m_portPool;
+            m_portPool = NULL;
         }
     }
 
-    // open jack client
-    if (!open_jack_client())
-    {
-        emit startupError();
-        return false;
-    }
-
-    // verify that JACK is running at correct sample rate and buffer size
-    jack_nframes_t bufferSize = jack_get_buffer_size(m_client);
-    jack_nframes_t sampleRate = jack_get_sample_rate(m_client);
-    if (bufferSize != (unsigned int)m_bufferSize)
-    {
-        qWarning("Expected JACK running with buffer size %d, but actual buffer size is %d", m_bufferSize, bufferSize);
-        emit startupError();
-        return false;
-    }
-    if (sampleRate != (unsigned int)m_sampleRate)
+    // register callbacks and activate (starts processing)
+    m_audio->setCallbacks(StreamingAudioManager::jackProcess, StreamingAudioManager::jackXrun, StreamingAudioManager::jackShutdown, this);
+    if (!m_audio->activate())
     {
-        qWarning("Expected JACK running with sample rate %d, but actual sample rate is %d", m_sampleRate, sampleRate);
+        qWarning("Couldn't activate %s audio backend", m_audio->getName());
         emit startupError();
         return false;
     }
 
-    // register jack callbacks
-    jack_set_buffer_size_callback(m_client, StreamingAudioManager::jackBufferSizeChanged, this);
-    jack_set_process_callback(m_client, StreamingAudioManager::jackProcess, this);
-    jack_set_sample_rate_callback(m_client, StreamingAudioManager::jackSampleRateChanged, this);
-    jack_set_xrun_callback(m_client, StreamingAudioManager::jackXrun, this);
-    jack_on_shutdown(m_client, StreamingAudioManager::jackShutdown, this);
-
-    // activate client (starts processing)
-    if (jack_activate(m_client) != 0)
+    if (!init_basic_output_ports())
     {
-        qWarning("Couldn't activate JACK client");
         emit startupError();
         return false;
     }
 
-    if (!init_basic_output_ports())
+    // connect half of the pool to the basic outputs ahead of time, since most apps are basic
+    if (m_portPool)
     {
-        emit startupError();
-        return false;
+        QList<QByteArray> basicOutputs;
+        char systemOut[MAX_PORT_NAME];
+        for (int i = 0; i < m_basicChannels.size(); i++)
+        {
+            if (m_basicChannels[i] > m_maxBasicOutputs) continue;
+            snprintf(systemOut, MAX_PORT_NAME, "%s:%s%d", m_outJackClientNameBasic, m_outJackPortBaseBasic, m_basicChannels[i]);
+            basicOutputs.append(QByteArray(systemOut));
+        }
+        int connected = m_portPool->preconnect(basicOutputs, m_portPool->getSize() / 2);
+        qDebug("StreamingAudioManager::run() connected %d pooled output ports to basic outputs", connected);
     }
 
     if (m_renderer && !init_discrete_output_ports())
@@ -375,6 +526,21 @@ int StreamingAudioManager::start()
         m_oscDirections.append("Send OSC messages to host " + hostString + ", port " + QString::number(m_oscServerPort));
     }
 
+    if (m_standby)
+    {
+        // mirror the primary SAM until it fails
+        m_standbyLink = new SamStandbyLink(m_primaryHost, m_primaryPort, m_standbyTimeoutMillis, this);
+        connect(m_standbyLink, SIGNAL(messageReady(OscMessage*, const char*, QAbstractSocket*)), this, SLOT(handleOscMessage(OscMessage*, const char*, QAbstractSocket*)));
+        connect(m_standbyLink, SIGNAL(primaryLost()), this, SLOT(takeOver()));
+        m_standbyLink->start();
+    }
+
+    if (!m_relayHost.isEmpty())
+    {
+        // forward a downmix to a downstream SAM
+        addRelay(m_relayHost, m_relayPort, SamRelay::SOURCE_MIX, m_relayChannels, m_relayBitDepth);
+    }
+
     m_isRunning = true;
     emit started();
     return true;
@@ -392,12 +558,23 @@ void StreamingAudioManager::stop()
 
     m_stopRequested = true;
 
+    // stop mirroring
+    m_standbyHeartbeatTimer->stop();
+    m_standbySockets.clear();
+    if (m_standbyLink)
+    {
+        delete m_standbyLink;
+        m_standbyLink = NULL;
+    }
+
     // wait for stop request to be acknowledged
     QEventLoop loop;
     connect(this, SIGNAL(stopConfirmed()), &loop, SLOT(quit()));
     QTimer::singleShot(1000, &loop, SLOT(quit())); // timeout after a second
     loop.exec();
 
+    // the audio thread has stopped, so delete removed apps now and then the rest
+    reclaim_active_apps(true);
     for (int i = 0; i < m_maxClients; i++)
     {
         if (m_apps[i])
@@ -406,6 +583,22 @@ void StreamingAudioManager::stop()
             m_apps[i] = NULL;
         }
     }
+    delete m_activeApps.fetchAndStoreOrdered(new SamActiveApps());
+
+    for (int i = 0; i < MAX_RELAYS; i++)
+    {
+        if (m_relays[i])
+        {
+            delete m_relays[i];
+            m_relays[i] = NULL;
+        }
+    }
+
+    if (m_masterRecorder)
+    {
+        delete m_masterRecorder; // finishes the file
+        m_masterRecorder = NULL;
+    }
 
     // disconnect renderer
     unregisterRenderer();
@@ -422,15 +615,24 @@ void StreamingAudioManager::stop()
         delete m_uiSubscribers[i];
     }
     m_uiSubscribers.clear();
+
+    // unregister meter frame subscribers
+    for (int format = 0; format < NUM_METER_FRAME_FORMATS; format++)
+    {
+        for (int i = 0; i < m_meterFrameSubscribers[format].size(); i++)
+        {
+            delete m_meterFrameSubscribers[format][i];
+        }
+        m_meterFrameSubscribers[format].clear();
+        m_meterFrameSubscribersTcp[format].clear();
+    }
     
-    // stop jack
-    bool success = close_jack_client();
+    // stop the audio backend (and the JACK server if we started it)
+    bool success = close_audio_backend();
     if (!success)
     {
-        qWarning("StreamingAudioManager::stop couldn't close jack client");
+        qWarning("StreamingAudioManager::stop couldn't close audio backend");
     }
-
-    success &= stop_jack(); // TODO: handle error case
     
     // stop OSC servers
     if (m_udpSocket)
@@ -509,18 +711,29 @@ int StreamingAudioManager::getNumApps()
     int count = 0;
     for (int i = 0; i < m_maxClients; i++)
     {
-        if (m_apps[i] != NULL) count++;
+        if (m_apps[i] != NULL && m_appState[i] != CLOSING) count++;
     }
     return count;
 }       
 
-int StreamingAudioManager::registerApp(const char* name, int channels, int x, int y, int width, int height, int depth, StreamingAudioType type, int preset, int packetQueueSize, QTcpSocket* socket, sam::SamErrorCode& errCode)
+int StreamingAudioManager::registerApp(const char* name, int channels, int x, int y, int width, int height, int depth, StreamingAudioType type, int preset, int packetQueueSize, QTcpSocket* socket, sam::SamErrorCode& errCode, int id, bool sharedMemory)
 {
     // TODO: check for duplicates (an app already at the same IP/port)?
     
     // find an available port
     int port = -1;
-    for (int i = 0; i < m_maxClients; i++)
+    if (id >= 0)
+    {
+        // a specific port was requested (mirroring a primary SAM)
+        if (id >= m_maxClients || m_appState[id] != AVAILABLE)
+        {
+            qWarning("StreamingAudioManager::registerApp error: requested port %d is not available!", id);
+            errCode = sam::SAM_ERR_INVALID_ID;
+            return -1;
+        }
+        port = id;
+    }
+    for (int i = 0; i < m_maxClients && port < 0; i++)
     {
         if (m_appState[i] == AVAILABLE)
         {
@@ -555,13 +768,13 @@ int StreamingAudioManager::registerApp(const char* name, int channels, int x, in
     pos.width = width;
     pos.height = height;
     pos.depth = depth;
-    m_apps[port] = new StreamingAudioApp(name, port, channels, pos, type, preset, m_client, socket, m_rtpPort, m_delayMaxClient, queueSize, m_clockSkewThreshold, this);
+    m_apps[port] = new StreamingAudioApp(name, port, channels, pos, type, preset, m_audio, socket, m_rtpPort, m_delayMaxClient, queueSize, m_clockSkewThreshold, this);
     connect(m_apps[port], SIGNAL(appClosed(int,int)), this, SLOT(cleanupApp(int,int)));
     connect(m_apps[port], SIGNAL(appDisconnected(int)), this, SLOT(closeApp(int)));
-    if (!m_apps[port]->init())
+    if (!m_apps[port]->init(sharedMemory))
     {
         qWarning("StreamingAudioManager::registerApp error: could not initialize app!");
-        m_apps[port]->flagForDelete();
+        retire_app(port);
         errCode = sam::SAM_ERR_DEFAULT;
         return -1;
     }
@@ -569,40 +782,42 @@ int StreamingAudioManager::registerApp(const char* name, int channels, int x, in
     // identify output ports for this app to connect to
     if (!allocate_output_ports(port, channels, type))
     {
-        m_apps[port]->flagForDelete();
+        retire_app(port);
         errCode = sam::SAM_ERR_NO_FREE_OUTPUT;
         return -1;
     }
     
     if (!connect_app_ports(port, m_apps[port]->getChannelAssignments(), type))
     {
-        m_apps[port]->flagForDelete();
+        retire_app(port);
         errCode = sam::SAM_ERR_DEFAULT;
         return -1;
     }
     qDebug("StreamingAudioManager::registerApp finished connecting app ports");
 
     m_appState[port] = ACTIVE;
+    publish_active_apps();
 
     // notify UI subscribers of app finished registering
-    for (int i = 0; i < m_uiSubscribers.size(); i++)
-    {
-        OscAddress* replyAddr = m_uiSubscribers.at(i);
-        OscMessage replyMsg;
-        replyMsg.init("/sam/app/registered", "isiiiiiiii", port,
-                                                         m_apps[port]->getName(),
-                                                         m_apps[port]->getNumChannels(),
-                                                         pos.x,
-                                                         pos.y,
-                                                         pos.width,
-                                                         pos.height,
-                                                         pos.depth,
-                                                         m_apps[port]->getType(),
-                                                         m_apps[port]->getPreset());
-        if (!OscClient::sendUdp(&replyMsg, replyAddr))
-        {
-            qWarning("Couldn't send OSC message");
-        }
+    OscMessage replyMsg;
+    replyMsg.init("/sam/app/registered", "isiiiiiiii", port,
+                                                     m_apps[port]->getName(),
+                                                     m_apps[port]->getNumChannels(),
+                                                     pos.x,
+                                                     pos.y,
+                                                     pos.width,
+                                                     pos.height,
+                                                     pos.depth,
+                                                     m_apps[port]->getType(),
+                                                     m_apps[port]->getPreset());
+    m_notifier->notify(OscNotifier::NO_COALESCE, &replyMsg, m_uiSubscribers);
+
+    // notify standby SAMs
+    if (!m_standbySockets.isEmpty())
+    {
+        OscMessage mirrorMsg;
+        init_mirror_app_message(port, mirrorMsg);
+        mirrorState(&mirrorMsg);
     }
     
     // notify renderer
@@ -635,9 +850,8 @@ bool StreamingAudioManager::unregisterApp(int port)
     
     if (!m_apps[port] || (m_appState[port] != ACTIVE)) return false;
 
-    // TODO: could this still be a race condition?  What if app is deleted/app status set to closing between check above and call below??
-    // flag app for deletion - we can't delete it now because the JACK processing thread could be using it
-    m_apps[port]->flagForDelete();
+    // we can't delete the app now because the JACK processing thread could be using it
+    retire_app(port);
 
     return true;
 }
@@ -728,6 +942,12 @@ bool StreamingAudioManager::unregisterUI(const char* host, quint16 port)
         }
     }
     
+    // unsubscribe the UI from meter frames, if it was subscribed
+    for (int format = 0; format < NUM_METER_FRAME_FORMATS; format++)
+    {
+        StreamingAudioApp::unsubscribe_helper(m_meterFrameSubscribers[format], host, port);
+    }
+
     // unsubscribe UI address from being notified when app registers/unregisters
     return StreamingAudioApp::unsubscribe_helper(m_uiSubscribers, host, port);
 }
@@ -746,7 +966,7 @@ bool StreamingAudioManager::registerRenderer(const char* hostname, quint16 port,
     m_renderer = address;
     m_renderSocket = renderSocket;
 
-    if (m_client && !init_discrete_output_ports())
+    if (m_audio && !init_discrete_output_ports())
     {
         qWarning("StreamingAudioManager::registerRenderer couldn't enable discrete output ports");
         return false;
@@ -779,6 +999,188 @@ bool StreamingAudioManager::registerRenderer(const char* hostname, quint16 port,
     return true;
 }
 
+int StreamingAudioManager::addRelay(const QString& host, quint16 port, int source, int channels, int bitDepth)
+{
+    quint8 payloadType;
+    switch (bitDepth)
+    {
+    case 16:
+        payloadType = PAYLOAD_PCM_16;
+        break;
+    case 24:
+        payloadType = PAYLOAD_PCM_24;
+        break;
+    case 32:
+        payloadType = PAYLOAD_PCM_32;
+        break;
+    default:
+        qWarning("StreamingAudioManager::addRelay error: bit depth must be 16, 24 or 32, not %d", bitDepth);
+        return -1;
+    }
+
+    QByteArray name;
+    if (source == SamRelay::SOURCE_MIX)
+    {
+        if (channels < 1)
+        {
+            qWarning("StreamingAudioManager::addRelay error: a downmix needs at least one channel");
+            return -1;
+        }
+        name = QHostInfo::localHostName().toLocal8Bit() + " mix";
+    }
+    else
+    {
+        if (!idIsValid(source) || m_appState[source] != ACTIVE)
+        {
+            qWarning("StreamingAudioManager::addRelay error: invalid app id %d", source);
+            return -1;
+        }
+        name = m_apps[source]->getName();
+        channels = m_apps[source]->getNumChannels();
+    }
+
+    // find an available relay
+    int id = -1;
+    for (int i = 0; i < MAX_RELAYS; i++)
+    {
+        if (!m_relays[i])
+        {
+            id = i;
+            break;
+        }
+    }
+    if (id < 0)
+    {
+        qWarning("StreamingAudioManager::addRelay error: max relays already in use!");
+        return -1;
+    }
+
+    SamRelay* relay = new SamRelay(id, source, name.constData(), channels, host, port, m_sampleRate, m_bufferSize, payloadType, this);
+    connect(relay, SIGNAL(deleteRequested(int)), this, SLOT(handleRelayDeleteRequested(int)));
+    relay->start();
+    m_relays[id] = relay; // the relay is only used by the audio thread once it is forwarding
+    return id;
+}
+
+bool StreamingAudioManager::removeRelay(int id)
+{
+    if (id == -1)
+    {
+        // remove all relays
+        bool success = false;
+        for (int i = 0; i < MAX_RELAYS; i++)
+        {
+            if (m_relays[i])
+            {
+                success = removeRelay(i) || success;
+            }
+        }
+        return success;
+    }
+
+    if (id < 0 || id >= MAX_RELAYS || !m_relays[id]) return false;
+
+    printf("Removing relay %d\n\n", id);
+    retire_relay(id);
+    return true;
+}
+
+void StreamingAudioManager::handleRelayDeleteRequested(int id)
+{
+    // the relay may already have been removed (retire_relay flags it too)
+    if (id < 0 || id >= MAX_RELAYS || !m_relays[id] || m_relays[id] != sender()) return;
+
+    printf("Removing relay %d\n\n", id);
+    retire_relay(id);
+}
+
+bool StreamingAudioManager::startRecording(int id, const QString& name)
+{
+    QString path;
+    if (!record_path(name, path)) return false;
+
+    if (id != -1)
+    {
+        if (!idIsValid(id)) return false;
+        return m_apps[id]->startRecording(path);
+    }
+
+    if (m_masterRecorder)
+    {
+        qWarning("StreamingAudioManager::startRecording the master mix is already being recorded");
+        return false;
+    }
+    if (m_basicChannels.isEmpty())
+    {
+        qWarning("StreamingAudioManager::startRecording no basic channels to record");
+        return false;
+    }
+
+    SamRecorder* recorder = new SamRecorder(path, m_basicChannels.size(), m_sampleRate, m_bufferSize);
+    if (!recorder->open())
+    {
+        delete recorder;
+        return false;
+    }
+    m_masterRecorder = recorder;
+
+    QByteArray pathBytes = path.toLocal8Bit();
+    printf("Recording master mix to %s\n", pathBytes.constData());
+    return true;
+}
+
+bool StreamingAudioManager::record_path(const QString& name, QString& path)
+{
+    QByteArray nameBytes = name.toLocal8Bit();
+    if (m_recordDirectory.isEmpty())
+    {
+        qWarning("StreamingAudioManager::record_path can't write %s: set RecordDirectory to allow recording and capture", nameBytes.constData());
+        return false;
+    }
+    if (name.isEmpty() || name.contains('/') || name.contains("..") || name == ".")
+    {
+        qWarning("StreamingAudioManager::record_path invalid file name %s: only a file name in RecordDirectory is allowed", nameBytes.constData());
+        return false;
+    }
+    path = QDir(m_recordDirectory).filePath(name);
+    return true;
+}
+
+bool StreamingAudioManager::stopRecording(int id)
+{
+    SamRecorder* recorder = NULL;
+    if (id != -1)
+    {
+        if (!idIsValid(id)) return false;
+        recorder = m_apps[id]->takeRecorder();
+    }
+    else
+    {
+        recorder = m_masterRecorder;
+        m_masterRecorder = NULL;
+    }
+    if (!recorder) return false;
+
+    // the JACK processing thread could still be using the recorder in the current period
+    retire_recorder(recorder);
+    return true;
+}
+
+bool StreamingAudioManager::startCapture(int id, const QString& name)
+{
+    if (!idIsValid(id)) return false;
+
+    QString path;
+    if (!record_path(name, path)) return false;
+    return m_apps[id]->startCapture(path);
+}
+
+bool StreamingAudioManager::stopCapture(int id)
+{
+    if (!idIsValid(id)) return false;
+    return m_apps[id]->stopCapture();
+}
+
 bool StreamingAudioManager::unregisterRenderer()
 {
     // TODO: need error checking to make sure the request is for this renderer??
@@ -809,16 +1211,10 @@ void StreamingAudioManager::setVolume(float volume)
     m_volumeNext = volume <= 1.0 ? volume : 1.0;
 
     // notify subscribers
-    for (int i = 0; i < m_uiSubscribers.size(); i++)
-    {
-        OscAddress* replyAddr = m_uiSubscribers.at(i);
-        OscMessage replyMsg;
-        replyMsg.init("/sam/val/volume", "if", -1, m_volumeNext);
-        if (!OscClient::sendUdp(&replyMsg, replyAddr))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    OscMessage replyMsg;
+    replyMsg.init("/sam/val/volume", "if", -1, m_volumeNext);
+    m_notifier->notify(OscNotifier::makeKey(SUBSCRIPTION_VOLUME, -1), &replyMsg, m_uiSubscribers);
+    mirrorState(&replyMsg, SUBSCRIPTION_VOLUME);
     emit volumeChanged(volume);
 }
 
@@ -833,16 +1229,10 @@ void StreamingAudioManager::setDelay(float delay)
     float delaySet = ((m_delayNext * 1000.0f) / (float)m_sampleRate); // actual delay set, in millis
 
     // notify subscribers
-    for (int i = 0; i < m_uiSubscribers.size(); i++)
-    {
-        OscAddress* replyAddr = m_uiSubscribers.at(i);
-        OscMessage replyMsg;
-        replyMsg.init("/sam/val/delay", "if", -1, delaySet);
-        if (!OscClient::sendUdp(&replyMsg, replyAddr))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    OscMessage replyMsg;
+    replyMsg.init("/sam/val/delay", "if", -1, delaySet);
+    m_notifier->notify(OscNotifier::makeKey(SUBSCRIPTION_DELAY, -1), &replyMsg, m_uiSubscribers);
+    mirrorState(&replyMsg, SUBSCRIPTION_DELAY);
     emit delayChanged(delay);
 }
 
@@ -852,16 +1242,10 @@ void StreamingAudioManager::setMute(bool isMuted)
     m_muteNext = isMuted;
 
     // notify subscribers
-    for (int i = 0; i < m_uiSubscribers.size(); i++)
-    {
-        OscAddress* replyAddr = m_uiSubscribers.at(i);
-        OscMessage replyMsg;
-        replyMsg.init("/sam/val/mute", "ii", -1, m_muteNext);
-        if (!OscClient::sendUdp(&replyMsg, replyAddr))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    OscMessage replyMsg;
+    replyMsg.init("/sam/val/mute", "ii", -1, m_muteNext);
+    m_notifier->notify(OscNotifier::makeKey(SUBSCRIPTION_MUTE, -1), &replyMsg, m_uiSubscribers);
+    mirrorState(&replyMsg, SUBSCRIPTION_MUTE);
     emit muteChanged(isMuted);
 }
 
@@ -1022,14 +1406,7 @@ bool StreamingAudioManager::set_app_type(int port, StreamingAudioType type, int
         }
 
         // release old output ports used by this app
-        // TODO: can use app's channel assigmments array to do this more efficiently ??  Would need to save a copy before it changes above...
-        for (unsigned int i = 0; i < m_maxDiscreteOutputs; i++)
-        {
-            if (m_discreteOutputUsed[i] == port)
-            {
-                m_discreteOutputUsed[i] = OUTPUT_ENABLED_DISCRETE;
-            }
-        }
+        release_discrete_outputs(port);
         
         // connect to new output ports
         if (!connect_app_ports(port, m_apps[port]->getChannelAssignments(), type))
@@ -1128,27 +1505,32 @@ bool StreamingAudioManager::getAppParams(int id, ClientParams& params)
     return true;
 }
 
-int StreamingAudioManager::jackBufferSizeChanged(jack_nframes_t nframes, void*)
-{
-    qWarning("WARNING: JACK buffer size changed to %d/sec", nframes);
-    return 0;
-}
-
 int StreamingAudioManager::jackProcess(jack_nframes_t nframes, void* sam)
 {
-    ((StreamingAudioManager*)sam)->jack_process(nframes);
-    return 0;
-}
+    StreamingAudioManager* manager = (StreamingAudioManager*)sam;
 
-int StreamingAudioManager::jackSampleRateChanged(jack_nframes_t nframes, void*)
-{
-    qWarning("WARNING: JACK sample rate changed to %d/sec", nframes);
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    manager->jack_process(nframes);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // update the process statistics reported by /sam/stats
+    quint32 nanos = (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+    if (manager->m_processMaxReset.testAndSetOrdered(1, 0))
+    {
+        manager->m_processNanosMax = 0;
+    }
+    if (nanos > manager->m_processNanosMax) manager->m_processNanosMax = nanos;
+    manager->m_processNanos += nanos;
+    manager->m_processPeriods++;
     return 0;
 }
 
 int StreamingAudioManager::jackXrun(void* sam)
 {
     qWarning("WARNING: JACK xrun");
+    ((StreamingAudioManager*)sam)->m_xruns++;
     ((StreamingAudioManager*)sam)->notifyXrun();
     return 0;
 }
@@ -1174,80 +1556,250 @@ void StreamingAudioManager::doBeforeQuit()
 void StreamingAudioManager::handleOscMessage(OscMessage* msg, const char* sender, QAbstractSocket* socket)
 {
     qDebug("StreamingAudioManager::handleOscMessage");
-    // check prefix
-    int prefixLen = 5; // prefix is "/sam/"
-    const char* address = msg->getAddress();
-    qDebug("address = %s", address);
-    if (qstrncmp(address, "/sam/", prefixLen) != 0)
+    dispatch_osc_message(msg, sender, socket);
+    delete msg;
+}
+
+void StreamingAudioManager::dispatch_osc_message(OscMessage* msg, const char* sender, QAbstractSocket* socket, quint16 senderPort)
+{
+    qDebug("address = %s", msg->getAddress());
+
+    // copy the matches, since a handler may end up dispatching another message
+    QVector<int> methods = m_oscDispatcher.match(msg);
+    if (methods.isEmpty())
     {
         printf("Unknown OSC message:\n");
         msg->print();
-        delete msg;
-        return;
     }
 
-    // check second level of address
-    if (qstrcmp(address + prefixLen, "quit") == 0) // /sam/quit
+    for (int i = 0; i < methods.size(); i++)
     {
-        if (msg->getNumArgs() > 0)
+        int method = methods[i];
+        int param = method & OSC_PARAM_MASK;
+        switch (method & OSC_GROUP_MASK)
         {
-            printf("Unknown OSC message:\n");
-            msg->print();
-            delete msg;
-            return;
-        }
-        qDebug("Received /sam/quit message");
-        QCoreApplication::quit();
-    }
-    else if (qstrncmp(address + prefixLen, "debug", 5) == 0)
-    {
-        // print debug info to console
-        qWarning("Received /sam/debug message");
-        print_debug();
-    }
-    else if (qstrncmp(address + prefixLen, "app", 3) == 0)
-    {
-        handle_app_message(address + prefixLen + 3, msg, sender, socket);
-    }
-    else if (qstrncmp(address + prefixLen, "ui", 2) == 0)
-    {
-        handle_ui_message(address + prefixLen + 2, msg, sender);
-    }
-    else if (qstrncmp(address + prefixLen, "render", 6) == 0)
-    {
-        handle_render_message(address + prefixLen + 6, msg, sender, socket);
-    }
-    else if (qstrncmp(address + prefixLen, "set", 3) == 0)
-    {
-        handle_set_message(address + prefixLen + 3, msg, sender, socket);
-    }
-    else if (qstrncmp(address + prefixLen, "get", 3) == 0)
-    {
-        handle_get_message(address + prefixLen + 3, msg, sender);
-    }
-    else if (qstrncmp(address + prefixLen, "subscribe", 9) == 0)
-    {
-        handle_subscribe_message(address + prefixLen + 9, msg, sender, socket, false);
-    }
-    else if (qstrncmp(address + prefixLen, "unsubscribe", 11) == 0)
-    {
-        handle_subscribe_message(address + prefixLen + 11, msg, sender, socket, true);
-    }
-    else if (qstrncmp(address + prefixLen, "type", 4) == 0)
-    {
-        handle_type_message(address + prefixLen + 4, msg, sender);
-    }
-    else
-    {
-        printf("Unknown OSC message:");
-        msg->print();
-    }
-    delete msg;
-}
+        case OSC_GROUP_APP:
+            handle_app_message(method, msg, sender, socket);
+            break;
 
-void StreamingAudioManager::handle_app_message(const char* address, OscMessage* msg, const char* sender, QAbstractSocket* socket)
-{
-    if (qstrcmp(address, "/register") == 0) // /sam/app/register
+        case OSC_GROUP_UI:
+            handle_ui_message(method, msg, sender);
+            break;
+
+        case OSC_GROUP_RENDER:
+            handle_render_message(method, msg, sender, socket);
+            break;
+
+        case OSC_GROUP_SET:
+            handle_set_message(param, msg, sender, socket);
+            break;
+
+        case OSC_GROUP_SET_BULK:
+            osc_set_bulk(msg, param, sender, senderPort, socket);
+            break;
+
+        case OSC_GROUP_GET:
+            handle_get_message(param, msg, sender);
+            break;
+
+        case OSC_GROUP_SUBSCRIBE:
+            handle_subscribe_message(param, msg, sender, socket, false);
+            break;
+
+        case OSC_GROUP_UNSUBSCRIBE:
+            handle_subscribe_message(param, msg, sender, socket, true);
+            break;
+
+        case OSC_GROUP_MIRROR:
+            // only accept mirrored state from our primary
+            if (m_standbyLink && socket == m_standbyLink->getSocket())
+            {
+                osc_mirror_value(param, msg);
+            }
+            break;
+
+        default:
+            if (method == OSC_QUIT) // /sam/quit
+            {
+                qDebug("Received /sam/quit message");
+                QCoreApplication::quit();
+            }
+            else if (method == OSC_DEBUG) // /sam/debug
+            {
+                // print debug info to console
+                qWarning("Received /sam/debug message");
+                print_debug();
+            }
+            else if (method == OSC_TYPE_ADD) // /sam/type/add
+            {
+                // add a rendering type
+                osc_add_type(msg, sender);
+            }
+            else if (method == OSC_TYPE_REMOVE) // /sam/type/remove
+            {
+                // remove a rendering type
+                osc_remove_type(msg);
+            }
+            else if (method == OSC_METER_FRAME_SUBSCRIBE) // /sam/subscribe/meterframe
+            {
+                osc_subscribe_meter_frame(msg, sender, socket, false);
+            }
+            else if (method == OSC_METER_FRAME_UNSUBSCRIBE) // /sam/unsubscribe/meterframe
+            {
+                osc_subscribe_meter_frame(msg, sender, socket, true);
+            }
+            else if (method == OSC_STANDBY_REGISTER) // /sam/standby/register
+            {
+                if (socket->socketType() != QAbstractSocket::TcpSocket)
+                {
+                    qWarning("StreamingAudioManager::dispatch_osc_message ERROR: standby register message must be sent using TCP!");
+                    return;
+                }
+                osc_register_standby(dynamic_cast<QTcpSocket*>(socket));
+            }
+            else if (method == OSC_MIRROR_APP) // /sam/mirror/app
+            {
+                if (m_standbyLink && socket == m_standbyLink->getSocket())
+                {
+                    osc_mirror_app(msg);
+                }
+            }
+            else if (method == OSC_RELAY_ADD) // /sam/relay/add
+            {
+                osc_add_relay(msg);
+            }
+            else if (method == OSC_RELAY_REMOVE) // /sam/relay/remove
+            {
+                OscArg arg;
+                msg->getArg(0, arg);
+                removeRelay(arg.val.i);
+            }
+            else if (method == OSC_RECORD_START) // /sam/record/start
+            {
+                OscArg arg;
+                msg->getArg(0, arg);
+                int id = arg.val.i;
+                msg->getArg(1, arg);
+                if (!startRecording(id, QString(arg.val.s)))
+                {
+                    qWarning("StreamingAudioManager couldn't start recording %d", id);
+                }
+            }
+            else if (method == OSC_RECORD_STOP) // /sam/record/stop
+            {
+                OscArg arg;
+                msg->getArg(0, arg);
+                stopRecording(arg.val.i);
+            }
+            else if (method == OSC_CAPTURE_START) // /sam/capture/start
+            {
+                OscArg arg;
+                msg->getArg(0, arg);
+                int id = arg.val.i;
+                msg->getArg(1, arg);
+                if (!startCapture(id, QString(arg.val.s)))
+                {
+                    qWarning("StreamingAudioManager couldn't start capturing %d", id);
+                }
+            }
+            else if (method == OSC_CAPTURE_STOP) // /sam/capture/stop
+            {
+                OscArg arg;
+                msg->getArg(0, arg);
+                stopCapture(arg.val.i);
+            }
+            else if (method == OSC_STATS) // /sam/stats
+            {
+                osc_stats(msg, sender);
+            }
+            else if (method == OSC_LATENCY) // /sam/latency
+            {
+                osc_latency(msg, sender);
+            }
+            else if (method == OSC_MIRROR_UNREGISTERED) // /sam/app/unregistered
+            {
+                if (m_standbyLink && socket == m_standbyLink->getSocket())
+                {
+                    OscArg arg;
+                    msg->getArg(0, arg);
+                    unregisterApp(arg.val.i);
+                }
+            }
+            break;
+        }
+    }
+}
+
+void StreamingAudioManager::init_osc_methods()
+{
+    // only the /sam/set, /sam/get, /sam/subscribe and /sam/unsubscribe families can be reached through an address
+    // pattern: everything else (quitting, registering, relays, recording, ...) must be addressed exactly
+    m_oscDispatcher.addMethod("/sam/quit", "", OSC_QUIT);
+    m_oscDispatcher.addMethod("/sam/debug", NULL, OSC_DEBUG);
+
+    m_oscDispatcher.addMethod("/sam/app/register", NULL, OSC_APP_REGISTER); // types are checked after the socket type
+    m_oscDispatcher.addMethod("/sam/app/unregister", "i", OSC_APP_UNREGISTER);
+    m_oscDispatcher.addMethod("/sam/ui/register", "iiii", OSC_UI_REGISTER);
+    m_oscDispatcher.addMethod("/sam/ui/unregister", "i", OSC_UI_UNREGISTER);
+    m_oscDispatcher.addMethod("/sam/render/register", "iiii", OSC_RENDER_REGISTER);
+    m_oscDispatcher.addMethod("/sam/render/unregister", "", OSC_RENDER_UNREGISTER);
+    m_oscDispatcher.addMethod("/sam/type/add", NULL, OSC_TYPE_ADD);
+    m_oscDispatcher.addMethod("/sam/type/remove", "i", OSC_TYPE_REMOVE);
+    m_oscDispatcher.addMethod("/sam/subscribe/meterframe", "ii", OSC_METER_FRAME_SUBSCRIBE, true);
+    m_oscDispatcher.addMethod("/sam/unsubscribe/meterframe", "ii", OSC_METER_FRAME_UNSUBSCRIBE, true);
+    m_oscDispatcher.addMethod("/sam/app/resume", "iiiii", OSC_APP_RESUME);
+    m_oscDispatcher.addMethod("/sam/relay/add", "siii", OSC_RELAY_ADD);
+    m_oscDispatcher.addMethod("/sam/relay/add", "siiii", OSC_RELAY_ADD); // optional bit depth
+    m_oscDispatcher.addMethod("/sam/relay/remove", "i", OSC_RELAY_REMOVE);
+    m_oscDispatcher.addMethod("/sam/record/start", "is", OSC_RECORD_START);
+    m_oscDispatcher.addMethod("/sam/record/stop", "i", OSC_RECORD_STOP);
+    m_oscDispatcher.addMethod("/sam/capture/start", "is", OSC_CAPTURE_START);
+    m_oscDispatcher.addMethod("/sam/capture/stop", "i", OSC_CAPTURE_STOP);
+    m_oscDispatcher.addMethod("/sam/stats", "ii", OSC_STATS);
+    m_oscDispatcher.addMethod("/sam/latency", "ii", OSC_LATENCY);
+
+    // hot standby: registration with a primary, and state mirrored from it
+    m_oscDispatcher.addMethod("/sam/standby/register", "", OSC_STANDBY_REGISTER);
+    m_oscDispatcher.addMethod("/sam/mirror/app", "isiiiiiiiiifiif", OSC_MIRROR_APP);
+    m_oscDispatcher.addMethod("/sam/app/unregistered", "i", OSC_MIRROR_UNREGISTERED);
+    const char* valTypes[NUM_SUBSCRIPTIONS] = {"if", "ii", "ii", "if", "iiiiii", "iii", NULL};
+    for (int param = 0; param < NUM_SUBSCRIPTIONS; param++)
+    {
+        if (!valTypes[param]) continue;
+        QByteArray address = QByteArray("/sam/val/") + OSC_PARAM_NAMES[param];
+        m_oscDispatcher.addMethod(address.constData(), valTypes[param], OSC_GROUP_MIRROR | param);
+    }
+
+    // /sam/set/*: single-app form first, then the bulk (array) form
+    const char* setTypes[NUM_SUBSCRIPTIONS] = {"if", "ii", "ii", "if", "iiiiii", "iiii", NULL};
+    for (int param = 0; param < NUM_SUBSCRIPTIONS; param++)
+    {
+        if (!setTypes[param]) continue;
+        QByteArray address = QByteArray("/sam/set/") + OSC_PARAM_NAMES[param];
+        m_oscDispatcher.addMethod(address.constData(), setTypes[param], OSC_GROUP_SET | param, true);
+        if (param != SUBSCRIPTION_TYPE)
+        {
+            QByteArray bulkTypes = QByteArray(setTypes[param]) + "+";
+            m_oscDispatcher.addMethod(address.constData(), bulkTypes.constData(), OSC_GROUP_SET_BULK | param, true);
+        }
+    }
+
+    // /sam/get/*, /sam/subscribe/* and /sam/unsubscribe/*
+    for (int param = 0; param <= NUM_SUBSCRIPTIONS; param++)
+    {
+        const char* name = (param == NUM_SUBSCRIPTIONS) ? "all" : OSC_PARAM_NAMES[param];
+        if (param < NUM_SUBSCRIPTIONS)
+        {
+            m_oscDispatcher.addMethod((QByteArray("/sam/get/") + name).constData(), "ii", OSC_GROUP_GET | param, true);
+        }
+        m_oscDispatcher.addMethod((QByteArray("/sam/subscribe/") + name).constData(), "ii", OSC_GROUP_SUBSCRIBE | param, true);
+        m_oscDispatcher.addMethod((QByteArray("/sam/unsubscribe/") + name).constData(), "ii", OSC_GROUP_UNSUBSCRIBE | param, true);
+    }
+}
+
+void StreamingAudioManager::handle_app_message(int method, OscMessage* msg, const char* sender, QAbstractSocket* socket)
+{
+    if (method == OSC_APP_REGISTER) // /sam/app/register
     {
         if (socket->socketType() != QAbstractSocket::TcpSocket)
         {
@@ -1256,9 +1808,9 @@ void StreamingAudioManager::handle_app_message(const char* address, OscMessage*
             return;
         }
     
-        if (msg->typeMatches("siiiiiiiiiiiiii"))
+        if (msg->typeMatches("siiiiiiiiiiiiii") || msg->typeMatches("siiiiiiiiiiiiiii"))
         {
-            // register
+            // register (the optional last argument requests shared memory transport)
             osc_register(msg, dynamic_cast<QTcpSocket*>(socket));
         }
         else
@@ -1267,47 +1819,35 @@ void StreamingAudioManager::handle_app_message(const char* address, OscMessage*
             msg->print();
         }
     }
-    else if (qstrcmp(address, "/unregister") == 0) // /sam/app/unregister
+    else if (method == OSC_APP_UNREGISTER) // /sam/app/unregister
     {
-        if (msg->typeMatches("i"))
-        {
-            // unregister
-            qDebug("SAM received message to unregister app: source host = %s", sender);
+        // unregister
+        qDebug("SAM received message to unregister app: source host = %s", sender);
 
-            OscArg arg;
-            msg->getArg(0, arg);
-            int port = arg.val.i;
-            unregisterApp(port);
+        OscArg arg;
+        msg->getArg(0, arg);
+        int port = arg.val.i;
+        unregisterApp(port);
 
-            // TODO: error handling?  handle return value from UnregisterApp?
-        }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-        }
+        // TODO: error handling?  handle return value from UnregisterApp?
     }
-    else
+    else if (method == OSC_APP_RESUME) // /sam/app/resume
     {
-        printf("Unknown OSC message:\n");
-        msg->print();
+        if (socket->socketType() != QAbstractSocket::TcpSocket)
+        {
+            qWarning("StreamingAudioManager::handle_app_message ERROR: app resume message must be sent using TCP!");
+            return;
+        }
+        osc_resume(msg, dynamic_cast<QTcpSocket*>(socket));
     }
 }
 
-void StreamingAudioManager::handle_ui_message(const char* address, OscMessage* msg, const char* sender)
+void StreamingAudioManager::handle_ui_message(int method, OscMessage* msg, const char* sender)
 {
     qDebug("SAM received UI message: source host = %s", sender);
 
-    // check third level of address
-    if (qstrcmp(address, "/register") == 0) // /sam/ui/register
+    if (method == OSC_UI_REGISTER) // /sam/ui/register
     {
-        if (!msg->typeMatches("iiii"))
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-            return;
-        }
-
         OscArg arg;
         msg->getArg(0, arg);
         int majorVersion = arg.val.i;
@@ -1347,15 +1887,8 @@ void StreamingAudioManager::handle_ui_message(const char* address, OscMessage* m
             }
         }
     }
-    else if (qstrcmp(address, "/unregister") == 0) // /sam/ui/unregister
+    else if (method == OSC_UI_UNREGISTER) // /sam/ui/unregister
     {
-        if (!msg->typeMatches("i"))
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-            return;
-        }
-
         OscArg arg;
         msg->getArg(0, arg);
         quint16 replyPort = arg.val.i;
@@ -1364,188 +1897,96 @@ void StreamingAudioManager::handle_ui_message(const char* address, OscMessage* m
         unregisterUI(sender, replyPort);
         // TODO: error handling?  handle return value from UnregisterUI?
     }
-    else
-    {
-        printf("Unknown OSC message:\n");
-        msg->print();
-    }
 }
 
-void StreamingAudioManager::handle_render_message(const char* address, OscMessage* msg, const char* sender, QAbstractSocket* socket)
+void StreamingAudioManager::handle_render_message(int method, OscMessage* msg, const char* sender, QAbstractSocket* socket)
 {
-    // check third level of address
-    if (qstrcmp(address, "/register") == 0) // /sam/render/register
+    if (method == OSC_RENDER_REGISTER) // /sam/render/register
     {
-        if (msg->typeMatches("iiii"))
-        {
-            qDebug("SAM received message to register a renderer: source host = %s", sender);
-
-            OscArg arg;
-            msg->getArg(0, arg);
-            int majorVersion = arg.val.i;
-            msg->getArg(1, arg);
-            int minorVersion = arg.val.i;
-            msg->getArg(2, arg);
-            int patchVersion = arg.val.i;
-            msg->getArg(3, arg);
-            quint16 replyPort = arg.val.i;
-
-            if (socket->socketType() != QAbstractSocket::TcpSocket)
-            {
-                qWarning("StreamingAudioManager::handle_render_message registering renderer with UDP.");
-                socket = NULL;
-            }
+        qDebug("SAM received message to register a renderer: source host = %s", sender);
 
-            bool success = false;
-            sam::SamErrorCode code = sam::SAM_ERR_DEFAULT;
-            if (version_check(majorVersion, minorVersion, patchVersion))
-            {
-                success = registerRenderer(sender, replyPort, dynamic_cast<QTcpSocket*>(socket));
-            }
-            else
-            {
-                code = sam::SAM_ERR_VERSION_MISMATCH;
-                qWarning("Denying renderer registration due to version mismatch: SAM is version %d.%d.%d, renderer is %d.%d.%d",
-                         sam::VERSION_MAJOR, sam::VERSION_MINOR, sam::VERSION_PATCH, majorVersion, minorVersion, patchVersion);
-            }
+        OscArg arg;
+        msg->getArg(0, arg);
+        int majorVersion = arg.val.i;
+        msg->getArg(1, arg);
+        int minorVersion = arg.val.i;
+        msg->getArg(2, arg);
+        int patchVersion = arg.val.i;
+        msg->getArg(3, arg);
+        quint16 replyPort = arg.val.i;
 
-            if (success)
-            {
-                printf("Registered a renderer at host %s, port %d\n\n", sender, replyPort);
-            }
-            else
-            {
-                OscMessage replyMsg;
-                replyMsg.init("/sam/render/regdeny", "i", code);
-                OscAddress replyAddress;
-                replyAddress.host.setAddress(sender);
-                replyAddress.port = replyPort;
-                if (!OscClient::sendUdp(&replyMsg, &replyAddress))
-                {
-                    qWarning("Couldn't send OSC message");
-                }
-            }
-        }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-        }
-    }
-    else if (qstrcmp(address, "/unregister") == 0) // /sam/render/unregister
-    {
-        if (msg->typeMatches(""))
-        {
-            qDebug("SAM received message to unregister a renderer: source host = %s", sender);
-            printf("Unregistering renderer\n\n");
-            unregisterRenderer();
-        }
-        else
+        if (socket->socketType() != QAbstractSocket::TcpSocket)
         {
-            printf("Unknown OSC message:\n");
-            msg->print();
+            qWarning("StreamingAudioManager::handle_render_message registering renderer with UDP.");
+            socket = NULL;
         }
-    }
-    else
-    {
-        printf("Unknown OSC message:\n");
-        msg->print();
-    }
-}
 
-void StreamingAudioManager::handle_set_message(const char* address, OscMessage* msg, const char* sender, QAbstractSocket* socket)
-{
-    // TODO: error handling (invalid port, etc.)
-
-    // check third level of address
-    if (qstrcmp(address, "/volume") == 0) // /sam/set/volume
-    {
-        if (msg->typeMatches("if"))
-        {
-            osc_set_volume(msg, sender);
-        }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-        }
-    }
-    else if (qstrcmp(address, "/mute") == 0) // /sam/set/mute
-    {
-        if (msg->typeMatches("ii"))
-        {
-            osc_set_mute(msg, sender);
-        }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-        }
-    }
-    else if (qstrcmp(address, "/solo") == 0) // /sam/set/solo
-    {
-        if (msg->typeMatches("ii"))
-        {
-            osc_set_solo(msg, sender);
-        }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-        }
-    }
-    else if (qstrcmp(address, "/delay") == 0) // /sam/set/delay
-    {
-        if (msg->typeMatches("if"))
-        {
-            osc_set_delay(msg, sender);
-        }
-        else
-        {
-            printf("Unknown OSC message:\n");
-            msg->print();
-        }
-    }
-    else if (qstrcmp(address, "/position") == 0) // /sam/set/position
-    {
-        if (msg->typeMatches("iiiiii"))
+        bool success = false;
+        sam::SamErrorCode code = sam::SAM_ERR_DEFAULT;
+        if (version_check(majorVersion, minorVersion, patchVersion))
         {
-            osc_set_position(msg, sender);
+            success = registerRenderer(sender, replyPort, dynamic_cast<QTcpSocket*>(socket));
         }
         else
         {
-            printf("Unknown OSC message:\n");
-            msg->print();
+            code = sam::SAM_ERR_VERSION_MISMATCH;
+            qWarning("Denying renderer registration due to version mismatch: SAM is version %d.%d.%d, renderer is %d.%d.%d",
+                     sam::VERSION_MAJOR, sam::VERSION_MINOR, sam::VERSION_PATCH, majorVersion, minorVersion, patchVersion);
         }
-    }
-    else if (qstrcmp(address, "/type") == 0) // /sam/set/type
-    {
-        if (msg->typeMatches("iiii"))
+
+        if (success)
         {
-            osc_set_type(msg, sender, socket);
+            printf("Registered a renderer at host %s, port %d\n\n", sender, replyPort);
         }
         else
         {
-            printf("Unknown OSC message:\n");
-            msg->print();
+            OscMessage replyMsg;
+            replyMsg.init("/sam/render/regdeny", "i", code);
+            OscAddress replyAddress;
+            replyAddress.host.setAddress(sender);
+            replyAddress.port = replyPort;
+            if (!OscClient::sendUdp(&replyMsg, &replyAddress))
+            {
+                qWarning("Couldn't send OSC message");
+            }
         }
     }
-    else
+    else if (method == OSC_RENDER_UNREGISTER) // /sam/render/unregister
     {
-        printf("Unknown OSC message:\n");
-        msg->print();
+        qDebug("SAM received message to unregister a renderer: source host = %s", sender);
+        printf("Unregistering renderer\n\n");
+        unregisterRenderer();
     }
 }
 
-void StreamingAudioManager::handle_get_message(const char* address, OscMessage* msg, const char* sender)
+void StreamingAudioManager::handle_set_message(int param, OscMessage* msg, const char* sender, QAbstractSocket* socket)
 {
-    if (!msg->typeMatches("ii"))
+    // TODO: error handling (invalid port, etc.)
+    switch (param)
     {
-        printf("Unknown OSC message:\n");
-        msg->print();
-        return;
+    case SUBSCRIPTION_VOLUME: // /sam/set/volume
+        osc_set_volume(msg, sender);
+        break;
+    case SUBSCRIPTION_MUTE: // /sam/set/mute
+        osc_set_mute(msg, sender);
+        break;
+    case SUBSCRIPTION_SOLO: // /sam/set/solo
+        osc_set_solo(msg, sender);
+        break;
+    case SUBSCRIPTION_DELAY: // /sam/set/delay
+        osc_set_delay(msg, sender);
+        break;
+    case SUBSCRIPTION_POSITION: // /sam/set/position
+        osc_set_position(msg, sender);
+        break;
+    case SUBSCRIPTION_TYPE: // /sam/set/type
+        osc_set_type(msg, sender, socket);
+        break;
     }
+}
 
+void StreamingAudioManager::handle_get_message(int param, OscMessage* msg, const char* sender)
+{
     OscArg arg;
     msg->getArg(0, arg);
     int port = arg.val.i;
@@ -1562,23 +2003,23 @@ void StreamingAudioManager::handle_get_message(const char* address, OscMessage*
     // check for out of range port
     bool validPort = idIsValid(port);
 
-    // check third level of address and init message
-    if ((validPort || (port == -1)) && qstrcmp(address, "/volume") == 0) // /sam/get/volume
+    // init message
+    if ((validPort || (port == -1)) && param == SUBSCRIPTION_VOLUME) // /sam/get/volume
     {
         float volume = (port < 0) ? m_volumeNext : m_apps[port]->getVolume();
         replyMsg.init("/sam/val/volume", "if", port, volume);
     }
-    else if ((validPort || (port == -1)) && qstrcmp(address, "/mute") == 0) // /sam/get/mute
+    else if ((validPort || (port == -1)) && param == SUBSCRIPTION_MUTE) // /sam/get/mute
     {
         bool mute = (port < 0) ? m_muteNext : m_apps[port]->getMute();
         replyMsg.init("/sam/val/mute", "ii", port, mute);
     }
-    else if ((validPort) && qstrcmp(address, "/solo") == 0) // /sam/get/solo
+    else if ((validPort) && param == SUBSCRIPTION_SOLO) // /sam/get/solo
     {
         bool solo = m_apps[port]->getSolo();
         replyMsg.init("/sam/val/solo", "ii", port, solo);
     }
-    else if ((validPort || (port == -1)) && qstrcmp(address, "/delay") == 0) // /sam/get/delay
+    else if ((validPort || (port == -1)) && param == SUBSCRIPTION_DELAY) // /sam/get/delay
     {
         float delayMillis = 0.0f;
         if (port < 0)
@@ -1592,31 +2033,25 @@ void StreamingAudioManager::handle_get_message(const char* address, OscMessage*
         }
         replyMsg.init("/sam/val/delay", "if", port, delayMillis);
     }
-    else if (validPort && qstrcmp(address, "/position") == 0) // /sam/get/position
+    else if (validPort && param == SUBSCRIPTION_POSITION) // /sam/get/position
     {
         SamAppPosition pos = m_apps[port]->getPosition();
         replyMsg.init("/sam/val/position", "iiiii", port, pos.x, pos.y, pos.width, pos.height);
     }
-    else if (validPort && qstrcmp(address, "/type") == 0) // /sam/get/type
+    else if (validPort && param == SUBSCRIPTION_TYPE) // /sam/get/type
     {
         StreamingAudioType type = m_apps[port]->getType();
         int preset = m_apps[port]->getPreset();
         replyMsg.init("/sam/val/type", "iii", port, type, preset);
     }
-    else if (validPort && qstrcmp(address, "/meter") == 0) // /sam/get/meter
+    else if (validPort && param == SUBSCRIPTION_METER) // /sam/get/meter
     {
         qWarning("/sam/get/meter not implemented yet!");
         return;
     }
-    else if (!validPort)
-    {
-        replyMsg.init("/sam/err/idinvalid", "i", port);
-    }
     else
     {
-        printf("Unknown OSC message:\n");
-        msg->print();
-        return;
+        replyMsg.init("/sam/err/idinvalid", "i", port);
     }
 
     // send the reply
@@ -1626,15 +2061,8 @@ void StreamingAudioManager::handle_get_message(const char* address, OscMessage*
     }
 }
 
-void StreamingAudioManager::handle_subscribe_message(const char* address, OscMessage* msg, const char* sender, QAbstractSocket* socket, bool unsubscribe)
+void StreamingAudioManager::handle_subscribe_message(int param, OscMessage* msg, const char* sender, QAbstractSocket* socket, bool unsubscribe)
 {
-    if (!msg->typeMatches("ii"))
-    {
-        printf("Unknown OSC message:\n");
-        msg->print();
-        return;
-    }
-
     OscArg arg;
     msg->getArg(0, arg);
     int port = arg.val.i;
@@ -1650,52 +2078,7 @@ void StreamingAudioManager::handle_subscribe_message(const char* address, OscMes
     msg->getArg(1, arg);
     quint16 replyPort = arg.val.i;
 
-    int param = -1;
-
-    // check third level of address
-    if (qstrcmp(address, "/volume") == 0) // /sam/unsubscribe/volume
-    {
-        if (unsubscribe) printf("Unsubscribing host %s, port %d from volume for app %d\n\n", sender, replyPort, port);
-        else printf("Subscribing host %s, port %d to volume for app %d\n\n", sender, replyPort, port);
-        param = SUBSCRIPTION_VOLUME;
-    }
-    else if (qstrcmp(address, "/mute") == 0) // /sam/unsubscribe/mute
-    {
-        if (unsubscribe) printf("Unsubscribing host %s, port %d from mute for app %d\n\n", sender, replyPort, port);
-        else printf("Subscribing host %s, port %d to mute for app %d\n\n", sender, replyPort, port);
-        param = SUBSCRIPTION_MUTE;
-    }
-    else if (qstrcmp(address, "/solo") == 0) // /sam/unsubscribe/solo
-    {
-        if (unsubscribe) printf("Unsubscribing host %s, port %d from solo for app %d\n\n", sender, replyPort, port);
-        else printf("Subscribing host %s, port %d to solo for app %d\n\n", sender, replyPort, port);
-        param = SUBSCRIPTION_SOLO;
-    }
-    else if (qstrcmp(address, "/delay") == 0) // /sam/unsubscribe/delay
-    {
-        if (unsubscribe) printf("Unsubscribing host %s, port %d from delay for app %d\n\n", sender, replyPort, port);
-        else printf("Subscribing host %s, port %d to delay for app %d\n\n", sender, replyPort, port);
-        param = SUBSCRIPTION_DELAY;
-    }
-    else if (qstrcmp(address, "/position") == 0) // /sam/unsubscribe/position
-    {
-        if (unsubscribe) printf("Unsubscribing host %s, port %d from position for app %d\n\n", sender, replyPort, port);
-        else printf("Subscribing host %s, port %d to position for app %d\n\n", sender, replyPort, port);
-        param = SUBSCRIPTION_POSITION;
-    }
-    else if (qstrcmp(address, "/type") == 0) // /sam/unsubscribe/type
-    {
-        if (unsubscribe) printf("Unsubscribing host %s, port %d from type for app %d\n\n", sender, replyPort, port);
-        else printf("Subscribing host %s, port %d to type for app %d\n\n", sender, replyPort, port);
-        param = SUBSCRIPTION_TYPE;
-    }
-    else if (qstrcmp(address, "/meter") == 0) // /sam/unsubscribe/meter
-    {
-        if (unsubscribe) printf("Unsubscribing host %s, port %d from meter for app %d\n\n", sender, replyPort, port);
-        else printf("Subscribing host %s, port %d to meter for app %d\n\n", sender, replyPort, port);
-        param = SUBSCRIPTION_METER;
-    }
-    else if (qstrcmp(address, "/all") == 0) // /sam/unsubscribe/all
+    if (param == NUM_SUBSCRIPTIONS) // /sam/subscribe/all or /sam/unsubscribe/all
     {
         if (unsubscribe)
         {
@@ -1723,12 +2106,9 @@ void StreamingAudioManager::handle_subscribe_message(const char* address, OscMes
         }
         return;
     }
-    else
-    {
-        printf("Unknown OSC message:\n");
-        msg->print();
-        return;
-    }
+
+    if (unsubscribe) printf("Unsubscribing host %s, port %d from %s for app %d\n\n", sender, replyPort, OSC_PARAM_NAMES[param], port);
+    else printf("Subscribing host %s, port %d to %s for app %d\n\n", sender, replyPort, OSC_PARAM_NAMES[param], port);
 
     if (unsubscribe)
     {
@@ -1756,97 +2136,57 @@ void StreamingAudioManager::handle_subscribe_message(const char* address, OscMes
     // TODO: error handling (invalid port, etc.)
 }
 
-void StreamingAudioManager::handle_type_message(const char* address, OscMessage* msg, const char* sender)
-{
-    if (qstrcmp(address, "/add") == 0) // /sam/type/add
-    {
-        // add a rendering type
-        osc_add_type(msg, sender);
-    }
-    else if ((qstrcmp(address, "/remove") == 0) && msg->typeMatches("i")) // /sam/type/remove
-    {
-        // remove a rendering type
-        osc_remove_type(msg);
-    }
-    else
-    {
-        printf("Unknown OSC message:\n");
-        msg->print();
-    }
-}
-
-bool StreamingAudioManager::start_jack(int sampleRate, int bufferSize, int outChannels, const char* driver)
+bool StreamingAudioManager::open_audio_backend()
 {
-    // error checking
-    if (m_jackPID >= 0)
+    if (m_audio)
     {
-        qWarning("StreamingAudioManager::start_jack() error: JACK server already started.  To restart, you must first stop the server.");
+        qWarning("StreamingAudioManager::open_audio_backend() error: audio backend already open.  To restart, you must first close it.");
         return false;
     }
 
-    // start jackd
-    m_jackPID = StartJack(sampleRate, bufferSize, outChannels, driver);
-    if (m_jackPID >= 0)
+    if (m_audioBackendName == "virtual" || m_audioBackendName == "offline")
     {
-        qDebug("Successfully started the JACK server with PID %d\n", m_jackPID);
-        return true;
+        // a virtual sound card with the configured output ports, clocked in real time ("virtual") or stepped by a test harness ("offline")
+        VirtualAudioBackend* backend = new VirtualAudioBackend(m_sampleRate, m_bufferSize, m_audioBackendName == "virtual");
+        backend->addPhysicalPorts(m_outJackClientNameBasic, m_outJackPortBaseBasic, m_maxOutputChannels);
+        backend->addPhysicalPorts(m_outJackClientNameDiscrete, m_outJackPortBaseDiscrete, m_maxOutputChannels);
+        m_audio = backend;
     }
     else
     {
-        return false;
-    }
-}
-
-bool StreamingAudioManager::stop_jack()
-{
-    if (m_jackPID < 0) return true; // nothing to stop
-    bool success = StopJack(m_jackPID);
-    if (success) m_jackPID = 0;
-    return success;
-}
-
-bool StreamingAudioManager::open_jack_client()
-{
-    // open a client connection to the JACK server
-    jack_status_t status;
-    m_client = jack_client_open("StreamingAudioManager", JackNullOption, &status);
-    if (m_client == NULL)
-    {
-        qWarning("StreamingAudioManager::open_jack_client(): jack_client_open() failed, status = 0x%2.0x", status);
-        if (status & JackServerFailed)
+        if (m_audioBackendName != "jack")
         {
-            qWarning("StreamingAudioManager::open_jack_client(): Unable to connect to JACK server");
+            QByteArray nameBytes = m_audioBackendName.toLocal8Bit();
+            qWarning("Unknown audio backend %s, using JACK", nameBytes.constData());
         }
-        return false;
-    }
-    if (status & JackServerStarted)
-    {
-        qWarning("StreamingAudioManager::open_jack_client(): had to start new JACK server");
+        m_audio = new JackAudioBackend(m_sampleRate, m_bufferSize, m_maxOutputChannels, m_jackDriver, "StreamingAudioManager");
     }
-    if (status & JackNameNotUnique)
+
+    if (!m_audio->open())
     {
-        const char *client_name = jack_get_client_name(m_client);
-        qWarning("StreamingAudioManager::open_jack_client(): unique client name `%s' assigned", client_name);
+        qWarning("Couldn't open %s audio backend", m_audio->getName());
+        delete m_audio;
+        m_audio = NULL;
+        return false;
     }
+    printf("Audio backend: %s\n", m_audio->getName());
     return true;
 }
 
-bool StreamingAudioManager::close_jack_client()
+bool StreamingAudioManager::close_audio_backend()
 {
-    if (m_client != NULL)
+    if (!m_audio) return true;
+
+    if (m_portPool)
     {
-        // close this client
-        int result = jack_client_close(m_client);
-        if (result == 0)
-        {
-            m_client = NULL;
-        }
-        else
-        {
-            return false;
-        }
+        delete m_portPool;
+        m_portPool = NULL;
     }
-    return true;
+
+    bool success = m_audio->close();
+    delete m_audio;
+    m_audio = NULL;
+    return success;
 }
 
 // ---- OSC message handlers ----
@@ -1928,6 +2268,300 @@ void StreamingAudioManager::osc_set_position(OscMessage* msg, const char* sender
     setAppPosition(port, x, y, width, height, depth);
 }
 
+void StreamingAudioManager::osc_set_bulk(OscMessage* msg, int param, const char* sender, quint16 senderPort, QAbstractSocket* socket)
+{
+    qDebug("SAM received bulk message to set parameter %d", param);
+    qDebug("source host = %s", sender);
+
+    // if the audio thread hasn't applied the previous change set yet (or earlier ones are still queued),
+    // queue this one to be staged after the next period rather than waiting for it here
+    if (!m_queuedChangeSets.isEmpty() || !begin_change_set())
+    {
+        queue_change_set(msg, param, sender, senderPort, socket);
+        return;
+    }
+    stage_change_set(msg, param);
+}
+
+void StreamingAudioManager::stage_change_set(OscMessage* msg, int param)
+{
+    const char* valAddress = NULL;
+    int stride = 2;
+    switch (param)
+    {
+    case SUBSCRIPTION_VOLUME:
+        valAddress = "/sam/val/volume";
+        break;
+    case SUBSCRIPTION_MUTE:
+        valAddress = "/sam/val/mute";
+        break;
+    case SUBSCRIPTION_SOLO:
+        valAddress = "/sam/val/solo";
+        break;
+    case SUBSCRIPTION_DELAY:
+        valAddress = "/sam/val/delay";
+        break;
+    case SUBSCRIPTION_POSITION:
+        valAddress = "/sam/val/position";
+        stride = 6;
+        break;
+    default:
+        qWarning("StreamingAudioManager::stage_change_set unknown parameter %d", param);
+        return;
+    }
+
+    // stage all changes, building one coalesced notification per subscriber along the way
+    SamBulkNotification notify;
+    OscArg vals[6];
+    int numItems = msg->getNumArgs() / stride;
+    for (int item = 0; item < numItems; item++)
+    {
+        for (int i = 0; i < stride; i++)
+        {
+            msg->getArg(item * stride + i, vals[i]);
+        }
+        int port = vals[0].val.i;
+
+        if (port == -1 && param != SUBSCRIPTION_SOLO && param != SUBSCRIPTION_POSITION)
+        {
+            // global parameters
+            if (param == SUBSCRIPTION_VOLUME)
+            {
+                m_volumeStaged = vals[1].val.f >= 0.0f ? vals[1].val.f : 0.0f;
+                m_volumeStaged = m_volumeStaged <= 1.0f ? m_volumeStaged : 1.0f;
+                m_stagedFlags |= STAGED_VOLUME;
+                vals[1].val.f = m_volumeStaged;
+                emit volumeChanged(m_volumeStaged);
+            }
+            else if (param == SUBSCRIPTION_MUTE)
+            {
+                m_muteStaged = vals[1].val.i;
+                m_stagedFlags |= STAGED_MUTE;
+                emit muteChanged(m_muteStaged);
+            }
+            else
+            {
+                float delay = vals[1].val.f;
+                m_delayStaged = m_sampleRate * (delay / 1000.0f);
+                m_delayStaged = (m_delayStaged < 0) ? 0 : m_delayStaged;
+                m_delayStaged = (m_delayStaged >= m_delayMaxGlobal) ? m_delayMaxGlobal - 1 : m_delayStaged;
+                m_stagedFlags |= STAGED_DELAY;
+                vals[1].val.f = ((m_delayStaged * 1000.0f) / (float)m_sampleRate); // actual delay set, in millis
+                emit delayChanged(delay);
+            }
+            add_bulk_notification(notify, valAddress, m_uiSubscribers, QVector<QTcpSocket*>(), vals, stride);
+            continue;
+        }
+
+        if (!idIsValid(port))
+        {
+            qWarning("StreamingAudioManager::stage_change_set invalid id %d", port);
+            continue;
+        }
+
+        StreamingAudioApp* app = m_apps[port];
+        switch (param)
+        {
+        case SUBSCRIPTION_VOLUME:
+            vals[1].val.f = app->stageVolume(vals[1].val.f);
+            emit appVolumeChanged(port, vals[1].val.f);
+            break;
+        case SUBSCRIPTION_MUTE:
+            app->stageMute(vals[1].val.i);
+            emit appMuteChanged(port, vals[1].val.i);
+            break;
+        case SUBSCRIPTION_SOLO:
+            app->stageSolo(vals[1].val.i);
+            emit appSoloChanged(port, vals[1].val.i);
+            break;
+        case SUBSCRIPTION_DELAY:
+        {
+            float delay = vals[1].val.f;
+            vals[1].val.f = app->stageDelay(delay);
+            emit appDelayChanged(port, delay);
+            break;
+        }
+        case SUBSCRIPTION_POSITION:
+        {
+            SamAppPosition pos;
+            pos.x = vals[1].val.i;
+            pos.y = vals[2].val.i;
+            pos.width = vals[3].val.i;
+            pos.height = vals[4].val.i;
+            pos.depth = vals[5].val.i;
+            app->setPosition(pos, false);
+            emit appPositionChanged(port, pos.x, pos.y, pos.width, pos.height, pos.depth);
+            break;
+        }
+        }
+        add_bulk_notification(notify, valAddress, app->getSubscribers(param), app->getSubscribersTcp(param), vals, stride);
+    }
+
+    commit_change_set();
+
+    // standby SAMs apply the same change set
+    mirrorState(msg);
+
+    // send one coalesced notification to each subscriber
+    for (int i = 0; i < notify.udpDests.size(); i++)
+    {
+        m_notifier->notify(OscNotifier::NO_COALESCE, notify.udpMsgs[i], QVector<OscAddress*>(1, notify.udpDests[i]));
+        delete notify.udpMsgs[i];
+    }
+    for (int i = 0; i < notify.tcpDests.size(); i++)
+    {
+        m_notifier->notify(OscNotifier::NO_COALESCE, notify.tcpMsgs[i], QVector<OscAddress*>(), QVector<QTcpSocket*>(1, notify.tcpDests[i]));
+        delete notify.tcpMsgs[i];
+    }
+}
+
+void StreamingAudioManager::add_bulk_notification(SamBulkNotification& notify,
+                                                  const char* address,
+                                                  const QVector<OscAddress*>& subscribers,
+                                                  const QVector<QTcpSocket*>& subscribersTcp,
+                                                  const OscArg* vals,
+                                                  int numVals)
+{
+    for (int i = 0; i < subscribers.size(); i++)
+    {
+        OscAddress* dest = subscribers[i];
+
+        // find the message already being built for this subscriber, if any
+        OscMessage* msg = NULL;
+        for (int j = 0; j < notify.udpDests.size(); j++)
+        {
+            if (notify.udpDests[j]->host == dest->host && notify.udpDests[j]->port == dest->port)
+            {
+                msg = notify.udpMsgs[j];
+                break;
+            }
+        }
+        if (!msg)
+        {
+            msg = new OscMessage();
+            msg->init(address);
+            notify.udpDests.append(dest);
+            notify.udpMsgs.append(msg);
+        }
+
+        for (int v = 0; v < numVals; v++)
+        {
+            if (vals[v].type == 'f') msg->addFloatArg(vals[v].val.f);
+            else msg->addIntArg(vals[v].val.i);
+        }
+    }
+
+    for (int i = 0; i < subscribersTcp.size(); i++)
+    {
+        QTcpSocket* dest = subscribersTcp[i];
+        int index = notify.tcpDests.indexOf(dest);
+        OscMessage* msg = NULL;
+        if (index >= 0)
+        {
+            msg = notify.tcpMsgs[index];
+        }
+        else
+        {
+            msg = new OscMessage();
+            msg->init(address);
+            notify.tcpDests.append(dest);
+            notify.tcpMsgs.append(msg);
+        }
+
+        for (int v = 0; v < numVals; v++)
+        {
+            if (vals[v].type == 'f') msg->addFloatArg(vals[v].val.f);
+            else msg->addIntArg(vals[v].val.i);
+        }
+    }
+}
+
+bool StreamingAudioManager::begin_change_set()
+{
+    // audio isn't running, so apply anything left over here
+    if (!m_isRunning && m_changeSetPending.testAndSetOrdered(1, 0))
+    {
+        apply_change_set();
+    }
+
+    // the staged values belong to the audio thread until it has applied the previous change set
+    return m_changeSetPending.testAndSetOrdered(0, 0);
+}
+
+void StreamingAudioManager::queue_change_set(OscMessage* msg, int param, const char* sender, quint16 senderPort, QAbstractSocket* socket)
+{
+    SamQueuedChangeSet queued;
+    queued.param = param;
+    queued.sender = sender;
+    queued.senderPort = senderPort;
+    queued.socket = socket;
+    if (m_queuedChangeSets.size() >= MAX_QUEUED_CHANGE_SETS || !msg->write(queued.data))
+    {
+        qWarning("StreamingAudioManager::queue_change_set rejected change set for parameter %d (%d already queued)",
+                 param, m_queuedChangeSets.size());
+        reject_change_set(queued);
+        return;
+    }
+
+    m_queuedChangeSets.append(queued);
+    if (!m_changeSetScheduled)
+    {
+        m_changeSetScheduled = true;
+        QTimer::singleShot(CHANGE_SET_RETRY_MILLIS, this, SLOT(stageQueuedChangeSets()));
+    }
+}
+
+void StreamingAudioManager::reject_change_set(const SamQueuedChangeSet& rejected)
+{
+    OscMessage errMsg;
+    errMsg.init("/sam/err/changeset", "i", rejected.param);
+    QAbstractSocket* socket = rejected.socket;
+    if (socket && socket->socketType() == QAbstractSocket::TcpSocket)
+    {
+        if (!OscClient::sendFromSocket(&errMsg, socket))
+        {
+            qWarning("Couldn't send OSC message");
+        }
+    }
+    else if (rejected.senderPort != 0)
+    {
+        OscAddress replyAddr;
+        replyAddr.host.setAddress(QString(rejected.sender));
+        replyAddr.port = rejected.senderPort;
+        if (!OscClient::sendUdp(&errMsg, &replyAddr))
+        {
+            qWarning("Couldn't send OSC message");
+        }
+    }
+}
+
+void StreamingAudioManager::commit_change_set()
+{
+    if (m_isRunning)
+    {
+        // the audio thread will apply the change set at the start of its next period
+        m_changeSetPending.fetchAndStoreOrdered(1);
+    }
+    else
+    {
+        apply_change_set();
+    }
+}
+
+void StreamingAudioManager::apply_change_set()
+{
+    const SamActiveApps* active = m_activeApps.fetchAndAddAcquire(0);
+    for (int i = 0; i < active->apps.size(); i++)
+    {
+        active->apps.at(i)->commitStaged();
+    }
+
+    if (m_stagedFlags & STAGED_VOLUME) m_volumeNext = m_volumeStaged;
+    if (m_stagedFlags & STAGED_MUTE) m_muteNext = m_muteStaged;
+    if (m_stagedFlags & STAGED_DELAY) m_delayNext = m_delayStaged;
+    m_stagedFlags = 0;
+}
+
 void StreamingAudioManager::osc_set_type(OscMessage* msg, const char* sender, QAbstractSocket* socket)
 {
     qDebug("SAM received message to set type");
@@ -1991,6 +2625,29 @@ void StreamingAudioManager::osc_set_type(OscMessage* msg, const char* sender, QA
     }
 }
 
+/**
+ * Check if an address belongs to this host.
+ * @param address the address to check
+ * @return true if the address is a loopback address or one of this host's interface addresses
+ */
+static bool is_local_host(const QHostAddress& address)
+{
+    QHostAddress addr = address;
+    if (addr.protocol() == QAbstractSocket::IPv6Protocol)
+    {
+        // a dual-stack socket reports IPv4 peers as IPv4-mapped IPv6 addresses (::ffff:a.b.c.d)
+        Q_IPV6ADDR ip6 = addr.toIPv6Address();
+        bool mapped = (ip6.c[10] == 0xff && ip6.c[11] == 0xff);
+        for (int i = 0; i < 10 && mapped; i++)
+        {
+            mapped = (ip6.c[i] == 0);
+        }
+        if (mapped) addr.setAddress(qFromBigEndian<quint32>(ip6.c + 12));
+    }
+    if (addr == QHostAddress(QHostAddress::LocalHost) || addr == QHostAddress(QHostAddress::LocalHostIPv6)) return true;
+    return QNetworkInterface::allAddresses().contains(addr);
+}
+
 void StreamingAudioManager::osc_register(OscMessage* msg, QTcpSocket* socket)
 {
     qDebug("SAM received message to register an app");
@@ -2028,6 +2685,13 @@ void StreamingAudioManager::osc_register(OscMessage* msg, QTcpSocket* socket)
     int patchVersion = arg.val.i;
     msg->getArg(14, arg);
     quint16 replyPort = arg.val.i;
+    bool sharedMemory = false;
+    if (msg->getNumArgs() > 15)
+    {
+        msg->getArg(15, arg);
+        // only a client on this host can share memory with SAM
+        sharedMemory = (arg.val.i != 0) && is_local_host(socket->peerAddress());
+    }
 
     int port = -1;
     // register if version matches
@@ -2038,7 +2702,7 @@ void StreamingAudioManager::osc_register(OscMessage* msg, QTcpSocket* socket)
         QString addrString = addr.toString();
         QByteArray addrBytes = addrString.toLocal8Bit();
         printf("Registering app at hostname %s, port %d with name %s, %d channel(s), position [%d %d %d %d %d], type = %d, preset = %d, packet queue length = %d\n\n", addrBytes.constData(), replyPort, name, channels, x, y, width, height, depth, type, preset, packetQueueLength);
-        port = registerApp(name, channels, x, y, width, height, depth, type, preset, packetQueueLength, socket, code);
+        port = registerApp(name, channels, x, y, width, height, depth, type, preset, packetQueueLength, socket, code, -1, sharedMemory);
     }
     else
     {
@@ -2060,7 +2724,15 @@ void StreamingAudioManager::osc_register(OscMessage* msg, QTcpSocket* socket)
     else
     {
         OscMessage msg;
-        msg.init("/sam/app/regconfirm", "iiii", port, m_sampleRate, m_bufferSize, m_rtpPort);
+        const char* ringName = m_apps[port]->getSharedRingName();
+        if (ringName)
+        {
+            msg.init("/sam/app/regconfirm", "iiiis", port, m_sampleRate, m_bufferSize, m_rtpPort, ringName);
+        }
+        else
+        {
+            msg.init("/sam/app/regconfirm", "iiii", port, m_sampleRate, m_bufferSize, m_rtpPort);
+        }
         if (!OscClient::sendFromSocket(&msg, socket))
         {
             qWarning("Couldn't send OSC message");
@@ -2166,14 +2838,7 @@ void StreamingAudioManager::osc_add_type(OscMessage* msg, const char* sender)
     printf("Added rendering type %d, \"%s\" with %d preset(s)\n\n", id, name, numPresets);
 
     // notify UIs of added type
-    for (int i = 0; i < m_uiSubscribers.size(); i++)
-    {
-        OscAddress* replyAddr = m_uiSubscribers.at(i);
-        if (!OscClient::sendUdp(msg, replyAddr))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    m_notifier->notify(OscNotifier::NO_COALESCE, msg, m_uiSubscribers);
 
     emit typeAdded(id);
 }
@@ -2221,14 +2886,7 @@ void StreamingAudioManager::osc_remove_type(OscMessage* msg)
     printf("Removed rendering type %d\n\n", type);
 
     // notify UIs of removed type
-    for (int i = 0; i < m_uiSubscribers.size(); i++)
-    {
-        OscAddress* replyAddr = m_uiSubscribers.at(i);
-        if (!OscClient::sendUdp(msg, replyAddr))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    m_notifier->notify(OscNotifier::NO_COALESCE, msg, m_uiSubscribers);
 
     emit typeRemoved(type);
 }
@@ -2240,28 +2898,23 @@ int StreamingAudioManager::jack_process(jack_nframes_t nframes)
         emit stopConfirmed();
         return -1;
     }
-    
-    // check if any app is solo'd or should be deleted
-    bool soloNext = false;
-    for (int i = 0; i < m_maxClients; i++)
+
+    // the apps to process this period: a list replaced by the control thread isn't deleted (nor are the apps
+    // it removed) until this period has finished
+    const SamActiveApps* active = m_activeApps.fetchAndAddAcquire(0);
+    const int numActive = active->apps.size();
+    StreamingAudioApp* const* apps = active->apps.constData();
+
+    // apply any bulk change set committed since the last period
+    if (m_changeSetPending.testAndSetOrdered(1, 1))
     {
-        if (m_apps[i])
-        {
-            if (m_apps[i]->shouldDelete())
-            {
-                qDebug("StreamingAudioManager::jack_process telling app %d to deleteLater, current thread = %p", i, QThread::currentThreadId());
-                m_appState[i] = CLOSING;
-                m_apps[i]->deleteLater();
-                m_apps[i] = NULL;
-                emit appRemoved(i);
-            }
-            else if (m_apps[i]->getSolo())
-            {
-                soloNext = true;
-            }
-        }
+        apply_change_set();
+        m_changeSetPending.fetchAndStoreOrdered(0);
     }
     
+    // check if any app is solo'd
+    bool soloNext = m_soloCount.fetchAndAddAcquire(0) > 0;
+    
     bool updateMeters = (m_samplesElapsed > m_nextMeterNotify);
     if (updateMeters)
     {
@@ -2269,74 +2922,145 @@ int StreamingAudioManager::jack_process(jack_nframes_t nframes)
         m_nextMeterNotify += m_meterInterval;
     }
     
+    // a standby SAM keeps its mirrored apps running but silent until it takes over
+    bool standbyMute = m_standby;
+
+    // free pooled ports stay connected, so keep them silent
+    if (m_portPool)
+    {
+        m_portPool->silenceIdle(nframes);
+    }
+
     // have all apps do their own processing
     float rmsIn = 0.0f;
     float peakIn = 0.0f;
     float rmsOut = 0.0f;
     float peakOut = 0.0f;
-    for (int i = 0; i < m_maxClients; i++)
+    for (int i = 0; i < numActive; i++)
     {
-        if (m_apps[i] && m_appState[i] == ACTIVE) // TODO: maybe only need to check app state? but this is safer...
-        {
-            m_apps[i]->process(nframes, m_volumeCurrent, m_volumeNext, m_muteCurrent, m_muteNext, m_soloCurrent, soloNext, m_delayCurrent, m_delayNext);
-            // TODO: need any kind of error handling here?
+        StreamingAudioApp* app = apps[i];
+        app->process(nframes, m_volumeCurrent, m_volumeNext, m_muteCurrent || m_standbyMuteCurrent, m_muteNext || standbyMute, m_soloCurrent, soloNext, m_delayCurrent, m_delayNext);
+        // TODO: need any kind of error handling here?
 
-            if (updateMeters)
+        if (updateMeters)
+        {
+            // meter updates
+            for (int ch = 0; ch < app->getNumChannels(); ch++)
             {
-                // meter updates
-                for (int ch = 0; ch < m_apps[i]->getNumChannels(); ch++)
+                bool success = app->getMeters(ch, rmsIn, peakIn, rmsOut, peakOut);
+                if (success)
                 {
-                    bool success = m_apps[i]->getMeters(ch, rmsIn, peakIn, rmsOut, peakOut);
-                    if (success)
-                    {
-                        emit appMeterChanged(i, ch, rmsIn, peakIn, rmsOut, peakOut);
-                    }
-                    else
-                    {
-                        qWarning("StreamingAudioManager::jack_process couldn't get meter info for app %d, channel %d", i, ch);
-                    }
+                    emit appMeterChanged(app->getPort(), ch, rmsIn, peakIn, rmsOut, peakOut);
+                }
+                else
+                {
+                    qWarning("StreamingAudioManager::jack_process couldn't get meter info for app %d, channel %d", app->getPort(), ch);
                 }
             }
         }
     }
     
     m_volumeCurrent = m_volumeNext;
+    // forward streams to downstream SAMs
+    process_relays(nframes, active);
+
+    process_master_recording(nframes, active);
+
     m_muteCurrent = m_muteNext;
+    m_standbyMuteCurrent = standbyMute;
     m_soloCurrent = soloNext;
     m_delayCurrent = m_delayNext;
     
     m_samplesElapsed += nframes;
+
+    // done with this period's active app list
+    m_processEpoch.fetchAndAddRelease(1);
     
     return 0;
 }
 
-bool StreamingAudioManager::init_basic_output_ports()
+void StreamingAudioManager::process_relays(jack_nframes_t nframes, const SamActiveApps* active)
 {
-    // get all jack ports that correspond to the basic client
-    const char** outputPortsBasic = jack_get_ports(m_client, m_outJackClientNameBasic, NULL, JackPortIsInput);
-    if (!outputPortsBasic)
-    {
-        qWarning("JACK client %s has no input ports", m_outJackClientNameBasic);
-        return false;
-    }
-    
-    // count the number of basic output ports available
-    const char** currentPortBasic = outputPortsBasic;
-    m_maxBasicOutputs = 0;
-    while (*currentPortBasic != NULL)
-    {
-        m_maxBasicOutputs++;
-        qDebug("StreamingAudioManager::init_basic_output_ports() counted basic port %s", *currentPortBasic);
-        currentPortBasic++;
-    }
-    qDebug("StreamingAudioManager::init_basic_output_ports() counted %d possible basic outputs", m_maxBasicOutputs);
-    jack_free(outputPortsBasic);
-    
-    for (int i = 0; i < m_basicChannels.size(); i++)
+    for (int r = 0; r < MAX_RELAYS; r++)
     {
-        if (m_basicChannels[i] <= m_maxBasicOutputs)
+        SamRelay* relay = m_relays[r];
+        if (!relay) continue;
+
+        // a relay that has stopped itself is retired by the control thread
+        if (relay->shouldDelete()) continue;
+
+        // a standby SAM doesn't forward anything until it takes over
+        if (!relay->isForwarding() || m_standby) continue;
+
+        int source = relay->getSource();
+        if (source == SamRelay::SOURCE_MIX)
         {
-            qDebug("StreamingAudioManager::init_basic_output_ports() enabling basic channel %u", m_basicChannels[i]);
+            relay->clearMix(nframes);
+            for (int i = 0; i < active->apps.size(); i++)
+            {
+                relay->mixApp(active->apps.at(i), nframes);
+            }
+            relay->sendMix(nframes);
+        }
+        else if (m_apps[source] && m_appState[source] == ACTIVE)
+        {
+            relay->sendApp(m_apps[source], nframes);
+        }
+    }
+}
+
+void StreamingAudioManager::process_master_recording(jack_nframes_t nframes, const SamActiveApps* active)
+{
+    SamRecorder* recorder = m_masterRecorder;
+    if (!recorder) return;
+
+    if ((int)nframes > m_bufferSize) return;
+
+    // mix basic apps the same way their outputs are connected to the basic channels
+    int channels = m_basicChannels.size();
+    for (int ch = 0; ch < channels; ch++)
+    {
+        memset(m_masterMix[ch], 0, nframes * sizeof(float));
+    }
+    for (int i = 0; i < active->apps.size(); i++)
+    {
+        StreamingAudioApp* app = active->apps.at(i);
+        if (app->getType() != TYPE_BASIC) continue;
+
+        for (int ch = 0; ch < channels && ch < app->getNumChannels(); ch++)
+        {
+            const float* out = app->getOutputBuffer(ch, nframes);
+            if (!out) continue;
+
+            float* mix = m_masterMix[ch];
+            for (unsigned int n = 0; n < nframes; n++)
+            {
+                mix[n] += out[n];
+            }
+        }
+    }
+    recorder->write(m_masterMix, nframes);
+}
+
+bool StreamingAudioManager::init_basic_output_ports()
+{
+    // get all jack ports that correspond to the basic client
+    QStringList outputPortsBasic = m_audio->getPorts(m_outJackClientNameBasic, true);
+    if (outputPortsBasic.isEmpty())
+    {
+        qWarning("JACK client %s has no input ports", m_outJackClientNameBasic);
+        return false;
+    }
+    
+    // count the number of basic output ports available
+    m_maxBasicOutputs = outputPortsBasic.size();
+    qDebug("StreamingAudioManager::init_basic_output_ports() counted %d possible basic outputs", m_maxBasicOutputs);
+    
+    for (int i = 0; i < m_basicChannels.size(); i++)
+    {
+        if (m_basicChannels[i] <= m_maxBasicOutputs)
+        {
+            qDebug("StreamingAudioManager::init_basic_output_ports() enabling basic channel %u", m_basicChannels[i]);
         }
         else
         {
@@ -2349,30 +3073,30 @@ bool StreamingAudioManager::init_basic_output_ports()
 bool StreamingAudioManager::init_discrete_output_ports()
 {
     // get all jack ports that correspond to the discrete client
-    const char** outputPortsDiscrete = jack_get_ports(m_client, m_outJackClientNameDiscrete, NULL, JackPortIsInput);
-    if (!outputPortsDiscrete)
+    QStringList outputPortsDiscrete = m_audio->getPorts(m_outJackClientNameDiscrete, true);
+    if (outputPortsDiscrete.isEmpty())
     {
         qWarning("JACK client %s has no input ports", m_outJackClientNameDiscrete);
         return false;
     }
 
     // count the number of discrete output ports available
-    const char** currentPortDiscrete = outputPortsDiscrete;
-    m_maxDiscreteOutputs = 0;
-    while (*currentPortDiscrete != NULL)
-    {
-        m_maxDiscreteOutputs++;
-        qDebug("StreamingAudioManager::init_discrete_output_ports() counted discrete port %s", *currentPortDiscrete);
-        currentPortDiscrete++;
-    }
+    m_maxDiscreteOutputs = outputPortsDiscrete.size();
     qDebug("StreamingAudioManager::init_discrete_output_ports() counted %d possible discrete outputs", m_maxDiscreteOutputs);
-    jack_free(outputPortsDiscrete);
 
+    if (m_discreteOutputUsed)
+    {
+        delete[] m_discreteOutputUsed;
+    }
     m_discreteOutputUsed = new int[m_maxDiscreteOutputs];
     for (unsigned int i = 0; i < m_maxDiscreteOutputs; i++)
     {
         m_discreteOutputUsed[i] = OUTPUT_DISABLED;
     }
+    for (int i = 0; i < m_discreteOwned.size(); i++)
+    {
+        m_discreteOwned[i].clear();
+    }
 
     for (int i = 0; i < m_discreteChannels.size(); i++)
     {
@@ -2388,6 +3112,14 @@ bool StreamingAudioManager::init_discrete_output_ports()
         }
     }
 
+    // stack the enabled outputs so the lowest is allocated first
+    m_discreteFree.clear();
+    m_discreteFree.reserve(m_maxDiscreteOutputs);
+    for (int k = (int)m_maxDiscreteOutputs - 1; k >= 0; k--)
+    {
+        if (m_discreteOutputUsed[k] == OUTPUT_ENABLED_DISCRETE) m_discreteFree.append(k);
+    }
+
     return true;
 }
 
@@ -2472,40 +3204,24 @@ bool StreamingAudioManager::allocate_output_ports(int port, int channels, Stream
 
         break;
     }
-    default: // TODO: simplify to iterate through m_discreteChannel list instead
+    default:
     {
-        // find a free output port for each app output channel
-        unsigned int nextFreeOutput = 0;
+        // check up front that there's a free output for each app output channel, so nothing needs undoing
+        if (m_discreteFree.size() < channels)
+        {
+            qWarning("StreamingAudioManager::allocate_output_ports %d ports requested but only %d available out of %d discrete outputs!", channels, m_discreteFree.size(), m_maxDiscreteOutputs);
+            return false;
+        }
+
+        // assign the lowest free output to each app output channel
         for (int ch = 0; ch < channels; ch++)
         {
-            // assign the next available output
-            bool portFound = false;
-            for (unsigned int k = nextFreeOutput; k < m_maxDiscreteOutputs; k++)
-            {
-                qDebug("StreamingAudioManager::allocate_output_ports m_discreteOutputUsed[%d] = %d", k, m_discreteOutputUsed[k]);
-                if (m_discreteOutputUsed[k] != OUTPUT_ENABLED_DISCRETE) continue;
-                m_apps[port]->setChannelAssignment(ch, k + 1);
-                m_discreteOutputUsed[k] = port;
-                nextFreeOutput = k + 1; // for the next port don't search the slots we already searched
-                portFound = true;
-                break;
-            }
-            if (!portFound)
-            {
-                qWarning("StreamingAudioManager::allocate_output_ports no ports available out of %d discrete outputs!", m_maxDiscreteOutputs);
-                
-                // release output ports already allocated to this app
-                // TODO: also undo channel assignment changes !?!
-                for (unsigned int i = 0; i < m_maxDiscreteOutputs; i++)
-                {
-                    if (m_discreteOutputUsed[i] == port)
-                    {
-                        m_discreteOutputUsed[i] = OUTPUT_ENABLED_DISCRETE;
-                    }
-                }
-                
-                return false;
-            }
+            int k = m_discreteFree.last();
+            m_discreteFree.removeLast();
+            m_discreteOutputUsed[k] = port;
+            m_discreteOwned[port].append(k);
+            m_apps[port]->setChannelAssignment(ch, k + 1);
+            qDebug("StreamingAudioManager::allocate_output_ports m_discreteOutputUsed[%d] = %d", k, port);
         }
         break;
     }
@@ -2513,6 +3229,22 @@ bool StreamingAudioManager::allocate_output_ports(int port, int channels, Stream
     return true;
 }
 
+void StreamingAudioManager::release_discrete_outputs(int port)
+{
+    // push back in reverse so the app's lowest output is on top again
+    QVector<int>& owned = m_discreteOwned[port];
+    for (int i = owned.size() - 1; i >= 0; i--)
+    {
+        int k = owned[i];
+        if (m_discreteOutputUsed && k < (int)m_maxDiscreteOutputs && m_discreteOutputUsed[k] == port)
+        {
+            m_discreteOutputUsed[k] = OUTPUT_ENABLED_DISCRETE;
+            m_discreteFree.append(k);
+        }
+    }
+    owned.clear();
+}
+
 bool StreamingAudioManager::connect_app_ports(int port, const int* outputPorts, int type)
 {
     qDebug("StreamingAudioManager::connect_app_ports starting");
@@ -2539,9 +3271,28 @@ bool StreamingAudioManager::connect_app_ports(int port, const int* outputPorts,
         {
             snprintf(systemOut, MAX_PORT_NAME, "%s:%s%d", m_outJackClientNameDiscrete, m_outJackPortBaseDiscrete, outputPorts[ch]);
         }
+
+        // take a port from the pool, which is usually already connected to this output
+        if (m_portPool && !m_apps[port]->getOutputPortName(ch))
+        {
+            int index = m_portPool->acquire(systemOut);
+            if (index >= 0)
+            {
+                m_apps[port]->setPooledOutputPort(ch, m_portPool->getPort(index), index);
+                qDebug("StreamingAudioManager::connect_app_ports connected pooled port %d to %s", index, systemOut);
+                continue;
+            }
+            qWarning("StreamingAudioManager::connect_app_ports no pooled port for %s: registering one for app %d", systemOut, port);
+            if (!m_apps[port]->registerOutputPort(ch))
+            {
+                if (type != TYPE_BASIC) release_discrete_outputs(port);
+                return false;
+            }
+        }
+
         const char* appPortName = m_apps[port]->getOutputPortName(ch);
         if (!appPortName) return false;
-        int result = jack_connect(m_client, appPortName, systemOut);
+        int result = m_audio->connectPorts(appPortName, systemOut);
         if (result == EEXIST)
         {
             qWarning("StreamingAudioManager::connect_app_ports WARNING: %s and %s were already connected", appPortName, systemOut);
@@ -2552,10 +3303,7 @@ bool StreamingAudioManager::connect_app_ports(int port, const int* outputPorts,
             qWarning("StreamingAudioManager::connect_app_ports ERROR: couldn't connect %s to %s", appPortName, systemOut);
 
             // release output ports allocated to this app
-            for (int i = 0; i < channels; i++)
-            {
-                m_discreteOutputUsed[outputPorts[i]] = OUTPUT_DISABLED;
-            }
+            if (type != TYPE_BASIC) release_discrete_outputs(port);
 
             return false;
         }
@@ -2577,21 +3325,26 @@ bool StreamingAudioManager::disconnect_app_ports(int port)
     int channels = m_apps[port]->getNumChannels();
     for (int ch = 0; ch < channels; ch++)
     {
+        // return a pooled port to the pool, still connected for the next app that wants the same output
+        int index = m_apps[port]->takePooledOutputPort(ch);
+        if (index >= 0)
+        {
+            m_portPool->release(index);
+            continue;
+        }
+
         // get the app output port's name
         const char* appPortName = m_apps[port]->getOutputPortName(ch);
-        if (!appPortName) return false;
+        if (!appPortName) continue; // this channel has no port
         
         // get a list of the ports this app's port is connected to
-        const char** connections = jack_port_get_connections(jack_port_by_name(m_client, appPortName)); 
-       
-        if (!connections) continue; // this port isn't connected to anything
-        
-        const char** conn = connections;
-        while (*conn != NULL)
+        QStringList connections = m_audio->getConnections(appPortName);
+        for (int i = 0; i < connections.size(); i++)
         {
-            const char* connName = *conn;
+            QByteArray connBytes = connections[i].toLocal8Bit();
+            const char* connName = connBytes.constData();
             // disconnect the port
-            if (jack_disconnect(m_client, appPortName, connName) != 0)\
+            if (!m_audio->disconnectPorts(appPortName, connName))
             {
                 qWarning("StreamingAudioManager::disconnect_app_ports failed to disconnect %s and %s", appPortName, connName);
                 return false;
@@ -2600,7 +3353,6 @@ bool StreamingAudioManager::disconnect_app_ports(int port)
             {
                 qDebug("StreamingAudioManager::disconnect_app_ports disconnected %s and %s", appPortName, connName);
             }
-            conn++;
         }
     }
     
@@ -2623,27 +3375,25 @@ void StreamingAudioManager::handleTcpConnection()
 
 void StreamingAudioManager::readPendingDatagrams()
 {
+    // the datagram buffer and message are reused so that reading a datagram doesn't allocate
     while (m_udpSocket->hasPendingDatagrams())
     {
-        QByteArray datagram;
-        datagram.resize(m_udpSocket->pendingDatagramSize());
+        m_udpDatagram.resize(m_udpSocket->pendingDatagramSize());
         QHostAddress sender;
         quint16 senderPort;
-        m_udpSocket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
-        qDebug() << "StreamingAudioManager::readPendingDatagrams UDP message = " << QString(datagram);
+        m_udpSocket->readDatagram(m_udpDatagram.data(), m_udpDatagram.size(), &sender, &senderPort);
+        qDebug() << "StreamingAudioManager::readPendingDatagrams UDP message = " << QString(m_udpDatagram);
 
-        OscMessage* oscMsg = new OscMessage();
-        bool success = oscMsg->read(datagram);
+        bool success = m_udpMsg.read(m_udpDatagram);
         if (!success)
         {
             qDebug("StreamingAudioManager::readPendingDatagrams Couldn't read OSC message");
-            delete oscMsg;
         }
         else
         {
             QString senderStr = sender.toString();
             QByteArray senderBytes = senderStr.toLocal8Bit();
-            handleOscMessage(oscMsg, senderBytes.constData(), m_udpSocket);
+            dispatch_osc_message(&m_udpMsg, senderBytes.constData(), m_udpSocket, senderPort);
         }
     }
 }
@@ -2660,16 +3410,19 @@ void StreamingAudioManager::cleanupApp(int port, int type)
 
     m_apps[port] = NULL;
 
-    if (type > sam::TYPE_BASIC)
+    // stop forwarding this app
+    for (int i = 0; i < MAX_RELAYS; i++)
     {
-        // release output ports used by this app
-        for (unsigned int i = 0; i < m_maxDiscreteOutputs; i++)
+        if (m_relays[i] && m_relays[i]->getSource() == port)
         {
-            if (m_discreteOutputUsed[i] == port)
-            {
-                m_discreteOutputUsed[i] = OUTPUT_ENABLED_DISCRETE;
-            }
+            removeRelay(i);
         }
+    }
+
+    if (type > sam::TYPE_BASIC)
+    {
+        // release output ports used by this app
+        release_discrete_outputs(port);
 
         // notify renderer
         if (m_renderer)
@@ -2693,30 +3446,613 @@ void StreamingAudioManager::cleanupApp(int port, int type)
     if (m_appState[port] == ACTIVE || m_appState[port] == CLOSING)
     {
         // notify UI subscribers of app unregistering
-        for (int i = 0; i < m_uiSubscribers.size(); i++)
+        OscMessage replyMsg;
+        replyMsg.init("/sam/app/unregistered", "i", port);
+        m_notifier->notify(OscNotifier::NO_COALESCE, &replyMsg, m_uiSubscribers);
+        mirrorState(&replyMsg);
+    }
+
+    m_appState[port] = AVAILABLE;
+}
+
+SamActiveApps* StreamingAudioManager::publish_active_apps(StreamingAudioApp* removed)
+{
+    SamActiveApps* active = new SamActiveApps();
+    for (int i = 0; i < m_maxClients; i++)
+    {
+        if (m_apps[i] && m_appState[i] == ACTIVE) active->apps.append(m_apps[i]);
+    }
+    active->retiredEpoch = 0;
+
+    // the audio thread picks up the new list at the start of its next period, so the old list can be deleted once
+    // the period count has moved on from what it is after the switch
+    SamActiveApps* old = m_activeApps.fetchAndStoreOrdered(active);
+    old->retiredEpoch = m_processEpoch.fetchAndAddOrdered(0);
+    if (removed) old->removed.append(removed);
+    m_retiredApps.append(old);
+
+    if (!m_reclaimScheduled)
+    {
+        m_reclaimScheduled = true;
+        QTimer::singleShot(RECLAIM_INTERVAL_MILLIS, this, SLOT(reclaimActiveApps()));
+    }
+    return old;
+}
+
+void StreamingAudioManager::retire_relay(int id)
+{
+    SamRelay* relay = m_relays[id];
+    if (!relay) return;
+
+    // clear the slot before publishing, so periods that start after the switch can't see the relay
+    m_relays[id] = NULL;
+    disconnect(relay, SIGNAL(deleteRequested(int)), this, SLOT(handleRelayDeleteRequested(int)));
+    relay->flagForDelete();
+    publish_active_apps()->removedRelays.append(relay);
+}
+
+void StreamingAudioManager::retire_recorder(SamRecorder* recorder)
+{
+    if (!recorder) return;
+    publish_active_apps()->removedRecorders.append(recorder);
+}
+
+void StreamingAudioManager::retire_app(int port)
+{
+    StreamingAudioApp* app = m_apps[port];
+    if (!app || app->shouldDelete()) return;
+
+    qDebug("StreamingAudioManager::retire_app removing app %d", port);
+    app->flagForDelete();
+    app->releaseSolo();
+    m_appState[port] = CLOSING;
+    publish_active_apps(app);
+    emit appRemoved(port);
+}
+
+void StreamingAudioManager::reclaim_active_apps(bool force)
+{
+    int epoch = m_processEpoch.fetchAndAddOrdered(0);
+    while (!m_retiredApps.isEmpty())
+    {
+        // lists are retired in order, so if the audio thread could still be using this one it could be using the rest
+        SamActiveApps* retired = m_retiredApps.first();
+        if (!force && retired->retiredEpoch == epoch) break;
+
+        m_retiredApps.removeFirst();
+        for (int i = 0; i < retired->removed.size(); i++)
         {
-            OscAddress* replyAddr = m_uiSubscribers.at(i);
-            OscMessage replyMsg;
-            replyMsg.init("/sam/app/unregistered", "i", port);
-            if (!OscClient::sendUdp(&replyMsg, replyAddr))
+            delete retired->removed[i]; // emits appClosed
+        }
+        for (int i = 0; i < retired->removedRelays.size(); i++)
+        {
+            delete retired->removedRelays[i];
+        }
+        for (int i = 0; i < retired->removedRecorders.size(); i++)
+        {
+            delete retired->removedRecorders[i]; // finishes the file
+        }
+        delete retired;
+    }
+}
+
+void StreamingAudioManager::stageQueuedChangeSets()
+{
+    // one change set is staged per period: committing it makes begin_change_set() fail until it is applied
+    m_changeSetScheduled = false;
+    while (!m_queuedChangeSets.isEmpty() && begin_change_set())
+    {
+        SamQueuedChangeSet queued = m_queuedChangeSets.takeFirst();
+        OscMessage msg;
+        if (msg.read(queued.data))
+        {
+            stage_change_set(&msg, queued.param);
+        }
+        else
+        {
+            qWarning("StreamingAudioManager::stageQueuedChangeSets couldn't read queued change set for parameter %d", queued.param);
+            reject_change_set(queued);
+        }
+    }
+    if (!m_queuedChangeSets.isEmpty())
+    {
+        m_changeSetScheduled = true;
+        QTimer::singleShot(CHANGE_SET_RETRY_MILLIS, this, SLOT(stageQueuedChangeSets()));
+    }
+}
+
+void StreamingAudioManager::reclaimActiveApps()
+{
+    // if audio isn't running the period count won't move on, but nothing is using the lists
+    m_reclaimScheduled = false;
+    reclaim_active_apps(!m_isRunning);
+    if (!m_retiredApps.isEmpty())
+    {
+        m_reclaimScheduled = true;
+        QTimer::singleShot(RECLAIM_INTERVAL_MILLIS, this, SLOT(reclaimActiveApps()));
+    }
+}
+
+void StreamingAudioManager::mirrorState(OscMessage* msg, int param, int id)
+{
+    if (m_standbySockets.isEmpty()) return;
+
+    quint32 key = (param < 0) ? OscNotifier::NO_COALESCE : OscNotifier::makeKey(MIRROR_KEY_BASE + param, id);
+    m_notifier->notify(key, msg, QVector<OscAddress*>(), m_standbySockets);
+}
+
+void StreamingAudioManager::takeOver()
+{
+    if (!m_standby) return;
+
+    qWarning("\nPrimary SAM lost: this SAM is taking over.\n");
+    m_standby = false; // the audio thread unmutes mirrored apps on its next period
+
+    if (m_standbyLink)
+    {
+        m_standbyLink->deleteLater();
+        m_standbyLink = NULL;
+    }
+
+    // give clients time to fail over before dropping apps they've abandoned
+    QTimer::singleShot(RESUME_TIMEOUT_MILLIS, this, SLOT(dropUnresumedApps()));
+}
+
+void StreamingAudioManager::sendStandbyHeartbeat()
+{
+    OscMessage msg;
+    msg.init("/sam/standby/heartbeat");
+    for (int i = 0; i < m_standbySockets.size(); i++)
+    {
+        if (!OscClient::sendFromSocket(&msg, m_standbySockets[i]))
+        {
+            qWarning("StreamingAudioManager::sendStandbyHeartbeat couldn't send heartbeat");
+        }
+    }
+}
+
+void StreamingAudioManager::standbyDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    int index = m_standbySockets.indexOf(socket);
+    if (index < 0) return;
+
+    qWarning("Standby SAM disconnected");
+    m_standbySockets.remove(index);
+    if (m_standbySockets.isEmpty())
+    {
+        m_standbyHeartbeatTimer->stop();
+    }
+}
+
+void StreamingAudioManager::dropUnresumedApps()
+{
+    for (int i = 0; i < m_maxClients; i++)
+    {
+        if (m_apps[i] && m_appState[i] == ACTIVE && !m_apps[i]->isAttached())
+        {
+            qWarning("StreamingAudioManager::dropUnresumedApps client for app %d never resumed", i);
+            unregisterApp(i);
+        }
+    }
+}
+
+void StreamingAudioManager::osc_add_relay(OscMessage* msg)
+{
+    OscArg arg;
+    msg->getArg(0, arg);
+    QString host(arg.val.s);
+    msg->getArg(1, arg);
+    quint16 port = arg.val.i;
+    msg->getArg(2, arg);
+    int source = arg.val.i;
+    msg->getArg(3, arg);
+    int channels = arg.val.i;
+    int bitDepth = m_relayBitDepth;
+    if (msg->getNumArgs() > 4)
+    {
+        msg->getArg(4, arg);
+        bitDepth = arg.val.i;
+    }
+
+    if (addRelay(host, port, source, channels, bitDepth) < 0)
+    {
+        qWarning("StreamingAudioManager::osc_add_relay couldn't add relay for source %d", source);
+    }
+}
+
+void StreamingAudioManager::osc_register_standby(QTcpSocket* socket)
+{
+    QHostAddress addr = socket->peerAddress();
+    QString addrString = addr.toString();
+    QByteArray addrBytes = addrString.toLocal8Bit();
+    printf("Registering standby SAM at hostname %s\n\n", addrBytes.constData());
+
+    // send a snapshot of the current state before any further changes
+    OscMessage msg;
+    msg.init("/sam/val/volume", "if", -1, m_volumeNext);
+    OscClient::sendFromSocket(&msg, socket);
+    msg.init("/sam/val/mute", "ii", -1, m_muteNext);
+    OscClient::sendFromSocket(&msg, socket);
+    msg.init("/sam/val/delay", "if", -1, (m_delayNext * 1000.0f) / (float)m_sampleRate);
+    OscClient::sendFromSocket(&msg, socket);
+    for (int i = 0; i < m_maxClients; i++)
+    {
+        if (m_apps[i] && m_appState[i] == ACTIVE)
+        {
+            init_mirror_app_message(i, msg);
+            if (!OscClient::sendFromSocket(&msg, socket))
             {
-                qWarning("Couldn't send OSC message");
+                qWarning("StreamingAudioManager::osc_register_standby couldn't send app %d", i);
             }
         }
     }
 
-    m_appState[port] = AVAILABLE;
+    connect(socket, SIGNAL(disconnected()), this, SLOT(standbyDisconnected()));
+    m_standbySockets.append(socket);
+    if (!m_standbyHeartbeatTimer->isActive())
+    {
+        m_standbyHeartbeatTimer->start(STANDBY_HEARTBEAT_MILLIS);
+    }
+}
+
+void StreamingAudioManager::osc_resume(OscMessage* msg, QTcpSocket* socket)
+{
+    OscArg arg;
+    msg->getArg(0, arg);
+    int port = arg.val.i;
+    msg->getArg(1, arg);
+    int majorVersion = arg.val.i;
+    msg->getArg(2, arg);
+    int minorVersion = arg.val.i;
+    msg->getArg(3, arg);
+    int patchVersion = arg.val.i;
+
+    sam::SamErrorCode code = sam::SAM_ERR_DEFAULT;
+    bool resumed = false;
+    if (!version_check(majorVersion, minorVersion, patchVersion))
+    {
+        code = sam::SAM_ERR_VERSION_MISMATCH;
+    }
+    else if (!idIsValid(port) || m_appState[port] != ACTIVE || m_apps[port]->isAttached())
+    {
+        qWarning("StreamingAudioManager::osc_resume no mirrored app %d to resume", port);
+        code = sam::SAM_ERR_INVALID_ID;
+    }
+    else
+    {
+        // a client failing over means the primary is gone, even if the heartbeat hasn't timed out yet
+        takeOver();
+        m_apps[port]->attachSocket(socket);
+        resumed = true;
+        printf("Resumed app %d after failover\n\n", port);
+    }
+
+    // send response
+    OscMessage replyMsg;
+    if (resumed)
+    {
+        replyMsg.init("/sam/app/regconfirm", "iiii", port, m_sampleRate, m_bufferSize, m_rtpPort);
+    }
+    else
+    {
+        replyMsg.init("/sam/app/regdeny", "i", code);
+    }
+    if (!OscClient::sendFromSocket(&replyMsg, socket))
+    {
+        qWarning("Couldn't send OSC message");
+    }
+}
+
+void StreamingAudioManager::osc_mirror_app(OscMessage* msg)
+{
+    OscArg args[15];
+    for (int i = 0; i < 15; i++)
+    {
+        msg->getArg(i, args[i]);
+    }
+    int port = args[0].val.i;
+
+    sam::SamErrorCode code = sam::SAM_ERR_DEFAULT;
+    if (registerApp(args[1].val.s, args[2].val.i, args[3].val.i, args[4].val.i, args[5].val.i, args[6].val.i, args[7].val.i,
+                    (StreamingAudioType)args[8].val.i, args[9].val.i, args[10].val.i, NULL, code, port) != port)
+    {
+        qWarning("StreamingAudioManager::osc_mirror_app couldn't mirror app %d: error code = %d", port, code);
+        return;
+    }
+    m_apps[port]->setVolume(args[11].val.f);
+    m_apps[port]->setMute(args[12].val.i);
+    m_apps[port]->setSolo(args[13].val.i);
+    m_apps[port]->setDelay(args[14].val.f);
+}
+
+void StreamingAudioManager::osc_mirror_value(int param, OscMessage* msg)
+{
+    OscArg args[6];
+    for (int i = 0; i < msg->getNumArgs() && i < 6; i++)
+    {
+        msg->getArg(i, args[i]);
+    }
+    int port = args[0].val.i;
+
+    switch (param)
+    {
+    case SUBSCRIPTION_VOLUME:
+        setAppVolume(port, args[1].val.f);
+        break;
+    case SUBSCRIPTION_MUTE:
+        setAppMute(port, args[1].val.i);
+        break;
+    case SUBSCRIPTION_SOLO:
+        setAppSolo(port, args[1].val.i);
+        break;
+    case SUBSCRIPTION_DELAY:
+        setAppDelay(port, args[1].val.f);
+        break;
+    case SUBSCRIPTION_POSITION:
+        setAppPosition(port, args[1].val.i, args[2].val.i, args[3].val.i, args[4].val.i, args[5].val.i);
+        break;
+    case SUBSCRIPTION_TYPE:
+        if (idIsValid(port))
+        {
+            setAppType(port, args[1].val.i, args[2].val.i);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void StreamingAudioManager::init_mirror_app_message(int port, OscMessage& msg)
+{
+    StreamingAudioApp* app = m_apps[port];
+    SamAppPosition pos = app->getPosition();
+    msg.init("/sam/mirror/app", "isiiiiiiiiifiif", port,
+                                                    app->getName(),
+                                                    app->getNumChannels(),
+                                                    pos.x,
+                                                    pos.y,
+                                                    pos.width,
+                                                    pos.height,
+                                                    pos.depth,
+                                                    app->getType(),
+                                                    app->getPreset(),
+                                                    app->getPacketQueueSize(),
+                                                    app->getVolume(),
+                                                    app->getMute(),
+                                                    app->getSolo(),
+                                                    app->getDelay());
 }
 
 void StreamingAudioManager::notifyMeter()
 {
+    // send meter frames first, since per-app meter updates reset peak levels
+    bool sentFrames = false;
+    for (int format = 0; format < NUM_METER_FRAME_FORMATS; format++)
+    {
+        if (m_meterFrameSubscribers[format].isEmpty() && m_meterFrameSubscribersTcp[format].isEmpty()) continue;
+        send_meter_frame((MeterFrameFormat)format);
+        sentFrames = true;
+    }
+
     for (int i = 0; i < m_maxClients; i++)
     {
         if (m_apps[i])
         {
             m_apps[i]->notifyMeter();
+            if (sentFrames) m_apps[i]->resetMeterPeaks();
+        }
+    }
+}
+
+/**
+ * Encode a linear meter level for a binary meter frame.
+ * @param dest the buffer to write to
+ * @param level the linear level to encode
+ * @param format the encoding to use
+ * @return the number of bytes written
+ */
+static int encode_meter_level(char* dest, float level, MeterFrameFormat format)
+{
+    if (format == METER_FRAME_FLOAT32)
+    {
+        quint32 bits;
+        memcpy(&bits, &level, sizeof(bits));
+        qToBigEndian<quint32>(bits, (uchar*)dest);
+        return 4;
+    }
+
+    // quantize to dB between METER_FRAME_DB_MIN and METER_FRAME_DB_MAX, reserving 0 for silence
+    quint32 maxCode = (format == METER_FRAME_DB8) ? 0xFF : 0xFFFF;
+    quint32 code = 0;
+    if (level > 0.0f)
+    {
+        float db = 20.0f * log10f(level);
+        if (db > METER_FRAME_DB_MIN)
+        {
+            float scaled = (db - METER_FRAME_DB_MIN) / (METER_FRAME_DB_MAX - METER_FRAME_DB_MIN) * maxCode;
+            code = (scaled >= maxCode) ? maxCode : (quint32)(scaled + 0.5f);
+            if (code == 0) code = 1;
         }
     }
+
+    if (format == METER_FRAME_DB8)
+    {
+        dest[0] = (char)code;
+        return 1;
+    }
+    qToBigEndian<quint16>((quint16)code, (uchar*)dest);
+    return 2;
+}
+
+void StreamingAudioManager::write_meter_frame(MeterFrameFormat format)
+{
+    int levelSize = (format == METER_FRAME_FLOAT32) ? 4 : ((format == METER_FRAME_DB8) ? 1 : 2);
+
+    // size the frame first so it can be written in place
+    int numApps = 0;
+    int size = METER_FRAME_HEADER_SIZE;
+    for (int i = 0; i < m_maxClients; i++)
+    {
+        if (m_apps[i])
+        {
+            numApps++;
+            size += METER_FRAME_APP_HEADER_SIZE + m_apps[i]->getNumChannels() * 4 * levelSize;
+        }
+    }
+    m_meterFrame.resize(size);
+    char* data = m_meterFrame.data();
+
+    data[0] = (char)METER_FRAME_VERSION;
+    data[1] = (char)format;
+    qToBigEndian<quint16>((quint16)numApps, (uchar*)data + 2);
+    int pos = METER_FRAME_HEADER_SIZE;
+
+    for (int i = 0; i < m_maxClients; i++)
+    {
+        if (!m_apps[i]) continue;
+
+        int channels = m_apps[i]->getNumChannels();
+        qToBigEndian<quint16>((quint16)i, (uchar*)data + pos);
+        qToBigEndian<quint16>((quint16)channels, (uchar*)data + pos + 2);
+        pos += METER_FRAME_APP_HEADER_SIZE;
+
+        for (int ch = 0; ch < channels; ch++)
+        {
+            float rmsIn = 0.0f;
+            float peakIn = 0.0f;
+            float rmsOut = 0.0f;
+            float peakOut = 0.0f;
+            m_apps[i]->getMeters(ch, rmsIn, peakIn, rmsOut, peakOut);
+            pos += encode_meter_level(data + pos, rmsIn, format);
+            pos += encode_meter_level(data + pos, sqrt(peakIn), format); // peaks are stored squared
+            pos += encode_meter_level(data + pos, rmsOut, format);
+            pos += encode_meter_level(data + pos, sqrt(peakOut), format);
+        }
+    }
+}
+
+void StreamingAudioManager::send_meter_frame(MeterFrameFormat format)
+{
+    write_meter_frame(format);
+
+    m_meterFrameMsg.init("/sam/val/meterframe");
+    m_meterFrameMsg.addBlobArg(m_meterFrame.constData(), m_meterFrame.size());
+
+    // each format gets its own coalescing key, after the SamClientSubscription parameters
+    m_notifier->notify(OscNotifier::makeKey(NUM_SUBSCRIPTIONS + format, -1), &m_meterFrameMsg, m_meterFrameSubscribers[format], m_meterFrameSubscribersTcp[format]);
+}
+
+void StreamingAudioManager::osc_subscribe_meter_frame(OscMessage* msg, const char* sender, QAbstractSocket* socket, bool unsubscribe)
+{
+    OscArg arg;
+    msg->getArg(0, arg);
+    int format = arg.val.i;
+    msg->getArg(1, arg);
+    quint16 replyPort = arg.val.i;
+
+    if (format < 0 || format >= NUM_METER_FRAME_FORMATS)
+    {
+        qWarning("StreamingAudioManager::osc_subscribe_meter_frame invalid meter frame format %d", format);
+        return;
+    }
+
+    if (unsubscribe) printf("Unsubscribing host %s, port %d from meter frames (format %d)\n\n", sender, replyPort, format);
+    else printf("Subscribing host %s, port %d to meter frames (format %d)\n\n", sender, replyPort, format);
+
+    if (socket && socket->socketType() == QAbstractSocket::TcpSocket)
+    {
+        QTcpSocket* tcpSocket = dynamic_cast<QTcpSocket*>(socket);
+        if (unsubscribe) StreamingAudioApp::unsubscribe_tcp_helper(m_meterFrameSubscribersTcp[format], tcpSocket);
+        else StreamingAudioApp::subscribe_tcp_helper(m_meterFrameSubscribersTcp[format], tcpSocket);
+    }
+    else
+    {
+        if (unsubscribe) StreamingAudioApp::unsubscribe_helper(m_meterFrameSubscribers[format], sender, replyPort);
+        else StreamingAudioApp::subscribe_helper(m_meterFrameSubscribers[format], sender, replyPort);
+    }
+}
+
+void StreamingAudioManager::osc_stats(OscMessage* msg, const char* sender)
+{
+    OscArg arg;
+    msg->getArg(0, arg);
+    int id = arg.val.i;
+    msg->getArg(1, arg);
+    quint16 replyPort = arg.val.i;
+
+    OscAddress replyAddr;
+    replyAddr.host.setAddress(sender);
+    replyAddr.port = replyPort;
+    OscMessage replyMsg;
+
+    if (id != -1 && !idIsValid(id))
+    {
+        replyMsg.init("/sam/err/idinvalid", "i", id);
+    }
+    else
+    {
+        // sum the receiver counters for the requested app (or for all apps if id is -1)
+        quint64 received = 0;
+        quint64 late = 0;
+        quint64 skipped = 0;
+        quint64 missed = 0;
+        for (int i = 0; i < m_maxClients; i++)
+        {
+            if ((id != -1 && i != id) || !m_apps[i]) continue;
+
+            const RtpReceiver* receiver = m_apps[i]->getReceiver();
+            if (!receiver) continue;
+            received += receiver->getPacketsReceived();
+            late += receiver->getPacketsLate();
+            skipped += receiver->getPacketsSkipped();
+            missed += receiver->getPeriodsMissed();
+        }
+
+        // counters are sent as 32-bit OSC ints and wrap, so clients should difference successive replies
+        quint32 processMax = m_processNanosMax / 1000;
+        m_processMaxReset.fetchAndStoreOrdered(1);
+        replyMsg.init("/sam/val/stats", "iiiiiiiiii", id, getNumApps(), (quint32)m_xruns, (quint32)m_processPeriods,
+                      (quint32)(m_processNanos / 1000), processMax, (quint32)received, (quint32)late, (quint32)skipped, (quint32)missed);
+    }
+
+    if (!OscClient::sendUdp(&replyMsg, &replyAddr))
+    {
+        qWarning("Couldn't send OSC message");
+    }
+}
+
+void StreamingAudioManager::osc_latency(OscMessage* msg, const char* sender)
+{
+    OscArg arg;
+    msg->getArg(0, arg);
+    int id = arg.val.i;
+    msg->getArg(1, arg);
+    quint16 replyPort = arg.val.i;
+
+    OscAddress replyAddr;
+    replyAddr.host.setAddress(sender);
+    replyAddr.port = replyPort;
+    OscMessage replyMsg;
+
+    const RtpReceiver* receiver = idIsValid(id) ? m_apps[id]->getReceiver() : NULL;
+    if (!receiver)
+    {
+        replyMsg.init("/sam/err/idinvalid", "i", id);
+    }
+    else
+    {
+        // the reply's second argument is 0 until the app's first RTCP sender report has arrived
+        qint32 transitMicros = 0;
+        qint32 playoutMicros = 0;
+        bool valid = receiver->getLatency(transitMicros, playoutMicros);
+        replyMsg.init("/sam/val/latency", "iiii", id, valid ? 1 : 0, transitMicros, playoutMicros);
+    }
+
+    if (!OscClient::sendUdp(&replyMsg, &replyAddr))
+    {
+        qWarning("Couldn't send OSC message");
+    }
 }
 
 void StreamingAudioManager::print_debug()
@@ -2726,52 +4062,39 @@ void StreamingAudioManager::print_debug()
     qWarning("SAM global volume %f, mute %d, delay %d", m_volumeNext, m_muteNext, m_delayNext);
 
     qWarning("\nJACK port connections:");
-    if (!m_client)
+    if (!m_audio)
     {
-        qWarning("JACK client is NULL, no ports to display");
+        qWarning("audio backend is NULL, no ports to display");
+        return;
     }
 
     // get all jack ports that correspond to physical outputs
-    const char** portNames = jack_get_ports(m_client, NULL, NULL, 0);
+    QStringList portNames = m_audio->getPorts(NULL, false);
 
-    if (!portNames)
+    if (portNames.isEmpty())
     {
         qWarning("no JACK ports detected");
         return;
     }
 
-    const char** currentName = portNames;
-    while (*currentName != NULL)
+    for (int i = 0; i < portNames.size(); i++)
     {
         // find all ports connected to this one
-        jack_port_t* port = jack_port_by_name(m_client, *currentName);
-        if (!port)
-        {
-            qWarning("Couldn't get JACK port by name %s", *currentName);
-            currentName++;
-            continue;
-        }
-
-        const char** connPorts = jack_port_get_connections(port);
+        QByteArray nameBytes = portNames[i].toLocal8Bit();
+        QStringList connPorts = m_audio->getConnections(nameBytes.constData());
 
-        if (!connPorts)
+        if (connPorts.isEmpty())
         {
-            qWarning("JACK port %s has no connections", *currentName);
-            currentName++;
+            qWarning("JACK port %s has no connections", nameBytes.constData());
             continue;
         }
 
-        const char** currentPort = connPorts;
-        while (*currentPort != NULL)
+        for (int j = 0; j < connPorts.size(); j++)
         {
-            qWarning("JACK port %s connected to %s", *currentName, *currentPort);
-            currentPort++;
+            QByteArray connBytes = connPorts[j].toLocal8Bit();
+            qWarning("JACK port %s connected to %s", nameBytes.constData(), connBytes.constData());
         }
-
-        jack_free(connPorts);
-        currentName++;
     }
-    jack_free(portNames);
 
     qWarning("\nSAM clients:");
     for (int i = 0; i < m_maxClients; i++)
@@ -45,13 +45,18 @@
 #ifndef SAM_H
 #define	SAM_H
 
+#include <QAtomicInt>
+#include <QAtomicPointer>
 #include <QCoreApplication>
+#include <QPointer>
 #include <QTcpServer>
+#include <QTimer>
 #include <QUdpSocket>
 #include <QVector>
 
 #include "jack/jack.h"
 #include "osc.h"
+#include "sam_audio_backend.h"
 #include "sam_shared.h"
 
 namespace sam
@@ -120,8 +125,54 @@ enum SamAppState
     NUM_APP_STATES
 };
 
+/**
+ * @struct SamBulkNotification
+ * The coalesced /sam/val notifications built while applying a bulk change set
+ * (one message for each subscriber).
+ */
+struct SamBulkNotification
+{
+    QList<OscAddress*> udpDests;  ///< UDP subscribers to be notified
+    QList<OscMessage*> udpMsgs;   ///< coalesced message for each UDP subscriber
+    QList<QTcpSocket*> tcpDests;  ///< TCP subscribers to be notified
+    QList<OscMessage*> tcpMsgs;   ///< coalesced message for each TCP subscriber
+};
+
+/**
+ * @struct SamQueuedChangeSet
+ * A bulk /sam/set message received before the audio thread applied the previous
+ * change set, kept until it can be staged.
+ */
+struct SamQueuedChangeSet
+{
+    QByteArray data;                  ///< the serialized OSC message
+    int param;                        ///< the SamClientSubscription parameter to set
+    QByteArray sender;                ///< the name of the host that sent the message
+    quint16 senderPort;               ///< the UDP port the message was sent from (0 for TCP)
+    QPointer<QAbstractSocket> socket; ///< the socket the message was received on
+};
+
 class StreamingAudioApp;
 class SamParams;
+class OscNotifier;
+class SamStandbyLink;
+class SamRelay;
+class SamRecorder;
+class SamPortPool;
+
+/**
+ * @struct SamActiveApps
+ * A list of the apps the audio thread processes.  The control thread publishes a new list whenever an app becomes
+ * active or is removed, and never changes a list once it has been published.
+ */
+struct SamActiveApps
+{
+    QVector<StreamingAudioApp*> apps;  ///< the active apps, in port order
+    int retiredEpoch;                  ///< audio period count when this list was replaced
+    QList<StreamingAudioApp*> removed; ///< apps removed when this list was replaced, deleted along with the list
+    QList<SamRelay*> removedRelays;    ///< relays removed when this list was replaced, deleted along with the list
+    QList<SamRecorder*> removedRecorders; ///< recorders stopped when this list was replaced, deleted (finishing their files) along with the list
+};
 
 /**
  * @class StreamingAudioManager
@@ -203,9 +254,11 @@ public:
      * @param packetQueueSize number of packets to buffer in receiver, or -1 to use SAM default
      * @param socket the TCP socket through which the app/client connected to SAM
      * @param errCode if an error occurs, the SamErrorCode which best describes the error.  Otherwise undefined.
+     * @param id the unique port to use (e.g. to match a primary SAM's app), or -1 to use the first one available
+     * @param sharedMemory true to receive the app's audio through a SharedAudioRing (the app must be on this host)
      * @return unique port for this stream or -1 on error
      */
-    int registerApp(const char* name, int channels, int x, int y, int width, int height, int depth, sam::StreamingAudioType type, int preset, int packetQueueSize, QTcpSocket* socket, sam::SamErrorCode& errCode);
+    int registerApp(const char* name, int channels, int x, int y, int width, int height, int depth, sam::StreamingAudioType type, int preset, int packetQueueSize, QTcpSocket* socket, sam::SamErrorCode& errCode, int id = -1, bool sharedMemory = false);
 
     /**
      * Unregister an app
@@ -245,6 +298,54 @@ public:
      */
     bool unregisterRenderer();
 
+    /**
+     * Start forwarding an app or a downmix to a downstream SAM.
+     * @param host address of the downstream SAM
+     * @param port OSC port of the downstream SAM
+     * @param source the id of the app to forward, or -1 to forward a downmix of all apps
+     * @param channels the number of channels in the downmix (ignored when forwarding an app)
+     * @param bitDepth bits per sample sent to the downstream SAM (16 or 24 for integer PCM, 32 for float)
+     * @return the id of the new relay, or -1 on error
+     */
+    int addRelay(const QString& host, quint16 port, int source, int channels, int bitDepth);
+
+    /**
+     * Stop forwarding to a downstream SAM.
+     * @param id the id of the relay, or -1 to remove all relays
+     * @return true on success, false if there was no such relay
+     */
+    bool removeRelay(int id);
+
+    /**
+     * Start recording an app, or the master (basic output) mix, to a new file in RecordDirectory.
+     * @param id the app id, or -1 for the master mix
+     * @param name the name of the file to record to (must not exist yet)
+     * @return true on success, false on failure
+     */
+    bool startRecording(int id, const QString& name);
+
+    /**
+     * Stop recording an app or the master mix.
+     * @param id the app id, or -1 for the master mix
+     * @return true on success, false if not recording
+     */
+    bool stopRecording(int id);
+
+    /**
+     * Start capturing the RTP datagrams an app receives to a new file in RecordDirectory, for offline replay.
+     * @param id the app id
+     * @param name the name of the capture file (must not exist yet)
+     * @return true on success, false on failure
+     */
+    bool startCapture(int id, const QString& name);
+
+    /**
+     * Stop capturing an app's RTP datagrams.
+     * @param id the app id
+     * @return true on success, false if not capturing
+     */
+    bool stopCapture(int id);
+
     /**
      * Get the name of an app.
      * @param id the port/unique ID of the app to be queried
@@ -266,37 +367,75 @@ public:
     QString& getOscMessageString() { return m_oscDirections; }
 
     /**
-     * JACK buffer size changed callback.
-     * JACK will call this callback if the system buffer size changes.
+     * Get the notifier used to send OSC notifications to subscribers.
+     * @return the notifier
+     */
+    OscNotifier* getNotifier() { return m_notifier; }
+
+    /**
+     * Get the multicast group that apps' RTP receivers should join.
+     * @return the multicast group address (null for unicast only)
+     */
+    const QHostAddress& getRtpMulticastGroup() const { return m_rtpMulticastGroup; }
+
+    /**
+     * Get the group whose members may attach to apps' shared-memory rings.
+     * @return the group id, or -1 if only SAM's own user may attach
+     */
+    int getSharedMemoryGroup() const { return m_sharedMemoryGid; }
+
+    /**
+     * Send a state change to any standby SAMs mirroring this one.
+     * @param msg the message describing the change
+     * @param param the SamSubscription parameter that changed, or -1 for events that must not be coalesced
+     * @param id the app id the parameter belongs to, or -1 for global parameters
+     */
+    void mirrorState(OscMessage* msg, int param = -1, int id = -1);
+
+    /**
+     * Check if this SAM is a standby that hasn't taken over from its primary yet.
+     * @return true if in standby, false otherwise
      */
-    static int jackBufferSizeChanged(jack_nframes_t nframes, void* sam);
+    bool isStandby() const { return m_standby; }
 
     /**
-     * JACK process callback.
-     * The process callback for this JACK application is called in a
+     * Audio backend process callback.
+     * The process callback is called by the audio backend (JACK or virtual) in a
      * special realtime thread once for each audio cycle.  
      * This is where muting, volume control, delay, and panning occurs.
      */
     static int jackProcess(jack_nframes_t nframes, void* sam);
 
     /**
-     * JACK sample rate changed callback.
-     * JACK will call this callback if the system sample rate changes.
+     * Audio backend xrun callback.
+     * The audio backend will call this callback if an xrun occurs.
      */
-    static int jackSampleRateChanged(jack_nframes_t nframes, void* sam);
+    static int jackXrun(void* sam);
 
     /**
-     * JACK xrun callback.
-     * JACK will call this callback if an xrun occurs.
+     * Audio backend shutdown callback.
+     * The audio backend calls this callback if it ever shuts down on its own
+     * (e.g. the JACK server shuts down or decides to disconnect the client).
      */
-    static int jackXrun(void* sam);
+    static void jackShutdown(void* sam);
 
     /**
-     * JACK shutdown callback.
-     * JACK calls this callback if the server ever shuts down or
-     * decides to disconnect the client.
+     * Get the audio backend SAM is running on, e.g. to step a virtual backend's clock from a test harness.
+     * @return the audio backend, or NULL if SAM isn't running
      */
-    static void jackShutdown(void* sam);
+    SamAudioBackend* getAudioBackend() { return m_audio; }
+
+    /**
+     * Get the pool of output ports apps take their ports from.
+     * @return the port pool, or NULL if apps register their own ports
+     */
+    SamPortPool* getPortPool() { return m_portPool; }
+
+    /**
+     * Update the number of solo'd apps (called by apps when their solo status changes, from any thread).
+     * @param delta 1 when an app is solo'd, -1 when it is un-solo'd or removed
+     */
+    void adjustSoloCount(int delta) { m_soloCount.fetchAndAddOrdered(delta); }
 
     /**
      * Query if SAM is running.
@@ -442,6 +581,42 @@ public slots:
      */
     void notifyMeter();
 
+    /**
+     * Take over from a failed primary SAM: start playing mirrored apps and accept resuming clients.
+     */
+    void takeOver();
+
+    /**
+     * Send a heartbeat to standby SAMs.
+     */
+    void sendStandbyHeartbeat();
+
+    /**
+     * Stop mirroring to a standby SAM that disconnected.
+     */
+    void standbyDisconnected();
+
+    /**
+     * Unregister mirrored apps whose clients didn't resume after a takeover.
+     */
+    void dropUnresumedApps();
+
+    /**
+     * Delete app lists (and removed apps) the audio thread has finished with.
+     */
+    void reclaimActiveApps();
+
+    /**
+     * Stage queued bulk change sets the audio thread is ready for.
+     */
+    void stageQueuedChangeSets();
+
+    /**
+     * Remove a relay that has stopped itself, e.g. because the downstream SAM disconnected.
+     * @param id the id of the relay
+     */
+    void handleRelayDeleteRequested(int id);
+
 signals:
     /**
      * Announce when it's time for OSC meter updates to be sent.
@@ -500,98 +675,180 @@ private:
      */
     bool set_app_type(int port, sam::StreamingAudioType type, int preset, sam::SamErrorCode& errorCode);
 
+    /**
+     * Handle a request from a standby SAM to mirror this SAM.
+     * @param socket the standby's TCP socket
+     */
+    void osc_register_standby(QTcpSocket* socket);
+
+    /**
+     * Handle a client resuming its registration after failing over from a primary SAM.
+     * @param msg the OSC message (id, version major, minor, patch, reply port)
+     * @param socket the client's TCP socket
+     */
+    void osc_resume(OscMessage* msg, QTcpSocket* socket);
+
+    /**
+     * Create a mirrored copy of an app registered with the primary SAM.
+     * @param msg the /sam/mirror/app message
+     */
+    void osc_mirror_app(OscMessage* msg);
+
+    /**
+     * Apply a parameter change mirrored from the primary SAM.
+     * @param param the SamSubscription parameter that changed
+     * @param msg the /sam/val/* message
+     */
+    void osc_mirror_value(int param, OscMessage* msg);
+
+    /**
+     * Write a message describing an app and its current parameters, for standby SAMs.
+     * @param port the unique port/ID of the app
+     * @param msg the message to write
+     */
+    void init_mirror_app_message(int port, OscMessage& msg);
+
+    /**
+     * Handle a request to start forwarding to a downstream SAM.
+     * @param msg the OSC message (host, port, source id, channels)
+     */
+    void osc_add_relay(OscMessage* msg);
+
+    /**
+     * Forward audio for the current period to downstream SAMs (JACK thread only).
+     * @param nframes the number of frames in the current period
+     * @param active the apps active in the current period
+     */
+    void process_relays(jack_nframes_t nframes, const SamActiveApps* active);
+
+    /**
+     * Record the basic output mix for the current period (JACK thread only).
+     * @param nframes the number of frames in the current period
+     * @param active the apps active in the current period
+     */
+    void process_master_recording(jack_nframes_t nframes, const SamActiveApps* active);
+
+    /**
+     * Publish a new list of active apps for the audio thread, built from the apps in the ACTIVE state.
+     * @param removed an app to delete once the audio thread has stopped using the old list (or NULL)
+     * @return the old list, now retired, to which other objects the audio thread may still be using can be added
+     */
+    SamActiveApps* publish_active_apps(StreamingAudioApp* removed = NULL);
+
+    /**
+     * Take a relay out of processing and delete it once the audio thread can no longer be using it.
+     * @param id the id of the relay
+     */
+    void retire_relay(int id);
+
+    /**
+     * Delete a recorder once the audio thread can no longer be using it.
+     * @param recorder the recorder, already out of reach of the audio thread's next period (may be NULL)
+     */
+    void retire_recorder(SamRecorder* recorder);
+
+    /**
+     * Resolve a file name requested over OSC to a path in RecordDirectory.
+     * Used for both recordings and RTP captures.  Only a bare file name is accepted
+     * (no absolute paths, directories or ".."), so a remote request can't write outside RecordDirectory.
+     * @param name the requested file name
+     * @param path set to the file's path in RecordDirectory on success
+     * @return true if the name is acceptable and RecordDirectory is set, false otherwise
+     */
+    bool record_path(const QString& name, QString& path);
+
+    /**
+     * Take an app out of processing and delete it once the audio thread can no longer be using it.
+     * @param port the unique port/ID of the app
+     */
+    void retire_app(int port);
+
+    /**
+     * Delete app lists (and removed apps, relays and recorders) the audio thread has finished with.
+     * @param force true to delete all of them (only when the audio thread isn't running)
+     */
+    void reclaim_active_apps(bool force);
+
+    /**
+     * Register all OSC methods SAM responds to with m_oscDispatcher.
+     */
+    void init_osc_methods();
+
+    /**
+     * Route an OSC message to its handlers.
+     * @param msg the OSC message to handle (not deleted)
+     * @param sender the name of the host that sent the message
+     * @param socket the socket the message was received through
+     * @param senderPort the UDP port the message was sent from (0 if it wasn't a datagram)
+     */
+    void dispatch_osc_message(OscMessage* msg, const char* sender, QAbstractSocket* socket, quint16 senderPort = 0);
+
     /**
      * Handle requests to register or unregister apps.
-     * @param address the part of the OSC address string following "/sam/app"
+     * @param method the OSC method id matched by the dispatcher
      * @param msg the OSC message to handle
      * @param sender the name of the host that sent the message
      * @param socket the socket the message was received through
      */
-    void handle_app_message(const char* address, OscMessage*msg, const char* sender, QAbstractSocket* socket);
+    void handle_app_message(int method, OscMessage*msg, const char* sender, QAbstractSocket* socket);
 
     /**
      * Handle requests to register or unregister UIs.
-     * @param address the part of the OSC address string following "/sam/ui"
+     * @param method the OSC method id matched by the dispatcher
      * @param msg the OSC message to handle
      * @param sender the name of the host that sent the message
      */
-    void handle_ui_message(const char* address, OscMessage*msg, const char* sender);
+    void handle_ui_message(int method, OscMessage*msg, const char* sender);
 
     /**
      * Handle requests to register or unregister a renderer.
-     * @param address the part of the OSC address string following "/sam/render"
+     * @param method the OSC method id matched by the dispatcher
      * @param msg the OSC message to handle
      * @param sender the name of the host that sent the message
      * @param socket the socket the message was received through
      */
-    void handle_render_message(const char* address, OscMessage* msg, const char* sender, QAbstractSocket* socket);
+    void handle_render_message(int method, OscMessage* msg, const char* sender, QAbstractSocket* socket);
 
     /**
      * Handle requests to set parameter values.
-     * @param address the part of the OSC address string following "/sam/set"
+     * @param param the SamClientSubscription parameter to set
      * @param msg the OSC message to handle
      * @param sender the name of the host that sent the message
      * @param socket the socket the message was received through
      */
-    void handle_set_message(const char* address, OscMessage* msg, const char* sender, QAbstractSocket* socket);
+    void handle_set_message(int param, OscMessage* msg, const char* sender, QAbstractSocket* socket);
 
     /**
      * Handle requests to get parameter values.
-     * @param address the part of the OSC address string following "/sam/get"
+     * @param param the SamClientSubscription parameter to get
      * @param msg the OSC message to handle
      * @param sender the name of the host that sent the message
      */
-    void handle_get_message(const char* address, OscMessage* msg, const char* sender);
+    void handle_get_message(int param, OscMessage* msg, const char* sender);
 
     /**
      * Handle requests to subscribe to parameters.
-     * @param address the part of the OSC address string following "/sam/subscribe"
+     * @param param the SamClientSubscription parameter to subscribe to (NUM_SUBSCRIPTIONS for all parameters)
      * @param msg the OSC message to handle
      * @param sender the name of the host that sent the message
      * @param socket the socket the message was received through
      * @param unsubscribe true to unsubscribe, false to subscribe
      */
-    void handle_subscribe_message(const char* address, OscMessage* msg, const char* sender, QAbstractSocket* socket, bool unsubscribe);
-
-    /**
-     * Handle requests about rendering types.
-     * @param address the part of the OSC address string following "/sam/type"
-     * @param msg the OSC message to handle
-     * @param sender the name of the host that sent the message
-     */
-    void handle_type_message(const char* address, OscMessage* msg, const char* sender);
-
-    /**
-     * Start the JACK server.
-     * @param sampleRate the audio sampling rate for JACK
-     * @param bufferSize the audio buffer size for JACK
-     * @param outChannels the max number of output channels
-     * @param driver driver to use for JACK
-     * @return true on success, false on failure
-     * @see stop_jack
-     */
-    bool start_jack(int sampleRate, int bufferSize, int outChannels, const char* driver);
-
-    /**
-     * Stop the JACK server.
-     * @return true on success, false on failure
-     * @see start_jack
-     */
-    bool stop_jack();
+    void handle_subscribe_message(int param, OscMessage* msg, const char* sender, QAbstractSocket* socket, bool unsubscribe);
 
     /**
-     * Open the jack client.
+     * Create and open the audio backend selected by the AudioBackend parameter.
      * @return true on success, false on failure
-     * @see close_jack_client
+     * @see close_audio_backend
      */
-    bool open_jack_client();
+    bool open_audio_backend();
 
     /**
-     * Close the jack client.
+     * Close and delete the audio backend.
      * @return true on success, false on failure
-     * @see open_jack_client
+     * @see open_audio_backend
      */
-    bool close_jack_client();
+    bool close_audio_backend();
 
     /**
      * Handle requests to set volume parameter
@@ -635,6 +892,84 @@ private:
      */
     void osc_set_position(OscMessage* msg, const char* sender);
 
+    /**
+     * Handle array-form requests to set a parameter for many apps at once.
+     * The message contains repeated (id, value...) groups with the same types as the
+     * single-app form (e.g. "ifif..." for volume, "iiiiii..." for position).  All changes
+     * are applied together at one period boundary, and each subscriber receives one
+     * coalesced /sam/val message in the same array form.  If the audio thread hasn't
+     * applied the previous change set yet, the message is queued and staged after a later
+     * period; if the queue is full it is rejected with /sam/err/changeset.
+     * @param msg the OSC message to handle
+     * @param param the SamClientSubscription parameter to set
+     * @param sender the name of the host that sent the message
+     * @param senderPort the UDP port the message was sent from, which errors are sent back to
+     * @param socket the socket the message was received on
+     */
+    void osc_set_bulk(OscMessage* msg, int param, const char* sender, quint16 senderPort, QAbstractSocket* socket);
+
+    /**
+     * Stage and commit the changes in an array-form set message.
+     * Must only be called after begin_change_set() succeeds.
+     * @param msg the OSC message to apply
+     * @param param the SamClientSubscription parameter to set
+     * @see osc_set_bulk
+     */
+    void stage_change_set(OscMessage* msg, int param);
+
+    /**
+     * Queue an array-form set message to be staged once the previous change set has been applied,
+     * or send /sam/err/changeset to the sender if too many are already queued.
+     * @param msg the OSC message to queue
+     * @param param the SamClientSubscription parameter to set
+     * @param sender the name of the host that sent the message
+     * @param senderPort the UDP port the message was sent from
+     * @param socket the socket the message was received on
+     */
+    void queue_change_set(OscMessage* msg, int param, const char* sender, quint16 senderPort, QAbstractSocket* socket);
+
+    /**
+     * Send /sam/err/changeset to the sender of a rejected array-form set message.
+     * @param rejected the rejected change set (over TCP the reply goes to its socket,
+     * over UDP to the port it was sent from)
+     */
+    void reject_change_set(const SamQueuedChangeSet& rejected);
+
+    /**
+     * Add one app's new parameter values to the coalesced notifications for a bulk change set.
+     * @param notify the coalesced notifications being built
+     * @param address the /sam/val OSC address for the parameter
+     * @param subscribers the UDP subscribers to the parameter
+     * @param subscribersTcp the TCP subscribers to the parameter
+     * @param vals the (id, value...) arguments to add
+     * @param numVals the number of arguments in vals
+     */
+    void add_bulk_notification(SamBulkNotification& notify,
+                               const char* address,
+                               const QVector<OscAddress*>& subscribers,
+                               const QVector<QTcpSocket*>& subscribersTcp,
+                               const OscArg* vals,
+                               int numVals);
+
+    /**
+     * Check whether the audio thread has applied any previously committed change set.
+     * Doesn't block.
+     * @return true if a new change set can be staged, false if the previous one is still pending
+     * @see commit_change_set
+     */
+    bool begin_change_set();
+
+    /**
+     * Hand staged parameter changes to the audio thread to be applied at the next period boundary.
+     * @see begin_change_set
+     */
+    void commit_change_set();
+
+    /**
+     * Apply all staged parameter changes (called from the audio thread).
+     */
+    void apply_change_set();
+
     /**
      * Handle requests to set type
      * @param msg the OSC message to handle
@@ -670,6 +1005,42 @@ private:
      */
     void osc_remove_type(OscMessage* msg);
 
+    /**
+     * Handle requests to subscribe to or unsubscribe from binary meter frames for all apps.
+     * @param msg the OSC message to handle
+     * @param sender the name of the host that sent the message
+     * @param socket the socket the message was received through
+     * @param unsubscribe true to unsubscribe, false to subscribe
+     */
+    void osc_subscribe_meter_frame(OscMessage* msg, const char* sender, QAbstractSocket* socket, bool unsubscribe);
+
+    /**
+     * Write the meter levels for all apps into m_meterFrame.
+     * @param format the encoding to use for the levels
+     */
+    void write_meter_frame(MeterFrameFormat format);
+
+    /**
+     * Send a /sam/val/meterframe message to all subscribers to the given format.
+     * @param format the encoding to use for the levels
+     */
+    void send_meter_frame(MeterFrameFormat format);
+
+    /**
+     * Handle requests for performance statistics (/sam/stats), used for benchmarking.
+     * @param msg the OSC message to handle
+     * @param sender the name of the host that sent the message
+     */
+    void osc_stats(OscMessage* msg, const char* sender);
+
+    /**
+     * Handle requests for an app's latency estimates (/sam/latency): the network transit time and playout
+     * delay measured when its last RTCP sender report arrived.
+     * @param msg the OSC message to handle
+     * @param sender the name of the host that sent the message
+     */
+    void osc_latency(OscMessage* msg, const char* sender);
+
     /**
      * JACK process callback
      * @param nframes the number of sample frames to process
@@ -712,6 +1083,12 @@ private:
      * @return true on success, false on failure
      */
     bool allocate_output_ports(int port, int channels, sam::StreamingAudioType type);
+
+    /**
+     * Release the discrete outputs allocated to an app (does nothing if it has none).
+     * @param port the unique port for the app
+     */
+    void release_discrete_outputs(int port);
     
     /**
      * Connect app ports to physical outputs.
@@ -744,8 +1121,8 @@ private:
     int m_numBasicChannels;           ///< number of basic channels
     int m_maxOutputChannels;          ///< max number of output channels to use
     char* m_jackDriver;               ///< driver for JACK to use
-    pid_t m_jackPID;                  ///< PID for the jackd process
-    jack_client_t* m_client;          ///< local JACK client
+    QString m_audioBackendName;       ///< which audio backend to use ("jack", "virtual" or "offline")
+    SamAudioBackend* m_audio;         ///< audio backend (JACK client or virtual sound card)
     int m_maxClients;                 ///< max number of clients that can simultaneously connect
     StreamingAudioApp** m_apps;       ///< pointers to active StreamingAudioApps
     SamAppState* m_appState;          ///< the state for all StreamingAudioApps in m_apps
@@ -761,7 +1138,13 @@ private:
     unsigned int m_maxBasicOutputs;    ///< max number of output JACK ports for basic JACK client
     unsigned int m_maxDiscreteOutputs; ///< max number of output JACK ports for discrete JACK client
     int* m_discreteOutputUsed;         ///< which output ports are in use (by which app)
+    QVector<int> m_discreteFree;       ///< free discrete outputs (0-indexed), lowest on top
+    QVector<QVector<int> > m_discreteOwned; ///< discrete outputs allocated to each app, in allocation order
+    int m_outputPortPoolSize;          ///< number of output ports to register at startup (0 for none)
+    SamPortPool* m_portPool;           ///< output ports shared by apps (NULL if apps register their own)
     quint16 m_rtpPort;                 ///< base port to use for RTP streaming
+    QHostAddress m_rtpMulticastGroup;  ///< multicast group for RTP receivers to join (null for unicast only)
+    int m_sharedMemoryGid;             ///< group allowed to attach to shared-memory rings (-1 for SAM's user only)
     char* m_outJackClientNameBasic;    ///< jack client name to which SAM will connect outputs
     char* m_outJackPortBaseBasic;      ///< base jack port name to which SAM will connect outputs
     char* m_outJackClientNameDiscrete; ///< jack client name to which SAM will connect outputs
@@ -771,6 +1154,10 @@ private:
 
     // subscribers
     QVector<OscAddress*> m_uiSubscribers;   ///< list of subscribers to UI parameters
+    QVector<OscAddress*> m_meterFrameSubscribers[NUM_METER_FRAME_FORMATS];     ///< subscribers to meter frames, by format
+    QVector<QTcpSocket*> m_meterFrameSubscribersTcp[NUM_METER_FRAME_FORMATS];  ///< TCP sockets subscribed to meter frames, by format
+    QByteArray m_meterFrame;                ///< reusable buffer for a meter frame
+    OscMessage m_meterFrameMsg;             ///< reusable /sam/val/meterframe message
     OscAddress* m_renderer;                 ///< external audio renderer
     quint32 m_meterInterval;                ///< number of samples between meter updates
     qint64 m_nextMeterNotify;               ///< time when next meter updates should be sent (in samples)
@@ -787,9 +1174,36 @@ private:
     int m_delayMaxClient;           ///< the maximum supported delay (in samples)
     int m_delayMaxGlobal;           ///< the maximum supported delay (in samples)
 
+    // bulk change sets
+    QAtomicInt m_changeSetPending;  ///< set when a committed change set is waiting for the audio thread
+    QList<SamQueuedChangeSet> m_queuedChangeSets; ///< bulk set messages waiting to be staged, oldest first
+    bool m_changeSetScheduled;      ///< true while a stageQueuedChangeSets() call is pending
+
+    // active apps (see SamActiveApps)
+    QAtomicPointer<SamActiveApps> m_activeApps; ///< apps the audio thread processes, published by the control thread
+    QList<SamActiveApps*> m_retiredApps;        ///< replaced app lists the audio thread may still be using, oldest first
+    QAtomicInt m_processEpoch;      ///< number of periods the audio thread has finished (wraps)
+    QAtomicInt m_soloCount;         ///< number of apps that are solo'd
+    bool m_reclaimScheduled;        ///< true while a reclaimActiveApps() call is pending
+    float m_volumeStaged;           ///< global volume staged by a bulk change set
+    bool m_muteStaged;              ///< global mute status staged by a bulk change set
+    int m_delayStaged;              ///< global delay staged by a bulk change set (in samples)
+    int m_stagedFlags;              ///< which global parameters are waiting to be committed
+
+    // performance statistics (written by the JACK thread, read by osc_stats)
+    volatile quint32 m_xruns;           ///< number of xruns since the audio backend was activated
+    volatile quint32 m_processPeriods;  ///< number of process callbacks since the audio backend was activated
+    volatile quint64 m_processNanos;    ///< total time spent in the process callback (in nanoseconds)
+    volatile quint32 m_processNanosMax; ///< longest process callback since the last /sam/stats query (in nanoseconds)
+    QAtomicInt m_processMaxReset;       ///< set by osc_stats to have the JACK thread restart m_processNanosMax
+
     // for OSC
+    OscDispatcher m_oscDispatcher;  ///< routes incoming OSC messages to handlers
+    OscNotifier* m_notifier;        ///< sends OSC notifications to subscribers
     quint16 m_oscServerPort;        ///< port the OSC server will listen for messages on
     QUdpSocket* m_udpSocket;        ///< UDP socket for receiving OSC messages
+    QByteArray m_udpDatagram;       ///< reusable buffer for datagrams received on m_udpSocket
+    OscMessage m_udpMsg;            ///< reusable message for datagrams received on m_udpSocket
     QTcpServer* m_tcpServer;        ///< The server listening for incoming TCP connections
     QHostAddress m_hostAddress;     ///< Local host address where OSC messages should be sent
     QString m_oscDirections;        ///< string that explains where to send OSC messages for SAM
@@ -797,6 +1211,28 @@ private:
 
     // for version checking
     bool m_verifyPatchVersion;      ///< Whether the patch version must match for version checking
+
+    // for hot standby
+    QString m_primaryHost;                  ///< address of the primary SAM (empty unless running as a standby)
+    quint16 m_primaryPort;                  ///< OSC port of the primary SAM
+    int m_standbyTimeoutMillis;             ///< milliseconds without a heartbeat before taking over from the primary
+    SamStandbyLink* m_standbyLink;          ///< link to the primary SAM (standby only)
+    volatile bool m_standby;                ///< true while mirroring a primary (output is muted)
+    bool m_standbyMuteCurrent;              ///< whether output was muted for standby during the last period
+    QVector<QTcpSocket*> m_standbySockets;  ///< standby SAMs mirroring this SAM
+    QTimer* m_standbyHeartbeatTimer;        ///< timer for sending heartbeats to standby SAMs
+
+    // for relaying to downstream SAMs
+    SamRelay** m_relays;                    ///< relays to downstream SAMs (NULL where unused)
+    QString m_relayHost;                    ///< downstream SAM to forward a downmix to at startup (empty for none)
+    quint16 m_relayPort;                    ///< OSC port of m_relayHost
+    int m_relayChannels;                    ///< number of channels in the startup downmix
+    int m_relayBitDepth;                    ///< bits per sample sent by relays unless /sam/relay/add specifies it
+
+    // for master recording
+    SamRecorder* volatile m_masterRecorder; ///< recorder for the basic output mix (NULL if not recording)
+    QString m_recordDirectory;          ///< directory recordings and RTP captures are written to (empty if they are disabled)
+    float** m_masterMix;                    ///< basic output mix for the current period [basic channels][buffer size]
 }; 
 
 } // end of namespace SAM
@@ -17,9 +17,18 @@ SOURCES += sam_main.cpp \
     sam_app.cpp \
     jack_util.cpp \
     ../osc.cpp \
+    osc_notifier.cpp \
+    sam_standby.cpp \
+    sam_relay.cpp \
+    sam_recorder.cpp \
+    sam_port_pool.cpp \
+    sam_audio_backend.cpp \
     ../rtp.cpp \
     ../rtcp.cpp \
+    ../shared_audio_ring.cpp \
     rtpreceiver.cpp \
+    rtpcapture.cpp \
+    ../client/rtpsender.cpp \
     samui.cpp \
     clientwidget.cpp \
     masterwidget.cpp \
@@ -29,9 +38,18 @@ HEADERS += sam.h \
     sam_app.h \
     jack_util.h \
     ../osc.h \
+    osc_notifier.h \
+    sam_standby.h \
+    sam_relay.h \
+    sam_recorder.h \
+    sam_port_pool.h \
+    sam_audio_backend.h \
     ../rtp.h \
     ../rtcp.h \
+    ../shared_audio_ring.h \
     rtpreceiver.h \
+    rtpcapture.h \
+    ../client/rtpsender.h \
     samui.h \
     clientwidget.h \
     masterwidget.h \
@@ -50,6 +68,7 @@ CONFIG -= warn_on
 DEFINES += QT_NO_DEBUG_OUTPUT
 
 LIBS += -ljack
+unix:!macx: LIBS += -lrt # for shm_open
 #QT -= gui
 QT += network
 
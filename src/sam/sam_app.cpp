@@ -46,13 +46,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <QDebug>
 
 #include "jack/jack.h"
 
+#include "osc_notifier.h"
 #include "sam.h"
 #include "sam_app.h"
+#include "sam_port_pool.h"
 
 namespace sam
 {
@@ -60,16 +63,54 @@ namespace sam
 static const int MAX_IP_LEN = 32;
 static const int MAX_CMD_LEN = 32;
 static const int MAX_PORT_NAME = 128;
+static const int MAX_RING_NAME = 32; // shared memory names are limited to 31 characters on OS X
 
 static const quint32 REPORT_INTERVAL = 1000;
 
+// flags for parameters staged by a bulk change set
+static const int STAGED_VOLUME = 0x1;
+static const int STAGED_MUTE = 0x2;
+static const int STAGED_SOLO = 0x4;
+static const int STAGED_DELAY = 0x8;
+
+// m_soloCounted values: not solo'd, solo'd, or removed (no longer counted at all)
+static const int SOLO_NOT_COUNTED = 0;
+static const int SOLO_COUNTED = 1;
+static const int SOLO_RELEASED = 2;
+
+static const int RING_NAME_RANDOM_BYTES = 8; // random part of a shared-memory ring name, so other users can't guess it
+
+/**
+ * Write random bytes as hex digits.
+ * @param out the buffer to write to, with room for 2 * bytes + 1 characters
+ * @param bytes the number of random bytes
+ * @return true on success, false if no random bytes could be read
+ */
+static bool random_hex(char* out, int bytes)
+{
+    unsigned char random[RING_NAME_RANDOM_BYTES];
+    if (bytes > RING_NAME_RANDOM_BYTES) return false;
+
+    FILE* urandom = fopen("/dev/urandom", "rb");
+    if (!urandom) return false;
+    bool success = (fread(random, 1, bytes, urandom) == (size_t)bytes);
+    fclose(urandom);
+    if (!success) return false;
+
+    for (int i = 0; i < bytes; i++)
+    {
+        snprintf(out + 2 * i, 3, "%02x", random[i]);
+    }
+    return true;
+}
+
 StreamingAudioApp::StreamingAudioApp(const char* name, 
                                      int port, 
                                      int channels, 
                                      const SamAppPosition& pos, 
                                      StreamingAudioType type, 
                                      int preset,
-                                     jack_client_t* client, 
+                                     SamAudioBackend* audio, 
                                      QTcpSocket* socket, 
                                      quint16 rtpBasePort, 
                                      int maxDelay, 
@@ -89,16 +130,23 @@ StreamingAudioApp::StreamingAudioApp(const char* name,
     m_deleteMe(false),
     m_sam(sam),
     m_channelAssign(NULL),
-    m_jackClient(client),
+    m_audio(audio),
     m_outputPorts(NULL),
+    m_poolIndex(NULL),
     m_volumeCurrent(1.0f),
     m_volumeNext(1.0f),
     m_isMutedCurrent(false),
     m_isMutedNext(false),
     m_isSoloCurrent(false),
     m_isSoloNext(false),
+    m_soloCounted(SOLO_NOT_COUNTED),
     m_delayCurrent(0),
     m_delayNext(0),
+    m_volumeStaged(1.0f),
+    m_isMutedStaged(false),
+    m_isSoloStaged(false),
+    m_delayStaged(0),
+    m_stagedFlags(0),
     m_delayMax(maxDelay),
     m_delayBuffer(NULL),
     m_delayRead(NULL),
@@ -108,10 +156,12 @@ StreamingAudioApp::StreamingAudioApp(const char* name,
     m_rmsIn(NULL),
     m_peakIn(NULL),
     m_receiver(NULL),
+    m_ring(NULL),
     m_rtpBasePort(rtpBasePort),
     m_packetQueueSize(packetQueueSize),
     m_clockSkewThreshold(clockSkewThreshold),
-    m_socket(socket)
+    m_recorder(NULL),
+    m_socket(NULL)
 {
     qDebug("StreamingAudioApp::StreamingAudioApp app port = %d", m_port);
     int len = strlen(name);
@@ -119,7 +169,8 @@ StreamingAudioApp::StreamingAudioApp(const char* name,
     strncpy(m_name, name, len + 1);
 
     // allocate array of output port pointers
-    m_outputPorts = new jack_port_t*[m_channels];
+    m_outputPorts = new SamAudioPort*[m_channels];
+    m_poolIndex = new int[m_channels];
 
     // allocate arrays of RMS levels
     m_rmsOut = new float[m_channels];
@@ -136,6 +187,7 @@ StreamingAudioApp::StreamingAudioApp(const char* name,
     for (int ch = 0; ch < m_channels; ch++)
     {
         m_outputPorts[ch] = NULL;
+        m_poolIndex[ch] = -1;
         m_rmsOut[ch] = 0.0f;
         m_peakOut[ch] = 0.0f;
         m_rmsIn[ch] = 0.0f;
@@ -143,11 +195,10 @@ StreamingAudioApp::StreamingAudioApp(const char* name,
         m_channelAssign[ch] = -1;
     }
 
-    // subscribe to params
-    subscribe_tcp_helper(m_muteSubscribersTcp, m_socket);
-    subscribe_tcp_helper(m_soloSubscribersTcp, m_socket);
-
-    connect(m_socket, SIGNAL(disconnected()), this, SLOT(disconnectApp()));
+    if (socket)
+    {
+        attachSocket(socket);
+    }
 }
 
 StreamingAudioApp::~StreamingAudioApp()
@@ -160,20 +211,32 @@ StreamingAudioApp::~StreamingAudioApp()
 
     m_port = -1; // this will prevent SAM from trying to unregister us a second time from disconnectApp
 
+    // apps removed by SAM have already done this
+    releaseSolo();
+
     // disconnect this signal/slot: it was only for when the socket disconnected before the app was being deleted
-    disconnect(m_socket, SIGNAL(disconnected()), this, SLOT(disconnectApp()));
+    if (m_socket)
+    {
+        disconnect(m_socket, SIGNAL(disconnected()), this, SLOT(disconnectApp()));
+    }
 
     // free array of ports
     if (m_outputPorts)
     {
-        if (m_jackClient)
+        if (m_audio)
         {
-            // unregister ports (this automatically disconnects ports)
+            // return pooled ports to the pool and unregister our own ports (this automatically disconnects ports)
+            SamPortPool* pool = m_sam ? m_sam->getPortPool() : NULL;
             for (int i = 0; i < m_channels; i++)
             {
-                if (m_outputPorts[i])
+                if (m_outputPorts[i] && m_poolIndex[i] >= 0)
+                {
+                    if (pool) pool->release(m_poolIndex[i]);
+                    m_outputPorts[i] = NULL;
+                }
+                else if (m_outputPorts[i])
                 {
-                    jack_port_unregister(m_jackClient, m_outputPorts[i]);
+                    m_audio->unregisterPort(m_outputPorts[i]);
                     m_outputPorts[i] = NULL;
                 }
             }
@@ -183,6 +246,12 @@ StreamingAudioApp::~StreamingAudioApp()
         m_outputPorts = NULL;
     }
 
+    if (m_poolIndex)
+    {
+        delete[] m_poolIndex;
+        m_poolIndex = NULL;
+    }
+
     if (m_channelAssign)
     {
         delete[] m_channelAssign;
@@ -218,6 +287,18 @@ StreamingAudioApp::~StreamingAudioApp()
         delete m_receiver;
         m_receiver = NULL;
     }
+
+    if (m_ring)
+    {
+        delete m_ring; // removes the shared memory
+        m_ring = NULL;
+    }
+
+    if (m_recorder)
+    {
+        delete m_recorder; // finishes the file
+        m_recorder = NULL;
+    }
     
     if (m_name)
     {
@@ -321,32 +402,27 @@ StreamingAudioApp::~StreamingAudioApp()
     emit appClosed(port, type);
 }
 
-bool StreamingAudioApp::init()
+bool StreamingAudioApp::init(bool sharedMemory)
 {
     qDebug("StreamingAudioApp::init port = %d", m_port);
 
     // TODO: any error checking? Making sure that ports haven't already been registered somehow??
 
-    if (!m_jackClient)
+    if (!m_audio)
     {
-        qWarning("StreamingAudioApp::init JACK client was NULL, port = %d", m_port);
+        qWarning("StreamingAudioApp::init audio backend was NULL, port = %d", m_port);
         return false;
     }
 
-    m_sampleRate = jack_get_sample_rate(m_jackClient);
+    m_sampleRate = m_audio->getSampleRate();
 
-    // register JACK output ports
-    char portName[MAX_PORT_NAME];
-    for (int i = 0; i < m_channels; i++)
+    // register JACK output ports, unless SAM hands out pooled ports when the app is connected
+    if (!m_sam->getPortPool())
     {
-        snprintf(portName, MAX_PORT_NAME, "app%d-output_%d", m_port, i + 1);
-        m_outputPorts[i] = jack_port_register(m_jackClient, portName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
-        if (!m_outputPorts[i])
+        for (int i = 0; i < m_channels; i++)
         {
-            qWarning("StreamingAudioApp::init port = %d, ERROR: couldn't register output port for channel %d!", m_port, i + 1);
-            return false;
+            if (!registerOutputPort(i)) return false;
         }
-        qDebug("StreamingAudioApp::init port = %d registered output port %d", m_port, i);
     }
     
     // allocate audio buffer and delay line
@@ -356,7 +432,7 @@ bool StreamingAudioApp::init()
     m_delayWrite = new int[m_channels];
     for (int ch = 0; ch < m_channels; ch++)
     {
-        m_audioData[ch] = new float[jack_get_buffer_size(m_jackClient)];
+        m_audioData[ch] = new float[m_audio->getBufferSize()];
         m_delayBuffer[ch] = new float[m_delayMax];
         m_delayRead[ch] = 0;
         m_delayWrite[ch] = 0;
@@ -364,15 +440,43 @@ bool StreamingAudioApp::init()
 
     // start receiver
     quint16 portOffset = m_port * 4;
-    m_receiver = new RtpReceiver(portOffset + m_rtpBasePort, portOffset + m_rtpBasePort + 1, portOffset + m_rtpBasePort + 3, REPORT_INTERVAL, 1000 + m_port, jack_get_sample_rate(m_jackClient), jack_get_buffer_size(m_jackClient), m_packetQueueSize, m_clockSkewThreshold, m_jackClient, NULL);
+    m_receiver = new RtpReceiver(portOffset + m_rtpBasePort, portOffset + m_rtpBasePort + 1, portOffset + m_rtpBasePort + 3, REPORT_INTERVAL, 1000 + m_port, m_audio->getSampleRate(), m_audio->getBufferSize(), m_packetQueueSize, m_clockSkewThreshold, m_audio, NULL);
 
     connect(m_sam, SIGNAL(xrun()), m_receiver, SLOT(handleXrun()));
 
+    if (!m_sam->getRtpMulticastGroup().isNull())
+    {
+        m_receiver->setMulticastGroup(m_sam->getRtpMulticastGroup());
+    }
+
     if (!m_receiver->start())
     {
         qWarning("StreamingAudioApp::init port = %d, ERROR: couldn't start RTP receiver!", m_port);
         return false;
     }
+
+    // offer a client on this host a shared-memory ring (the RTP receiver remains the fallback)
+    if (sharedMemory)
+    {
+        // the name is only sent to the client in its registration reply
+        char random[2 * RING_NAME_RANDOM_BYTES + 1];
+        char ringName[MAX_RING_NAME];
+        int group = m_sam ? m_sam->getSharedMemoryGroup() : -1;
+        m_ring = new SharedAudioRing();
+        if (!random_hex(random, RING_NAME_RANDOM_BYTES))
+        {
+            qWarning("StreamingAudioApp::init port = %d couldn't read random bytes for a shared-memory ring name: using RTP", m_port);
+            delete m_ring;
+            m_ring = NULL;
+        }
+        else if (snprintf(ringName, MAX_RING_NAME, "/sam-%d-%s", m_port, random) < 0
+                 || !m_ring->create(ringName, m_channels, m_audio->getBufferSize(), m_sampleRate, group))
+        {
+            qWarning("StreamingAudioApp::init port = %d couldn't create shared-memory ring: using RTP", m_port);
+            delete m_ring;
+            m_ring = NULL;
+        }
+    }
     
     return true;
 }
@@ -385,22 +489,7 @@ void StreamingAudioApp::setVolume(float volume)
     // notify subscribers
     OscMessage replyMsg;
     replyMsg.init("/sam/val/volume", "if", m_port, m_volumeNext);
-    QVector<OscAddress*>::iterator it;
-    for (it = m_volumeSubscribers.begin(); it != m_volumeSubscribers.end(); it++)
-    {
-        if (!OscClient::sendUdp(&replyMsg, (OscAddress*)*it))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
-    QVector<QTcpSocket*>::iterator itTcp;
-    for (itTcp = m_volumeSubscribersTcp.begin(); itTcp != m_volumeSubscribersTcp.end(); itTcp++)
-    {
-        if (!OscClient::sendFromSocket(&replyMsg, (QTcpSocket*)*itTcp))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    notify_subscribers(SUBSCRIPTION_VOLUME, &replyMsg);
 }
 
 void StreamingAudioApp::setMute(bool isMuted)
@@ -410,46 +499,37 @@ void StreamingAudioApp::setMute(bool isMuted)
     // notify subscribers
     OscMessage replyMsg;
     replyMsg.init("/sam/val/mute", "ii", m_port, m_isMutedNext);
-    QVector<OscAddress*>::iterator it;
-    for (it = m_muteSubscribers.begin(); it != m_muteSubscribers.end(); it++)
-    {
-        if (!OscClient::sendUdp(&replyMsg, (OscAddress*)*it))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
-    QVector<QTcpSocket*>::iterator itTcp;
-    for (itTcp = m_muteSubscribersTcp.begin(); itTcp != m_muteSubscribersTcp.end(); itTcp++)
-    {
-        if (!OscClient::sendFromSocket(&replyMsg, (QTcpSocket*)*itTcp))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    notify_subscribers(SUBSCRIPTION_MUTE, &replyMsg);
 }
 
 void StreamingAudioApp::setSolo(bool isSolo)
 {
-    m_isSoloNext = isSolo;
+    set_solo_next(isSolo);
 
     // notify subscribers
     OscMessage replyMsg;
     replyMsg.init("/sam/val/solo", "ii", m_port, m_isSoloNext);
-    QVector<OscAddress*>::iterator it;
-    for (it = m_soloSubscribers.begin(); it != m_soloSubscribers.end(); it++)
+    notify_subscribers(SUBSCRIPTION_SOLO, &replyMsg);
+}
+
+void StreamingAudioApp::releaseSolo()
+{
+    if (m_soloCounted.fetchAndStoreOrdered(SOLO_RELEASED) == SOLO_COUNTED)
     {
-        if (!OscClient::sendUdp(&replyMsg, (OscAddress*)*it))
-        {
-            qWarning("Couldn't send OSC message");
-        }
+        m_sam->adjustSoloCount(-1);
     }
-    QVector<QTcpSocket*>::iterator itTcp;
-    for (itTcp = m_soloSubscribersTcp.begin(); itTcp != m_soloSubscribersTcp.end(); itTcp++)
+}
+
+void StreamingAudioApp::set_solo_next(bool isSolo)
+{
+    m_isSoloNext = isSolo;
+
+    // only a change counts, and nothing once the app has been released
+    bool changed = isSolo ? m_soloCounted.testAndSetOrdered(SOLO_NOT_COUNTED, SOLO_COUNTED)
+                          : m_soloCounted.testAndSetOrdered(SOLO_COUNTED, SOLO_NOT_COUNTED);
+    if (changed)
     {
-        if (!OscClient::sendFromSocket(&replyMsg, (QTcpSocket*)*itTcp))
-        {
-            qWarning("Couldn't send OSC message");
-        }
+        m_sam->adjustSoloCount(isSolo ? 1 : -1);
     }
 }
 
@@ -466,22 +546,7 @@ void StreamingAudioApp::setDelay(float delay)
     // notify subscribers
     OscMessage replyMsg;
     replyMsg.init("/sam/val/delay", "if", m_port, delaySet);
-    QVector<OscAddress*>::iterator it;
-    for (it = m_delaySubscribers.begin(); it != m_delaySubscribers.end(); it++)
-    {
-        if (!OscClient::sendUdp(&replyMsg, (OscAddress*)*it))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
-    QVector<QTcpSocket*>::iterator itTcp;
-    for (itTcp = m_delaySubscribersTcp.begin(); itTcp != m_delaySubscribersTcp.end(); itTcp++)
-    {
-        if (!OscClient::sendFromSocket(&replyMsg, (QTcpSocket*)*itTcp))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    notify_subscribers(SUBSCRIPTION_DELAY, &replyMsg);
 }
 
 void StreamingAudioApp::setType(StreamingAudioType type, int preset)
@@ -493,52 +558,81 @@ void StreamingAudioApp::setType(StreamingAudioType type, int preset)
     // notify subscribers
     OscMessage replyMsg;
     replyMsg.init("/sam/val/type", "iii", m_port, m_type, m_preset);
-    QVector<OscAddress*>::iterator it;
-    for (it = m_typeSubscribers.begin(); it != m_typeSubscribers.end(); it++)
-    {
-        if (!OscClient::sendUdp(&replyMsg, (OscAddress*)*it))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
-    QVector<QTcpSocket*>::iterator itTcp;
-    for (itTcp = m_typeSubscribersTcp.begin(); itTcp != m_typeSubscribersTcp.end(); itTcp++)
-    {
-        if (!OscClient::sendFromSocket(&replyMsg, (QTcpSocket*)*itTcp))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    notify_subscribers(SUBSCRIPTION_TYPE, &replyMsg);
 
     // notify the client
-    if (!OscClient::sendFromSocket(&replyMsg, m_socket))
+    if (m_socket && !OscClient::sendFromSocket(&replyMsg, m_socket))
     {
         qWarning("Couldn't send OSC message");
     }
 }
 
-void StreamingAudioApp::setPosition(const SamAppPosition& pos)
+void StreamingAudioApp::setPosition(const SamAppPosition& pos, bool notify)
 {
     m_position = pos;
+    if (!notify) return;
 
     // notify subscribers
     OscMessage replyMsg;
     replyMsg.init("/sam/val/position", "iiiiii", m_port, m_position.x, m_position.y, m_position.width, m_position.height, m_position.depth);
-    QVector<OscAddress*>::iterator it;
-    for (it = m_positionSubscribers.begin(); it != m_positionSubscribers.end(); it++)
-    {
-        if (!OscClient::sendUdp(&replyMsg, (OscAddress*)*it))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
-    QVector<QTcpSocket*>::iterator itTcp;
-    for (itTcp = m_positionSubscribersTcp.begin(); itTcp != m_positionSubscribersTcp.end(); itTcp++)
+    notify_subscribers(SUBSCRIPTION_POSITION, &replyMsg);
+}
+
+float StreamingAudioApp::stageVolume(float volume)
+{
+    m_volumeStaged = volume >= 0.0f ? volume : 0.0f;
+    m_volumeStaged = m_volumeStaged <= 1.0f ? m_volumeStaged : 1.0f;
+    m_stagedFlags |= STAGED_VOLUME;
+    return m_volumeStaged;
+}
+
+void StreamingAudioApp::stageMute(bool isMuted)
+{
+    m_isMutedStaged = isMuted;
+    m_stagedFlags |= STAGED_MUTE;
+}
+
+void StreamingAudioApp::stageSolo(bool isSolo)
+{
+    m_isSoloStaged = isSolo;
+    m_stagedFlags |= STAGED_SOLO;
+}
+
+float StreamingAudioApp::stageDelay(float delay)
+{
+    m_delayStaged = m_sampleRate * (delay / 1000.0f);
+    m_delayStaged = (m_delayStaged < 0) ? 0 : m_delayStaged;
+    m_delayStaged = (m_delayStaged >= m_delayMax) ? m_delayMax - 1 : m_delayStaged;
+    m_stagedFlags |= STAGED_DELAY;
+    return ((m_delayStaged * 1000.0f) / (float)m_sampleRate); // actual delay set, in millis
+}
+
+void StreamingAudioApp::commitStaged()
+{
+    if (m_stagedFlags & STAGED_VOLUME) m_volumeNext = m_volumeStaged;
+    if (m_stagedFlags & STAGED_MUTE) m_isMutedNext = m_isMutedStaged;
+    if (m_stagedFlags & STAGED_SOLO) set_solo_next(m_isSoloStaged);
+    if (m_stagedFlags & STAGED_DELAY) m_delayNext = m_delayStaged;
+    m_stagedFlags = 0;
+}
+
+void StreamingAudioApp::attachSocket(QTcpSocket* socket)
+{
+    m_socket = socket;
+
+    // subscribe to params
+    subscribe_tcp_helper(m_muteSubscribersTcp, m_socket);
+    subscribe_tcp_helper(m_soloSubscribersTcp, m_socket);
+
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(disconnectApp()));
+}
+
+void StreamingAudioApp::notify_subscribers(int param, OscMessage* msg)
+{
+    m_sam->getNotifier()->notify(OscNotifier::makeKey(param, m_port), msg, getSubscribers(param), getSubscribersTcp(param));
+    if (param != SUBSCRIPTION_METER)
     {
-        if (!OscClient::sendFromSocket(&replyMsg, (QTcpSocket*)*itTcp))
-        {
-            qWarning("Couldn't send OSC message");
-        }
+        m_sam->mirrorState(msg, param, m_port);
     }
 }
 
@@ -814,42 +908,68 @@ bool StreamingAudioApp::unsubscribeAllTcp(QTcpSocket* socket)
     return true;
 }
 
+const QVector<OscAddress*>& StreamingAudioApp::getSubscribers(int param) const
+{
+    switch (param)
+    {
+    case SUBSCRIPTION_VOLUME:
+        return m_volumeSubscribers;
+    case SUBSCRIPTION_MUTE:
+        return m_muteSubscribers;
+    case SUBSCRIPTION_SOLO:
+        return m_soloSubscribers;
+    case SUBSCRIPTION_DELAY:
+        return m_delaySubscribers;
+    case SUBSCRIPTION_POSITION:
+        return m_positionSubscribers;
+    case SUBSCRIPTION_TYPE:
+        return m_typeSubscribers;
+    case SUBSCRIPTION_METER:
+    default:
+        return m_meterSubscribers;
+    }
+}
+
+const QVector<QTcpSocket*>& StreamingAudioApp::getSubscribersTcp(int param) const
+{
+    switch (param)
+    {
+    case SUBSCRIPTION_VOLUME:
+        return m_volumeSubscribersTcp;
+    case SUBSCRIPTION_MUTE:
+        return m_muteSubscribersTcp;
+    case SUBSCRIPTION_SOLO:
+        return m_soloSubscribersTcp;
+    case SUBSCRIPTION_DELAY:
+        return m_delaySubscribersTcp;
+    case SUBSCRIPTION_POSITION:
+        return m_positionSubscribersTcp;
+    case SUBSCRIPTION_TYPE:
+        return m_typeSubscribersTcp;
+    case SUBSCRIPTION_METER:
+    default:
+        return m_meterSubscribersTcp;
+    }
+}
+
 bool StreamingAudioApp::notifyMeter()
 {
     if (!m_rmsOut || !m_peakOut) return false;
 
-    if (m_meterSubscribers.isEmpty()) return true;
+    if (m_meterSubscribers.isEmpty() && m_meterSubscribersTcp.isEmpty()) return true;
 
-    OscMessage replyMsg;
-    replyMsg.init("/sam/val/meter", "ii", m_port, m_channels);
+    m_meterMsg.init("/sam/val/meter", "ii", m_port, m_channels);
     for (int ch = 0; ch < m_channels; ch++)
     {
-        replyMsg.addFloatArg(m_rmsIn[ch]);
-        replyMsg.addFloatArg(sqrt(m_peakIn[ch])); // only take square root when peak is sent, not each time it changes, for efficiency
-        replyMsg.addFloatArg(m_rmsOut[ch]);
-        replyMsg.addFloatArg(sqrt(m_peakOut[ch])); // only take square root when peak is sent, not each time it changes, for efficiency
+        m_meterMsg.addFloatArg(m_rmsIn[ch]);
+        m_meterMsg.addFloatArg(sqrt(m_peakIn[ch])); // only take square root when peak is sent, not each time it changes, for efficiency
+        m_meterMsg.addFloatArg(m_rmsOut[ch]);
+        m_meterMsg.addFloatArg(sqrt(m_peakOut[ch])); // only take square root when peak is sent, not each time it changes, for efficiency
         m_peakIn[ch] = 0.0f; // reset peak levels for next interval
         m_peakOut[ch] = 0.0f; // reset peak levels for next interval
     }
 
-    // send the current meter levels to all subscribers
-    QVector<OscAddress*>::iterator it;
-    for (it = m_meterSubscribers.begin(); it != m_meterSubscribers.end(); it++)
-    {
-        if (!OscClient::sendUdp(&replyMsg, (OscAddress*)*it))
-        {
-            qWarning("Couldn't send OSC message");
-            return false;
-        }
-    }
-    QVector<QTcpSocket*>::iterator itTcp;
-    for (itTcp = m_meterSubscribersTcp.begin(); itTcp != m_meterSubscribersTcp.end(); itTcp++)
-    {
-        if (!OscClient::sendFromSocket(&replyMsg, (QTcpSocket*)*itTcp))
-        {
-            qWarning("Couldn't send OSC message");
-        }
-    }
+    notify_subscribers(SUBSCRIPTION_METER, &m_meterMsg);
 
     return true;
 }
@@ -868,8 +988,22 @@ int StreamingAudioApp::process(jack_nframes_t nframes, float volumeCurrent, floa
     delayEnd = (delayEnd >= m_delayMax) ? m_delayMax - 1 : delayEnd;
     float delayInc = (delayEnd - delayStart) / (float)nframes;
 
-    // get audio from the network
-    m_receiver->receiveAudio(m_audioData, m_channels, nframes);
+    // get audio from the client's shared-memory ring if it has attached, otherwise from the network
+    if (m_ring && m_ring->isWriterAttached())
+    {
+        m_ring->read(m_audioData, m_channels, nframes);
+    }
+    else
+    {
+        m_receiver->receiveAudio(m_audioData, m_channels, nframes);
+    }
+
+    // record the received audio
+    SamRecorder* recorder = m_recorder;
+    if (recorder)
+    {
+        recorder->write(m_audioData, nframes);
+    }
 
     // process audio only for channels that are actually used (connected to an output)
     for (int ch = 0; ch < m_channelsUsed; ch++)
@@ -879,11 +1013,11 @@ int StreamingAudioApp::process(jack_nframes_t nframes, float volumeCurrent, floa
             qWarning("StreamingAudioApp::process for app %d: output ports are NULL!!", m_port);
             return -1;
         }
-        jack_port_t* outPort = m_outputPorts[ch];
+        SamAudioPort* outPort = m_outputPorts[ch];
 
         if (outPort)
         {
-            jack_default_audio_sample_t* out = (jack_default_audio_sample_t*)jack_port_get_buffer(outPort, nframes);
+            float* out = m_audio->getPortBuffer(outPort, nframes);
             if (!out)
             {
                 qWarning("StreamingAudioApp::process for app %d couldn't get output buffer from JACK", m_port);
@@ -1012,7 +1146,99 @@ const char* StreamingAudioApp::getOutputPortName(unsigned int index)
 {
     if ((int)index >= m_channels || !m_outputPorts || !m_outputPorts[index]) return NULL;
     
-    return jack_port_name(m_outputPorts[index]);
+    return m_audio->getPortName(m_outputPorts[index]);
+}
+
+bool StreamingAudioApp::registerOutputPort(int ch)
+{
+    if (ch < 0 || ch >= m_channels || !m_audio) return false;
+    if (m_outputPorts[ch]) return true;
+
+    char portName[MAX_PORT_NAME];
+    snprintf(portName, MAX_PORT_NAME, "app%d-output_%d", m_port, ch + 1);
+    m_outputPorts[ch] = m_audio->registerOutputPort(portName);
+    if (!m_outputPorts[ch])
+    {
+        qWarning("StreamingAudioApp::registerOutputPort port = %d, ERROR: couldn't register output port for channel %d!", m_port, ch + 1);
+        return false;
+    }
+    qDebug("StreamingAudioApp::registerOutputPort port = %d registered output port %d", m_port, ch);
+    return true;
+}
+
+void StreamingAudioApp::setPooledOutputPort(int ch, SamAudioPort* port, int index)
+{
+    if (ch < 0 || ch >= m_channels) return;
+    m_poolIndex[ch] = index;
+    m_outputPorts[ch] = port;
+}
+
+int StreamingAudioApp::takePooledOutputPort(int ch)
+{
+    if (ch < 0 || ch >= m_channels || m_poolIndex[ch] < 0) return -1;
+
+    // the audio thread skips channels without a port
+    int index = m_poolIndex[ch];
+    m_outputPorts[ch] = NULL;
+    m_poolIndex[ch] = -1;
+    return index;
+}
+
+bool StreamingAudioApp::startRecording(const QString& path)
+{
+    if (m_recorder)
+    {
+        qWarning("StreamingAudioApp::startRecording app %d is already being recorded", m_port);
+        return false;
+    }
+
+    SamRecorder* recorder = new SamRecorder(path, m_channels, m_audio->getSampleRate(), m_audio->getBufferSize());
+    if (!recorder->open())
+    {
+        delete recorder;
+        return false;
+    }
+    m_recorder = recorder;
+
+    QByteArray pathBytes = path.toLocal8Bit();
+    printf("Recording app %d to %s\n", m_port, pathBytes.constData());
+    return true;
+}
+
+SamRecorder* StreamingAudioApp::takeRecorder()
+{
+    SamRecorder* recorder = m_recorder;
+    m_recorder = NULL;
+    return recorder;
+}
+
+bool StreamingAudioApp::startCapture(const QString& path)
+{
+    if (!m_receiver)
+    {
+        qWarning("StreamingAudioApp::startCapture app %d has no RTP receiver", m_port);
+        return false;
+    }
+    if (!m_receiver->startCapture(path, m_channels)) return false;
+
+    QByteArray pathBytes = path.toLocal8Bit();
+    printf("Capturing RTP packets for app %d to %s\n", m_port, pathBytes.constData());
+    return true;
+}
+
+bool StreamingAudioApp::stopCapture()
+{
+    if (!m_receiver || !m_receiver->isCapturing()) return false;
+
+    m_receiver->stopCapture();
+    return true;
+}
+
+const float* StreamingAudioApp::getOutputBuffer(int ch, jack_nframes_t nframes)
+{
+    if (ch < 0 || ch >= m_channelsUsed || !m_outputPorts || !m_outputPorts[ch]) return NULL;
+
+    return m_audio->getPortBuffer(m_outputPorts[ch], nframes);
 }
 
 bool StreamingAudioApp::getMeters(int ch, float& rmsIn, float& peakIn, float& rmsOut, float& peakOut)
@@ -1026,6 +1252,17 @@ bool StreamingAudioApp::getMeters(int ch, float& rmsIn, float& peakIn, float& rm
     return true;
 }
 
+void StreamingAudioApp::resetMeterPeaks()
+{
+    if (!m_peakIn || !m_peakOut) return;
+
+    for (int ch = 0; ch < m_channels; ch++)
+    {
+        m_peakIn[ch] = 0.0f;
+        m_peakOut[ch] = 0.0f;
+    }
+}
+
 bool StreamingAudioApp::subscribe_helper(QVector<OscAddress*> &subscribers, const char* hostRef, quint16 portRef)
 {
     for (int i = 0; i < subscribers.size(); i++)
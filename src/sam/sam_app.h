@@ -49,6 +49,9 @@
 
 #include "sam.h"
 #include "rtpreceiver.h"
+#include "sam_audio_backend.h"
+#include "sam_recorder.h"
+#include "shared_audio_ring.h"
 
 namespace sam
 {
@@ -88,7 +91,7 @@ public:
                       const SamAppPosition& pos, 
                       StreamingAudioType type, 
                       int preset,
-                      jack_client_t* client, 
+                      SamAudioBackend* audio, 
                       QTcpSocket* socket, 
                       quint16 rtpBasePort, 
                       int maxDelay, 
@@ -114,8 +117,10 @@ public:
 
     /**
      * Initialize the app.
+     * @param sharedMemory true to also create a SharedAudioRing for a client on the same host.
+     *      Audio is read from the ring instead of the RTP receiver while the client is attached to it.
      */
-    bool init();
+    bool init(bool sharedMemory = false);
 
     /** 
      * Activate the app.
@@ -176,6 +181,11 @@ public:
      */
     bool getSolo() const { return m_isSoloNext; }
 
+    /**
+     * Stop counting toward SAM's number of solo'd apps (when the app is removed).
+     */
+    void releaseSolo();
+
     /**
      * Set the delay.
      * @param delay delay in milliseconds
@@ -191,8 +201,46 @@ public:
     /**
      * Set the position.
      * @param pos the new position
+     * @param notify true if position subscribers should be notified of the change
+     */
+    void setPosition(const SamAppPosition& pos, bool notify = true);
+
+    /**
+     * Stage a volume change to be applied by the next call to commitStaged().
+     * Subscribers are not notified.
+     * @param volume the volume to be set, in the range [0.0, 1.0]
+     * @return the volume actually staged
+     */
+    float stageVolume(float volume);
+
+    /**
+     * Stage a mute change to be applied by the next call to commitStaged().
+     * Subscribers are not notified.
+     * @param isMuted true if this app is to be muted, false otherwise
+     */
+    void stageMute(bool isMuted);
+
+    /**
+     * Stage a solo change to be applied by the next call to commitStaged().
+     * Subscribers are not notified.
+     * @param isSolo true if this app is to be solo'd, false otherwise
+     */
+    void stageSolo(bool isSolo);
+
+    /**
+     * Stage a delay change to be applied by the next call to commitStaged().
+     * Subscribers are not notified.
+     * @param delay delay in milliseconds
+     * @return the delay actually staged, in milliseconds
+     */
+    float stageDelay(float delay);
+
+    /**
+     * Apply all staged parameter changes.
+     * Called from the audio thread at a period boundary so that a bulk change set
+     * takes effect within a single period.
      */
-    void setPosition(const SamAppPosition& pos);
+    void commitStaged();
 
     /**
      * Get the app window's position.
@@ -219,6 +267,12 @@ public:
      */
     int getPreset() const { return m_preset; }
 
+    /**
+     * Get the packet queue size.
+     * @return the number of packets queued before playback
+     */
+    quint32 getPacketQueueSize() const { return m_packetQueueSize; }
+
     /**
      * Set a channel assignment.
      * @param appChannel the app's channel
@@ -298,6 +352,20 @@ public:
      */
     bool unsubscribeAllTcp(QTcpSocket* socket);
 
+    /**
+     * Get the UDP subscribers for the given parameter.
+     * @param param the SamClientSubscription parameter
+     * @return the OSC addresses subscribed to the parameter (not to be modified)
+     */
+    const QVector<OscAddress*>& getSubscribers(int param) const;
+
+    /**
+     * Get the TCP subscribers for the given parameter.
+     * @param param the SamClientSubscription parameter
+     * @return the TCP sockets subscribed to the parameter (not to be modified)
+     */
+    const QVector<QTcpSocket*>& getSubscribersTcp(int param) const;
+
     /**
      * Notify subscribers of current meter levels.
      * @return true on success, false on failure
@@ -326,6 +394,96 @@ public:
      */
     const char* getOutputPortName(unsigned int index);
 
+    /**
+     * Register a dedicated output port for a channel (when no pooled port is available).
+     * @param ch the channel
+     * @return true on success, false on failure
+     */
+    bool registerOutputPort(int ch);
+
+    /**
+     * Use a port from SAM's port pool as the output port for a channel.
+     * @param ch the channel
+     * @param port the pooled port
+     * @param index the index of the port in the pool
+     */
+    void setPooledOutputPort(int ch, SamAudioPort* port, int index);
+
+    /**
+     * Stop using a pooled output port, so it can be released back to the pool.
+     * @param ch the channel
+     * @return the index of the port in the pool, or -1 if the channel doesn't have a pooled port
+     */
+    int takePooledOutputPort(int ch);
+
+    /**
+     * Get the output buffer of a channel for the current period (JACK thread only, after process()).
+     * @param ch the channel
+     * @param nframes the number of frames in the current period
+     * @return the output buffer, or NULL if the channel isn't connected to an output
+     */
+    const float* getOutputBuffer(int ch, jack_nframes_t nframes);
+
+    /**
+     * Get the audio received from the network for the current period (JACK thread only, after process()).
+     * This is the audio as sent by the client, before volume and delay are applied.
+     * @return the audio data [channels][nframes]
+     */
+    float** getAudioData() { return m_audioData; }
+
+    /**
+     * Start recording the audio received from this app's client to a file.
+     * Audio is recorded after the packet queue, before volume and delay are applied.
+     * @param path the file to record to
+     * @return true on success, false on failure (e.g. if already recording)
+     */
+    bool startRecording(const QString& path);
+
+    /**
+     * Stop recording.  The audio thread stops writing from its next period on, but may still be writing the
+     * current one, so the caller must only delete the recorder (which finishes the file) once the audio thread
+     * has moved on (see StreamingAudioManager::stopRecording).
+     * @return the recorder, or NULL if not recording
+     */
+    SamRecorder* takeRecorder();
+
+    /**
+     * Query if this app is being recorded.
+     * @return true if recording, false otherwise
+     */
+    bool isRecording() const { return m_recorder != NULL; }
+
+    /**
+     * Start capturing the RTP datagrams received from this app's client, for offline replay.
+     * @param path the capture file
+     * @return true on success, false on failure (e.g. if already capturing)
+     */
+    bool startCapture(const QString& path);
+
+    /**
+     * Stop capturing RTP datagrams.
+     * @return true on success, false if not capturing
+     */
+    bool stopCapture();
+
+    /**
+     * Get the RTP receiver for this app, e.g. to read its packet statistics.
+     * @return the receiver, or NULL if the app hasn't been started
+     */
+    const RtpReceiver* getReceiver() const { return m_receiver; }
+
+    /**
+     * Get the RTP receiver for this app, e.g. to feed it datagrams directly in a benchmark.
+     * @return the receiver, or NULL if the app hasn't been started
+     */
+    RtpReceiver* getReceiver() { return m_receiver; }
+
+    /**
+     * Get the name of this app's shared-memory ring.
+     * @return the ring name, or NULL if the app doesn't have a ring
+     */
+    const char* getSharedRingName() const { return m_ring ? m_ring->getName() : NULL; }
+
     /**
      * Get this app's number of channels.
      * @return the number of channels
@@ -355,6 +513,11 @@ public:
      */
     bool getMeters(int ch, float& rmsIn, float& peakIn, float& rmsOut, float& peakOut);
 
+    /**
+     * Reset the peak levels for all channels, starting a new metering interval.
+     */
+    void resetMeterPeaks();
+
     /**
      * Subscribe to a parameter.
      * @param subscribers a vector of subscriber addresses to which the specified address will be added
@@ -399,6 +562,19 @@ public:
      * @return true if flagged for deletion, false otherwise
      */
     bool shouldDelete() const { return m_deleteMe; }
+
+    /**
+     * Attach the TCP socket of this app's client.
+     * Apps mirrored from a primary SAM have no socket until their client fails over to this SAM.
+     * @param socket the client's socket
+     */
+    void attachSocket(QTcpSocket* socket);
+
+    /**
+     * Query if this app's client is connected.
+     * @return true if a client socket is attached, false otherwise
+     */
+    bool isAttached() const { return m_socket != NULL; }
     
 signals:
     /**
@@ -421,6 +597,19 @@ public slots:
     
 private:
 
+    /**
+     * Hand a parameter change to SAM's notifier for delivery to this app's subscribers.
+     * @param param the SamSubscription parameter that changed
+     * @param msg the message to deliver (copied by the notifier)
+     */
+    void notify_subscribers(int param, OscMessage* msg);
+
+    /**
+     * Set the next solo status and keep SAM's number of solo'd apps up to date (from any thread).
+     * @param isSolo true if this app is to be solo'd, false otherwise
+     */
+    void set_solo_next(bool isSolo);
+
     char* m_name;               ///< the name of this app, to be used for UI displays
     int m_port;                 ///< the port (offset from default 4464) to be used for jacktrip (also serves as unique ID)
     int m_channels;             ///< number of audio channels
@@ -434,8 +623,9 @@ private:
 
     // JACK ports, etc.
     int* m_channelAssign;        ///< channel assignments (which physical output channels this app will be connected to)
-    jack_client_t* m_jackClient; ///< pointer to the parent SAM's JACK client, needed to register/unregister ports
-    jack_port_t** m_outputPorts; ///< array of JACK output ports for this app
+    SamAudioBackend* m_audio;    ///< pointer to the parent SAM's audio backend, needed to register/unregister ports
+    SamAudioPort** m_outputPorts; ///< array of JACK output ports for this app
+    int* m_poolIndex;            ///< index in SAM's port pool of each output port (-1 if registered by this app)
     
     // control parameters
     float m_volumeCurrent;  ///< current volume level in the range [0.0, 1.0]
@@ -444,8 +634,14 @@ private:
     bool m_isMutedNext;     ///< next target/requested mute status
     bool m_isSoloCurrent;   ///< current solo status
     bool m_isSoloNext;      ///< next target/requested solo status
+    QAtomicInt m_soloCounted; ///< whether this app counts toward SAM's solo count (see SOLO_RELEASED)
     int m_delayCurrent;     ///< current delay in samples
     int m_delayNext;        ///< next target/requested delay in samples
+    float m_volumeStaged;   ///< volume staged by a bulk change set
+    bool m_isMutedStaged;   ///< mute status staged by a bulk change set
+    bool m_isSoloStaged;    ///< solo status staged by a bulk change set
+    int m_delayStaged;      ///< delay staged by a bulk change set, in samples
+    int m_stagedFlags;      ///< which staged parameters are waiting to be committed
     int m_delayMax;         ///< maximum number of samples for delay
     float** m_delayBuffer;  ///< buffer for delayed samples
     int* m_delayRead;       ///< index into delay buffer for reading samples (per channel)
@@ -472,13 +668,18 @@ private:
     QVector<QTcpSocket*> m_positionSubscribersTcp; ///< TCP sockets subscribed to position changes
     QVector<QTcpSocket*> m_typeSubscribersTcp;     ///< TCP sockets subscribed to type changes
     QVector<QTcpSocket*> m_meterSubscribersTcp;    ///< TCP sockets subscribed to meter updates
+    OscMessage m_meterMsg;                         ///< reusable meter message, so metering doesn't allocate each tick
 
     // RTP-related parameters
     RtpReceiver* m_receiver;     ///< RTP receiver for this app/client
+    SharedAudioRing* m_ring;     ///< shared-memory ring for a client on the same host (NULL if not used)
     float** m_audioData;         ///< temp buffer for received audio data
     quint16 m_rtpBasePort;       ///< base RTP and RTCP port for this app/client
     quint32 m_packetQueueSize;   ///< packet queue size
     qint32 m_clockSkewThreshold; ///< number of samples of clock skew required before compensation
+
+    // For recording
+    SamRecorder* volatile m_recorder; ///< recorder for received audio (NULL if not recording)
     
     // For OSC
     QTcpSocket* m_socket;       ///< TCP socket for sending and listening to OSC messages to/from this app/client
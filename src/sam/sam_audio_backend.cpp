@@ -0,0 +1,581 @@
+/**
+ * @file sam_audio_backend.cpp
+ * SAM audio backend implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "sam_audio_backend.h"
+#include "jack_util.h"
+
+namespace sam
+{
+
+static const qint64 NANOS_PER_SECOND = 1000000000LL;
+
+/**
+ * A port registered with a VirtualAudioBackend (JACK ports are used directly as SamAudioPort handles).
+ */
+class SamAudioPort
+{
+public:
+    QByteArray name;    ///< full port name ("client:port")
+    float* buffer;      ///< one period of audio
+    bool physical;      ///< true for playback ports, which sum the ports connected to them
+};
+
+// ------------------- SamAudioBackend implementation -------------------
+
+SamAudioBackend::SamAudioBackend(int sampleRate, int bufferSize) :
+    m_sampleRate(sampleRate),
+    m_bufferSize(bufferSize),
+    m_processCallback(NULL),
+    m_xrunCallback(NULL),
+    m_shutdownCallback(NULL),
+    m_callbackArg(NULL)
+{
+}
+
+SamAudioBackend::~SamAudioBackend()
+{
+}
+
+void SamAudioBackend::setCallbacks(SamProcessCallback process, SamXrunCallback xrun, SamShutdownCallback shutdown, void* arg)
+{
+    m_processCallback = process;
+    m_xrunCallback = xrun;
+    m_shutdownCallback = shutdown;
+    m_callbackArg = arg;
+}
+
+// ------------------- JackAudioBackend implementation -------------------
+
+JackAudioBackend::JackAudioBackend(int sampleRate, int bufferSize, int outChannels, const char* driver, const char* clientName) :
+    SamAudioBackend(sampleRate, bufferSize),
+    m_client(NULL),
+    m_jackPID(-1),
+    m_outChannels(outChannels),
+    m_driver(driver),
+    m_clientName(clientName)
+{
+}
+
+JackAudioBackend::~JackAudioBackend()
+{
+    close();
+}
+
+bool JackAudioBackend::open()
+{
+    // check for an already-running JACK server
+    if (JackServerIsRunning())
+    {
+        qWarning("*An instance of the JACK server (jackd or jackdmp) is already running.  SAM will try to use it.");
+    }
+    else
+    {
+        // start jackd
+        m_jackPID = StartJack(m_sampleRate, m_bufferSize, m_outChannels, m_driver.constData());
+        if (m_jackPID < 0)
+        {
+            qWarning("Couldn't start JACK server process");
+            return false;
+        }
+        qDebug("Successfully started the JACK server with PID %d\n", m_jackPID);
+    }
+
+    // open a client connection to the JACK server
+    jack_status_t status;
+    m_client = jack_client_open(m_clientName.constData(), JackNullOption, &status);
+    if (m_client == NULL)
+    {
+        qWarning("JackAudioBackend::open(): jack_client_open() failed, status = 0x%2.0x", status);
+        if (status & JackServerFailed)
+        {
+            qWarning("JackAudioBackend::open(): Unable to connect to JACK server");
+        }
+        return false;
+    }
+    if (status & JackServerStarted)
+    {
+        qWarning("JackAudioBackend::open(): had to start new JACK server");
+    }
+    if (status & JackNameNotUnique)
+    {
+        const char *client_name = jack_get_client_name(m_client);
+        qWarning("JackAudioBackend::open(): unique client name `%s' assigned", client_name);
+    }
+
+    // verify that JACK is running at correct sample rate and buffer size
+    jack_nframes_t bufferSize = jack_get_buffer_size(m_client);
+    jack_nframes_t sampleRate = jack_get_sample_rate(m_client);
+    if (bufferSize != (unsigned int)m_bufferSize)
+    {
+        qWarning("Expected JACK running with buffer size %d, but actual buffer size is %d", m_bufferSize, bufferSize);
+        return false;
+    }
+    if (sampleRate != (unsigned int)m_sampleRate)
+    {
+        qWarning("Expected JACK running with sample rate %d, but actual sample rate is %d", m_sampleRate, sampleRate);
+        return false;
+    }
+    return true;
+}
+
+bool JackAudioBackend::activate()
+{
+    if (!m_client) return false;
+
+    // register jack callbacks
+    jack_set_buffer_size_callback(m_client, JackAudioBackend::jack_buffer_size_changed, this);
+    jack_set_process_callback(m_client, m_processCallback, m_callbackArg);
+    jack_set_sample_rate_callback(m_client, JackAudioBackend::jack_sample_rate_changed, this);
+    jack_set_xrun_callback(m_client, m_xrunCallback, m_callbackArg);
+    jack_on_shutdown(m_client, m_shutdownCallback, m_callbackArg);
+
+    // activate client (starts processing)
+    if (jack_activate(m_client) != 0)
+    {
+        qWarning("Couldn't activate JACK client");
+        return false;
+    }
+    return true;
+}
+
+bool JackAudioBackend::close()
+{
+    bool success = true;
+    if (m_client != NULL)
+    {
+        // close this client
+        if (jack_client_close(m_client) == 0)
+        {
+            m_client = NULL;
+        }
+        else
+        {
+            qWarning("JackAudioBackend::close couldn't close jack client");
+            success = false;
+        }
+    }
+
+    if (m_jackPID >= 0)
+    {
+        if (StopJack(m_jackPID)) m_jackPID = -1; // TODO: handle error case
+        else success = false;
+    }
+    return success;
+}
+
+SamAudioPort* JackAudioBackend::registerOutputPort(const char* name)
+{
+    if (!m_client) return NULL;
+    return reinterpret_cast<SamAudioPort*>(jack_port_register(m_client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0));
+}
+
+bool JackAudioBackend::unregisterPort(SamAudioPort* port)
+{
+    if (!m_client || !port) return false;
+    return jack_port_unregister(m_client, reinterpret_cast<jack_port_t*>(port)) == 0;
+}
+
+float* JackAudioBackend::getPortBuffer(SamAudioPort* port, jack_nframes_t nframes)
+{
+    return (float*)jack_port_get_buffer(reinterpret_cast<jack_port_t*>(port), nframes);
+}
+
+const char* JackAudioBackend::getPortName(SamAudioPort* port)
+{
+    return jack_port_name(reinterpret_cast<jack_port_t*>(port));
+}
+
+QStringList JackAudioBackend::getPorts(const char* pattern, bool inputsOnly)
+{
+    QStringList names;
+    if (!m_client) return names;
+
+    const char** ports = jack_get_ports(m_client, pattern, NULL, inputsOnly ? JackPortIsInput : 0);
+    if (!ports) return names;
+    for (const char** current = ports; *current != NULL; current++)
+    {
+        names.append(QString(*current));
+    }
+    jack_free(ports);
+    return names;
+}
+
+QStringList JackAudioBackend::getConnections(const char* portName)
+{
+    QStringList names;
+    if (!m_client) return names;
+
+    jack_port_t* port = jack_port_by_name(m_client, portName);
+    if (!port)
+    {
+        qWarning("Couldn't get JACK port by name %s", portName);
+        return names;
+    }
+    const char** connections = jack_port_get_connections(port);
+    if (!connections) return names;
+    for (const char** current = connections; *current != NULL; current++)
+    {
+        names.append(QString(*current));
+    }
+    jack_free(connections);
+    return names;
+}
+
+int JackAudioBackend::connectPorts(const char* source, const char* destination)
+{
+    if (!m_client) return -1;
+    return jack_connect(m_client, source, destination);
+}
+
+bool JackAudioBackend::disconnectPorts(const char* source, const char* destination)
+{
+    if (!m_client) return false;
+    return jack_disconnect(m_client, source, destination) == 0;
+}
+
+int JackAudioBackend::jack_buffer_size_changed(jack_nframes_t nframes, void*)
+{
+    qWarning("WARNING: JACK buffer size changed to %d/sec", nframes);
+    return 0;
+}
+
+int JackAudioBackend::jack_sample_rate_changed(jack_nframes_t nframes, void*)
+{
+    qWarning("WARNING: JACK sample rate changed to %d/sec", nframes);
+    return 0;
+}
+
+// ------------------- VirtualAudioBackend implementation -------------------
+
+VirtualAudioBackend::VirtualAudioBackend(int sampleRate, int bufferSize, bool realtime) :
+    SamAudioBackend(sampleRate, bufferSize),
+    m_realtime(realtime),
+    m_shouldQuit(false),
+    m_active(false),
+    m_frameTime(0),
+    m_periods(0),
+    m_startNanos(0)
+{
+}
+
+VirtualAudioBackend::~VirtualAudioBackend()
+{
+    close();
+
+    for (int i = 0; i < m_ports.size(); i++)
+    {
+        delete[] m_ports[i]->buffer;
+        delete m_ports[i];
+    }
+    m_ports.clear();
+}
+
+void VirtualAudioBackend::addPhysicalPorts(const char* clientName, const char* portBase, int count)
+{
+    QMutexLocker locker(&m_graphMutex);
+    for (int n = 1; n <= count; n++)
+    {
+        QByteArray name = QByteArray(clientName) + ":" + portBase + QByteArray::number(n);
+        bool exists = false;
+        for (int i = 0; i < m_ports.size() && !exists; i++)
+        {
+            exists = (m_ports[i]->name == name);
+        }
+        if (exists) continue;
+
+        SamAudioPort* port = new SamAudioPort;
+        port->name = name;
+        port->buffer = new float[m_bufferSize];
+        memset(port->buffer, 0, m_bufferSize * sizeof(float));
+        port->physical = true;
+        m_ports.append(port);
+    }
+}
+
+bool VirtualAudioBackend::open()
+{
+    return true;
+}
+
+bool VirtualAudioBackend::activate()
+{
+    if (m_active || !m_realtime) return true; // an offline clock only advances with runPeriods()
+
+    m_shouldQuit = false;
+    m_active = true;
+    m_startNanos = now_nanos();
+    start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+bool VirtualAudioBackend::close()
+{
+    if (!m_active) return true;
+
+    m_shouldQuit = true;
+    wait();
+    m_active = false;
+    return true;
+}
+
+bool VirtualAudioBackend::runPeriods(int periods)
+{
+    if (m_active) return false;
+
+    for (int i = 0; i < periods; i++)
+    {
+        if (!process_period()) return false;
+    }
+    return true;
+}
+
+void VirtualAudioBackend::run()
+{
+    quint64 nextTick = 0;
+    while (!m_shouldQuit)
+    {
+        if (!process_period())
+        {
+            // as with JACK, a failed process callback stops processing
+            qDebug("VirtualAudioBackend::run() process callback returned non-zero, stopping");
+            break;
+        }
+
+        // pace the clock to real time against absolute deadlines, so sleep overshoot doesn't accumulate
+        nextTick += m_bufferSize;
+        qint64 elapsedNanos = now_nanos() - m_startNanos;
+        quint64 elapsedSamples = (elapsedNanos / NANOS_PER_SECOND) * m_sampleRate + (elapsedNanos % NANOS_PER_SECOND) * m_sampleRate / NANOS_PER_SECOND;
+        if (elapsedSamples >= nextTick + m_bufferSize)
+        {
+            // more than a period late: skip the missed periods, as a sound card would
+            if (m_xrunCallback) m_xrunCallback(m_callbackArg);
+            quint64 missed = (elapsedSamples - nextTick) / m_bufferSize;
+            nextTick += missed * m_bufferSize;
+            m_frameTime.fetchAndAddOrdered((int)(missed * m_bufferSize));
+            continue;
+        }
+
+        sleep_until(m_startNanos + tick_nanos(nextTick));
+    }
+
+    qDebug("VirtualAudioBackend::run finished");
+}
+
+bool VirtualAudioBackend::process_period()
+{
+    // the frame time stays at the start of the current period until the next one starts
+    if (m_periods > 0) m_frameTime.fetchAndAddOrdered(m_bufferSize);
+
+    bool success = true;
+    if (m_processCallback)
+    {
+        success = (m_processCallback(m_bufferSize, m_callbackArg) == 0);
+    }
+
+    // sum connected outputs into the physical ports
+    m_graphMutex.lock();
+    for (int i = 0; i < m_ports.size(); i++)
+    {
+        if (m_ports[i]->physical) memset(m_ports[i]->buffer, 0, m_bufferSize * sizeof(float));
+    }
+    for (int i = 0; i < m_connections.size(); i++)
+    {
+        const float* in = m_connections[i].first->buffer;
+        float* out = m_connections[i].second->buffer;
+        for (int n = 0; n < m_bufferSize; n++)
+        {
+            out[n] += in[n];
+        }
+    }
+    m_graphMutex.unlock();
+
+    m_periods++;
+    return success;
+}
+
+jack_nframes_t VirtualAudioBackend::getFrameTime()
+{
+    jack_nframes_t frameTime = (jack_nframes_t)m_frameTime.fetchAndAddOrdered(0);
+    if (!m_realtime || !m_active) return frameTime;
+
+    // frames elapsed since the start of the current period, estimated from the real-time clock
+    qint64 elapsedNanos = now_nanos() - m_startNanos;
+    quint64 elapsedSamples = (elapsedNanos / NANOS_PER_SECOND) * m_sampleRate + (elapsedNanos % NANOS_PER_SECOND) * m_sampleRate / NANOS_PER_SECOND;
+    jack_nframes_t offset = elapsedSamples % m_bufferSize;
+    return frameTime + offset;
+}
+
+qint64 VirtualAudioBackend::tick_nanos(quint64 tick) const
+{
+    // split into whole seconds and a remainder so the multiplication can't overflow
+    return (qint64)(tick / m_sampleRate) * NANOS_PER_SECOND + (qint64)((tick % m_sampleRate) * NANOS_PER_SECOND / m_sampleRate);
+}
+
+void VirtualAudioBackend::sleep_until(qint64 deadlineNanos)
+{
+#if defined __APPLE__
+    // no clock_nanosleep: sleep for the remaining time instead
+    qint64 remaining = deadlineNanos - now_nanos();
+    if (remaining <= 0) return;
+    timespec ts;
+    ts.tv_sec = remaining / NANOS_PER_SECOND;
+    ts.tv_nsec = remaining % NANOS_PER_SECOND;
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR && !m_shouldQuit) {}
+#else
+    timespec ts;
+    ts.tv_sec = deadlineNanos / NANOS_PER_SECOND;
+    ts.tv_nsec = deadlineNanos % NANOS_PER_SECOND;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !m_shouldQuit) {}
+#endif
+}
+
+qint64 VirtualAudioBackend::now_nanos()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (qint64)ts.tv_sec * NANOS_PER_SECOND + ts.tv_nsec;
+}
+
+SamAudioPort* VirtualAudioBackend::registerOutputPort(const char* name)
+{
+    SamAudioPort* port = new SamAudioPort;
+    port->name = QByteArray("StreamingAudioManager:") + name;
+    port->buffer = new float[m_bufferSize];
+    memset(port->buffer, 0, m_bufferSize * sizeof(float));
+    port->physical = false;
+
+    QMutexLocker locker(&m_graphMutex);
+    m_ports.append(port);
+    return port;
+}
+
+bool VirtualAudioBackend::unregisterPort(SamAudioPort* port)
+{
+    QMutexLocker locker(&m_graphMutex);
+    if (!m_ports.removeOne(port)) return false;
+
+    for (int i = m_connections.size() - 1; i >= 0; i--)
+    {
+        if (m_connections[i].first == port) m_connections.removeAt(i);
+    }
+    locker.unlock();
+
+    delete[] port->buffer;
+    delete port;
+    return true;
+}
+
+float* VirtualAudioBackend::getPortBuffer(SamAudioPort* port, jack_nframes_t)
+{
+    return port->buffer;
+}
+
+const char* VirtualAudioBackend::getPortName(SamAudioPort* port)
+{
+    return port->name.constData();
+}
+
+SamAudioPort* VirtualAudioBackend::getPortByName(const char* name)
+{
+    QMutexLocker locker(&m_graphMutex);
+    for (int i = 0; i < m_ports.size(); i++)
+    {
+        if (m_ports[i]->name == name) return m_ports[i];
+    }
+    return NULL;
+}
+
+QStringList VirtualAudioBackend::getPorts(const char* pattern, bool inputsOnly)
+{
+    QStringList names;
+    QMutexLocker locker(&m_graphMutex);
+    for (int i = 0; i < m_ports.size(); i++)
+    {
+        if (inputsOnly && !m_ports[i]->physical) continue;
+        if (pattern && !m_ports[i]->name.contains(pattern)) continue;
+        names.append(QString(m_ports[i]->name));
+    }
+    return names;
+}
+
+QStringList VirtualAudioBackend::getConnections(const char* portName)
+{
+    QStringList names;
+    QMutexLocker locker(&m_graphMutex);
+    for (int i = 0; i < m_connections.size(); i++)
+    {
+        if (m_connections[i].first->name == portName) names.append(QString(m_connections[i].second->name));
+        else if (m_connections[i].second->name == portName) names.append(QString(m_connections[i].first->name));
+    }
+    return names;
+}
+
+int VirtualAudioBackend::connectPorts(const char* source, const char* destination)
+{
+    SamAudioPort* src = getPortByName(source);
+    SamAudioPort* dst = getPortByName(destination);
+    if (!src || !dst || src->physical || !dst->physical) return -1;
+
+    QMutexLocker locker(&m_graphMutex);
+    QPair<SamAudioPort*, SamAudioPort*> connection(src, dst);
+    if (m_connections.contains(connection)) return EEXIST;
+    m_connections.append(connection);
+    return 0;
+}
+
+bool VirtualAudioBackend::disconnectPorts(const char* source, const char* destination)
+{
+    SamAudioPort* src = getPortByName(source);
+    SamAudioPort* dst = getPortByName(destination);
+    if (!src || !dst) return false;
+
+    QMutexLocker locker(&m_graphMutex);
+    return m_connections.removeOne(QPair<SamAudioPort*, SamAudioPort*>(src, dst));
+}
+
+} // end of namespace sam
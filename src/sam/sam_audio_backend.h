@@ -0,0 +1,435 @@
+/**
+ * @file sam_audio_backend.h
+ * SAM audio backend interface
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef SAM_AUDIO_BACKEND_H
+#define SAM_AUDIO_BACKEND_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QStringList>
+#include <QThread>
+
+#include "jack/jack.h"
+
+namespace sam
+{
+
+/**
+ * @typedef SamProcessCallback
+ * Prototype for the audio process callback (same signature as JACK's process callback).
+ * IMPORTANT: the code in this function must be suitable for real-time execution.
+ * @param nframes the number of sample frames to process
+ * @param arg pointer to client-supplied data
+ * @return 0 on success, non-zero on failure
+ */
+typedef int (*SamProcessCallback)(jack_nframes_t nframes, void* arg);
+
+/**
+ * @typedef SamXrunCallback
+ * Prototype for the xrun callback (same signature as JACK's xrun callback).
+ * @param arg pointer to client-supplied data
+ * @return 0 on success, non-zero on failure
+ */
+typedef int (*SamXrunCallback)(void* arg);
+
+/**
+ * @typedef SamShutdownCallback
+ * Prototype for the shutdown callback (same signature as JACK's shutdown callback).
+ * @param arg pointer to client-supplied data
+ */
+typedef void (*SamShutdownCallback)(void* arg);
+
+/**
+ * @class SamAudioPort
+ * Opaque handle to an audio port registered with a SamAudioBackend.
+ */
+class SamAudioPort;
+
+/**
+ * @class SamAudioBackend
+ * @author agent
+ * @date October 2026
+ *
+ * This is a virtual base class/abstraction of the audio engine that drives SAM: it provides the
+ * period clock, output ports and port connections.
+ */
+class SamAudioBackend
+{
+public:
+    /**
+     * SamAudioBackend constructor.
+     * @param sampleRate sampling rate the backend will run at
+     * @param bufferSize number of samples per period
+     */
+    SamAudioBackend(int sampleRate, int bufferSize);
+
+    /**
+     * SamAudioBackend destructor.
+     */
+    virtual ~SamAudioBackend();
+
+    /**
+     * Open the backend (e.g. start and connect to the audio server).
+     * @return true on success, false on failure
+     */
+    virtual bool open() = 0;
+
+    /**
+     * Start calling the process callback once per period.
+     * @return true on success, false on failure
+     */
+    virtual bool activate() = 0;
+
+    /**
+     * Stop processing and close the backend.
+     * @return true on success, false on failure
+     */
+    virtual bool close() = 0;
+
+    /**
+     * Set the backend callbacks.  Must be called before activate().
+     * @param process called once per period in the audio thread
+     * @param xrun called when a period was missed
+     * @param shutdown called if the backend shuts down on its own
+     * @param arg passed to each callback
+     */
+    void setCallbacks(SamProcessCallback process, SamXrunCallback xrun, SamShutdownCallback shutdown, void* arg);
+
+    /**
+     * Get the backend's name for display.
+     * @return the backend name
+     */
+    virtual const char* getName() const = 0;
+
+    /**
+     * Get the sample rate.
+     * @return the sample rate
+     */
+    int getSampleRate() const { return m_sampleRate; }
+
+    /**
+     * Get the period (buffer) size.
+     * @return the number of samples per period
+     */
+    int getBufferSize() const { return m_bufferSize; }
+
+    /**
+     * Get an estimate of the current time in frames (can be called from any thread).
+     * @return the current frame time
+     */
+    virtual jack_nframes_t getFrameTime() = 0;
+
+    /**
+     * Get the frame time at the start of the current period.
+     * @return the frame time at the start of the current period
+     */
+    virtual jack_nframes_t getLastFrameTime() = 0;
+
+    /**
+     * Register an output audio port.
+     * @param name the short name of the port
+     * @return the port, or NULL on failure
+     */
+    virtual SamAudioPort* registerOutputPort(const char* name) = 0;
+
+    /**
+     * Unregister a port.
+     * @param port the port to unregister
+     * @return true on success, false on failure
+     */
+    virtual bool unregisterPort(SamAudioPort* port) = 0;
+
+    /**
+     * Get a port's buffer for the current period (audio thread only).
+     * @param port the port
+     * @param nframes the number of frames in the period
+     * @return the port's buffer
+     */
+    virtual float* getPortBuffer(SamAudioPort* port, jack_nframes_t nframes) = 0;
+
+    /**
+     * Get a port's full name ("client:port").
+     * @param port the port
+     * @return the port's full name
+     */
+    virtual const char* getPortName(SamAudioPort* port) = 0;
+
+    /**
+     * Get the full names of the ports matching a name pattern.
+     * @param pattern the name pattern to match (e.g. a client name)
+     * @param inputsOnly true to only include input (playback) ports
+     * @return the names of the matching ports
+     */
+    virtual QStringList getPorts(const char* pattern, bool inputsOnly) = 0;
+
+    /**
+     * Get the full names of the ports a port is connected to.
+     * @param portName the port's full name
+     * @return the names of the connected ports
+     */
+    virtual QStringList getConnections(const char* portName) = 0;
+
+    /**
+     * Connect two ports.
+     * @param source the full name of the output port
+     * @param destination the full name of the input port
+     * @return 0 on success, EEXIST if already connected, otherwise non-zero on failure
+     */
+    virtual int connectPorts(const char* source, const char* destination) = 0;
+
+    /**
+     * Disconnect two ports.
+     * @param source the full name of the output port
+     * @param destination the full name of the input port
+     * @return true on success, false on failure
+     */
+    virtual bool disconnectPorts(const char* source, const char* destination) = 0;
+
+protected:
+    int m_sampleRate;                       ///< sampling rate
+    int m_bufferSize;                       ///< samples per period
+
+    SamProcessCallback m_processCallback;   ///< process callback
+    SamXrunCallback m_xrunCallback;         ///< xrun callback
+    SamShutdownCallback m_shutdownCallback; ///< shutdown callback
+    void* m_callbackArg;                    ///< user-supplied data for callbacks
+};
+
+/**
+ * @class JackAudioBackend
+ * @author agent
+ * @date October 2026
+ *
+ * This SamAudioBackend encapsulates a JACK Audio Connection Kit client, starting the JACK server if necessary.
+ */
+class JackAudioBackend : public SamAudioBackend
+{
+public:
+    /**
+     * JackAudioBackend constructor.
+     * @param sampleRate sampling rate JACK must run at
+     * @param bufferSize JACK period size
+     * @param outChannels max number of output channels (if starting the JACK server)
+     * @param driver driver for the JACK server to use (if starting the JACK server)
+     * @param clientName desired JACK client name
+     */
+    JackAudioBackend(int sampleRate, int bufferSize, int outChannels, const char* driver, const char* clientName);
+
+    /**
+     * JackAudioBackend destructor.
+     */
+    virtual ~JackAudioBackend();
+
+    /**
+     * Copy constructor (not used).
+     */
+    JackAudioBackend(const JackAudioBackend&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    JackAudioBackend& operator=(const JackAudioBackend&);
+
+    // SamAudioBackend interface
+    virtual bool open();
+    virtual bool activate();
+    virtual bool close();
+    virtual const char* getName() const { return "JACK"; }
+    virtual jack_nframes_t getFrameTime() { return jack_frame_time(m_client); }
+    virtual jack_nframes_t getLastFrameTime() { return jack_last_frame_time(m_client); }
+    virtual SamAudioPort* registerOutputPort(const char* name);
+    virtual bool unregisterPort(SamAudioPort* port);
+    virtual float* getPortBuffer(SamAudioPort* port, jack_nframes_t nframes);
+    virtual const char* getPortName(SamAudioPort* port);
+    virtual QStringList getPorts(const char* pattern, bool inputsOnly);
+    virtual QStringList getConnections(const char* portName);
+    virtual int connectPorts(const char* source, const char* destination);
+    virtual bool disconnectPorts(const char* source, const char* destination);
+
+protected:
+    /**
+     * JACK buffer size changed callback.
+     */
+    static int jack_buffer_size_changed(jack_nframes_t nframes, void*);
+
+    /**
+     * JACK sample rate changed callback.
+     */
+    static int jack_sample_rate_changed(jack_nframes_t nframes, void*);
+
+    jack_client_t* m_client;    ///< JACK client
+    pid_t m_jackPID;            ///< PID for the jackd process if we started it, otherwise -1
+    int m_outChannels;          ///< max number of output channels for a started JACK server
+    QByteArray m_driver;        ///< driver for a started JACK server
+    QByteArray m_clientName;    ///< requested JACK client name
+};
+
+/**
+ * @class VirtualAudioBackend
+ * @author agent
+ * @date October 2026
+ *
+ * This SamAudioBackend encapsulates a virtual sound card: an internal clock drives processing, and
+ * the "physical" playback ports sum whatever is connected to them.  The clock either runs in its own
+ * thread paced to real time (for running SAM headless against live clients), or only advances when
+ * runPeriods() is called (for deterministic tests and benchmarks, which can step it as fast as they like).
+ */
+class VirtualAudioBackend : public SamAudioBackend, public QThread
+{
+public:
+    /**
+     * VirtualAudioBackend constructor.
+     * @param sampleRate sampling rate the virtual clock runs at
+     * @param bufferSize samples per period
+     * @param realtime true to run a clock thread paced to real time, false to only advance the clock with runPeriods()
+     */
+    VirtualAudioBackend(int sampleRate, int bufferSize, bool realtime);
+
+    /**
+     * VirtualAudioBackend destructor.
+     */
+    virtual ~VirtualAudioBackend();
+
+    /**
+     * Copy constructor (not used).
+     */
+    VirtualAudioBackend(const VirtualAudioBackend&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    VirtualAudioBackend& operator=(const VirtualAudioBackend&);
+
+    /**
+     * Add "physical" playback ports named clientName:portBaseN for N = 1..count.
+     * @param clientName the client name (e.g. "system")
+     * @param portBase the port base name (e.g. "playback_")
+     * @param count the number of ports
+     */
+    void addPhysicalPorts(const char* clientName, const char* portBase, int count);
+
+    /**
+     * Run periods from the calling thread (only without a real-time clock thread running).
+     * @param periods the number of periods to run
+     * @return true on success, false if activated or the process callback failed
+     */
+    bool runPeriods(int periods);
+
+    /**
+     * Find a port by its full name, e.g. to read a physical port's buffer after runPeriods().
+     * @param name the port's full name
+     * @return the port, or NULL if not found
+     */
+    SamAudioPort* getPortByName(const char* name);
+
+    /**
+     * Get the number of periods processed.
+     * @return the number of periods processed
+     */
+    quint64 getPeriods() const { return m_periods; }
+
+    // SamAudioBackend interface
+    virtual bool open();
+    virtual bool activate();
+    virtual bool close();
+    virtual const char* getName() const { return m_realtime ? "virtual" : "offline"; }
+    virtual jack_nframes_t getFrameTime();
+    virtual jack_nframes_t getLastFrameTime() { return (jack_nframes_t)m_frameTime.fetchAndAddOrdered(0); }
+    virtual SamAudioPort* registerOutputPort(const char* name);
+    virtual bool unregisterPort(SamAudioPort* port);
+    virtual float* getPortBuffer(SamAudioPort* port, jack_nframes_t nframes);
+    virtual const char* getPortName(SamAudioPort* port);
+    virtual QStringList getPorts(const char* pattern, bool inputsOnly);
+    virtual QStringList getConnections(const char* portName);
+    virtual int connectPorts(const char* source, const char* destination);
+    virtual bool disconnectPorts(const char* source, const char* destination);
+
+protected:
+    /**
+     * Run the clock thread.
+     */
+    virtual void run();
+
+    /**
+     * Process one period: call the process callback, then sum connected ports into the physical ports.
+     * @return true on success, false if the process callback failed
+     */
+    bool process_period();
+
+    /**
+     * Convert a tick (sample count since the clock started) to nanoseconds.
+     * @param tick the tick
+     * @return the time of the tick in nanoseconds since the clock started
+     */
+    qint64 tick_nanos(quint64 tick) const;
+
+    /**
+     * Sleep until an absolute deadline on the monotonic clock.
+     * @param deadlineNanos the time to wake up, in nanoseconds
+     */
+    void sleep_until(qint64 deadlineNanos);
+
+    /**
+     * Get the current monotonic clock time.
+     * @return the current time in nanoseconds
+     */
+    static qint64 now_nanos();
+
+    bool m_realtime;                        ///< flag: true to run a clock thread paced to real time
+    volatile bool m_shouldQuit;             ///< flag: true if the clock thread should stop running
+    bool m_active;                          ///< flag: true if the clock thread is running
+    QAtomicInt m_frameTime;                 ///< frame time at the start of the current period (a jack_nframes_t, written by the clock thread)
+    quint64 m_periods;                      ///< number of periods processed
+    qint64 m_startNanos;                    ///< monotonic clock time when the clock thread started, in nanoseconds (realtime mode)
+
+    QList<SamAudioPort*> m_ports;           ///< all registered and physical ports
+    QList<QPair<SamAudioPort*, SamAudioPort*> > m_connections; ///< connections from output ports to physical ports
+    QMutex m_graphMutex;                    ///< mutex protecting ports and connections
+};
+
+} // end of namespace sam
+
+#endif // SAM_AUDIO_BACKEND_H
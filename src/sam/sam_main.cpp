@@ -74,6 +74,7 @@ void print_help()
     printf("[--samplerate or -r sample rate]\n");
     printf("[--period or -p period (buffer size)]\n");
     printf("[--driver or -d driver to use for JACK (ie coreaudio, alsa, etc.)]\n");
+    printf("[--backend or -b audio backend: jack, virtual (no audio hardware or jackd) or offline (clock stepped by a test harness)]\n");
     printf("[--oscport or -o OSC port]\n");
     printf("[--jtport or -j base JackTrip port]\n");
     printf("[--maxout or -m max number of output channels to use]\n");
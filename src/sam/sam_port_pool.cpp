@@ -0,0 +1,251 @@
+/**
+ * @file sam_port_pool.cpp
+ * SamPortPool implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <QDebug>
+
+#include "sam_audio_backend.h"
+#include "sam_port_pool.h"
+
+namespace sam
+{
+
+static const int MAX_PORT_NAME = 32;
+
+SamPortPool::SamPortPool(SamAudioBackend* audio) :
+    m_audio(audio),
+    m_size(0),
+    m_ports(NULL),
+    m_destinations(NULL),
+    m_freePos(NULL),
+    m_destinationPos(NULL),
+    m_idle(NULL),
+    m_reconnects(0)
+{
+}
+
+SamPortPool::~SamPortPool()
+{
+    if (m_ports)
+    {
+        // unregistering also disconnects the ports
+        for (int i = 0; i < m_size; i++)
+        {
+            if (m_ports[i]) m_audio->unregisterPort(m_ports[i]);
+        }
+        delete[] m_ports;
+        m_ports = NULL;
+    }
+
+    delete[] m_destinations;
+    m_destinations = NULL;
+    delete[] m_freePos;
+    m_freePos = NULL;
+    delete[] m_destinationPos;
+    m_destinationPos = NULL;
+    delete[] m_idle;
+    m_idle = NULL;
+}
+
+bool SamPortPool::init(int size)
+{
+    if (m_ports || !m_audio || size <= 0) return false;
+
+    m_ports = new SamAudioPort*[size];
+    m_destinations = new QByteArray[size];
+    m_freePos = new int[size];
+    m_destinationPos = new int[size];
+    m_idle = new QAtomicInt[size];
+    m_free.reserve(size);
+    m_size = size;
+    for (int i = 0; i < size; i++)
+    {
+        m_ports[i] = NULL;
+        m_freePos[i] = -1;
+        m_destinationPos[i] = -1;
+    }
+
+    // register ports in reverse so the lowest-numbered ports are handed out first
+    char portName[MAX_PORT_NAME];
+    for (int i = size - 1; i >= 0; i--)
+    {
+        snprintf(portName, MAX_PORT_NAME, "pool-output_%d", i + 1);
+        m_ports[i] = m_audio->registerOutputPort(portName);
+        if (!m_ports[i])
+        {
+            qWarning("SamPortPool::init couldn't register output port %d of %d", i + 1, size);
+            return false; // the destructor unregisters the ports registered so far
+        }
+        put(i);
+    }
+    return true;
+}
+
+int SamPortPool::preconnect(const QList<QByteArray>& destinations, int count)
+{
+    if (destinations.isEmpty()) return 0;
+
+    int connected = 0;
+    QHash<QByteArray, QVector<int> >::iterator unconnected = m_freeByDestination.find(QByteArray());
+    while (connected < count && unconnected != m_freeByDestination.end() && !unconnected.value().isEmpty())
+    {
+        int index = unconnected.value().last();
+        take(index);
+        bool success = route(index, destinations[connected % destinations.size()]);
+        put(index);
+        if (!success) break;
+        connected++;
+        unconnected = m_freeByDestination.find(QByteArray()); // put() may have rehashed
+    }
+    return connected;
+}
+
+int SamPortPool::acquire(const char* destination)
+{
+    QByteArray dest(destination);
+    int index = -1;
+
+    // prefer a free port that is already connected to the destination, then an unconnected one,
+    // and only then take a port away from another destination
+    QHash<QByteArray, QVector<int> >::const_iterator it = m_freeByDestination.constFind(dest);
+    if (it == m_freeByDestination.constEnd() || it.value().isEmpty())
+    {
+        it = m_freeByDestination.constFind(QByteArray());
+    }
+    if (it != m_freeByDestination.constEnd() && !it.value().isEmpty())
+    {
+        index = it.value().last();
+    }
+    else if (!m_free.isEmpty())
+    {
+        index = m_free.last();
+    }
+    if (index < 0) return -1;
+
+    take(index);
+    if (m_destinations[index] != dest && !route(index, dest))
+    {
+        put(index);
+        return -1;
+    }
+    return index;
+}
+
+void SamPortPool::release(int index)
+{
+    if (index < 0 || index >= m_size || m_freePos[index] >= 0) return;
+    put(index);
+}
+
+void SamPortPool::silenceIdle(jack_nframes_t nframes)
+{
+    for (int i = 0; i < m_size; i++)
+    {
+        if (m_idle[i].testAndSetOrdered(1, 1))
+        {
+            float* buffer = m_audio->getPortBuffer(m_ports[i], nframes);
+            if (buffer) memset(buffer, 0, nframes * sizeof(float));
+        }
+    }
+}
+
+void SamPortPool::take(int index)
+{
+    m_idle[index].fetchAndStoreOrdered(0);
+
+    // swap the last port into this port's place in each list
+    int last = m_free.last();
+    m_free[m_freePos[index]] = last;
+    m_freePos[last] = m_freePos[index];
+    m_free.removeLast();
+    m_freePos[index] = -1;
+
+    QVector<int>& sameDest = m_freeByDestination[m_destinations[index]];
+    last = sameDest.last();
+    sameDest[m_destinationPos[index]] = last;
+    m_destinationPos[last] = m_destinationPos[index];
+    sameDest.removeLast();
+    m_destinationPos[index] = -1;
+}
+
+void SamPortPool::put(int index)
+{
+    m_freePos[index] = m_free.size();
+    m_free.append(index);
+
+    QVector<int>& sameDest = m_freeByDestination[m_destinations[index]];
+    m_destinationPos[index] = sameDest.size();
+    sameDest.append(index);
+
+    m_idle[index].fetchAndStoreOrdered(m_destinations[index].isEmpty() ? 0 : 1);
+}
+
+bool SamPortPool::route(int index, const QByteArray& destination)
+{
+    const char* portName = m_audio->getPortName(m_ports[index]);
+    if (!m_destinations[index].isEmpty())
+    {
+        if (!m_audio->disconnectPorts(portName, m_destinations[index].constData()))
+        {
+            qWarning("SamPortPool::route couldn't disconnect %s from %s", portName, m_destinations[index].constData());
+        }
+        m_destinations[index].clear();
+    }
+    if (destination.isEmpty()) return true;
+
+    m_reconnects++;
+    int result = m_audio->connectPorts(portName, destination.constData());
+    if (result != 0 && result != EEXIST)
+    {
+        qWarning("SamPortPool::route couldn't connect %s to %s", portName, destination.constData());
+        return false;
+    }
+    m_destinations[index] = destination;
+    return true;
+}
+
+} // end of namespace sam
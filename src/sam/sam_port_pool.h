@@ -0,0 +1,186 @@
+/**
+ * @file sam_port_pool.h
+ * Pool of pre-registered SAM output ports
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef SAM_PORT_POOL_H
+#define SAM_PORT_POOL_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+#include "jack/jack.h"
+
+namespace sam
+{
+
+class SamAudioBackend;
+class SamAudioPort;
+
+/**
+ * @class SamPortPool
+ * @author agent
+ * @date October 2026
+ *
+ * This class is a pool of output ports registered with a SamAudioBackend when SAM starts, so that apps joining
+ * and leaving don't register and unregister ports (and reorder the JACK graph) while audio is running.
+ *
+ * A port stays connected to its last destination when it is released, and acquiring a port for a destination
+ * first looks for a free port that is already connected there, so in the common case apps come and go without
+ * any connection changes at all.  Free ports are kept both on a free list and on a list per destination, with each
+ * port's position in both, so acquiring and releasing are O(1).  Free ports that are still connected are silenced
+ * by silenceIdle() every period.
+ *
+ * Apart from silenceIdle(), which is called from the audio thread, the pool must only be used from one thread.
+ */
+class SamPortPool
+{
+public:
+
+    /**
+     * SamPortPool constructor.
+     * @param audio the audio backend to register ports with
+     */
+    SamPortPool(SamAudioBackend* audio);
+
+    /**
+     * SamPortPool destructor.
+     * Unregisters all ports.
+     */
+    ~SamPortPool();
+
+    /**
+     * Copy constructor (not used).
+     */
+    SamPortPool(const SamPortPool&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    SamPortPool& operator=(const SamPortPool&);
+
+    /**
+     * Register the pool's ports.
+     * Should be called before the backend is activated, so registering doesn't disturb running audio.
+     * @param size the number of ports
+     * @return true on success, false on failure
+     */
+    bool init(int size);
+
+    /**
+     * Connect free, unconnected ports to destinations ahead of time, cycling through the destinations.
+     * @param destinations the full names of the input ports to connect to
+     * @param count the maximum number of ports to connect
+     * @return the number of ports connected
+     */
+    int preconnect(const QList<QByteArray>& destinations, int count);
+
+    /**
+     * Take a free port and make sure it is connected to (only) a destination.
+     * @param destination the full name of the input port to connect to
+     * @return the index of the port, or -1 if no port is free or the port couldn't be connected
+     */
+    int acquire(const char* destination);
+
+    /**
+     * Return a port to the pool.  The port stays connected to its destination.
+     * @param index the index of the port
+     */
+    void release(int index);
+
+    /**
+     * Write silence to the free ports that are still connected (audio thread only).
+     * @param nframes the number of frames in the period
+     */
+    void silenceIdle(jack_nframes_t nframes);
+
+    /**
+     * Get a port.
+     * @param index the index of the port
+     * @return the port, or NULL if the index is invalid
+     */
+    SamAudioPort* getPort(int index) const { return (index >= 0 && index < m_size) ? m_ports[index] : NULL; }
+
+    int getSize() const { return m_size; }                  ///< @return the number of ports in the pool
+    int getNumFree() const { return m_free.size(); }        ///< @return the number of free ports
+    quint64 getReconnects() const { return m_reconnects; }  ///< @return the number of times a port had to be (re)connected
+
+protected:
+
+    /**
+     * Remove a port from the free lists.
+     * @param index the index of the port
+     */
+    void take(int index);
+
+    /**
+     * Add a port to the free lists.
+     * @param index the index of the port
+     */
+    void put(int index);
+
+    /**
+     * Change the destination a port is connected to.
+     * @param index the index of the port
+     * @param destination the full name of the input port to connect to (empty to leave it unconnected)
+     * @return true on success, false on failure (the port is left unconnected)
+     */
+    bool route(int index, const QByteArray& destination);
+
+    SamAudioBackend* m_audio;           ///< audio backend the ports are registered with
+    int m_size;                         ///< number of ports
+    SamAudioPort** m_ports;             ///< the ports
+    QByteArray* m_destinations;         ///< full name of the input port each port is connected to (empty if none)
+    QVector<int> m_free;                ///< free ports, most recently released last
+    int* m_freePos;                     ///< position of each port in m_free (-1 if in use)
+    QHash<QByteArray, QVector<int> > m_freeByDestination; ///< free ports by the destination they are connected to
+    int* m_destinationPos;              ///< position of each port in its m_freeByDestination list (-1 if in use)
+    QAtomicInt* m_idle;                 ///< per port: 1 while free and connected, so the audio thread silences it
+    quint64 m_reconnects;               ///< number of times a port had to be (re)connected
+};
+
+} // end of namespace sam
+
+#endif // SAM_PORT_POOL_H
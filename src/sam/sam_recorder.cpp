@@ -0,0 +1,294 @@
+/**
+ * @file sam_recorder.cpp
+ * SAM disk recorder implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sam_recorder.h"
+
+namespace sam
+{
+
+static const int RING_SECONDS = 4;                  // seconds of audio the ring can hold while the disk is busy
+static const int WRITE_BLOCK_BYTES = 1 << 20;       // maximum bytes written to the file at once
+static const int WRITER_SLEEP_MILLIS = 20;          // how long the writer thread sleeps when the ring is empty
+static const int HEADER_BYTES = 80;                 // RIFF + JUNK/ds64 + fmt + data chunk headers
+static const quint16 WAVE_FORMAT_IEEE_FLOAT = 3;
+static const quint64 MAX_RIFF_SIZE = 0xFFFFFFFFULL;
+
+/**
+ * Append a little-endian integer to a header.
+ * @param header the header
+ * @param val the value
+ * @param bytes the size of the value in bytes
+ */
+static void append_le(QByteArray& header, quint64 val, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        header.append((char)((val >> (8 * i)) & 0xFF));
+    }
+}
+
+SamRecorder::SamRecorder(const QString& path, int channels, int sampleRate, int bufferSize) :
+    QThread(),
+    m_path(path),
+    m_channels(channels),
+    m_sampleRate(sampleRate),
+    m_bufferSize(bufferSize),
+    m_file(path),
+    m_ring(NULL),
+    m_interleaved(NULL),
+    m_writeBuffer(NULL),
+    m_framesWritten(0),
+    m_framesDropped(0),
+    m_framesUnwritten(0),
+    m_writeFailed(false),
+    m_stopRequested(false)
+{
+}
+
+SamRecorder::~SamRecorder()
+{
+    if (isRunning())
+    {
+        m_stopRequested = true;
+        wait();
+    }
+
+    if (m_file.isOpen())
+    {
+        // write what's left in the ring, then fix up the header now that the length is known
+        while (drain() > 0) {}
+        if (m_writeFailed)
+        {
+            // what's left in the ring is lost, and a partly written frame is cut off so the file matches the header
+            m_framesUnwritten += jack_ringbuffer_read_space(m_ring) / (m_channels * sizeof(float));
+            m_file.resize(HEADER_BYTES + m_framesWritten * m_channels * sizeof(float));
+        }
+        if (!write_header())
+        {
+            qWarning("SamRecorder::~SamRecorder couldn't finish writing header");
+        }
+        m_file.close();
+
+        QByteArray pathBytes = m_path.toLocal8Bit();
+        printf("Finished recording %s: %llu frames", pathBytes.constData(), (unsigned long long)m_framesWritten);
+        if (m_framesDropped > 0)
+        {
+            printf(", %llu frames DROPPED (disk too slow)", (unsigned long long)m_framesDropped);
+        }
+        if (m_framesUnwritten > 0)
+        {
+            printf(", %llu frames DROPPED (write error)", (unsigned long long)m_framesUnwritten);
+        }
+        printf("\n");
+    }
+
+    if (m_ring)
+    {
+        jack_ringbuffer_free(m_ring);
+        m_ring = NULL;
+    }
+
+    if (m_interleaved)
+    {
+        delete[] m_interleaved;
+        m_interleaved = NULL;
+    }
+
+    if (m_writeBuffer)
+    {
+        delete[] m_writeBuffer;
+        m_writeBuffer = NULL;
+    }
+}
+
+bool SamRecorder::open()
+{
+    // never overwrite (or follow a link to) an existing file
+    QByteArray pathBytes = QFile::encodeName(m_path);
+    int fd = ::open(pathBytes.constData(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        qWarning("SamRecorder::open couldn't create %s: %s", pathBytes.constData(), strerror(errno));
+        return false;
+    }
+    if (!m_file.open(fd, QIODevice::WriteOnly, QFile::AutoCloseHandle))
+    {
+        qWarning("SamRecorder::open couldn't open %s for writing", pathBytes.constData());
+        ::close(fd);
+        return false;
+    }
+    if (!write_header())
+    {
+        qWarning("SamRecorder::open couldn't write header");
+        m_file.close();
+        return false;
+    }
+
+    size_t frameBytes = m_channels * sizeof(float);
+    m_ring = jack_ringbuffer_create(RING_SECONDS * m_sampleRate * frameBytes);
+    if (!m_ring)
+    {
+        qWarning("SamRecorder::open couldn't allocate ring buffer");
+        m_file.close();
+        return false;
+    }
+    jack_ringbuffer_mlock(m_ring); // keep the JACK thread from page faulting
+
+    m_interleaved = new float[m_channels * m_bufferSize];
+    m_writeBuffer = new char[WRITE_BLOCK_BYTES];
+
+    start(QThread::LowPriority);
+    return true;
+}
+
+void SamRecorder::write(float** data, jack_nframes_t nframes)
+{
+    if ((int)nframes > m_bufferSize) return;
+
+    size_t bytes = nframes * m_channels * sizeof(float);
+    if (m_writeFailed || jack_ringbuffer_write_space(m_ring) < bytes)
+    {
+        m_framesDropped += nframes;
+        return;
+    }
+
+    float* out = m_interleaved;
+    for (unsigned int n = 0; n < nframes; n++)
+    {
+        for (int ch = 0; ch < m_channels; ch++)
+        {
+            *out++ = data[ch][n];
+        }
+    }
+    jack_ringbuffer_write(m_ring, (const char*)m_interleaved, bytes);
+}
+
+void SamRecorder::run()
+{
+    while (!m_stopRequested && !m_writeFailed)
+    {
+        if (drain() == 0)
+        {
+            msleep(WRITER_SLEEP_MILLIS);
+        }
+    }
+}
+
+qint64 SamRecorder::drain()
+{
+    if (m_writeFailed) return 0;
+
+    size_t frameBytes = m_channels * sizeof(float);
+    size_t available = jack_ringbuffer_read_space(m_ring);
+    size_t bytes = (available < (size_t)WRITE_BLOCK_BYTES) ? available : WRITE_BLOCK_BYTES;
+    bytes -= bytes % frameBytes; // only write whole frames
+    if (bytes == 0) return 0;
+
+    jack_ringbuffer_read(m_ring, m_writeBuffer, bytes);
+    qint64 written = m_file.write(m_writeBuffer, bytes);
+    if (written != (qint64)bytes)
+    {
+        // e.g. the disk is full: stop recording, and only count the whole frames that made it into the file
+        QByteArray pathBytes = m_path.toLocal8Bit();
+        qWarning("SamRecorder::drain couldn't write to %s, stopping recording", pathBytes.constData());
+        quint64 framesOk = (written > 0) ? written / frameBytes : 0;
+        m_framesWritten += framesOk;
+        m_framesUnwritten += bytes / frameBytes - framesOk;
+        m_writeFailed = true;
+        return 0;
+    }
+    m_framesWritten += bytes / frameBytes;
+    return bytes;
+}
+
+bool SamRecorder::write_header()
+{
+    quint16 blockAlign = m_channels * sizeof(float);
+    quint64 dataBytes = m_framesWritten * blockAlign;
+    quint64 riffSize = HEADER_BYTES - 8 + dataBytes;
+    bool rf64 = (riffSize > MAX_RIFF_SIZE);
+
+    QByteArray header;
+    header.append(rf64 ? "RF64" : "RIFF");
+    append_le(header, rf64 ? MAX_RIFF_SIZE : riffSize, 4);
+    header.append("WAVE");
+
+    // reserve space for a ds64 chunk so the file can become RF64 without moving the audio
+    header.append(rf64 ? "ds64" : "JUNK");
+    append_le(header, 28, 4);
+    append_le(header, rf64 ? riffSize : 0, 8);
+    append_le(header, rf64 ? dataBytes : 0, 8);
+    append_le(header, rf64 ? m_framesWritten : 0, 8);
+    append_le(header, 0, 4); // no table entries
+
+    header.append("fmt ");
+    append_le(header, 16, 4);
+    append_le(header, WAVE_FORMAT_IEEE_FLOAT, 2);
+    append_le(header, m_channels, 2);
+    append_le(header, m_sampleRate, 4);
+    append_le(header, (quint64)m_sampleRate * blockAlign, 4);
+    append_le(header, blockAlign, 2);
+    append_le(header, 32, 2);
+
+    header.append("data");
+    append_le(header, rf64 ? MAX_RIFF_SIZE : dataBytes, 4);
+    Q_ASSERT(header.size() == HEADER_BYTES);
+
+    qint64 pos = m_file.pos();
+    if (!m_file.seek(0)) return false;
+    bool success = (m_file.write(header) == HEADER_BYTES);
+    if (pos > HEADER_BYTES)
+    {
+        m_file.seek(pos);
+    }
+    return success;
+}
+
+} // end of namespace sam
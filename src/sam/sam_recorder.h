@@ -0,0 +1,151 @@
+/**
+ * @file sam_recorder.h
+ * SAM disk recorder interface
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef SAM_RECORDER_H
+#define SAM_RECORDER_H
+
+#include <QFile>
+#include <QThread>
+
+#include "jack/jack.h"
+#include "jack/ringbuffer.h"
+
+namespace sam
+{
+
+/**
+ * @class SamRecorder
+ * @author agent
+ * @date October 2026
+ *
+ * A SamRecorder records multichannel audio to a 32-bit float WAV file.  The JACK thread
+ * interleaves each period into a lock-free ring buffer, and a writer thread drains the
+ * ring to disk in large blocks, so recording never blocks audio processing.  If the ring
+ * fills up (the disk can't keep up), periods are dropped and counted rather than waited on.
+ * If a write fails (e.g. the disk is full) recording stops, and the header only covers the
+ * frames that reached the file.  Files that grow beyond 4 GB are written as RF64 when the
+ * recording is finished.
+ */
+class SamRecorder : public QThread
+{
+public:
+    /**
+     * Constructor.
+     * @param path the file to record to (must not exist yet)
+     * @param channels the number of channels to record
+     * @param sampleRate the sample rate
+     * @param bufferSize the maximum number of frames written per period
+     */
+    SamRecorder(const QString& path, int channels, int sampleRate, int bufferSize);
+
+    /**
+     * Destructor.  Finishes writing any buffered audio and closes the file.
+     */
+    virtual ~SamRecorder();
+
+    /**
+     * Copy constructor (not used).
+     */
+    SamRecorder(const SamRecorder&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    SamRecorder& operator=(const SamRecorder&);
+
+    /**
+     * Create the file and start the writer thread.
+     * @return true on success, false on failure (including if the file already exists)
+     */
+    bool open();
+
+    /**
+     * Record a period of audio (JACK thread only).
+     * @param data the audio data [channels][nframes]
+     * @param nframes the number of frames
+     */
+    void write(float** data, jack_nframes_t nframes);
+
+    /**
+     * Get the number of channels being recorded.
+     * @return the number of channels
+     */
+    int getNumChannels() const { return m_channels; }
+
+protected:
+    /**
+     * Run the writer thread.
+     */
+    virtual void run();
+
+    /**
+     * Write as much buffered audio as is available to the file.
+     * @return the number of bytes written (0 once a write has failed)
+     */
+    qint64 drain();
+
+    /**
+     * Write the WAV header with the current length.
+     * @return true on success, false on failure
+     */
+    bool write_header();
+
+    QString m_path;                 ///< file being recorded to
+    int m_channels;                 ///< number of channels recorded
+    int m_sampleRate;               ///< sample rate
+    int m_bufferSize;               ///< maximum frames per period
+    QFile m_file;                   ///< output file
+    jack_ringbuffer_t* m_ring;      ///< interleaved audio waiting to be written
+    float* m_interleaved;           ///< scratch buffer for interleaving a period (JACK thread)
+    char* m_writeBuffer;            ///< block of audio being written (writer thread)
+    quint64 m_framesWritten;        ///< frames written to the file
+    volatile quint64 m_framesDropped; ///< frames dropped because the ring was full (or recording stopped) (JACK thread)
+    quint64 m_framesUnwritten;      ///< frames dropped because writing them to the file failed (writer thread)
+    volatile bool m_writeFailed;    ///< true once a write to the file has failed
+    volatile bool m_stopRequested;  ///< true when the writer thread should finish
+};
+
+} // end of namespace sam
+
+#endif // SAM_RECORDER_H
@@ -0,0 +1,282 @@
+/**
+ * @file sam_relay.cpp
+ * SAM relay implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <QDebug>
+
+#include "rtpsender.h"
+#include "sam_app.h"
+#include "sam_relay.h"
+#include "sam_shared.h"
+
+namespace sam
+{
+
+static const quint32 REPORT_INTERVAL_MILLIS = 1000;
+
+SamRelay::SamRelay(int id, int source, const char* name, int channels, const QString& host, quint16 port, int sampleRate, int bufferSize, quint8 payloadType, QObject* parent) :
+    QObject(parent),
+    m_id(id),
+    m_source(source),
+    m_name(NULL),
+    m_channels(channels),
+    m_host(host),
+    m_port(port),
+    m_sampleRate(sampleRate),
+    m_bufferSize(bufferSize),
+    m_payloadType(payloadType),
+    m_reader(NULL),
+    m_sender(NULL),
+    m_downstreamId(-1),
+    m_mix(NULL),
+    m_forwarding(false),
+    m_deleteMe(false)
+{
+    int len = strlen(name);
+    m_name = new char[len + 1];
+    strncpy(m_name, name, len + 1);
+
+    if (m_source == SOURCE_MIX)
+    {
+        m_mix = new float*[m_channels];
+        for (int ch = 0; ch < m_channels; ch++)
+        {
+            m_mix[ch] = new float[m_bufferSize];
+            memset(m_mix[ch], 0, m_bufferSize * sizeof(float));
+        }
+    }
+
+    m_reader = new OscTcpSocketReader(&m_socket);
+    connect(&m_socket, SIGNAL(readyRead()), m_reader, SLOT(readFromSocket()));
+    connect(m_reader, SIGNAL(messageReady(OscMessage*, const char*, QAbstractSocket*)), this, SLOT(handleOscMessage(OscMessage*, const char*, QAbstractSocket*)));
+    connect(&m_socket, SIGNAL(connected()), this, SLOT(handleConnected()));
+    connect(&m_socket, SIGNAL(disconnected()), this, SLOT(handleDisconnected()));
+}
+
+SamRelay::~SamRelay()
+{
+    m_forwarding = false;
+
+    // unregister with the downstream SAM
+    if (m_downstreamId >= 0 && m_socket.state() == QAbstractSocket::ConnectedState)
+    {
+        OscMessage msg;
+        msg.init("/sam/app/unregister", "i", m_downstreamId);
+        if (!OscClient::sendFromSocket(&msg, &m_socket))
+        {
+            qWarning("SamRelay::~SamRelay couldn't unregister from downstream SAM");
+        }
+        m_socket.flush();
+    }
+    m_socket.disconnect();
+    m_socket.close();
+
+    delete m_reader;
+    m_reader = NULL;
+
+    if (m_sender)
+    {
+        delete m_sender;
+        m_sender = NULL;
+    }
+
+    if (m_mix)
+    {
+        for (int ch = 0; ch < m_channels; ch++)
+        {
+            delete[] m_mix[ch];
+        }
+        delete[] m_mix;
+        m_mix = NULL;
+    }
+
+    if (m_name)
+    {
+        delete[] m_name;
+        m_name = NULL;
+    }
+}
+
+void SamRelay::start()
+{
+    QByteArray hostBytes = m_host.toLocal8Bit();
+    printf("Relay %d: connecting to downstream SAM at %s, port %u\n", m_id, hostBytes.constData(), m_port);
+    m_socket.connectToHost(m_host, m_port);
+}
+
+void SamRelay::clearMix(jack_nframes_t nframes)
+{
+    if (!m_mix || (int)nframes > m_bufferSize) return;
+    for (int ch = 0; ch < m_channels; ch++)
+    {
+        memset(m_mix[ch], 0, nframes * sizeof(float));
+    }
+}
+
+void SamRelay::mixApp(StreamingAudioApp* app, jack_nframes_t nframes)
+{
+    if (!m_mix || (int)nframes > m_bufferSize) return;
+    for (int ch = 0; ch < app->getNumChannels(); ch++)
+    {
+        const float* out = app->getOutputBuffer(ch, nframes);
+        if (!out) continue;
+
+        float* mix = m_mix[ch % m_channels];
+        for (unsigned int n = 0; n < nframes; n++)
+        {
+            mix[n] += out[n];
+        }
+    }
+}
+
+void SamRelay::sendMix(jack_nframes_t nframes)
+{
+    if (!m_forwarding || !m_mix || (int)nframes > m_bufferSize) return;
+    m_sender->sendAudio(m_channels, nframes, m_mix);
+}
+
+void SamRelay::sendApp(StreamingAudioApp* app, jack_nframes_t nframes)
+{
+    if (!m_forwarding) return;
+    m_sender->sendAudio(m_channels, nframes, app->getAudioData());
+}
+
+void SamRelay::handleConnected()
+{
+    OscMessage msg;
+    msg.init("/sam/app/register", "siiiiiiiiiiiiii", m_name, m_channels,
+                                                       0, // x
+                                                       0, // y
+                                                       0, // width
+                                                       0, // height
+                                                       0, // depth
+                                                       TYPE_BASIC,
+                                                       0, // preset
+                                                       0, // placeholder for packet size/samples per packet requested
+                                                       -1, // use the downstream SAM's default packet queue size
+                                                       VERSION_MAJOR,
+                                                       VERSION_MINOR,
+                                                       VERSION_PATCH,
+                                                       m_socket.localPort());
+    if (!OscClient::sendFromSocket(&msg, &m_socket))
+    {
+        qWarning("SamRelay::handleConnected couldn't register with downstream SAM");
+        flagForDelete();
+    }
+}
+
+void SamRelay::flagForDelete()
+{
+    m_forwarding = false;
+    if (m_deleteMe) return;
+    m_deleteMe = true;
+    emit deleteRequested(m_id);
+}
+
+void SamRelay::handleDisconnected()
+{
+    qWarning("Relay %d: downstream SAM disconnected", m_id);
+    m_downstreamId = -1;
+    flagForDelete();
+}
+
+void SamRelay::handleOscMessage(OscMessage* msg, const char* sender, QAbstractSocket* socket)
+{
+    Q_UNUSED(sender);
+    Q_UNUSED(socket);
+
+    if (qstrcmp(msg->getAddress(), "/sam/app/regconfirm") == 0 && msg->typeMatches("iiii"))
+    {
+        handle_regconfirm(msg);
+    }
+    else if (qstrcmp(msg->getAddress(), "/sam/app/regdeny") == 0 && msg->typeMatches("i"))
+    {
+        OscArg arg;
+        msg->getArg(0, arg);
+        qWarning("Relay %d: downstream SAM denied registration: error code = %d", m_id, arg.val.i);
+        flagForDelete();
+    }
+    // other messages (mute and solo updates for the forwarded stream) are ignored
+    delete msg;
+}
+
+void SamRelay::handle_regconfirm(OscMessage* msg)
+{
+    OscArg arg;
+    msg->getArg(0, arg);
+    int downstreamId = arg.val.i;
+    msg->getArg(1, arg);
+    int sampleRate = arg.val.i;
+    msg->getArg(2, arg);
+    int bufferSize = arg.val.i;
+    msg->getArg(3, arg);
+    quint16 rtpBasePort = arg.val.i;
+    m_downstreamId = downstreamId;
+
+    if (sampleRate != m_sampleRate || bufferSize != m_bufferSize)
+    {
+        qWarning("Relay %d: downstream SAM runs at %d Hz with buffer size %d, but this SAM runs at %d Hz with buffer size %d",
+                 m_id, sampleRate, bufferSize, m_sampleRate, m_bufferSize);
+        flagForDelete();
+        return;
+    }
+
+    // same port layout as a client (see StreamingAudioClient::handle_regconfirm)
+    quint16 portOffset = downstreamId * 4;
+    m_sender = new RtpSender(m_host, portOffset + rtpBasePort, portOffset + rtpBasePort + 3, portOffset + rtpBasePort + 1, REPORT_INTERVAL_MILLIS, m_sampleRate, m_channels, m_bufferSize, downstreamId, m_payloadType);
+    if (!m_sender->init())
+    {
+        qWarning("Relay %d: couldn't initialize RtpSender", m_id);
+        flagForDelete();
+        return;
+    }
+
+    printf("Relay %d: forwarding %d channel(s) to downstream SAM as app %d\n", m_id, m_channels, downstreamId);
+    m_forwarding = true;
+    emit relayStarted(m_id, downstreamId);
+}
+
+} // end of namespace sam
@@ -0,0 +1,240 @@
+/**
+ * @file sam_relay.h
+ * SAM relay interface
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef SAM_RELAY_H
+#define SAM_RELAY_H
+
+#include <QTcpSocket>
+
+#include "jack/jack.h"
+#include "osc.h"
+
+namespace sam
+{
+
+class RtpSender;
+class StreamingAudioApp;
+
+/**
+ * @class SamRelay
+ * @author agent
+ * @date October 2026
+ *
+ * A SamRelay forwards audio from this SAM to a downstream SAM over RTP.  It registers with the
+ * downstream SAM exactly like a client does, so the forwarded stream is a regular app there (with
+ * its own packet queue, clock skew compensation, volume and delay).  The source is either a single
+ * app, forwarded as received from its client (before this SAM's volume and delay are applied), or
+ * a downmix of all apps as this SAM plays them.
+ */
+class SamRelay : public QObject
+{
+    Q_OBJECT
+public:
+
+    static const int SOURCE_MIX = -1; ///< source id for a downmix of all apps
+
+    /**
+     * Constructor.
+     * @param id this relay's id
+     * @param source the id of the app to forward, or SOURCE_MIX for a downmix of all apps
+     * @param name the name to register with the downstream SAM
+     * @param channels the number of channels to forward
+     * @param host address of the downstream SAM
+     * @param port OSC port of the downstream SAM
+     * @param sampleRate this SAM's sample rate
+     * @param bufferSize this SAM's buffer size
+     * @param payloadType RTP payload type to send (PAYLOAD_PCM_16, PAYLOAD_PCM_24 or PAYLOAD_PCM_32)
+     * @param parent this relay's parent QObject
+     */
+    SamRelay(int id, int source, const char* name, int channels, const QString& host, quint16 port, int sampleRate, int bufferSize, quint8 payloadType, QObject* parent = 0);
+
+    /**
+     * Destructor.
+     */
+    virtual ~SamRelay();
+
+    /**
+     * Copy constructor (not used).
+     */
+    SamRelay(const SamRelay&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    SamRelay& operator=(const SamRelay&);
+
+    /**
+     * Start connecting to the downstream SAM.  Forwarding starts once the downstream SAM confirms registration.
+     */
+    void start();
+
+    /**
+     * Get this relay's id.
+     * @return the id
+     */
+    int getId() const { return m_id; }
+
+    /**
+     * Get the source of this relay.
+     * @return the id of the app being forwarded, or SOURCE_MIX
+     */
+    int getSource() const { return m_source; }
+
+    /**
+     * Get the number of channels being forwarded.
+     * @return the number of channels
+     */
+    int getNumChannels() const { return m_channels; }
+
+    /**
+     * Get the id this relay was registered under by the downstream SAM.
+     * @return the downstream id, or -1 if not registered yet
+     */
+    int getDownstreamId() const { return m_downstreamId; }
+
+    /**
+     * Query if this relay is registered with the downstream SAM and forwarding audio.
+     * @return true if forwarding, false otherwise
+     */
+    bool isForwarding() const { return m_forwarding; }
+
+    /**
+     * Clear the downmix buffer for a new period (JACK thread only).
+     * @param nframes the number of frames in this period
+     */
+    void clearMix(jack_nframes_t nframes);
+
+    /**
+     * Add an app's output for this period to the downmix (JACK thread only).
+     * App channels beyond this relay's channel count wrap around.
+     * @param app the app, which must have processed this period already
+     * @param nframes the number of frames in this period
+     */
+    void mixApp(StreamingAudioApp* app, jack_nframes_t nframes);
+
+    /**
+     * Send the downmix for this period (JACK thread only).
+     * @param nframes the number of frames in this period
+     */
+    void sendMix(jack_nframes_t nframes);
+
+    /**
+     * Send an app's received audio for this period (JACK thread only).
+     * @param app the app, which must have processed this period already
+     * @param nframes the number of frames in this period
+     */
+    void sendApp(StreamingAudioApp* app, jack_nframes_t nframes);
+
+    /**
+     * Flag this relay to be deleted: it stops forwarding, and deleteRequested is emitted the first time.
+     */
+    void flagForDelete();
+
+    /**
+     * Query whether or not this relay should be deleted.
+     * @return true if flagged for deletion, false otherwise
+     */
+    bool shouldDelete() const { return m_deleteMe; }
+
+signals:
+    /**
+     * Emitted when the downstream SAM has confirmed registration and forwarding has started.
+     * @param id this relay's id
+     * @param downstreamId the id the downstream SAM assigned to the forwarded stream
+     */
+    void relayStarted(int id, int downstreamId);
+
+    /**
+     * Emitted when this relay is flagged for deletion, so its owner can delete it once the audio thread has let go.
+     * @param id this relay's id
+     */
+    void deleteRequested(int id);
+
+protected slots:
+    /**
+     * Register with the downstream SAM once connected.
+     */
+    void handleConnected();
+
+    /**
+     * Handle the downstream SAM disconnecting.
+     */
+    void handleDisconnected();
+
+    /**
+     * Handle an OSC message from the downstream SAM.
+     * @param msg the OscMessage received
+     * @param sender the downstream SAM's address
+     * @param socket the socket the message was received through
+     */
+    void handleOscMessage(OscMessage* msg, const char* sender, QAbstractSocket* socket);
+
+protected:
+    /**
+     * Start forwarding after the downstream SAM confirms registration.
+     * @param msg the /sam/app/regconfirm message
+     */
+    void handle_regconfirm(OscMessage* msg);
+
+    int m_id;                       ///< this relay's id
+    int m_source;                   ///< id of the app being forwarded, or SOURCE_MIX
+    char* m_name;                   ///< name registered with the downstream SAM
+    int m_channels;                 ///< number of channels forwarded
+    QString m_host;                 ///< address of the downstream SAM
+    quint16 m_port;                 ///< OSC port of the downstream SAM
+    int m_sampleRate;               ///< this SAM's sample rate
+    int m_bufferSize;               ///< this SAM's buffer size
+    quint8 m_payloadType;           ///< RTP payload type sent to the downstream SAM
+    QTcpSocket m_socket;            ///< socket connected to the downstream SAM
+    OscTcpSocketReader* m_reader;   ///< reads OSC messages from m_socket
+    RtpSender* m_sender;            ///< sends forwarded audio to the downstream SAM
+    int m_downstreamId;             ///< id assigned by the downstream SAM (-1 if not registered)
+    float** m_mix;                  ///< downmix buffer [channels][bufferSize]
+    volatile bool m_forwarding;     ///< true while registered and forwarding audio
+    volatile bool m_deleteMe;       ///< true if this relay should be deleted
+};
+
+} // end of namespace sam
+
+#endif // SAM_RELAY_H
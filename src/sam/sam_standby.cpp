@@ -0,0 +1,155 @@
+/**
+ * @file sam_standby.cpp
+ * Standby SAM link implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <stdio.h>
+
+#include <QDebug>
+
+#include "sam_standby.h"
+
+namespace sam
+{
+
+static const int RETRY_INTERVAL_MILLIS = 1000;  // how often to retry connecting to the primary before it is first reached
+
+SamStandbyLink::SamStandbyLink(const QString& primaryHost, quint16 primaryPort, int timeoutMillis, QObject* parent) :
+    QObject(parent),
+    m_primaryHost(primaryHost),
+    m_primaryPort(primaryPort),
+    m_timeoutMillis(timeoutMillis),
+    m_reader(NULL),
+    m_mirroring(false),
+    m_lost(false)
+{
+    m_reader = new OscTcpSocketReader(&m_socket);
+    connect(&m_socket, SIGNAL(readyRead()), m_reader, SLOT(readFromSocket()));
+    connect(m_reader, SIGNAL(messageReady(OscMessage*, const char*, QAbstractSocket*)), this, SLOT(handleMessage(OscMessage*, const char*, QAbstractSocket*)));
+    connect(&m_socket, SIGNAL(connected()), this, SLOT(handleConnected()));
+    connect(&m_socket, SIGNAL(disconnected()), this, SLOT(handleDisconnected()));
+    connect(&m_checkTimer, SIGNAL(timeout()), this, SLOT(checkPrimary()));
+}
+
+SamStandbyLink::~SamStandbyLink()
+{
+    m_checkTimer.stop();
+    m_socket.disconnect();
+    m_socket.abort();
+
+    delete m_reader;
+    m_reader = NULL;
+}
+
+void SamStandbyLink::start()
+{
+    QByteArray hostBytes = m_primaryHost.toLocal8Bit();
+    printf("Running as standby for primary SAM at %s, port %u\n", hostBytes.constData(), m_primaryPort);
+
+    m_lastHeard.start();
+    m_socket.connectToHost(m_primaryHost, m_primaryPort);
+    m_checkTimer.start(qMax(m_timeoutMillis / 4, 10));
+}
+
+void SamStandbyLink::handleConnected()
+{
+    qWarning("SamStandbyLink::handleConnected connected to primary SAM, mirroring its state");
+    m_mirroring = true;
+    m_lastHeard.restart();
+
+    OscMessage msg;
+    msg.init("/sam/standby/register", "");
+    if (!OscClient::sendFromSocket(&msg, &m_socket))
+    {
+        qWarning("SamStandbyLink::handleConnected couldn't register with primary SAM");
+    }
+}
+
+void SamStandbyLink::handleDisconnected()
+{
+    if (m_mirroring)
+    {
+        qWarning("SamStandbyLink::handleDisconnected primary SAM disconnected");
+        lose_primary();
+    }
+}
+
+void SamStandbyLink::handleMessage(OscMessage* msg, const char* sender, QAbstractSocket* socket)
+{
+    m_lastHeard.restart();
+    if (qstrcmp(msg->getAddress(), "/sam/standby/heartbeat") == 0)
+    {
+        delete msg;
+        return;
+    }
+    emit messageReady(msg, sender, socket);
+}
+
+void SamStandbyLink::checkPrimary()
+{
+    if (m_mirroring)
+    {
+        if (m_lastHeard.elapsed() > m_timeoutMillis)
+        {
+            qWarning("SamStandbyLink::checkPrimary no heartbeat from primary SAM for %lld ms", m_lastHeard.elapsed());
+            lose_primary();
+        }
+    }
+    else if (m_socket.state() == QAbstractSocket::UnconnectedState && m_lastHeard.elapsed() > RETRY_INTERVAL_MILLIS)
+    {
+        // primary isn't up yet: keep trying
+        m_lastHeard.restart();
+        m_socket.connectToHost(m_primaryHost, m_primaryPort);
+    }
+}
+
+void SamStandbyLink::lose_primary()
+{
+    if (m_lost) return;
+    m_lost = true;
+    m_mirroring = false;
+    m_checkTimer.stop();
+    m_socket.abort();
+    emit primaryLost();
+}
+
+} // end of namespace sam
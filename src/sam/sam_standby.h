@@ -0,0 +1,162 @@
+/**
+ * @file sam_standby.h
+ * Standby SAM link interface
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef SAM_STANDBY_H
+#define SAM_STANDBY_H
+
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "osc.h"
+
+namespace sam
+{
+
+/**
+ * @class SamStandbyLink
+ * @author agent
+ * @date October 2026
+ *
+ * A SamStandbyLink connects a standby SAM to its primary SAM.  The primary sends its
+ * registration and parameter state over the link, plus a heartbeat.  If the link drops
+ * or goes quiet for longer than the timeout, the primary is assumed to have failed.
+ */
+class SamStandbyLink : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Constructor.
+     * @param primaryHost address of the primary SAM
+     * @param primaryPort OSC port of the primary SAM
+     * @param timeoutMillis milliseconds without hearing from the primary before it is assumed to have failed
+     * @param parent this link's parent QObject
+     */
+    SamStandbyLink(const QString& primaryHost, quint16 primaryPort, int timeoutMillis, QObject* parent = 0);
+
+    /**
+     * Destructor.
+     */
+    virtual ~SamStandbyLink();
+
+    /**
+     * Copy constructor (not used).
+     */
+    SamStandbyLink(const SamStandbyLink&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    SamStandbyLink& operator=(const SamStandbyLink&);
+
+    /**
+     * Start connecting to the primary (retrying until it is reachable).
+     */
+    void start();
+
+    /**
+     * Get the socket connected to the primary.
+     * @return the socket
+     */
+    QTcpSocket* getSocket() { return &m_socket; }
+
+signals:
+    /**
+     * Signals when a state message has been received from the primary.
+     * @param msg the OscMessage received
+     * @param sender the primary's address
+     * @param socket the socket the message was received through
+     */
+    void messageReady(OscMessage* msg, const char* sender, QAbstractSocket* socket);
+
+    /**
+     * Signals (once) that the primary has failed.
+     */
+    void primaryLost();
+
+protected slots:
+    /**
+     * Register with the primary once connected.
+     */
+    void handleConnected();
+
+    /**
+     * Handle the primary disconnecting.
+     */
+    void handleDisconnected();
+
+    /**
+     * Handle a message from the primary.
+     * @param msg the OscMessage received
+     * @param sender the primary's address
+     * @param socket the socket the message was received through
+     */
+    void handleMessage(OscMessage* msg, const char* sender, QAbstractSocket* socket);
+
+    /**
+     * Check that the primary is still alive, or retry connecting to it.
+     */
+    void checkPrimary();
+
+protected:
+    /**
+     * Give up on the primary and signal that it has failed.
+     */
+    void lose_primary();
+
+    QString m_primaryHost;          ///< address of the primary SAM
+    quint16 m_primaryPort;          ///< OSC port of the primary SAM
+    int m_timeoutMillis;            ///< milliseconds of silence before the primary is assumed to have failed
+    QTcpSocket m_socket;            ///< socket connected to the primary
+    OscTcpSocketReader* m_reader;   ///< reads OSC messages from m_socket
+    QTimer m_checkTimer;            ///< timer for checking the primary's heartbeat
+    QElapsedTimer m_lastHeard;      ///< time since the primary was last heard from (or last connection attempt)
+    bool m_mirroring;               ///< true once connected and registered with the primary
+    bool m_lost;                    ///< true once the primary has been given up on
+};
+
+} // end of namespace sam
+
+#endif // SAM_STANDBY_H
@@ -67,8 +67,14 @@ SamParams::SamParams() :
     packetQueueSize(4),
     clockSkewThreshold(bufferSize),
     maxClients(100),
+    outputPortPool(64),
     meterIntervalMillis(1000.0f),
     verifyPatchVersion(false),
+    primaryPort(7770),
+    standbyTimeoutMillis(500),
+    relayPort(7770),
+    relayChannels(2),
+    relayBitDepth(24),
     useGui(false),
     printHelp(false)
 {
@@ -97,12 +103,18 @@ bool SamParams::parseConfig(const char* configFile, int argc, char* argv[])
 #endif
     jackDriver = temp.toString();
 
+    temp = settings.value("AudioBackend", "jack");
+    audioBackend = temp.toString();
+
     temp = settings.value("OscPort", oscPort);
     oscPort = temp.toInt();
 
     temp = settings.value("RtpPort", rtpPort);
     rtpPort = temp.toInt();
 
+    temp = settings.value("RtpMulticastGroup", "");
+    rtpMulticastGroup = temp.toString();
+
     temp = settings.value("MaxOutputChannels", maxOutputChannels);
     maxOutputChannels = temp.toInt();
 
@@ -142,6 +154,20 @@ bool SamParams::parseConfig(const char* configFile, int argc, char* argv[])
     temp = settings.value("MaxClients", maxClients);
     maxClients = temp.toInt();
 
+    temp = settings.value("OutputPortPool", outputPortPool);
+    outputPortPool = temp.toInt();
+    if (outputPortPool < 0)
+    {
+        qWarning("SamParams::parseConfig ERROR: OutputPortPool parameter can't be negative");
+        return false;
+    }
+
+    temp = settings.value("SharedMemoryGroup", "");
+    sharedMemoryGroup = temp.toString();
+
+    temp = settings.value("RecordDirectory", "");
+    recordDirectory = temp.toString();
+
     temp = settings.value("MeterIntervalMillis", meterIntervalMillis);
     meterIntervalMillis = temp.toFloat();
 
@@ -167,6 +193,37 @@ bool SamParams::parseConfig(const char* configFile, int argc, char* argv[])
     temp = settings.value("HostAddress", "");
     hostAddress = temp.toString();
 
+    temp = settings.value("PrimaryHost", "");
+    primaryHost = temp.toString();
+
+    temp = settings.value("PrimaryPort", primaryPort);
+    primaryPort = temp.toInt();
+
+    temp = settings.value("StandbyTimeoutMillis", standbyTimeoutMillis);
+    standbyTimeoutMillis = temp.toInt();
+
+    temp = settings.value("RelayHost", "");
+    relayHost = temp.toString();
+
+    temp = settings.value("RelayPort", relayPort);
+    relayPort = temp.toInt();
+
+    temp = settings.value("RelayChannels", relayChannels);
+    relayChannels = temp.toInt();
+    if (relayChannels < 1)
+    {
+        qWarning("SamParams::parseConfig ERROR: RelayChannels parameter must be at least 1");
+        return false;
+    }
+
+    temp = settings.value("RelayBitDepth", relayBitDepth);
+    relayBitDepth = temp.toInt();
+    if (relayBitDepth != 16 && relayBitDepth != 24 && relayBitDepth != 32)
+    {
+        qWarning("SamParams::parseConfig ERROR: RelayBitDepth parameter must be 16, 24 or 32");
+        return false;
+    }
+
     // parse command-line parameters which will override config file settings
     bool basicChOverride = false;
     if (argc > 0)
@@ -178,6 +235,7 @@ bool SamParams::parseConfig(const char* configFile, int argc, char* argv[])
                 {"samplerate", optional_argument, NULL, 'r'},
                 {"period", optional_argument, NULL, 'p'},
                 {"driver", optional_argument, NULL, 'd'},
+                {"backend", optional_argument, NULL, 'b'},
                 {"oscport", optional_argument, NULL, 'o'},
                 {"jtport", optional_argument, NULL, 'j'},
                 {"outoffset", optional_argument, NULL, 'f'},
@@ -189,7 +247,7 @@ bool SamParams::parseConfig(const char* configFile, int argc, char* argv[])
 
             // getopt_long stores the option index here.
             int option_index = 0;
-            int c = getopt_long(argc, argv, "n:r:p:d:o:j:f:m:hg", long_options, &option_index);
+            int c = getopt_long(argc, argv, "n:r:p:d:b:o:j:f:m:hg", long_options, &option_index);
 
             // Detect the end of the options.
             if (c == -1) break;
@@ -213,6 +271,10 @@ bool SamParams::parseConfig(const char* configFile, int argc, char* argv[])
                 jackDriver.append(optarg);
                 break;
 
+            case 'b':
+                audioBackend = QString(optarg);
+                break;
+
             case 'o':
                 oscPort = (quint16)atoi(optarg);
                 // TODO: check for valid range for port?
@@ -309,8 +371,12 @@ bool SamParams::parseConfig(const char* configFile, int argc, char* argv[])
     printf("JACK period (buffer size): %d\n", bufferSize);
     QByteArray jackDriverBytes = jackDriver.toLocal8Bit();
     printf("JACK driver: %s\n", jackDriverBytes.constData());
+    QByteArray audioBackendBytes = audioBackend.toLocal8Bit();
+    printf("Audio backend: %s\n", audioBackendBytes.constData());
     printf("OSC server port: %u\n", oscPort);
     printf("Base RTP port: %u\n", rtpPort);
+    QByteArray multicastBytes = rtpMulticastGroup.toLocal8Bit();
+    printf("RTP multicast group: %s\n", multicastBytes.constData());
     printf("Max output channels: %d\n", maxOutputChannels);
     printf("Volume: %f\n", volume);
     printf("Delay in millis: %f\n", delayMillis);
@@ -329,10 +395,25 @@ bool SamParams::parseConfig(const char* configFile, int argc, char* argv[])
     QByteArray portDiscreteBytes = outJackPortBaseDiscrete.toLocal8Bit();
     printf("Output JACK port base (Discrete): %s\n", portDiscreteBytes.constData());
     printf("Max clients: %d\n", maxClients);
+    printf("Output port pool: %d\n", outputPortPool);
+    QByteArray sharedMemoryGroupBytes = sharedMemoryGroup.toLocal8Bit();
+    printf("Shared memory group: %s\n", sharedMemoryGroupBytes.constData());
+    QByteArray recordDirectoryBytes = recordDirectory.toLocal8Bit();
+    printf("Record directory: %s\n", recordDirectoryBytes.constData());
     printf("Meter interval in millis: %f\n", meterIntervalMillis);
     printf("Verify patch version: %d\n", verifyPatchVersion);
     QByteArray hostBytes = hostAddress.toLocal8Bit();
     printf("Host address: %s\n", hostBytes.constData());
+    if (!primaryHost.isEmpty())
+    {
+        QByteArray primaryBytes = primaryHost.toLocal8Bit();
+        printf("Standby for primary SAM: %s, port %u (timeout %d ms)\n", primaryBytes.constData(), primaryPort, standbyTimeoutMillis);
+    }
+    if (!relayHost.isEmpty())
+    {
+        QByteArray relayBytes = relayHost.toLocal8Bit();
+        printf("Relay %d-channel %d-bit downmix to SAM: %s, port %u\n", relayChannels, relayBitDepth, relayBytes.constData(), relayPort);
+    }
 
     return true;
 }
@@ -64,8 +64,10 @@ public:
     int bufferSize;                       ///< The buffer size for JACK
     unsigned int numBasicChannels;        ///< The number of basic (non-spatialized) channels
     QString jackDriver;                   ///< The driver for JACK to use
+    QString audioBackend;                 ///< The audio backend to use: "jack", "virtual" (real-time clock, no audio hardware) or "offline" (clock stepped by a test harness)
     quint16 oscPort;                      ///< OSC server port
     quint16 rtpPort;                      ///< Base JackTrip port
+    QString rtpMulticastGroup;            ///< multicast group for RTP receivers to join (empty for unicast only)
     unsigned int maxOutputChannels;       ///< the maximum number of output channels to use
     float volume;                         ///< initial global volume
     float delayMillis;                    ///< initial global delay in milliseconds
@@ -82,9 +84,19 @@ public:
     QList<unsigned int> basicChannels; 	  ///< list of basic channels to use
     QList<unsigned int> discreteChannels; ///< list of discrete channels to use
     int maxClients;                       ///< maximum number of clients that can be connected simultaneously
+    int outputPortPool;                   ///< number of output ports registered at startup and shared by apps (0 to register ports per app)
+    QString sharedMemoryGroup;            ///< group whose members may attach to shared-memory rings (empty for SAM's user only)
+    QString recordDirectory;              ///< directory recordings and RTP captures are written to (empty to disable them)
     float meterIntervalMillis;            ///< milliseconds between meter broadcasts to subscribers
     bool verifyPatchVersion;              ///< whether or not the patch versions have to match during version check
     QString hostAddress;                  ///< local host address to bind to (UDP)/listen on (TCP)
+    QString primaryHost;                  ///< address of the primary SAM to mirror (empty unless running as a standby)
+    quint16 primaryPort;                  ///< OSC port of the primary SAM to mirror
+    int standbyTimeoutMillis;             ///< milliseconds without a heartbeat from the primary before a standby takes over
+    QString relayHost;                    ///< address of a downstream SAM to forward a downmix to (empty for none)
+    quint16 relayPort;                    ///< OSC port of the downstream SAM
+    int relayChannels;                    ///< number of channels in the downmix forwarded to the downstream SAM
+    int relayBitDepth;                    ///< bits per sample forwarded to downstream SAMs (16, 24 or 32 for float)
     bool useGui;                          ///< whether to run in GUI mode or not
     bool printHelp;                       ///< whether or not to print help to console
 };
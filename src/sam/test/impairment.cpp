@@ -0,0 +1,330 @@
+/**
+ * @file test/impairment.cpp
+ * Network impairment emulation implementation
+ * @author agent
+ * @date October 2026
+ * @copyright UCSD 2026
+ * @license New BSD License: http://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QStringList>
+#include <QTimer>
+#include <QUdpSocket>
+
+#include "impairment.h"
+
+namespace sam
+{
+
+static const double PARETO_SHAPE = 2.5;     ///< shape of the Pareto delay distribution (smaller is heavier-tailed)
+static const char* DISTRIBUTION_NAMES[NUM_DELAY_DISTRIBUTIONS] = {"uniform", "normal", "pareto"};
+
+NetworkImpairment::NetworkImpairment(const ImpairmentParams& params) :
+    m_params(params),
+    m_random(0),
+    m_burst(false),
+    m_firstSendMicros(-1),
+    m_packetsSent(0),
+    m_packetsLost(0),
+    m_packetsReordered(0),
+    m_packetsDuplicated(0)
+{
+    // seed the xorshift generator with a splitmix64 step so that nearby seeds give unrelated sequences
+    quint64 z = params.seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    m_random = z ^ (z >> 31);
+    if (m_random == 0) m_random = 1;
+}
+
+bool NetworkImpairment::parse(const char* spec, ImpairmentParams& params)
+{
+    QStringList items = QString(spec).split(',');
+    for (int i = 0; i < items.size(); i++)
+    {
+        if (items[i].trimmed().isEmpty()) continue;
+
+        QStringList keyVal = items[i].split('=');
+        if (keyVal.size() != 2)
+        {
+            qWarning("NetworkImpairment::parse invalid item \"%s\"", items[i].toLocal8Bit().constData());
+            return false;
+        }
+        QString key = keyVal[0].trimmed();
+        QStringList vals = keyVal[1].split(':');
+        bool ok = true;
+
+        if (key == "delay")
+        {
+            params.delayMillis = vals[0].toDouble(&ok);
+        }
+        else if (key == "jitter")
+        {
+            params.jitterMillis = vals[0].toDouble(&ok);
+        }
+        else if (key == "dist")
+        {
+            ok = false;
+            for (int d = 0; d < NUM_DELAY_DISTRIBUTIONS; d++)
+            {
+                if (vals[0] == DISTRIBUTION_NAMES[d])
+                {
+                    params.distribution = (DelayDistribution)d;
+                    ok = true;
+                }
+            }
+        }
+        else if (key == "loss")
+        {
+            params.loss = vals[0].toDouble(&ok);
+        }
+        else if (key == "burst" && vals.size() >= 2)
+        {
+            bool okExit = true;
+            params.burstEnter = vals[0].toDouble(&ok);
+            params.burstExit = vals[1].toDouble(&okExit);
+            ok = ok && okExit;
+            if (vals.size() > 2)
+            {
+                params.burstLoss = vals[2].toDouble(&okExit);
+                ok = ok && okExit;
+            }
+        }
+        else if (key == "reorder")
+        {
+            params.reorder = vals[0].toDouble(&ok);
+            if (vals.size() > 1)
+            {
+                bool okMillis = true;
+                params.reorderMillis = vals[1].toDouble(&okMillis);
+                ok = ok && okMillis;
+            }
+        }
+        else if (key == "dup")
+        {
+            params.duplicate = vals[0].toDouble(&ok);
+        }
+        else if (key == "drift")
+        {
+            params.driftPpm = vals[0].toDouble(&ok);
+        }
+        else if (key == "seed")
+        {
+            params.seed = vals[0].toUInt(&ok);
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            qWarning("NetworkImpairment::parse invalid item \"%s\"", items[i].toLocal8Bit().constData());
+            return false;
+        }
+    }
+    return true;
+}
+
+void NetworkImpairment::print() const
+{
+    printf("Impairment: delay %.2f ms, jitter %.2f ms (%s), loss %.4f, burst %.4f:%.4f:%.4f, reorder %.4f (%.2f ms), duplicate %.4f, drift %.1f ppm, seed %u\n",
+           m_params.delayMillis, m_params.jitterMillis, DISTRIBUTION_NAMES[m_params.distribution], m_params.loss,
+           m_params.burstEnter, m_params.burstExit, m_params.burstLoss, m_params.reorder, m_params.reorderMillis,
+           m_params.duplicate, m_params.driftPpm, m_params.seed);
+}
+
+void NetworkImpairment::push(qint64 sendMicros, const QByteArray& datagram)
+{
+    m_packetsSent++;
+    if (m_firstSendMicros < 0) m_firstSendMicros = sendMicros;
+
+    // Gilbert-Elliott burst loss: lose the packet with the current state's probability, then maybe change state
+    double lossProb = m_burst ? m_params.burstLoss : m_params.loss;
+    bool lost = (lossProb > 0.0) && (uniform() < lossProb);
+    if (m_burst)
+    {
+        if (uniform() < m_params.burstExit) m_burst = false;
+    }
+    else if (m_params.burstEnter > 0.0 && uniform() < m_params.burstEnter)
+    {
+        m_burst = true;
+    }
+    if (lost)
+    {
+        m_packetsLost++;
+        return;
+    }
+
+    // a drifting sender clock stretches (or shrinks) the time between packets
+    qint64 elapsed = sendMicros - m_firstSendMicros;
+    qint64 sent = m_firstSendMicros + elapsed + (qint64)(elapsed * m_params.driftPpm * 1.0e-6);
+
+    qint64 arrival = sent + draw_delay();
+    if (m_params.reorder > 0.0 && uniform() < m_params.reorder)
+    {
+        m_packetsReordered++;
+        arrival += (qint64)(m_params.reorderMillis * 1000.0);
+    }
+    insert(arrival, datagram);
+
+    if (m_params.duplicate > 0.0 && uniform() < m_params.duplicate)
+    {
+        m_packetsDuplicated++;
+        insert(sent + draw_delay(), datagram);
+    }
+}
+
+bool NetworkImpairment::pop(qint64 nowMicros, QByteArray& datagram, qint64& arrivalMicros)
+{
+    if (m_inFlight.isEmpty() || m_inFlight.first().arrivalMicros > nowMicros) return false;
+
+    InFlight packet = m_inFlight.takeFirst();
+    datagram = packet.datagram;
+    arrivalMicros = packet.arrivalMicros;
+    return true;
+}
+
+double NetworkImpairment::uniform()
+{
+    // xorshift64*
+    m_random ^= m_random >> 12;
+    m_random ^= m_random << 25;
+    m_random ^= m_random >> 27;
+    quint64 r = m_random * 0x2545F4914F6CDD1DULL;
+    return (r >> 11) * (1.0 / 9007199254740992.0);
+}
+
+qint64 NetworkImpairment::draw_delay()
+{
+    double delay = m_params.delayMillis;
+    double jitter = m_params.jitterMillis;
+    if (jitter > 0.0)
+    {
+        switch (m_params.distribution)
+        {
+        case DELAY_NORMAL:
+        {
+            // Box-Muller
+            double u1 = 1.0 - uniform(); // (0, 1]
+            double u2 = uniform();
+            delay += jitter * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+            break;
+        }
+        case DELAY_PARETO:
+        {
+            // scale so the mean extra delay is the jitter
+            double scale = jitter * (PARETO_SHAPE - 1.0);
+            delay += scale * (pow(1.0 - uniform(), -1.0 / PARETO_SHAPE) - 1.0);
+            break;
+        }
+        case DELAY_UNIFORM:
+        default:
+            delay += jitter * (2.0 * uniform() - 1.0);
+            break;
+        }
+    }
+    if (delay < 0.0) delay = 0.0;
+    return (qint64)(delay * 1000.0);
+}
+
+void NetworkImpairment::insert(qint64 arrivalMicros, const QByteArray& datagram)
+{
+    // datagrams arriving at the same time keep the order they were sent in
+    int i = m_inFlight.size();
+    while (i > 0 && m_inFlight[i - 1].arrivalMicros > arrivalMicros)
+    {
+        i--;
+    }
+    InFlight packet;
+    packet.arrivalMicros = arrivalMicros;
+    packet.datagram = datagram;
+    m_inFlight.insert(i, packet);
+}
+
+ImpairmentProxy::ImpairmentProxy(quint16 listenPort, const QString& destHost, quint16 destPort, const ImpairmentParams& params, QObject* parent) :
+    QObject(parent),
+    m_listenPort(listenPort),
+    m_destHost(destHost),
+    m_destPort(destPort),
+    m_impairment(params),
+    m_socket(NULL),
+    m_timer(NULL),
+    m_packetsForwarded(0)
+{
+}
+
+ImpairmentProxy::~ImpairmentProxy()
+{
+    if (m_socket)
+    {
+        m_socket->close();
+        delete m_socket;
+        m_socket = NULL;
+    }
+}
+
+bool ImpairmentProxy::start()
+{
+    m_socket = new QUdpSocket();
+    if (!m_socket->bind(m_listenPort))
+    {
+        qWarning("ImpairmentProxy::start couldn't bind to port %u", m_listenPort);
+        return false;
+    }
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(readPendingDatagrams()));
+
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+#if QT_VERSION >= 0x050000
+    m_timer->setTimerType(Qt::PreciseTimer);
+#endif
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(forwardArrived()));
+
+    m_clock.start();
+    return true;
+}
+
+void ImpairmentProxy::readPendingDatagrams()
+{
+    while (m_socket->hasPendingDatagrams())
+    {
+        QByteArray datagram;
+        datagram.resize(m_socket->pendingDatagramSize());
+        if (m_socket->readDatagram(datagram.data(), datagram.size()) < 0) continue;
+        m_impairment.push(now_micros(), datagram);
+    }
+    forwardArrived();
+}
+
+void ImpairmentProxy::forwardArrived()
+{
+    QByteArray datagram;
+    qint64 arrival = 0;
+    while (m_impairment.pop(now_micros(), datagram, arrival))
+    {
+        if (m_socket->writeDatagram(datagram, m_destHost, m_destPort) < 0)
+        {
+            qWarning("ImpairmentProxy::forwardArrived couldn't forward datagram to port %u", m_destPort);
+            continue;
+        }
+        m_packetsForwarded++;
+    }
+    schedule();
+}
+
+void ImpairmentProxy::schedule()
+{
+    qint64 next = m_impairment.getNextArrival();
+    if (next < 0) return;
+
+    // round up so the timer doesn't fire just before the datagram arrives
+    qint64 waitMillis = (next - now_micros() + 999) / 1000;
+    m_timer->start(waitMillis > 0 ? waitMillis : 0);
+}
+
+} // end of namespace sam
@@ -0,0 +1,275 @@
+/**
+ * @file test/impairment.h
+ * Network impairment emulation (delay, jitter, burst loss, reordering, duplication and clock drift) for testing
+ * @author agent
+ * @date October 2026
+ * @copyright UCSD 2026
+ * @license New BSD License: http://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef IMPAIRMENT_H
+#define IMPAIRMENT_H
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+
+class QTimer;
+class QUdpSocket;
+
+namespace sam
+{
+
+/**
+ * @enum DelayDistribution
+ * The distributions from which per-packet delay variation can be drawn.
+ */
+enum DelayDistribution
+{
+    DELAY_UNIFORM = 0,  ///< uniform within +/- the jitter
+    DELAY_NORMAL,       ///< normal with the jitter as standard deviation
+    DELAY_PARETO,       ///< heavy-tailed (Pareto) with the jitter as mean extra delay
+    NUM_DELAY_DISTRIBUTIONS
+};
+
+/**
+ * @struct ImpairmentParams
+ * This struct contains the parameters of a NetworkImpairment.
+ */
+struct ImpairmentParams
+{
+    ImpairmentParams() :
+        delayMillis(0.0),
+        jitterMillis(0.0),
+        distribution(DELAY_UNIFORM),
+        loss(0.0),
+        burstEnter(0.0),
+        burstExit(1.0),
+        burstLoss(1.0),
+        reorder(0.0),
+        reorderMillis(10.0),
+        duplicate(0.0),
+        driftPpm(0.0),
+        seed(1)
+    {}
+
+    double delayMillis;                 ///< base one-way delay
+    double jitterMillis;                ///< delay variation (meaning depends on the distribution)
+    DelayDistribution distribution;     ///< distribution of the delay variation
+    double loss;                        ///< probability of losing a packet in the Gilbert-Elliott "good" state
+    double burstEnter;                  ///< probability of moving from the "good" to the "bad" state after each packet
+    double burstExit;                   ///< probability of moving from the "bad" to the "good" state after each packet
+    double burstLoss;                   ///< probability of losing a packet in the "bad" state
+    double reorder;                     ///< probability of holding a packet back so later packets overtake it
+    double reorderMillis;               ///< extra delay of a held-back packet
+    double duplicate;                   ///< probability of delivering a packet twice
+    double driftPpm;                    ///< sender clock drift: positive values make packets arrive progressively later
+    quint32 seed;                       ///< random seed (impairments are reproducible for a given seed)
+};
+
+/**
+ * @class NetworkImpairment
+ * @author agent
+ * @date October 2026
+ *
+ * This class models an impaired network path.  Datagrams are pushed in with the time they were sent and
+ * popped out in order of the time they arrive.  The model has no clock of its own, so it can be driven in real
+ * time (see ImpairmentProxy) or in simulated time for reproducible tests (see rtpreplay).
+ */
+class NetworkImpairment
+{
+public:
+
+    /**
+     * NetworkImpairment constructor.
+     * @param params the impairment parameters
+     */
+    NetworkImpairment(const ImpairmentParams& params);
+
+    /**
+     * Parse an impairment specification.
+     * The specification is a comma-separated list of key=value pairs:
+     * delay=ms, jitter=ms, dist=uniform|normal|pareto, loss=p, burst=enter:exit[:loss],
+     * reorder=p[:ms], dup=p, drift=ppm, seed=n
+     * @param spec the specification
+     * @param params the parameters to fill in (unspecified parameters are left unchanged)
+     * @return true on success, false if the specification is invalid
+     */
+    static bool parse(const char* spec, ImpairmentParams& params);
+
+    /**
+     * Print the impairment parameters.
+     */
+    void print() const;
+
+    /**
+     * Send a datagram into the network.
+     * @param sendMicros the time the datagram was sent (microseconds, non-decreasing)
+     * @param datagram the datagram
+     */
+    void push(qint64 sendMicros, const QByteArray& datagram);
+
+    /**
+     * Receive the next datagram to arrive by the given time.
+     * @param nowMicros the current time (microseconds)
+     * @param datagram set to the datagram
+     * @param arrivalMicros set to the time the datagram arrived
+     * @return true if a datagram was received, false if none has arrived yet
+     */
+    bool pop(qint64 nowMicros, QByteArray& datagram, qint64& arrivalMicros);
+
+    /**
+     * Get the arrival time of the next datagram in flight.
+     * @return the arrival time (microseconds), or -1 if no datagrams are in flight
+     */
+    qint64 getNextArrival() const { return m_inFlight.isEmpty() ? -1 : m_inFlight.first().arrivalMicros; }
+
+    /**
+     * Check if any datagrams are in flight.
+     * @return true if no datagrams are in flight
+     */
+    bool isEmpty() const { return m_inFlight.isEmpty(); }
+
+    quint64 getPacketsSent() const { return m_packetsSent; }               ///< @return number of datagrams pushed
+    quint64 getPacketsLost() const { return m_packetsLost; }               ///< @return number of datagrams lost
+    quint64 getPacketsReordered() const { return m_packetsReordered; }     ///< @return number of datagrams held back
+    quint64 getPacketsDuplicated() const { return m_packetsDuplicated; }   ///< @return number of datagrams duplicated
+
+protected:
+
+    /**
+     * @struct InFlight
+     * A datagram in flight.
+     */
+    struct InFlight
+    {
+        qint64 arrivalMicros;   ///< time the datagram arrives
+        QByteArray datagram;    ///< the datagram
+    };
+
+    /**
+     * Get a uniformly-distributed random number.
+     * @return a random number in [0, 1)
+     */
+    double uniform();
+
+    /**
+     * Draw the delay for a datagram.
+     * @return the delay (microseconds)
+     */
+    qint64 draw_delay();
+
+    /**
+     * Put a datagram in flight, keeping datagrams in order of arrival.
+     * @param arrivalMicros the time the datagram arrives
+     * @param datagram the datagram
+     */
+    void insert(qint64 arrivalMicros, const QByteArray& datagram);
+
+    ImpairmentParams m_params;          ///< impairment parameters
+    quint64 m_random;                   ///< random number generator state
+    bool m_burst;                       ///< true in the Gilbert-Elliott "bad" state
+    qint64 m_firstSendMicros;           ///< time the first datagram was sent (drift is relative to this)
+    QList<InFlight> m_inFlight;         ///< datagrams in flight, in order of arrival
+    quint64 m_packetsSent;              ///< number of datagrams pushed
+    quint64 m_packetsLost;              ///< number of datagrams lost
+    quint64 m_packetsReordered;         ///< number of datagrams held back
+    quint64 m_packetsDuplicated;        ///< number of datagrams duplicated
+};
+
+/**
+ * @class ImpairmentProxy
+ * @author agent
+ * @date October 2026
+ *
+ * This class is a UDP proxy that forwards datagrams received on a local port to a destination
+ * through a NetworkImpairment driven in real time.
+ */
+class ImpairmentProxy : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * ImpairmentProxy constructor.
+     * @param listenPort the local port to receive datagrams on
+     * @param destHost the host to forward datagrams to
+     * @param destPort the port to forward datagrams to
+     * @param params the impairment parameters
+     * @param parent the parent QObject
+     */
+    ImpairmentProxy(quint16 listenPort, const QString& destHost, quint16 destPort, const ImpairmentParams& params, QObject* parent = 0);
+
+    /**
+     * ImpairmentProxy destructor.
+     */
+    virtual ~ImpairmentProxy();
+
+    /**
+     * Copy constructor (not used).
+     */
+    ImpairmentProxy(const ImpairmentProxy&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    ImpairmentProxy& operator=(const ImpairmentProxy&);
+
+    /**
+     * Start forwarding.
+     * @return true on success, false on failure
+     */
+    bool start();
+
+    /**
+     * Get the impairment model.
+     * @return the impairment model
+     */
+    const NetworkImpairment& getImpairment() const { return m_impairment; }
+
+    /**
+     * Get the number of datagrams forwarded.
+     * @return the number of datagrams forwarded
+     */
+    quint64 getPacketsForwarded() const { return m_packetsForwarded; }
+
+public slots:
+
+    /**
+     * Read datagrams from the listening socket.
+     */
+    void readPendingDatagrams();
+
+    /**
+     * Forward the datagrams that have arrived.
+     */
+    void forwardArrived();
+
+protected:
+
+    /**
+     * Schedule the release timer for the next datagram in flight.
+     */
+    void schedule();
+
+    /**
+     * Get the current time.
+     * @return microseconds since the proxy started
+     */
+    qint64 now_micros() const { return m_clock.nsecsElapsed() / 1000; }
+
+    quint16 m_listenPort;               ///< local port to receive datagrams on
+    QHostAddress m_destHost;            ///< host to forward datagrams to
+    quint16 m_destPort;                 ///< port to forward datagrams to
+    NetworkImpairment m_impairment;     ///< impairment model
+    QUdpSocket* m_socket;               ///< socket for receiving and forwarding datagrams
+    QTimer* m_timer;                    ///< fires when the next datagram in flight arrives
+    QElapsedTimer m_clock;              ///< real-time clock driving the impairment model
+    quint64 m_packetsForwarded;         ///< number of datagrams forwarded
+};
+
+} // end of namespace sam
+
+#endif // IMPAIRMENT_H
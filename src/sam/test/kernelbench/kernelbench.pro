@@ -0,0 +1,77 @@
+#-------------------------------------------------
+#
+# kernelbench: microbenchmarks for SAM's per-packet and per-period kernels
+#
+#-------------------------------------------------
+
+QT       += core network
+
+QT       -= gui
+
+TARGET = kernelbench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+ParentDirectory = ../../../..
+
+UI_DIR = "$$ParentDirectory/build/kernelbench"
+MOC_DIR = "$$ParentDirectory/build/kernelbench"
+OBJECTS_DIR = "$$ParentDirectory/build/kernelbench"
+
+CONFIG(debug, debug|release) {
+    DESTDIR = "$$ParentDirectory/bin/debug"
+}
+CONFIG(release, debug|release) {
+    DESTDIR = "$$ParentDirectory/bin"
+}
+
+SOURCES += kernelbench_main.cpp \
+    ../../sam.cpp \
+    ../../sam_app.cpp \
+    ../../jack_util.cpp \
+    ../../../osc.cpp \
+    ../../osc_notifier.cpp \
+    ../../sam_standby.cpp \
+    ../../sam_relay.cpp \
+    ../../sam_recorder.cpp \
+    ../../sam_port_pool.cpp \
+    ../../sam_audio_backend.cpp \
+    ../../../rtp.cpp \
+    ../../../rtcp.cpp \
+    ../../../shared_audio_ring.cpp \
+    ../../rtpreceiver.cpp \
+    ../../rtpcapture.cpp \
+    ../../../client/rtpsender.cpp \
+    ../../samparams.cpp
+
+HEADERS += \
+    ../../sam.h \
+    ../../sam_app.h \
+    ../../jack_util.h \
+    ../../../osc.h \
+    ../../osc_notifier.h \
+    ../../sam_standby.h \
+    ../../sam_relay.h \
+    ../../sam_recorder.h \
+    ../../sam_port_pool.h \
+    ../../sam_audio_backend.h \
+    ../../../rtp.h \
+    ../../../rtcp.h \
+    ../../../shared_audio_ring.h \
+    ../../rtpreceiver.h \
+    ../../rtpcapture.h \
+    ../../../client/rtpsender.h \
+    ../../samparams.h \
+    ../../../sam_shared.h
+
+INCLUDEPATH += /usr/local/include $$ParentDirectory/src $$ParentDirectory/src/sam $$ParentDirectory/src/client
+
+# debug output would swamp the timings
+DEFINES += QT_NO_DEBUG_OUTPUT
+
+LIBS += -ljack
+unix:!macx: LIBS += -lrt # for shm_open
+
+message(kernelbench.pro complete)
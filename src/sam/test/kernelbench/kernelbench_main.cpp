@@ -0,0 +1,655 @@
+/**
+ * @file test/kernelbench/kernelbench_main.cpp
+ * kernelbench: microbenchmarks for SAM's per-packet and per-period kernels (RTP payload coding and serialization, StreamingAudioApp::process, OscMessage encoding/decoding and RtpReceiver reordering)
+ * @author agent
+ * @date October 2026
+ * @copyright UCSD 2026
+ * @license New BSD License: http://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include "osc.h"
+#include "rtp.h"
+#include "rtpreceiver.h"
+#include "sam.h"
+#include "sam_app.h"
+#include "sam_audio_backend.h"
+#include "samparams.h"
+
+using namespace sam;
+
+static const int SAMPLE_RATE = 48000;
+static const int BUFFER_SIZE = 256;
+static const double DEFAULT_MIN_SECONDS = 0.2;      // minimum measured time per repetition
+static const int DEFAULT_REPETITIONS = 5;
+static const qint64 MAX_ITERATIONS = 100000000;
+static const quint16 DEFAULT_RTP_BASE_PORT = 54464; // away from SAM's default so a running SAM doesn't interfere
+static const int PROCESS_QUEUE_SIZE = 4;            // packet queue size for StreamingAudioApp::process
+static const int PROCESS_DELAY = 480;               // delay used by StreamingAudioApp::process (samples)
+static const int PROCESS_MAX_DELAY = SAMPLE_RATE;   // delay line length for StreamingAudioApp::process (samples)
+
+static bool g_verbose = false;
+static quint16 g_rtpBasePort = DEFAULT_RTP_BASE_PORT;
+
+/**
+ * @class BenchState
+ * Passed to each benchmark function: how many iterations to run, the benchmark's arguments,
+ * and a timer that is paused around work that shouldn't be measured.
+ */
+class BenchState
+{
+public:
+    BenchState(qint64 iterations, int arg0, int arg1) : iterations(iterations), arg0(arg0), arg1(arg1), m_nanos(0) {}
+
+    void resumeTiming() { m_timer.start(); }
+    void pauseTiming() { m_nanos += m_timer.nsecsElapsed(); }
+    qint64 getNanos() const { return m_nanos; }
+
+    const qint64 iterations;
+    const int arg0;
+    const int arg1;
+
+private:
+    QElapsedTimer m_timer;
+    qint64 m_nanos;
+};
+
+// a benchmark function returns a checksum of its results so the work can't be optimized away
+typedef double (*BenchFunction)(BenchState& state);
+
+struct BenchCase
+{
+    QByteArray name;
+    BenchFunction function;
+    int arg0;
+    int arg1;
+};
+
+struct BenchResult
+{
+    qint64 iterations;
+    double medianNanos;
+    double minNanos;
+    double maxNanos;
+    double checksum;
+};
+
+void print_help()
+{
+    printf("Usage: kernelbench [options]\n");
+    printf("Options:\n");
+    printf("  --filter or -f\t\tonly run benchmarks whose names contain this string\n");
+    printf("  --time or -t\t\tminimum measured time per repetition in seconds (default %.1f)\n", DEFAULT_MIN_SECONDS);
+    printf("  --repetitions or -r\tnumber of repetitions (default %d); the median is reported\n", DEFAULT_REPETITIONS);
+    printf("  --json or -j\t\tfile to write the results to as JSON\n");
+    printf("  --port or -p\t\tRTP base port for StreamingAudioApp benchmarks (default %u)\n", DEFAULT_RTP_BASE_PORT);
+    printf("  --list or -l\t\tlist the benchmarks and exit\n");
+    printf("  --verbose or -v\tprint SAM's warnings\n");
+    printf("\nExample usage:\n");
+    printf("kernelbench -f process -r 9 -j process.json\n");
+    printf("\n");
+}
+
+#if QT_VERSION >= 0x050000
+void message_handler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+{
+    if (g_verbose || type == QtFatalMsg)
+    {
+        QByteArray msgBytes = msg.toLocal8Bit();
+        fprintf(stderr, "%s\n", msgBytes.constData());
+    }
+    if (type == QtFatalMsg) abort();
+}
+#else
+void message_handler(QtMsgType type, const char* msg)
+{
+    if (g_verbose || type == QtFatalMsg)
+    {
+        fprintf(stderr, "%s\n", msg);
+    }
+    if (type == QtFatalMsg) abort();
+}
+#endif
+
+float** alloc_audio(int channels, int frames)
+{
+    float** audio = new float*[channels];
+    for (int ch = 0; ch < channels; ch++)
+    {
+        audio[ch] = new float[frames];
+        for (int n = 0; n < frames; n++)
+        {
+            audio[ch][n] = 0.5f * sinf(0.01f * (n + 17 * ch));
+        }
+    }
+    return audio;
+}
+
+void free_audio(float** audio, int channels)
+{
+    for (int ch = 0; ch < channels; ch++)
+    {
+        delete[] audio[ch];
+    }
+    delete[] audio;
+}
+
+/**
+ * Build an RTP datagram for one period of audio.
+ * @param payloadType the payload type
+ * @param channels the number of channels
+ * @return the datagram
+ */
+QByteArray make_datagram(quint8 payloadType, int channels)
+{
+    float** audio = alloc_audio(channels, BUFFER_SIZE);
+    RtpPacket packet;
+    packet.init(0, 0, payloadType, 1);
+    packet.setPayload(channels, BUFFER_SIZE, audio);
+    QByteArray datagram;
+    packet.write(datagram);
+    free_audio(audio, channels);
+    return datagram;
+}
+
+/**
+ * Rewrite the sequence number and timestamp of an RTP datagram in place, as a sender would for each period.
+ */
+void set_header(QByteArray& datagram, quint16 sequenceNum, quint32 timestamp)
+{
+    uchar* header = (uchar*)datagram.data();
+    qToBigEndian(sequenceNum, header + 2);
+    qToBigEndian(timestamp, header + 4);
+}
+
+// ------------------- RtpPacket -------------------
+
+double bench_set_payload(BenchState& state)
+{
+    int channels = state.arg1;
+    float** audio = alloc_audio(channels, BUFFER_SIZE);
+    RtpPacket packet;
+    packet.init(0, 0, state.arg0, 1);
+
+    double checksum = 0.0;
+    state.resumeTiming();
+    for (qint64 i = 0; i < state.iterations; i++)
+    {
+        packet.setPayload(channels, BUFFER_SIZE, audio);
+        checksum += (uchar)packet.m_payload.at(i % packet.m_payload.size());
+    }
+    state.pauseTiming();
+
+    free_audio(audio, channels);
+    return checksum;
+}
+
+double bench_get_payload(BenchState& state)
+{
+    int channels = state.arg1;
+    float** audio = alloc_audio(channels, BUFFER_SIZE);
+    RtpPacket packet;
+    packet.init(0, 0, state.arg0, 1);
+    packet.setPayload(channels, BUFFER_SIZE, audio);
+
+    double checksum = 0.0;
+    state.resumeTiming();
+    for (qint64 i = 0; i < state.iterations; i++)
+    {
+        packet.getPayload(channels, BUFFER_SIZE, audio);
+        checksum += audio[0][i % BUFFER_SIZE];
+    }
+    state.pauseTiming();
+
+    free_audio(audio, channels);
+    return checksum;
+}
+
+double bench_write(BenchState& state)
+{
+    int channels = state.arg1;
+    float** audio = alloc_audio(channels, BUFFER_SIZE);
+    RtpPacket packet;
+    packet.init(0, 0, state.arg0, 1);
+    packet.setPayload(channels, BUFFER_SIZE, audio);
+    QByteArray datagram;
+
+    double checksum = 0.0;
+    state.resumeTiming();
+    for (qint64 i = 0; i < state.iterations; i++)
+    {
+        packet.m_sequenceNum = i;
+        packet.write(datagram);
+        checksum += datagram.size();
+    }
+    state.pauseTiming();
+
+    free_audio(audio, channels);
+    return checksum;
+}
+
+double bench_write_audio(BenchState& state)
+{
+    int channels = state.arg1;
+    float** audio = alloc_audio(channels, BUFFER_SIZE);
+    QByteArray datagram(RTP_HEADER_BYTES + RtpPacket::getPayloadSize(state.arg0, channels, BUFFER_SIZE), 0);
+
+    double checksum = 0.0;
+    state.resumeTiming();
+    for (qint64 i = 0; i < state.iterations; i++)
+    {
+        checksum += RtpPacket::writeAudio(datagram.data(), datagram.size(), i * BUFFER_SIZE, i, state.arg0, 1, channels, BUFFER_SIZE, audio);
+    }
+    state.pauseTiming();
+
+    free_audio(audio, channels);
+    return checksum;
+}
+
+double bench_read(BenchState& state)
+{
+    QByteArray datagram = make_datagram(state.arg0, state.arg1);
+    RtpPacket packet;
+
+    double checksum = 0.0;
+    state.resumeTiming();
+    for (qint64 i = 0; i < state.iterations; i++)
+    {
+        packet.read(datagram, i);
+        checksum += packet.m_payload.size();
+    }
+    state.pauseTiming();
+
+    return checksum;
+}
+
+// ------------------- StreamingAudioApp -------------------
+
+struct ProcessContext
+{
+    StreamingAudioApp* app;
+    VirtualAudioBackend* audio;
+    BenchState* state;
+    QByteArray datagram;
+    quint16 sequenceNum;
+    quint32 timestamp;
+    bool timing;
+    double checksum;
+};
+
+int process_callback(jack_nframes_t nframes, void* arg)
+{
+    ProcessContext* ctx = (ProcessContext*)arg;
+
+    // a packet arrives for every period, as from a well-behaved client
+    set_header(ctx->datagram, ctx->sequenceNum++, ctx->timestamp);
+    ctx->timestamp += nframes;
+    ctx->app->getReceiver()->handleDatagram(ctx->datagram, ctx->audio->getLastFrameTime());
+
+    // delay mode 0 keeps the delay constant, delay mode 1 changes it every period
+    int delayCurrent = PROCESS_DELAY;
+    int delayNext = PROCESS_DELAY;
+    if (ctx->state->arg1 == 1)
+    {
+        bool even = (ctx->sequenceNum % 2) == 0;
+        delayCurrent = even ? 0 : PROCESS_DELAY;
+        delayNext = even ? PROCESS_DELAY : 0;
+    }
+
+    if (ctx->timing) ctx->state->resumeTiming();
+    ctx->app->process(nframes, 1.0f, 1.0f, false, false, false, false, delayCurrent, delayNext);
+    if (ctx->timing) ctx->state->pauseTiming();
+
+    ctx->checksum += ctx->app->getOutputBuffer(0, nframes)[nframes - 1];
+    return 0;
+}
+
+double bench_process(BenchState& state)
+{
+    int channels = state.arg0;
+
+    SamParams params;
+    params.sampleRate = SAMPLE_RATE;
+    params.bufferSize = BUFFER_SIZE;
+    StreamingAudioManager sam(params);
+    VirtualAudioBackend audio(SAMPLE_RATE, BUFFER_SIZE, false);
+
+    SamAppPosition pos = {0, 0, 0, 0, 0};
+    StreamingAudioApp* app = new StreamingAudioApp("kernelbench", 0, channels, pos, TYPE_BASIC, 0, &audio, NULL, g_rtpBasePort,
+                                                   PROCESS_MAX_DELAY, PROCESS_QUEUE_SIZE, BUFFER_SIZE, &sam);
+    if (!app->init())
+    {
+        fprintf(stderr, "Couldn't initialize StreamingAudioApp (is RTP base port %u free?)\n", g_rtpBasePort);
+        exit(EXIT_FAILURE);
+    }
+
+    ProcessContext ctx;
+    ctx.app = app;
+    ctx.audio = &audio;
+    ctx.state = &state;
+    ctx.datagram = make_datagram(PAYLOAD_PCM_16, channels);
+    ctx.sequenceNum = 0;
+    ctx.timestamp = 0;
+    ctx.timing = false;
+    ctx.checksum = 0.0;
+    audio.setCallbacks(process_callback, NULL, NULL, &ctx);
+
+    // fill the packet queue before measuring
+    audio.runPeriods(PROCESS_QUEUE_SIZE + 2);
+    ctx.timing = true;
+    audio.runPeriods(state.iterations);
+
+    delete app;
+    return ctx.checksum;
+}
+
+// ------------------- OscMessage -------------------
+
+double bench_osc_write(BenchState& state)
+{
+    // a meter message for state.arg0 channels, reusing the message and buffer as SAM does
+    OscMessage msg;
+    QByteArray bytes;
+
+    double checksum = 0.0;
+    state.resumeTiming();
+    for (qint64 i = 0; i < state.iterations; i++)
+    {
+        msg.init("/sam/val/meter", "ii", (int)i, state.arg0);
+        for (int n = 0; n < 4 * state.arg0; n++)
+        {
+            msg.addFloatArg(0.25f);
+        }
+        msg.write(bytes);
+        checksum += bytes.size();
+    }
+    state.pauseTiming();
+
+    return checksum;
+}
+
+double bench_osc_read(BenchState& state)
+{
+    OscMessage msg;
+    msg.init("/sam/val/meter", "ii", 1, state.arg0);
+    for (int n = 0; n < 4 * state.arg0; n++)
+    {
+        msg.addFloatArg(0.25f);
+    }
+    QByteArray bytes;
+    msg.write(bytes);
+    OscMessage decoded;
+
+    double checksum = 0.0;
+    state.resumeTiming();
+    for (qint64 i = 0; i < state.iterations; i++)
+    {
+        decoded.read(bytes);
+        checksum += decoded.getNumArgs();
+    }
+    state.pauseTiming();
+
+    return checksum;
+}
+
+// ------------------- RtpReceiver -------------------
+
+double bench_receiver(BenchState& state)
+{
+    // each block of state.arg0 packets is delivered in reverse order, with a queue deep enough to absorb it
+    int depth = state.arg0;
+    int channels = 2;
+    RtpReceiver receiver(0, 0, 0, 1000, 0, SAMPLE_RATE, BUFFER_SIZE, 2 * depth + 2, BUFFER_SIZE, NULL);
+    float** audio = alloc_audio(channels, BUFFER_SIZE);
+    QVector<QByteArray> block(depth);
+    for (int i = 0; i < depth; i++)
+    {
+        block[i] = make_datagram(PAYLOAD_PCM_16, channels);
+    }
+
+    quint32 playtime = 0;
+    quint16 sequenceNum = 0;
+    quint32 timestamp = 0;
+    double checksum = 0.0;
+    qint64 warmup = 4 * depth + 4;
+    for (qint64 p = 0; p < state.iterations + warmup; p++)
+    {
+        if (p == warmup) state.resumeTiming();
+
+        set_header(block[p % depth], sequenceNum++, timestamp);
+        timestamp += BUFFER_SIZE;
+        if (p % depth == depth - 1)
+        {
+            for (int i = depth - 1; i >= 0; i--)
+            {
+                receiver.handleDatagram(block[i], playtime);
+            }
+        }
+
+        receiver.receiveAudio(audio, channels, BUFFER_SIZE, playtime);
+        playtime += BUFFER_SIZE;
+        checksum += audio[0][0];
+    }
+    state.pauseTiming();
+
+    if (g_verbose)
+    {
+        printf("RtpReceiver (reorder depth %d): %llu received, %llu late, %llu skipped, %llu periods missed\n", depth,
+               receiver.getPacketsReceived(), receiver.getPacketsLate(), receiver.getPacketsSkipped(), receiver.getPeriodsMissed());
+    }
+
+    free_audio(audio, channels);
+    return checksum;
+}
+
+// ------------------- harness -------------------
+
+void add_case(QVector<BenchCase>& cases, const QByteArray& name, BenchFunction function, int arg0, int arg1)
+{
+    BenchCase bc;
+    bc.name = name;
+    bc.function = function;
+    bc.arg0 = arg0;
+    bc.arg1 = arg1;
+    cases.append(bc);
+}
+
+void init_cases(QVector<BenchCase>& cases)
+{
+    const quint8 payloadTypes[3] = {PAYLOAD_PCM_16, PAYLOAD_PCM_24, PAYLOAD_PCM_32};
+    const char* payloadNames[3] = {"pcm16", "pcm24", "pcm32"};
+    for (int t = 0; t < 3; t++)
+    {
+        QByteArray suffix = QByteArray("/") + payloadNames[t] + "/2ch";
+        add_case(cases, QByteArray("RtpPacket::setPayload") + suffix, bench_set_payload, payloadTypes[t], 2);
+        add_case(cases, QByteArray("RtpPacket::getPayload") + suffix, bench_get_payload, payloadTypes[t], 2);
+        add_case(cases, QByteArray("RtpPacket::write") + suffix, bench_write, payloadTypes[t], 2);
+        add_case(cases, QByteArray("RtpPacket::writeAudio") + suffix, bench_write_audio, payloadTypes[t], 2);
+        add_case(cases, QByteArray("RtpPacket::read") + suffix, bench_read, payloadTypes[t], 2);
+    }
+
+    const int channelCounts[4] = {1, 2, 8, 32};
+    for (int c = 0; c < 4; c++)
+    {
+        QByteArray prefix = QByteArray("StreamingAudioApp::process/") + QByteArray::number(channelCounts[c]) + "ch";
+        add_case(cases, prefix + "/constant_delay", bench_process, channelCounts[c], 0);
+        add_case(cases, prefix + "/changing_delay", bench_process, channelCounts[c], 1);
+    }
+
+    add_case(cases, "OscMessage::write/meter_2ch", bench_osc_write, 2, 0);
+    add_case(cases, "OscMessage::read/meter_2ch", bench_osc_read, 2, 0);
+
+    const int depths[3] = {1, 4, 16};
+    for (int d = 0; d < 3; d++)
+    {
+        add_case(cases, QByteArray("RtpReceiver::insert_receive/reorder_") + QByteArray::number(depths[d]), bench_receiver, depths[d], 0);
+    }
+}
+
+BenchResult run_case(const BenchCase& bc, double minSeconds, int repetitions)
+{
+    BenchResult result;
+    double minNanos = minSeconds * 1.0e9;
+
+    // calibrate: grow the iteration count until a run takes a tenth of the minimum time, then scale up
+    qint64 iterations = 1;
+    while (true)
+    {
+        BenchState state(iterations, bc.arg0, bc.arg1);
+        bc.function(state);
+        qint64 nanos = qMax(state.getNanos(), (qint64)1);
+        if (nanos >= minNanos / 10 || iterations >= MAX_ITERATIONS)
+        {
+            iterations = qMin((qint64)(iterations * (minNanos / nanos)) + 1, MAX_ITERATIONS);
+            break;
+        }
+        iterations *= 10;
+    }
+
+    QVector<double> perIteration;
+    result.checksum = 0.0;
+    for (int r = 0; r < repetitions; r++)
+    {
+        BenchState state(iterations, bc.arg0, bc.arg1);
+        result.checksum += bc.function(state);
+        perIteration.append((double)state.getNanos() / iterations);
+    }
+    qSort(perIteration);
+
+    result.iterations = iterations;
+    result.medianNanos = perIteration[perIteration.size() / 2];
+    result.minNanos = perIteration.first();
+    result.maxNanos = perIteration.last();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const char* filter = NULL;
+    const char* jsonPath = NULL;
+    double minSeconds = DEFAULT_MIN_SECONDS;
+    int repetitions = DEFAULT_REPETITIONS;
+    bool listOnly = false;
+
+    // parse command-line parameters
+    while (true)
+    {
+        static struct option long_options[] = {
+            {"filter", required_argument, 0, 'f'},
+            {"time", required_argument, 0, 't'},
+            {"repetitions", required_argument, 0, 'r'},
+            {"json", required_argument, 0, 'j'},
+            {"port", required_argument, 0, 'p'},
+            {"list", no_argument, 0, 'l'},
+            {"verbose", no_argument, 0, 'v'},
+            {"help", no_argument, 0, 'h'},
+            {0, 0, 0, 0}
+        };
+
+        int option_index = 0;
+        int c = getopt_long(argc, argv, "f:t:r:j:p:lvh", long_options, &option_index);
+        if (c == -1) break;
+
+        switch (c)
+        {
+        case 'f':
+            filter = optarg;
+            break;
+        case 't':
+            minSeconds = atof(optarg);
+            break;
+        case 'r':
+            repetitions = atoi(optarg);
+            break;
+        case 'j':
+            jsonPath = optarg;
+            break;
+        case 'p':
+            g_rtpBasePort = atoi(optarg);
+            break;
+        case 'l':
+            listOnly = true;
+            break;
+        case 'v':
+            g_verbose = true;
+            break;
+        case 'h':
+        default:
+            print_help();
+            exit(EXIT_SUCCESS);
+        }
+    }
+    if (minSeconds <= 0.0 || repetitions <= 0)
+    {
+        print_help();
+        exit(EXIT_FAILURE);
+    }
+
+#if QT_VERSION >= 0x050000
+    qInstallMessageHandler(message_handler);
+#else
+    qInstallMsgHandler(message_handler);
+#endif
+
+    QVector<BenchCase> cases;
+    init_cases(cases);
+
+    FILE* json = NULL;
+    if (jsonPath && !listOnly)
+    {
+        json = fopen(jsonPath, "w");
+        if (!json)
+        {
+            fprintf(stderr, "Couldn't open %s\n", jsonPath);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(json, "{\n  \"sampleRate\": %d,\n  \"bufferSize\": %d,\n  \"repetitions\": %d,\n  \"benchmarks\": [\n", SAMPLE_RATE, BUFFER_SIZE, repetitions);
+    }
+
+    if (!listOnly)
+    {
+        printf("%d frames per period, %d repetitions of at least %.2f s each (median reported)\n", BUFFER_SIZE, repetitions, minSeconds);
+        printf("%-52s %12s %12s %12s %12s\n", "benchmark", "ns/op", "min", "max", "iterations");
+    }
+
+    bool first = true;
+    for (int i = 0; i < cases.size(); i++)
+    {
+        if (filter && !cases[i].name.contains(filter)) continue;
+        if (listOnly)
+        {
+            printf("%s\n", cases[i].name.constData());
+            continue;
+        }
+
+        BenchResult result = run_case(cases[i], minSeconds, repetitions);
+        printf("%-52s %12.1f %12.1f %12.1f %12lld\n", cases[i].name.constData(), result.medianNanos, result.minNanos, result.maxNanos, result.iterations);
+        if (g_verbose) printf("  checksum %f\n", result.checksum);
+        fflush(stdout);
+
+        if (json)
+        {
+            fprintf(json, "%s    {\"name\": \"%s\", \"iterations\": %lld, \"medianNanos\": %.2f, \"minNanos\": %.2f, \"maxNanos\": %.2f}",
+                    first ? "" : ",\n", cases[i].name.constData(), result.iterations, result.medianNanos, result.minNanos, result.maxNanos);
+        }
+        first = false;
+    }
+
+    if (json)
+    {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+# oscbench: OSC dispatch throughput benchmark
+#
+#-------------------------------------------------
+
+QT       += core network
+
+QT       -= gui
+
+TARGET = oscbench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+ParentDirectory = ../../../..
+
+UI_DIR = "$$ParentDirectory/build/oscbench"
+MOC_DIR = "$$ParentDirectory/build/oscbench"
+OBJECTS_DIR = "$$ParentDirectory/build/oscbench"
+
+CONFIG(debug, debug|release) {
+    DESTDIR = "$$ParentDirectory/bin/debug"
+}
+CONFIG(release, debug|release) {
+    DESTDIR = "$$ParentDirectory/bin"
+}
+
+SOURCES += oscbench_main.cpp \
+    ../../../osc.cpp
+
+HEADERS += \
+    ../../../osc.h
+
+INCLUDEPATH += $$ParentDirectory/src
+
+message(oscbench.pro complete)
@@ -0,0 +1,403 @@
+/**
+ * @file test/oscbench/oscbench_main.cpp
+ * oscbench: command-line benchmark for OSC dispatch (string comparison ladder vs. OscDispatcher), OscMessage encoding/decoding and SLIP stream decoding
+ * @author agent
+ * @date October 2026
+ * @copyright UCSD 2026
+ * @license New BSD License: http://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#include "osc.h"
+
+using namespace sam;
+
+static const int DEFAULT_ITERATIONS = 1000000;
+static const int SLIP_SEGMENT_TRIALS = 1000;    // number of random segmentations of the SLIP stream to check
+static const int SLIP_MAX_SEGMENT = 64;         // largest random segment size (bytes)
+
+// method ids shared by both dispatch strategies
+static const int ID_UNKNOWN = -1;
+static const int ID_QUIT = 0;
+static const int ID_APP_REGISTER = 1;
+static const int ID_APP_UNREGISTER = 2;
+static const int ID_UI_REGISTER = 3;
+static const int ID_UI_UNREGISTER = 4;
+static const int ID_RENDER_REGISTER = 5;
+static const int ID_RENDER_UNREGISTER = 6;
+static const int ID_SET_BASE = 10;
+static const int ID_GET_BASE = 20;
+static const int ID_SUBSCRIBE_BASE = 30;
+static const int ID_UNSUBSCRIBE_BASE = 40;
+
+static const int NUM_PARAMS = 7;
+static const char* PARAM_NAMES[NUM_PARAMS] = {"volume", "mute", "solo", "delay", "position", "type", "meter"};
+static const char* SET_TYPES[NUM_PARAMS] = {"if", "ii", "ii", "if", "iiiiii", "iiii", NULL};
+
+void print_help()
+{
+    printf("Usage: [oscbench --iterations or -n number of messages to dispatch per test]\n");
+    printf("\nExample usage:\n");
+    printf("oscbench -n 1000000\n");
+    printf("\n");
+}
+
+/**
+ * Find the index of a parameter name following a second-level address, as the old SAM ladders did.
+ * @param address the third level of the address (e.g. "/volume")
+ * @return the parameter index, or -1 if the parameter is unknown
+ */
+int ladder_param(const char* address)
+{
+    if (qstrcmp(address, "/volume") == 0) return 0;
+    else if (qstrcmp(address, "/mute") == 0) return 1;
+    else if (qstrcmp(address, "/solo") == 0) return 2;
+    else if (qstrcmp(address, "/delay") == 0) return 3;
+    else if (qstrcmp(address, "/position") == 0) return 4;
+    else if (qstrcmp(address, "/type") == 0) return 5;
+    else if (qstrcmp(address, "/meter") == 0) return 6;
+    return -1;
+}
+
+/**
+ * Dispatch a message using nested qstrncmp/qstrcmp ladders, mirroring StreamingAudioManager before OscDispatcher.
+ * @param msg the message to dispatch
+ * @return the method id, or ID_UNKNOWN if no method matches
+ */
+int ladder_dispatch(OscMessage* msg)
+{
+    int prefixLen = 5; // prefix is "/sam/"
+    const char* address = msg->getAddress();
+    if (qstrncmp(address, "/sam/", prefixLen) != 0)
+    {
+        return ID_UNKNOWN;
+    }
+
+    if (qstrcmp(address + prefixLen, "quit") == 0) // /sam/quit
+    {
+        return msg->typeMatches("") ? ID_QUIT : ID_UNKNOWN;
+    }
+    else if (qstrncmp(address + prefixLen, "app", 3) == 0)
+    {
+        address += prefixLen + 3;
+        if (qstrcmp(address, "/register") == 0) return ID_APP_REGISTER;
+        else if (qstrcmp(address, "/unregister") == 0 && msg->typeMatches("i")) return ID_APP_UNREGISTER;
+    }
+    else if (qstrncmp(address + prefixLen, "ui", 2) == 0)
+    {
+        address += prefixLen + 2;
+        if (qstrcmp(address, "/register") == 0 && msg->typeMatches("iiii")) return ID_UI_REGISTER;
+        else if (qstrcmp(address, "/unregister") == 0 && msg->typeMatches("i")) return ID_UI_UNREGISTER;
+    }
+    else if (qstrncmp(address + prefixLen, "render", 6) == 0)
+    {
+        address += prefixLen + 6;
+        if (qstrcmp(address, "/register") == 0 && msg->typeMatches("iiii")) return ID_RENDER_REGISTER;
+        else if (qstrcmp(address, "/unregister") == 0 && msg->typeMatches("")) return ID_RENDER_UNREGISTER;
+    }
+    else if (qstrncmp(address + prefixLen, "set", 3) == 0)
+    {
+        int param = ladder_param(address + prefixLen + 3);
+        if (param >= 0 && SET_TYPES[param] && msg->typeMatches(SET_TYPES[param])) return ID_SET_BASE + param;
+    }
+    else if (qstrncmp(address + prefixLen, "get", 3) == 0)
+    {
+        int param = ladder_param(address + prefixLen + 3);
+        if (param >= 0 && msg->typeMatches("ii")) return ID_GET_BASE + param;
+    }
+    else if (qstrncmp(address + prefixLen, "subscribe", 9) == 0)
+    {
+        int param = ladder_param(address + prefixLen + 9);
+        if (param >= 0 && msg->typeMatches("ii")) return ID_SUBSCRIBE_BASE + param;
+    }
+    else if (qstrncmp(address + prefixLen, "unsubscribe", 11) == 0)
+    {
+        int param = ladder_param(address + prefixLen + 11);
+        if (param >= 0 && msg->typeMatches("ii")) return ID_UNSUBSCRIBE_BASE + param;
+    }
+    return ID_UNKNOWN;
+}
+
+/**
+ * Register the SAM address space with a dispatcher, using the same ids as ladder_dispatch.
+ * @param dispatcher the dispatcher to initialize
+ */
+void init_dispatcher(OscDispatcher& dispatcher)
+{
+    dispatcher.addMethod("/sam/quit", "", ID_QUIT);
+    dispatcher.addMethod("/sam/app/register", NULL, ID_APP_REGISTER);
+    dispatcher.addMethod("/sam/app/unregister", "i", ID_APP_UNREGISTER);
+    dispatcher.addMethod("/sam/ui/register", "iiii", ID_UI_REGISTER);
+    dispatcher.addMethod("/sam/ui/unregister", "i", ID_UI_UNREGISTER);
+    dispatcher.addMethod("/sam/render/register", "iiii", ID_RENDER_REGISTER);
+    dispatcher.addMethod("/sam/render/unregister", "", ID_RENDER_UNREGISTER);
+    for (int param = 0; param < NUM_PARAMS; param++)
+    {
+        if (SET_TYPES[param])
+        {
+            dispatcher.addMethod((QByteArray("/sam/set/") + PARAM_NAMES[param]).constData(), SET_TYPES[param], ID_SET_BASE + param, true);
+        }
+        dispatcher.addMethod((QByteArray("/sam/get/") + PARAM_NAMES[param]).constData(), "ii", ID_GET_BASE + param, true);
+        dispatcher.addMethod((QByteArray("/sam/subscribe/") + PARAM_NAMES[param]).constData(), "ii", ID_SUBSCRIBE_BASE + param, true);
+        dispatcher.addMethod((QByteArray("/sam/unsubscribe/") + PARAM_NAMES[param]).constData(), "ii", ID_UNSUBSCRIBE_BASE + param, true);
+    }
+}
+
+/**
+ * Build a representative mix of control messages, weighted toward the parameter messages sent during a session.
+ * @param msgs vector to fill with newly allocated messages
+ */
+void init_messages(QVector<OscMessage*>& msgs)
+{
+    OscMessage* msg = NULL;
+    for (int param = 0; param < NUM_PARAMS; param++)
+    {
+        if (SET_TYPES[param])
+        {
+            msg = new OscMessage();
+            msg->init((QByteArray("/sam/set/") + PARAM_NAMES[param]).constData(), NULL);
+            for (const char* t = SET_TYPES[param]; *t; t++)
+            {
+                if (*t == 'i') msg->addIntArg(1);
+                else msg->addFloatArg(0.5f);
+            }
+            msgs.append(msg);
+        }
+        const char* prefixes[3] = {"/sam/get/", "/sam/subscribe/", "/sam/unsubscribe/"};
+        for (int p = 0; p < 3; p++)
+        {
+            msg = new OscMessage();
+            msg->init((QByteArray(prefixes[p]) + PARAM_NAMES[param]).constData(), "ii", 1, 7770);
+            msgs.append(msg);
+        }
+    }
+    msg = new OscMessage();
+    msg->init("/sam/ui/register", "iiii", 0, 0, 0, 7771);
+    msgs.append(msg);
+    msg = new OscMessage();
+    msg->init("/sam/render/unregister", NULL);
+    msgs.append(msg);
+    msg = new OscMessage();
+    msg->init("/sam/unknown/address", "i", 1);
+    msgs.append(msg);
+}
+
+/**
+ * Build a SLIP-encoded stream from a set of messages, as a TCP peer would send it.
+ * @param msgs the messages to encode
+ * @param stream the stream to build
+ * @param packets the unencoded packets, in the order they appear in the stream
+ */
+void init_slip_stream(const QVector<OscMessage*>& msgs, QByteArray& stream, QVector<QByteArray>& packets)
+{
+    // a blob containing the SLIP special characters makes sure escapes get split across segments too
+    char special[8] = {SLIP_END, SLIP_ESC, SLIP_END, SLIP_END, SLIP_ESC, SLIP_ESC, 0, SLIP_END};
+    OscMessage blobMsg;
+    blobMsg.init("/sam/val/blob", "i", 1);
+    blobMsg.addBlobArg(special, sizeof(special));
+
+    QByteArray packet;
+    for (int i = 0; i <= msgs.size(); i++)
+    {
+        OscMessage* msg = (i < msgs.size()) ? msgs[i] : &blobMsg;
+        msg->write(packet);
+        packets.append(packet);
+        OscMessage::slipEncode(packet);
+        stream.append(SLIP_END);
+        stream.append(packet);
+        stream.append(SLIP_END);
+    }
+}
+
+/**
+ * Check that a SLIP stream decodes correctly no matter how it is split into segments.
+ * @param stream the SLIP-encoded stream
+ * @param packets the packets expected from the stream
+ * @return true if every random segmentation decoded to the expected packets, false otherwise
+ */
+bool check_slip_segmentation(const QByteArray& stream, const QVector<QByteArray>& packets)
+{
+    srand(1);
+    for (int trial = 0; trial < SLIP_SEGMENT_TRIALS; trial++)
+    {
+        OscSlipDecoder decoder;
+        int numPackets = 0;
+        int pos = 0;
+        while (pos < stream.size())
+        {
+            int segment = qMin(1 + rand() % SLIP_MAX_SEGMENT, stream.size() - pos);
+            const char* data = stream.constData() + pos;
+            const char* end = data + segment;
+            while (decoder.decode(data, end))
+            {
+                if (numPackets >= packets.size() || QByteArray(decoder.getPacket(), decoder.getPacketSize()) != packets[numPackets])
+                {
+                    printf("SLIP packet %d decoded incorrectly (trial %d)\n", numPackets, trial);
+                    return false;
+                }
+                numPackets++;
+            }
+            pos += segment;
+        }
+        if (numPackets != packets.size() || decoder.getNumDiscarded() > 0)
+        {
+            printf("SLIP stream decoded %d of %d packets, discarded %llu bytes (trial %d)\n", numPackets, packets.size(), decoder.getNumDiscarded(), trial);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = DEFAULT_ITERATIONS;
+
+    // parse command-line parameters
+    while (true)
+    {
+        static struct option long_options[] = {
+            {"iterations", required_argument, 0, 'n'},
+            {"help", no_argument, 0, 'h'},
+            {0, 0, 0, 0}
+        };
+
+        int option_index = 0;
+        int c = getopt_long(argc, argv, "n:h", long_options, &option_index);
+        if (c == -1) break;
+
+        switch (c)
+        {
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'h':
+        default:
+            print_help();
+            exit(EXIT_SUCCESS);
+        }
+    }
+    if (iterations <= 0)
+    {
+        print_help();
+        exit(EXIT_FAILURE);
+    }
+
+    OscDispatcher dispatcher;
+    init_dispatcher(dispatcher);
+    QVector<OscMessage*> msgs;
+    init_messages(msgs);
+
+    // check that both strategies agree before timing them
+    for (int i = 0; i < msgs.size(); i++)
+    {
+        const QVector<int>& ids = dispatcher.match(msgs[i]);
+        int id = ids.isEmpty() ? ID_UNKNOWN : ids[0];
+        if (id != ladder_dispatch(msgs[i]))
+        {
+            printf("Mismatch for message:\n");
+            msgs[i]->print();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // check that the SLIP decoder copes with arbitrary TCP segmentation
+    QByteArray slipStream;
+    QVector<QByteArray> slipPackets;
+    init_slip_stream(msgs, slipStream, slipPackets);
+    if (!check_slip_segmentation(slipStream, slipPackets))
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    QElapsedTimer timer;
+    qint64 checksum = 0;
+
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+    {
+        checksum += ladder_dispatch(msgs[i % msgs.size()]);
+    }
+    qint64 ladderNanos = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < iterations; i++)
+    {
+        const QVector<int>& ids = dispatcher.match(msgs[i % msgs.size()]);
+        checksum -= ids.isEmpty() ? ID_UNKNOWN : ids[0];
+    }
+    qint64 dispatcherNanos = timer.nsecsElapsed();
+
+    // pattern addresses (e.g. addressing a group of parameters) can only be handled by the dispatcher
+    OscMessage pattern;
+    pattern.init("/sam/{get,subscribe}/[mv]*", "ii", 1, 7770);
+    timer.restart();
+    for (int i = 0; i < iterations; i++)
+    {
+        checksum += dispatcher.match(&pattern).size();
+    }
+    qint64 patternNanos = timer.nsecsElapsed();
+
+    // encode and decode a 2-channel meter message, reusing the message and buffer as SAM does
+    OscMessage meterMsg;
+    OscMessage decodedMsg;
+    QByteArray meterBytes;
+    timer.restart();
+    for (int i = 0; i < iterations; i++)
+    {
+        meterMsg.init("/sam/val/meter", "ii", i, 2);
+        for (int n = 0; n < 8; n++)
+        {
+            meterMsg.addFloatArg(0.25f);
+        }
+        meterMsg.write(meterBytes);
+    }
+    qint64 writeNanos = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < iterations; i++)
+    {
+        decodedMsg.read(meterBytes);
+        checksum += decodedMsg.getNumArgs();
+    }
+    qint64 readNanos = timer.nsecsElapsed();
+
+    // decode the SLIP stream in socket-sized reads, as OscTcpSocketReader does
+    OscSlipDecoder decoder;
+    int slipDecoded = 0;
+    timer.restart();
+    while (slipDecoded < iterations)
+    {
+        for (int pos = 0; pos < slipStream.size(); pos += OSC_TCP_READ_SIZE)
+        {
+            const char* data = slipStream.constData() + pos;
+            const char* end = data + qMin(OSC_TCP_READ_SIZE, slipStream.size() - pos);
+            while (decoder.decode(data, end))
+            {
+                checksum += decoder.getPacketSize();
+                slipDecoded++;
+            }
+        }
+    }
+    qint64 slipNanos = timer.nsecsElapsed();
+
+    printf("%d messages per test (%d distinct addresses), checksum %lld\n", iterations, msgs.size(), checksum);
+    printf("qstrcmp ladder:       %8.1f ns/msg  %12.0f msgs/sec\n", (double)ladderNanos / iterations, iterations * 1.0e9 / ladderNanos);
+    printf("OscDispatcher:        %8.1f ns/msg  %12.0f msgs/sec\n", (double)dispatcherNanos / iterations, iterations * 1.0e9 / dispatcherNanos);
+    printf("OscDispatcher (pattern, %d matches): %8.1f ns/msg  %12.0f msgs/sec\n", dispatcher.match(&pattern).size(), (double)patternNanos / iterations, iterations * 1.0e9 / patternNanos);
+
+    printf("OscMessage::write (meter, %d bytes): %8.1f ns/msg  %12.0f msgs/sec\n", meterBytes.size(), (double)writeNanos / iterations, iterations * 1.0e9 / writeNanos);
+    printf("OscMessage::read (meter, %d bytes):  %8.1f ns/msg  %12.0f msgs/sec\n", meterBytes.size(), (double)readNanos / iterations, iterations * 1.0e9 / readNanos);
+    printf("OscSlipDecoder (%d-byte stream, %d segmentations checked): %8.1f ns/msg  %12.0f msgs/sec\n", slipStream.size(), SLIP_SEGMENT_TRIALS, (double)slipNanos / slipDecoded, slipDecoded * 1.0e9 / slipNanos);
+
+    for (int i = 0; i < msgs.size(); i++)
+    {
+        delete msgs[i];
+    }
+    return EXIT_SUCCESS;
+}
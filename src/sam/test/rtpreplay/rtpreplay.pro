@@ -0,0 +1,52 @@
+#-------------------------------------------------
+#
+# rtpreplay: replays captured RTP traffic through RtpReceiver
+#
+#-------------------------------------------------
+
+QT       += core network
+
+QT       -= gui
+
+TARGET = rtpreplay
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+ParentDirectory = ../../../..
+
+UI_DIR = "$$ParentDirectory/build/rtpreplay"
+MOC_DIR = "$$ParentDirectory/build/rtpreplay"
+OBJECTS_DIR = "$$ParentDirectory/build/rtpreplay"
+
+CONFIG(debug, debug|release) {
+    DESTDIR = "$$ParentDirectory/bin/debug"
+}
+CONFIG(release, debug|release) {
+    DESTDIR = "$$ParentDirectory/bin"
+}
+
+SOURCES += rtpreplay_main.cpp \
+    ../impairment.cpp \
+    ../../rtpreceiver.cpp \
+    ../../rtpcapture.cpp \
+    ../../sam_audio_backend.cpp \
+    ../../jack_util.cpp \
+    ../../../rtp.cpp \
+    ../../../rtcp.cpp
+
+HEADERS += \
+    ../impairment.h \
+    ../../rtpreceiver.h \
+    ../../rtpcapture.h \
+    ../../sam_audio_backend.h \
+    ../../jack_util.h \
+    ../../../rtp.h \
+    ../../../rtcp.h
+
+INCLUDEPATH += /usr/local/include $$ParentDirectory/src $$ParentDirectory/src/sam $$ParentDirectory/src/sam/test
+
+LIBS += -ljack
+
+message(rtpreplay.pro complete)
@@ -0,0 +1,261 @@
+/**
+ * @file test/rtpreplay/rtpreplay_main.cpp
+ * rtpreplay: replays an RTP capture recorded by SAM (/sam/capture/start) through RtpReceiver with a simulated JACK clock
+ * @author agent
+ * @date October 2026
+ * @copyright UCSD 2026
+ * @license New BSD License: http://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+
+#include "impairment.h"
+#include "rtpcapture.h"
+#include "rtpreceiver.h"
+
+using namespace sam;
+
+static bool g_verbose = false;
+
+void print_help()
+{
+    printf("Usage: rtpreplay [options] capture_file\n");
+    printf("Options:\n");
+    printf("  --queue or -q\t\tpacket queue size (default: as captured)\n");
+    printf("  --skew or -s\t\tclock skew threshold in samples (default: as captured)\n");
+    printf("  --output or -o\tfile to write the played audio to (interleaved 32-bit float)\n");
+    printf("  --impair or -i\timpair the captured datagrams before replaying them, as a comma-separated list of:\n");
+    printf("\t\t\tdelay=ms, jitter=ms, dist=uniform|normal|pareto, loss=p, burst=enter:exit[:loss],\n");
+    printf("\t\t\treorder=p[:ms], dup=p, drift=ppm, seed=n\n");
+    printf("  --verbose or -v\tprint the receiver's warnings\n");
+    printf("\nExample usage:\n");
+    printf("rtpreplay -q 6 -o replay.raw app1.rtpcap\n");
+    printf("rtpreplay -i \"jitter=5,dist=pareto,burst=0.001:0.2,reorder=0.01,seed=7\" app1.rtpcap\n");
+    printf("\n");
+}
+
+#if QT_VERSION >= 0x050000
+void message_handler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+{
+    if (g_verbose || type == QtFatalMsg)
+    {
+        QByteArray msgBytes = msg.toLocal8Bit();
+        fprintf(stderr, "%s\n", msgBytes.constData());
+    }
+    if (type == QtFatalMsg) abort();
+}
+#else
+void message_handler(QtMsgType type, const char* msg)
+{
+    if (g_verbose || type == QtFatalMsg)
+    {
+        fprintf(stderr, "%s\n", msg);
+    }
+    if (type == QtFatalMsg) abort();
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int packetQueueSize = -1;
+    int clockSkewThreshold = -1;
+    const char* outputPath = NULL;
+    ImpairmentParams impairParams;
+    bool impair = false;
+
+    // parse command-line parameters
+    while (true)
+    {
+        static struct option long_options[] = {
+            {"queue", required_argument, 0, 'q'},
+            {"skew", required_argument, 0, 's'},
+            {"output", required_argument, 0, 'o'},
+            {"impair", required_argument, 0, 'i'},
+            {"verbose", no_argument, 0, 'v'},
+            {"help", no_argument, 0, 'h'},
+            {0, 0, 0, 0}
+        };
+
+        int option_index = 0;
+        int c = getopt_long(argc, argv, "q:s:o:i:vh", long_options, &option_index);
+        if (c == -1) break;
+
+        switch (c)
+        {
+        case 'q':
+            packetQueueSize = atoi(optarg);
+            break;
+        case 's':
+            clockSkewThreshold = atoi(optarg);
+            break;
+        case 'o':
+            outputPath = optarg;
+            break;
+        case 'i':
+            if (!NetworkImpairment::parse(optarg, impairParams))
+            {
+                fprintf(stderr, "Invalid impairment: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            impair = true;
+            break;
+        case 'v':
+            g_verbose = true;
+            break;
+        case 'h':
+        default:
+            print_help();
+            exit(EXIT_SUCCESS);
+        }
+    }
+    if (optind != argc - 1)
+    {
+        print_help();
+        exit(EXIT_FAILURE);
+    }
+
+#if QT_VERSION >= 0x050000
+    qInstallMessageHandler(message_handler);
+#else
+    qInstallMsgHandler(message_handler);
+#endif
+
+    RtpCapture capture;
+    if (!capture.open(QString::fromLocal8Bit(argv[optind])))
+    {
+        fprintf(stderr, "Couldn't open capture file %s\n", argv[optind]);
+        exit(EXIT_FAILURE);
+    }
+    const RtpCaptureInfo& info = capture.getInfo();
+    if (info.channels == 0 || info.bufferSize == 0 || info.sampleRate == 0)
+    {
+        fprintf(stderr, "Capture file has invalid parameters\n");
+        exit(EXIT_FAILURE);
+    }
+    if (packetQueueSize < 0) packetQueueSize = info.packetQueueSize;
+    if (clockSkewThreshold < 0) clockSkewThreshold = info.clockSkewThreshold;
+
+    FILE* output = NULL;
+    if (outputPath)
+    {
+        output = fopen(outputPath, "wb");
+        if (!output)
+        {
+            fprintf(stderr, "Couldn't open output file %s\n", outputPath);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // the receiver is never started, so it doesn't bind any sockets or need JACK
+    RtpReceiver receiver(0, 0, 0, 1000, 0, info.sampleRate, info.bufferSize, packetQueueSize, clockSkewThreshold, NULL);
+
+    int channels = info.channels;
+    int frames = info.bufferSize;
+    float** audio = new float*[channels];
+    for (int ch = 0; ch < channels; ch++)
+    {
+        audio[ch] = new float[frames];
+    }
+    float* interleaved = new float[channels * frames];
+
+    // datagrams pass through the impairment in simulated time (microseconds since the period origin)
+    NetworkImpairment impairment(impairParams);
+    if (impair) impairment.print();
+
+    // simulate the JACK clock: the process callback for the period starting at playtime runs
+    // before any datagram that arrives during that period is handled
+    quint32 playtime = info.periodOrigin;
+    quint64 periods = 0;
+    int drainPeriods = packetQueueSize + 2; // periods to play after the last datagram so the queue empties
+    double checksum = 0.0;
+    quint32 arrivalTime = 0;
+    QByteArray datagram;
+    bool more = capture.next(arrivalTime, datagram);
+
+    QElapsedTimer timer;
+    timer.start();
+    while (true)
+    {
+        while (more && (qint32)(arrivalTime - playtime) < 0)
+        {
+            if (impair)
+            {
+                qint64 sendMicros = ((qint64)(qint32)(arrivalTime - info.periodOrigin) * 1000000) / info.sampleRate;
+                impairment.push(sendMicros, datagram);
+            }
+            else
+            {
+                receiver.handleDatagram(datagram, arrivalTime);
+            }
+            more = capture.next(arrivalTime, datagram);
+        }
+        if (impair)
+        {
+            // deliver everything that has arrived by the start of this period
+            qint64 playMicros = ((qint64)(qint32)(playtime - info.periodOrigin) * 1000000) / info.sampleRate;
+            QByteArray impaired;
+            qint64 impairedMicros = 0;
+            while (impairment.pop(playMicros - 1, impaired, impairedMicros))
+            {
+                quint32 impairedTime = info.periodOrigin + (qint32)((impairedMicros * info.sampleRate) / 1000000);
+                receiver.handleDatagram(impaired, impairedTime);
+            }
+        }
+        if (!more && impairment.isEmpty() && drainPeriods-- <= 0)
+        {
+            break;
+        }
+
+        receiver.receiveAudio(audio, channels, frames, playtime);
+        for (int ch = 0; ch < channels; ch++)
+        {
+            for (int n = 0; n < frames; n++)
+            {
+                checksum += audio[ch][n];
+                interleaved[n * channels + ch] = audio[ch][n];
+            }
+        }
+        if (output)
+        {
+            fwrite(interleaved, sizeof(float), channels * frames, output);
+        }
+        playtime += frames;
+        periods++;
+    }
+    qint64 nanos = timer.nsecsElapsed();
+
+    if (output)
+    {
+        fclose(output);
+    }
+
+    double seconds = (double)periods * frames / info.sampleRate;
+    printf("%llu datagrams, %d channels, %d Hz, %d frames/period, packet queue %d, clock skew threshold %d\n", capture.getNumDatagrams(), channels, info.sampleRate, frames, packetQueueSize, clockSkewThreshold);
+    printf("Periods played:    %llu (%.2f seconds of audio)\n", periods, seconds);
+    printf("Periods missed:    %llu\n", receiver.getPeriodsMissed());
+    printf("Packets received:  %llu\n", receiver.getPacketsReceived());
+    printf("Packets late:      %llu\n", receiver.getPacketsLate());
+    printf("Packets skipped:   %llu\n", receiver.getPacketsSkipped());
+    if (impair)
+    {
+        printf("Impairment:        %llu lost, %llu reordered, %llu duplicated\n", impairment.getPacketsLost(), impairment.getPacketsReordered(), impairment.getPacketsDuplicated());
+    }
+    printf("Checksum:          %.6f\n", checksum);
+    printf("Replay time:       %.3f ms (%.0fx real time)\n", nanos / 1.0e6, (nanos > 0) ? seconds * 1.0e9 / nanos : 0.0);
+
+    for (int ch = 0; ch < channels; ch++)
+    {
+        delete[] audio[ch];
+    }
+    delete[] audio;
+    delete[] interleaved;
+
+    return 0;
+}
@@ -27,12 +27,15 @@ CONFIG(release, debug|release) {
     DESTDIR = "$$ParentDirectory/bin"
 }
 
-SOURCES += samtest_main.cpp
+SOURCES += samtest_main.cpp \
+    impairment.cpp
 
 HEADERS += \
-    samtester.h
+    samtester.h \
+    impairment.h
 
 INCLUDEPATH += $$ParentDirectory/src/client
 LIBS += -L$$ParentDirectory/lib -lsac -ljack
+unix:!macx: LIBS += -lrt # for shm_open (libsac SharedAudioRing)
 
 message(samtest.pro complete)
@@ -13,6 +13,8 @@
 #include <QtCore/QCoreApplication>
 
 #include "samtester.h"
+#include "impairment.h"
+#include "sam_client_group.h"
 
 void print_help()
 {
@@ -21,9 +23,24 @@ void print_help()
     printf("--maxclients or -m max number of clients to register\n");
     printf("--channels or -c number of channels per client\n");
     printf("--interval or -t interval between adding clients (millis)\n");
-    printf("--mode or -d testing mode (0 = stress test, 1 = parallel test)\n");
+    printf("--mode or -d testing mode (0 = stress test, 1 = parallel test, 2 = benchmark, 3 = impairment proxy,\n");
+    printf("    4 = multi-stream test: one client group sends maxclients streams from a single audio thread)\n");
+    printf("\nBenchmark options (the interval is the measurement time for each step):\n");
+    printf("--start or -s number of clients in the first step (default 1)\n");
+    printf("--step or -n number of clients added for each following step (default 1)\n");
+    printf("--bits or -b bits per sample sent by each client (16, 24 or 32, default 16)\n");
+    printf("--queue or -q packet queue size requested by each client (default: SAM's)\n");
+    printf("--monitor or -w SAM JACK output port to monitor for latency markers (default: the port connected to the first physical output)\n");
+    printf("--output or -o file to write the JSON results to (default: stdout)\n");
+    printf("\nImpairment proxy options (datagrams received on the listen port are forwarded to the ip and port):\n");
+    printf("--listen or -l local UDP port to listen on\n");
+    printf("--impair or -x comma-separated list of: delay=ms, jitter=ms, dist=uniform|normal|pareto, loss=p,\n");
+    printf("    burst=enter:exit[:loss], reorder=p[:ms], dup=p, drift=ppm, seed=n\n");
     printf("\nExample usage:\n");
     printf("samtest -i \"127.0.0.1\" -p 7770 -m 16 -c 2 -t 100 -d 0\n");
+    printf("samtest -i \"127.0.0.1\" -p 7770 -m 64 -c 2 -t 10000 -d 2 -s 4 -n 4 -b 24 -o bench.json\n");
+    printf("samtest -i \"127.0.0.1\" -p 7770 -m 32 -c 2 -d 4\n");
+    printf("samtest -i \"127.0.0.1\" -p 4464 -l 5464 -d 3 -x \"delay=20,jitter=4,dist=normal,burst=0.001:0.3,seed=3\"\n");
     printf("\n");
 }
 
@@ -53,6 +70,9 @@ int main(int argc, char *argv[])
     int maxClients = 0;
     int interval = 0;
     int mode = 0;
+    SamBenchmarkParams benchParams;
+    quint16 listenPort = 0;
+    ImpairmentParams impairParams;
 
     // parse command-line parameters
     while (true)
@@ -65,12 +85,20 @@ int main(int argc, char *argv[])
             {"channels", required_argument, NULL, 'c'},
             {"interval", required_argument, NULL, 't'},
             {"mode", required_argument, NULL, 'd'},
+            {"start", required_argument, NULL, 's'},
+            {"step", required_argument, NULL, 'n'},
+            {"bits", required_argument, NULL, 'b'},
+            {"queue", required_argument, NULL, 'q'},
+            {"monitor", required_argument, NULL, 'w'},
+            {"output", required_argument, NULL, 'o'},
+            {"listen", required_argument, NULL, 'l'},
+            {"impair", required_argument, NULL, 'x'},
             {NULL, 0, NULL, 0}
         };
 
         // getopt_long stores the option index here.
         int option_index = 0;
-        int c = getopt_long(argc, argv, "i:p:m:c:t:d:", long_options, &option_index);
+        int c = getopt_long(argc, argv, "i:p:m:c:t:d:s:n:b:q:w:o:l:x:", long_options, &option_index);
 
         // Detect the end of the options.
         if (c == -1) break;
@@ -133,15 +161,79 @@ int main(int argc, char *argv[])
         case 'd':
         {
             int temp = atoi(optarg);
-            if (temp < 0 || temp > 1)
+            if (temp < 0 || temp > 3)
             {
-                qCritical("only modes 0 and 1 are defined");
+                qCritical("only modes 0, 1, 2 and 3 are defined");
             }
             mode = temp;
             qWarning("setting mode = %d", mode);
             break;
         }
 
+        case 's':
+        {
+            int temp = atoi(optarg);
+            if (temp <= 0)
+            {
+                qCritical("Number of starting clients must be at least 1");
+            }
+            benchParams.startClients = temp;
+            qWarning("setting number of starting clients = %d", temp);
+            break;
+        }
+
+        case 'n':
+        {
+            int temp = atoi(optarg);
+            if (temp <= 0)
+            {
+                qCritical("Number of clients per step must be at least 1");
+            }
+            benchParams.stepClients = temp;
+            qWarning("setting number of clients per step = %d", temp);
+            break;
+        }
+
+        case 'b':
+        {
+            int temp = atoi(optarg);
+            if (temp == 16) benchParams.payloadType = PAYLOAD_PCM_16;
+            else if (temp == 24) benchParams.payloadType = PAYLOAD_PCM_24;
+            else if (temp == 32) benchParams.payloadType = PAYLOAD_PCM_32;
+            else qCritical("bits per sample must be 16, 24 or 32");
+            qWarning("setting bits per sample = %d", temp);
+            break;
+        }
+
+        case 'q':
+            benchParams.packetQueueSize = atoi(optarg);
+            qWarning("setting packet queue size = %d", benchParams.packetQueueSize);
+            break;
+
+        case 'w':
+            benchParams.monitorPort = optarg;
+            qWarning("setting monitor port = %s", optarg);
+            break;
+
+        case 'o':
+            benchParams.outputPath = optarg;
+            qWarning("setting output file = %s", optarg);
+            break;
+
+        case 'l':
+            listenPort = atoi(optarg);
+            qWarning("setting listen port = %u", listenPort);
+            break;
+
+        case 'x':
+            if (!NetworkImpairment::parse(optarg, impairParams))
+            {
+                qCritical("invalid impairment %s", optarg);
+                exit(EXIT_FAILURE);
+            }
+            qWarning("setting impairment = %s", optarg);
+            break;
+
         default:
             print_help();
             exit(EXIT_SUCCESS);
@@ -160,6 +252,55 @@ int main(int argc, char *argv[])
         SamStressTester stressTester(samIP, samPort, interval, maxClients, channels, NULL);
         return a.exec();
     }
+    case 2:
+    {
+        benchParams.samAddress = samIP;
+        benchParams.samPort = samPort;
+        benchParams.channels = channels;
+        benchParams.maxClients = maxClients;
+        benchParams.stepMillis = interval;
+        SamBenchmarkTester benchmarkTester(benchParams, NULL);
+        return a.exec();
+    }
+    case 3:
+    {
+        ImpairmentProxy proxy(listenPort, QString(samIP), samPort, impairParams, NULL);
+        proxy.getImpairment().print();
+        if (!proxy.start())
+        {
+            return EXIT_FAILURE;
+        }
+        int ret = a.exec();
+        const NetworkImpairment& impairment = proxy.getImpairment();
+        printf("Forwarded %llu of %llu datagrams: %llu lost, %llu reordered, %llu duplicated\n", proxy.getPacketsForwarded(), impairment.getPacketsSent(),
+               impairment.getPacketsLost(), impairment.getPacketsReordered(), impairment.getPacketsDuplicated());
+        return ret;
+    }
+    case 4:
+    {
+        StreamingAudioClientGroup group;
+        SacParams params;
+        params.numChannels = channels;
+        params.name = CLIENT_NAME;
+        params.samIP = samIP;
+        params.samPort = samPort;
+        for (int i = 0; i < maxClients; i++)
+        {
+            if (group.addStream(params, 0, 0, 0, 0, 0) < 0)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        if (group.start() != SAC_SUCCESS)
+        {
+            qWarning("samtest ERROR: couldn't start the client group.");
+            return EXIT_FAILURE;
+        }
+        printf("Sending %d streams of %d channels from one audio thread\n", group.getNumStreams(), channels);
+        int ret = a.exec();
+        printf("%u datagrams dropped\n", group.getDatagramsDropped());
+        return ret;
+    }
     case 1:
     default:
     {
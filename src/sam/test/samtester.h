@@ -10,17 +10,39 @@
 #ifndef SAMTESTER_H
 #define SAMTESTER_H
 
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+
 #include <QCoreApplication>
 #include <QObject>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QTime>
 #include <QTimer>
 #include <QList>
+#include <QUdpSocket>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include "jack/jack.h"
 
 #include "sam_client.h"
 
 static const char* CLIENT_NAME = "test client";
 
+static const char* BENCH_JACK_CLIENT_NAME = "samtest";    // JACK client that monitors SAM's output for latency markers
+static const int BENCH_SETTLE_MILLIS = 2000;              // time after adding clients before measuring (lets packet queues fill)
+static const int BENCH_STATS_TIMEOUT_MILLIS = 2000;       // time to wait for a /sam/val/stats reply
+static const int BENCH_MARKER_INTERVAL_MILLIS = 250;      // time between latency markers
+static const int BENCH_MARKER_RING = 64;                  // number of latency marker send times remembered
+static const int BENCH_MAX_LATENCIES = 65536;             // maximum number of latency measurements stored
+static const float BENCH_MARKER_LEVEL = 0.9f;             // amplitude of a latency marker impulse
+static const float BENCH_MARKER_THRESHOLD = 0.5f;         // amplitude at which a latency marker is detected
+static const float BENCH_TONE_LEVEL = 0.25f;              // combined amplitude of all clients' background tones
+static const double BENCH_MAX_LOSS_RATIO = 0.001;         // fraction of packets that may be lost, late or missed in a sustainable step
+
 using namespace sam;
 
 // stress testing of client registering/unregistering/etc.
@@ -202,5 +224,553 @@ private:
     QList<StreamingAudioClient*> m_clients;
 };
 
+// parameters for SamBenchmarkTester
+struct SamBenchmarkParams
+{
+    SamBenchmarkParams() :
+        samAddress(NULL),
+        samPort(0),
+        channels(1),
+        payloadType(PAYLOAD_PCM_16),
+        packetQueueSize(-1),
+        startClients(1),
+        stepClients(1),
+        maxClients(1),
+        stepMillis(5000),
+        monitorPort(NULL),
+        outputPath(NULL)
+    {}
+
+    const char* samAddress; // IP address of SAM
+    quint16 samPort;        // SAM's OSC port
+    int channels;           // number of channels per client
+    quint8 payloadType;     // RTP payload type sent by each client
+    int packetQueueSize;    // packet queue size requested by each client (or -1 for SAM's default)
+    int startClients;       // number of clients in the first step
+    int stepClients;        // number of clients added for each following step
+    int maxClients;         // maximum number of clients
+    int stepMillis;         // measurement time for each step
+    const char* monitorPort;// SAM output port to monitor for latency markers (or NULL to find one)
+    const char* outputPath; // file to write the JSON results to (or NULL for stdout)
+};
+
+// the counters from a /sam/val/stats reply
+struct SamStats
+{
+    quint32 numApps;
+    quint32 xruns;
+    quint32 periods;
+    quint32 processMicros;
+    quint32 processMaxMicros;
+    quint32 packetsReceived;
+    quint32 packetsLate;
+    quint32 packetsSkipped;
+    quint32 periodsMissed;
+};
+
+class SamBenchmarkTester;
+
+// a synthetic client streaming to SAM
+struct SamBenchmarkClient
+{
+    StreamingAudioClient* sac;
+    SamBenchmarkTester* tester;
+    int index;
+    float phase;
+    float phaseIncrement;
+    jack_nframes_t framesToMarker;
+};
+
+// end-to-end throughput and latency benchmark: steps up the number of clients streaming to SAM
+// until SAM can no longer keep up, measuring each step and writing the results as JSON
+class SamBenchmarkTester : public QObject
+{
+    Q_OBJECT
+public:
+    SamBenchmarkTester(const SamBenchmarkParams& params, QObject* parent) :
+        QObject(parent),
+        m_params(params),
+        m_jackClient(NULL),
+        m_inputPort(NULL),
+        m_sampleRate(0),
+        m_bufferSize(0),
+        m_outputLatencyMicros(0),
+        m_markerFrames(0),
+        m_markersSent(0),
+        m_markersMatched(0),
+        m_markerAbove(false),
+        m_latencies(NULL),
+        m_latencyCount(0),
+        m_stepLatencyStart(0),
+        m_statsSocket(NULL),
+        m_statsTimer(NULL),
+        m_waitingForStepEnd(false),
+        m_maxSustainableClients(0)
+    {
+        memset(&m_stepStart, 0, sizeof(m_stepStart));
+        memset(&m_stepUsage, 0, sizeof(m_stepUsage));
+        memset(m_markerTimes, 0, sizeof(m_markerTimes));
+        m_latencies = new quint32[BENCH_MAX_LATENCIES];
+
+        m_statsTimer = new QTimer(this);
+        m_statsTimer->setSingleShot(true);
+        connect(m_statsTimer, SIGNAL(timeout()), this, SLOT(statsTimedOut()));
+
+        QTimer::singleShot(0, this, SLOT(start()));
+    }
+
+    ~SamBenchmarkTester()
+    {
+        if (m_jackClient)
+        {
+            jack_client_close(m_jackClient);
+            m_jackClient = NULL;
+        }
+
+        for (int i = 0; i < m_clients.size(); i++)
+        {
+            delete m_clients[i]->sac;
+            delete m_clients[i];
+            m_clients[i] = NULL;
+        }
+        m_clients.clear();
+
+        delete[] m_latencies;
+        m_latencies = NULL;
+    }
+
+public slots:
+    void start()
+    {
+        if (!open_jack_client())
+        {
+            finish();
+            return;
+        }
+
+        m_statsSocket = new QUdpSocket(this);
+        if (!m_statsSocket->bind())
+        {
+            qWarning("SamBenchmarkTester::start ERROR: couldn't bind a socket for SAM statistics");
+            finish();
+            return;
+        }
+        connect(m_statsSocket, SIGNAL(readyRead()), this, SLOT(readStats()));
+
+        if (!add_clients(m_params.startClients))
+        {
+            finish();
+            return;
+        }
+        QTimer::singleShot(BENCH_SETTLE_MILLIS, this, SLOT(beginStep()));
+    }
+
+    void beginStep()
+    {
+        m_waitingForStepEnd = false;
+        request_stats();
+    }
+
+    void endStep()
+    {
+        m_waitingForStepEnd = true;
+        request_stats();
+    }
+
+    void readStats()
+    {
+        while (m_statsSocket->hasPendingDatagrams())
+        {
+            QByteArray datagram;
+            datagram.resize(m_statsSocket->pendingDatagramSize());
+            m_statsSocket->readDatagram(datagram.data(), datagram.size());
+
+            OscMessage msg;
+            if (!msg.read(datagram)) continue;
+            if (strcmp(msg.getAddress(), "/sam/val/stats") != 0 || !msg.typeMatches("iiiiiiiiii")) continue;
+            if (!m_statsTimer->isActive()) continue; // not waiting for a reply
+            m_statsTimer->stop();
+
+            SamStats stats;
+            OscArg arg;
+            msg.getArg(1, arg);
+            stats.numApps = arg.val.i;
+            msg.getArg(2, arg);
+            stats.xruns = arg.val.i;
+            msg.getArg(3, arg);
+            stats.periods = arg.val.i;
+            msg.getArg(4, arg);
+            stats.processMicros = arg.val.i;
+            msg.getArg(5, arg);
+            stats.processMaxMicros = arg.val.i;
+            msg.getArg(6, arg);
+            stats.packetsReceived = arg.val.i;
+            msg.getArg(7, arg);
+            stats.packetsLate = arg.val.i;
+            msg.getArg(8, arg);
+            stats.packetsSkipped = arg.val.i;
+            msg.getArg(9, arg);
+            stats.periodsMissed = arg.val.i;
+
+            if (m_waitingForStepEnd)
+            {
+                finish_step(stats);
+            }
+            else
+            {
+                // start measuring (the stats query also restarts SAM's max process time)
+                m_stepStart = stats;
+                m_stepLatencyStart = m_latencyCount;
+                getrusage(RUSAGE_SELF, &m_stepUsage);
+                m_stepTimer.start();
+                QTimer::singleShot(m_params.stepMillis, this, SLOT(endStep()));
+            }
+        }
+    }
+
+    void statsTimedOut()
+    {
+        qWarning("SamBenchmarkTester::statsTimedOut ERROR: no reply from SAM to /sam/stats");
+        finish();
+    }
+
+private:
+
+    static bool audio_callback(unsigned int numChannels, unsigned int nframes, float** out, void* arg)
+    {
+        SamBenchmarkClient* client = (SamBenchmarkClient*)arg;
+        SamBenchmarkTester* tester = client->tester;
+
+        // a quiet tone keeps the payload realistic without masking the latency markers
+        float level = BENCH_TONE_LEVEL / tester->m_params.maxClients;
+        for (unsigned int n = 0; n < nframes; n++)
+        {
+            float sample = level * sinf(client->phase);
+            client->phase += client->phaseIncrement;
+            if (client->phase > 2.0f * M_PI) client->phase -= 2.0f * M_PI;
+            for (unsigned int ch = 0; ch < numChannels; ch++)
+            {
+                out[ch][n] = sample;
+            }
+        }
+
+        // the first client sends an impulse periodically and remembers when it was sent
+        if (client->index == 0 && tester->m_markerFrames > 0)
+        {
+            if (client->framesToMarker <= nframes)
+            {
+                out[0][0] = BENCH_MARKER_LEVEL;
+                quint32 sent = tester->m_markersSent;
+                tester->m_markerTimes[sent % BENCH_MARKER_RING] = jack_get_time();
+                tester->m_markersSent = sent + 1;
+                client->framesToMarker = tester->m_markerFrames;
+            }
+            else
+            {
+                client->framesToMarker -= nframes;
+            }
+        }
+        return true;
+    }
+
+    static int jack_process(jack_nframes_t nframes, void* arg)
+    {
+        SamBenchmarkTester* tester = (SamBenchmarkTester*)arg;
+        const float* in = (const float*)jack_port_get_buffer(tester->m_inputPort, nframes);
+        jack_nframes_t frameTime = jack_last_frame_time(tester->m_jackClient);
+
+        for (jack_nframes_t n = 0; n < nframes; n++)
+        {
+            bool above = in[n] > BENCH_MARKER_THRESHOLD;
+            if (above && !tester->m_markerAbove)
+            {
+                jack_time_t detected = jack_frames_to_time(tester->m_jackClient, frameTime + n) + tester->m_outputLatencyMicros;
+                tester->match_marker(detected);
+            }
+            tester->m_markerAbove = above;
+        }
+        return 0;
+    }
+
+    void match_marker(jack_time_t detected)
+    {
+        // pair the detected marker with the most recent marker sent before it
+        quint32 sent = m_markersSent;
+        if (sent - m_markersMatched > (quint32)BENCH_MARKER_RING) m_markersMatched = sent - BENCH_MARKER_RING;
+
+        bool found = false;
+        jack_time_t sendTime = 0;
+        for (quint32 i = m_markersMatched; i != sent; i++)
+        {
+            jack_time_t t = m_markerTimes[i % BENCH_MARKER_RING];
+            if (t > detected) break;
+            sendTime = t;
+            m_markersMatched = i + 1;
+            found = true;
+        }
+
+        if (found && m_latencyCount < BENCH_MAX_LATENCIES)
+        {
+            m_latencies[m_latencyCount] = detected - sendTime;
+            m_latencyCount = m_latencyCount + 1;
+        }
+    }
+
+    bool open_jack_client()
+    {
+        jack_status_t status;
+        m_jackClient = jack_client_open(BENCH_JACK_CLIENT_NAME, JackNoStartServer, &status);
+        if (!m_jackClient)
+        {
+            qWarning("SamBenchmarkTester ERROR: couldn't open JACK client, status = 0x%2.0x", status);
+            return false;
+        }
+        m_sampleRate = jack_get_sample_rate(m_jackClient);
+        m_bufferSize = jack_get_buffer_size(m_jackClient);
+        m_markerFrames = (m_sampleRate * BENCH_MARKER_INTERVAL_MILLIS) / 1000;
+
+        m_inputPort = jack_port_register(m_jackClient, "marker_in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+        if (!m_inputPort)
+        {
+            qWarning("SamBenchmarkTester ERROR: couldn't register JACK input port");
+            return false;
+        }
+        jack_set_process_callback(m_jackClient, SamBenchmarkTester::jack_process, this);
+        if (jack_activate(m_jackClient) != 0)
+        {
+            qWarning("SamBenchmarkTester ERROR: couldn't activate JACK client");
+            return false;
+        }
+
+        // by default, monitor whichever port is connected to the first physical output (SAM's first basic channel)
+        if (m_params.monitorPort)
+        {
+            m_monitorPort = m_params.monitorPort;
+        }
+        else
+        {
+            const char** outputs = jack_get_ports(m_jackClient, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput);
+            if (outputs && outputs[0])
+            {
+                const char** connections = jack_port_get_all_connections(m_jackClient, jack_port_by_name(m_jackClient, outputs[0]));
+                if (connections && connections[0]) m_monitorPort = connections[0];
+                if (connections) jack_free(connections);
+            }
+            if (outputs) jack_free(outputs);
+        }
+
+        QByteArray monitorBytes = m_monitorPort.toLocal8Bit();
+        jack_port_t* monitor = m_monitorPort.isEmpty() ? NULL : jack_port_by_name(m_jackClient, monitorBytes.constData());
+        if (!monitor || jack_connect(m_jackClient, monitorBytes.constData(), jack_port_name(m_inputPort)) != 0)
+        {
+            qWarning("SamBenchmarkTester WARNING: couldn't monitor a SAM output port, latency won't be measured");
+            m_monitorPort.clear();
+            return true;
+        }
+
+        // include the latency from SAM's output port to the hardware
+        jack_latency_range_t range;
+        jack_port_get_latency_range(monitor, JackPlaybackLatency, &range);
+        m_outputLatencyMicros = ((jack_time_t)range.max * 1000000) / m_sampleRate;
+        return true;
+    }
+
+    bool add_clients(int count)
+    {
+        for (int i = 0; i < count && m_clients.size() < m_params.maxClients; i++)
+        {
+            SamBenchmarkClient* client = new SamBenchmarkClient();
+            client->sac = new StreamingAudioClient();
+            client->tester = this;
+            client->index = m_clients.size();
+            client->phase = 0.0f;
+            client->phaseIncrement = (2.0f * M_PI * (220.0f + 10.0f * client->index)) / m_sampleRate;
+            client->framesToMarker = m_markerFrames;
+
+            SacParams params;
+            params.numChannels = m_params.channels;
+            params.type = TYPE_BASIC;
+            params.name = CLIENT_NAME;
+            params.samIP = m_params.samAddress;
+            params.samPort = m_params.samPort;
+            params.payloadType = m_params.payloadType;
+            params.packetQueueSize = m_params.packetQueueSize;
+
+            if (client->sac->init(params) != SAC_SUCCESS
+                || client->sac->setAudioCallback(SamBenchmarkTester::audio_callback, client) != SAC_SUCCESS
+                || client->sac->start(0, 0, 0, 0, 0) != SAC_SUCCESS)
+            {
+                qWarning("SamBenchmarkTester ERROR: couldn't register client %d", client->index);
+                delete client->sac;
+                delete client;
+                return false;
+            }
+            m_clients.append(client);
+        }
+        return true;
+    }
+
+    void request_stats()
+    {
+        OscMessage msg;
+        msg.init("/sam/stats", "ii", -1, m_statsSocket->localPort());
+        OscAddress addr;
+        addr.host.setAddress(m_params.samAddress);
+        addr.port = m_params.samPort;
+        if (!OscClient::sendUdp(&msg, &addr))
+        {
+            qWarning("SamBenchmarkTester ERROR: couldn't send /sam/stats");
+            finish();
+            return;
+        }
+        m_statsTimer->start(BENCH_STATS_TIMEOUT_MILLIS);
+    }
+
+    void finish_step(const SamStats& end)
+    {
+        double seconds = m_stepTimer.elapsed() / 1000.0;
+        int clients = m_clients.size();
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        double cpuSeconds = (usage.ru_utime.tv_sec - m_stepUsage.ru_utime.tv_sec) + (usage.ru_stime.tv_sec - m_stepUsage.ru_stime.tv_sec)
+                          + ((usage.ru_utime.tv_usec - m_stepUsage.ru_utime.tv_usec) + (usage.ru_stime.tv_usec - m_stepUsage.ru_stime.tv_usec)) / 1.0e6;
+
+        // the counters wrap, so difference them as unsigned 32-bit values
+        quint32 xruns = end.xruns - m_stepStart.xruns;
+        quint32 periods = end.periods - m_stepStart.periods;
+        quint32 processMicros = end.processMicros - m_stepStart.processMicros;
+        quint32 received = end.packetsReceived - m_stepStart.packetsReceived;
+        quint32 late = end.packetsLate - m_stepStart.packetsLate;
+        quint32 skipped = end.packetsSkipped - m_stepStart.packetsSkipped;
+        quint32 missed = end.periodsMissed - m_stepStart.periodsMissed;
+        quint64 expected = (quint64)periods * clients;
+        quint64 lost = (expected > received) ? expected - received : 0;
+
+        double periodMicros = (m_bufferSize * 1.0e6) / m_sampleRate;
+        double processMean = periods ? (double)processMicros / periods : 0.0;
+        double dspLoad = periods ? processMean / periodMicros : 0.0;
+        bool sustainable = (xruns == 0) && (end.numApps == (quint32)clients) && (late + missed + lost <= BENCH_MAX_LOSS_RATIO * expected);
+
+        // latency statistics for the markers detected during this step
+        QVector<quint32> latencies;
+        for (int i = m_stepLatencyStart; i < m_latencyCount; i++)
+        {
+            latencies.append(m_latencies[i]);
+        }
+        qSort(latencies);
+        double latencyMean = 0.0;
+        for (int i = 0; i < latencies.size(); i++)
+        {
+            latencyMean += latencies[i];
+        }
+        if (!latencies.isEmpty()) latencyMean /= latencies.size();
+        int n = latencies.size();
+
+        char buf[2048];
+        snprintf(buf, sizeof(buf),
+                 "    {\"clients\": %d, \"seconds\": %.3f, \"periods\": %u, \"xruns\": %u, "
+                 "\"processMeanMicros\": %.2f, \"processMaxMicros\": %u, \"dspLoad\": %.4f, "
+                 "\"packetsReceived\": %u, \"packetsPerSecond\": %.1f, \"packetsLost\": %llu, \"packetsLate\": %u, "
+                 "\"packetsSkipped\": %u, \"periodsMissed\": %u, \"clientCpuPercent\": %.1f, "
+                 "\"latencyMillis\": {\"count\": %d, \"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}, "
+                 "\"sustainable\": %s}",
+                 clients, seconds, periods, xruns,
+                 processMean, end.processMaxMicros, dspLoad,
+                 received, seconds > 0.0 ? received / seconds : 0.0, (unsigned long long)lost, late,
+                 skipped, missed, seconds > 0.0 ? 100.0 * cpuSeconds / seconds : 0.0,
+                 n, n ? latencies[0] / 1000.0 : 0.0, latencyMean / 1000.0, n ? latencies[n / 2] / 1000.0 : 0.0,
+                 n ? latencies[(n * 99) / 100] / 1000.0 : 0.0, n ? latencies[n - 1] / 1000.0 : 0.0,
+                 sustainable ? "true" : "false");
+        m_steps.append(QByteArray(buf));
+
+        qWarning("SamBenchmarkTester: %d clients, %u xruns, DSP load %.1f%%, %u late, %u missed, %llu lost, median latency %.3f ms%s",
+                 clients, xruns, dspLoad * 100.0, late, missed, (unsigned long long)lost, n ? latencies[n / 2] / 1000.0 : 0.0,
+                 sustainable ? "" : " (not sustainable)");
+
+        if (!sustainable || clients >= m_params.maxClients)
+        {
+            if (sustainable) m_maxSustainableClients = clients;
+            finish();
+            return;
+        }
+        m_maxSustainableClients = clients;
+
+        if (!add_clients(m_params.stepClients))
+        {
+            finish();
+            return;
+        }
+        QTimer::singleShot(BENCH_SETTLE_MILLIS, this, SLOT(beginStep()));
+    }
+
+    void finish()
+    {
+        FILE* out = stdout;
+        if (m_params.outputPath)
+        {
+            out = fopen(m_params.outputPath, "w");
+            if (!out)
+            {
+                qWarning("SamBenchmarkTester ERROR: couldn't open %s, writing results to stdout", m_params.outputPath);
+                out = stdout;
+            }
+        }
+
+        QByteArray monitorBytes = m_monitorPort.toLocal8Bit();
+        fprintf(out, "{\n");
+        fprintf(out, "  \"samAddress\": \"%s\",\n", m_params.samAddress);
+        fprintf(out, "  \"samPort\": %u,\n", m_params.samPort);
+        fprintf(out, "  \"sampleRate\": %u,\n", m_sampleRate);
+        fprintf(out, "  \"bufferSize\": %u,\n", m_bufferSize);
+        fprintf(out, "  \"channels\": %d,\n", m_params.channels);
+        fprintf(out, "  \"payloadType\": %u,\n", m_params.payloadType);
+        fprintf(out, "  \"packetQueueSize\": %d,\n", m_params.packetQueueSize);
+        fprintf(out, "  \"stepMillis\": %d,\n", m_params.stepMillis);
+        fprintf(out, "  \"monitorPort\": \"%s\",\n", monitorBytes.constData());
+        fprintf(out, "  \"outputLatencyMicros\": %llu,\n", (unsigned long long)m_outputLatencyMicros);
+        fprintf(out, "  \"maxSustainableClients\": %d,\n", m_maxSustainableClients);
+        fprintf(out, "  \"steps\": [\n");
+        for (int i = 0; i < m_steps.size(); i++)
+        {
+            fprintf(out, "%s%s\n", m_steps[i].constData(), (i < m_steps.size() - 1) ? "," : "");
+        }
+        fprintf(out, "  ]\n");
+        fprintf(out, "}\n");
+
+        if (out != stdout) fclose(out);
+        QCoreApplication::exit(0);
+    }
+
+    SamBenchmarkParams m_params;
+    QList<SamBenchmarkClient*> m_clients;
+
+    // latency measurement
+    jack_client_t* m_jackClient;
+    jack_port_t* m_inputPort;
+    QString m_monitorPort;
+    jack_nframes_t m_sampleRate;
+    jack_nframes_t m_bufferSize;
+    jack_time_t m_outputLatencyMicros;
+    jack_nframes_t m_markerFrames;
+    jack_time_t m_markerTimes[BENCH_MARKER_RING];
+    volatile quint32 m_markersSent;
+    quint32 m_markersMatched;
+    bool m_markerAbove;
+    quint32* m_latencies;
+    volatile int m_latencyCount;
+    int m_stepLatencyStart;
+
+    // SAM statistics
+    QUdpSocket* m_statsSocket;
+    QTimer* m_statsTimer;
+    bool m_waitingForStepEnd;
+    SamStats m_stepStart;
+    struct rusage m_stepUsage;
+    QElapsedTimer m_stepTimer;
+
+    QList<QByteArray> m_steps;
+    int m_maxSustainableClients;
+};
 
 #endif // SAMTESTER_H
@@ -40,5 +40,29 @@ enum StreamingAudioType
     TYPE_BASIC = 0
 };
 
+/**
+ * @enum MeterFrameFormat
+ * Encodings for the levels in a binary meter frame.
+ *
+ * A meter frame is the blob argument of a /sam/val/meterframe message, and contains the meter
+ * levels for all apps in network byte order: a header of version (8 bits), format (8 bits)
+ * and number of apps (16 bits), then for each app its id (16 bits) and number of channels
+ * (16 bits), then for each channel the input RMS, input peak, output RMS and output peak
+ * levels encoded according to the format.
+ */
+enum MeterFrameFormat
+{
+    METER_FRAME_FLOAT32 = 0,    ///< linear levels as 32-bit IEEE floats
+    METER_FRAME_DB8,            ///< levels in dB, quantized to 8 bits between METER_FRAME_DB_MIN and METER_FRAME_DB_MAX (0 means silence)
+    METER_FRAME_DB16,           ///< levels in dB, quantized to 16 bits between METER_FRAME_DB_MIN and METER_FRAME_DB_MAX (0 means silence)
+    NUM_METER_FRAME_FORMATS
+};
+
+static const int METER_FRAME_VERSION = 1;           ///< version number written in meter frame headers
+static const int METER_FRAME_HEADER_SIZE = 4;       ///< size of a meter frame header in bytes
+static const int METER_FRAME_APP_HEADER_SIZE = 4;   ///< size of the per-app header in a meter frame in bytes
+static const float METER_FRAME_DB_MIN = -96.0f;     ///< lowest level represented by the quantized meter frame formats (dB)
+static const float METER_FRAME_DB_MAX = 12.0f;      ///< highest level represented by the quantized meter frame formats (dB)
+
 }
 #endif // SAM_SHARED_H
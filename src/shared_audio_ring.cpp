@@ -0,0 +1,348 @@
+/**
+ * @file shared_audio_ring.cpp
+ * SharedAudioRing implementation
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <new>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <QAtomicInt>
+#include <QDebug>
+
+#include "shared_audio_ring.h"
+
+namespace sam
+{
+
+static const quint32 RING_MAGIC = 0x53414d52;   // "SAMR"
+static const quint32 RING_VERSION = 1;
+static const int RING_BUFFERS = 4;              // capacity of the ring in reader buffers (rounded up to a power of two)
+static const int CACHE_LINE_BYTES = 64;
+
+/**
+ * @struct SharedAudioRingHeader
+ * The header at the start of a ring's shared memory, followed by the samples.
+ * The two positions are kept on separate cache lines so the reader and writer don't contend.
+ */
+struct SharedAudioRingHeader
+{
+    quint32 magic;              ///< RING_MAGIC
+    quint32 version;            ///< RING_VERSION
+    qint32 channels;            ///< number of channels
+    qint32 capacity;            ///< frames per channel (a power of two)
+    qint32 sampleRate;          ///< audio sample rate
+    qint32 samplesOffset;       ///< offset of the first sample from the start of the header, in bytes
+    QAtomicInt writerAttached;  ///< 1 while a writer is attached
+    char pad1[CACHE_LINE_BYTES];
+    QAtomicInt writePos;        ///< total frames written (modulo 2^32), advanced only by the writer
+    char pad2[CACHE_LINE_BYTES];
+    QAtomicInt readPos;         ///< total frames read (modulo 2^32), advanced only by the reader
+    char pad3[CACHE_LINE_BYTES];
+};
+
+SharedAudioRing::SharedAudioRing() :
+    m_header(NULL),
+    m_samples(NULL),
+    m_bytes(0),
+    m_owner(false),
+    m_channels(0),
+    m_capacity(0),
+    m_bufferSize(0),
+    m_primed(false),
+    m_underruns(0),
+    m_overruns(0),
+    m_skipped(0)
+{
+}
+
+SharedAudioRing::~SharedAudioRing()
+{
+    close();
+}
+
+bool SharedAudioRing::create(const char* name, int channels, int bufferSize, int sampleRate, int group)
+{
+    close();
+    if (channels <= 0 || bufferSize <= 0)
+    {
+        qWarning("SharedAudioRing::create invalid ring: %d channel(s), buffer size %d", channels, bufferSize);
+        return false;
+    }
+
+    int capacity = 1;
+    while (capacity < RING_BUFFERS * bufferSize) capacity <<= 1;
+    size_t samplesOffset = (sizeof(SharedAudioRingHeader) + CACHE_LINE_BYTES - 1) & ~(size_t)(CACHE_LINE_BYTES - 1);
+    size_t bytes = samplesOffset + (size_t)channels * capacity * sizeof(float);
+
+    // O_EXCL: never reuse an object someone else may have created (and could still have mapped)
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        qWarning("SharedAudioRing::create couldn't create shared memory %s: %s", name, strerror(errno));
+        return false;
+    }
+    if (group >= 0 && (fchown(fd, (uid_t)-1, (gid_t)group) < 0 || fchmod(fd, 0660) < 0))
+    {
+        qWarning("SharedAudioRing::create couldn't give group %d access to shared memory %s: %s", group, name, strerror(errno));
+        ::close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    if (ftruncate(fd, bytes) < 0)
+    {
+        qWarning("SharedAudioRing::create couldn't size shared memory %s: %s", name, strerror(errno));
+        ::close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    m_name = name;
+    m_owner = true;
+    if (!map(fd, bytes))
+    {
+        shm_unlink(name);
+        m_owner = false;
+        return false;
+    }
+
+    // the new object is zero-filled, so the positions start at 0 and the ring is silent
+    new (m_header) SharedAudioRingHeader();
+    m_header->channels = channels;
+    m_header->capacity = capacity;
+    m_header->sampleRate = sampleRate;
+    m_header->samplesOffset = samplesOffset;
+    m_header->version = RING_VERSION;
+    m_header->magic = RING_MAGIC;
+
+    m_samples = (float*)((char*)m_header + samplesOffset);
+    m_channels = channels;
+    m_capacity = capacity;
+    m_bufferSize = bufferSize;
+    return true;
+}
+
+bool SharedAudioRing::attach(const char* name, int channels, int sampleRate)
+{
+    close();
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        qWarning("SharedAudioRing::attach couldn't open shared memory %s: %s", name, strerror(errno));
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(SharedAudioRingHeader))
+    {
+        qWarning("SharedAudioRing::attach shared memory %s is too small", name);
+        ::close(fd);
+        return false;
+    }
+    m_name = name;
+    if (!map(fd, info.st_size)) return false;
+
+    const SharedAudioRingHeader* header = m_header;
+    size_t expected = header->samplesOffset + (size_t)header->channels * header->capacity * sizeof(float);
+    if (header->magic != RING_MAGIC || header->version != RING_VERSION || header->channels != channels
+        || header->sampleRate != sampleRate || header->capacity <= 0 || (header->capacity & (header->capacity - 1)) != 0
+        || expected > m_bytes)
+    {
+        qWarning("SharedAudioRing::attach shared memory %s isn't a matching ring", name);
+        unmap();
+        return false;
+    }
+    if (!m_header->writerAttached.testAndSetOrdered(0, 1))
+    {
+        qWarning("SharedAudioRing::attach ring %s already has a writer", name);
+        unmap();
+        return false;
+    }
+
+    m_samples = (float*)((char*)m_header + header->samplesOffset);
+    m_channels = channels;
+    m_capacity = header->capacity;
+    return true;
+}
+
+void SharedAudioRing::close()
+{
+    if (m_header)
+    {
+        if (!m_owner)
+        {
+            m_header->writerAttached.fetchAndStoreOrdered(0);
+        }
+        unmap();
+    }
+    if (m_owner)
+    {
+        shm_unlink(m_name.constData());
+        m_owner = false;
+    }
+}
+
+bool SharedAudioRing::isWriterAttached() const
+{
+    return m_header && m_header->writerAttached.testAndSetOrdered(1, 1);
+}
+
+bool SharedAudioRing::write(float** data, int channels, int frames)
+{
+    if (!m_header) return false;
+
+    quint32 writePos = (quint32)m_header->writePos.fetchAndAddRelaxed(0); // only this side changes it
+    quint32 readPos = (quint32)m_header->readPos.fetchAndAddAcquire(0);
+    if (frames > m_capacity - (int)(writePos - readPos))
+    {
+        m_overruns++;
+        return false;
+    }
+
+    int start = writePos & (m_capacity - 1);
+    int first = qMin(frames, m_capacity - start);
+    for (int ch = 0; ch < m_channels; ch++)
+    {
+        float* dest = channel(ch);
+        if (ch < channels && data[ch])
+        {
+            memcpy(dest + start, data[ch], first * sizeof(float));
+            memcpy(dest, data[ch] + first, (frames - first) * sizeof(float));
+        }
+        else
+        {
+            memset(dest + start, 0, first * sizeof(float));
+            memset(dest, 0, (frames - first) * sizeof(float));
+        }
+    }
+
+    // publish the frames
+    m_header->writePos.fetchAndAddRelease(frames);
+    return true;
+}
+
+int SharedAudioRing::read(float** data, int channels, int frames)
+{
+    int framesRead = 0;
+    if (m_header)
+    {
+        quint32 writePos = (quint32)m_header->writePos.fetchAndAddAcquire(0);
+        quint32 readPos = (quint32)m_header->readPos.fetchAndAddRelaxed(0); // only this side changes it
+        int queued = (int)(writePos - readPos);
+
+        if (!m_primed && queued >= frames) m_primed = true;
+        if (m_primed)
+        {
+            // keep the latency bounded if the writer has got ahead
+            int maxQueued = 2 * qMax(frames, m_bufferSize);
+            if (queued > maxQueued)
+            {
+                m_skipped += queued - maxQueued;
+                readPos += queued - maxQueued;
+                queued = maxQueued;
+            }
+
+            framesRead = qMin(frames, queued);
+            if (framesRead < frames) m_underruns++;
+
+            int start = readPos & (m_capacity - 1);
+            int first = qMin(framesRead, m_capacity - start);
+            for (int ch = 0; ch < channels && ch < m_channels; ch++)
+            {
+                const float* src = channel(ch);
+                memcpy(data[ch], src + start, first * sizeof(float));
+                memcpy(data[ch] + first, src, (framesRead - first) * sizeof(float));
+            }
+
+            // hand the space back to the writer
+            m_header->readPos.fetchAndStoreRelease((int)(readPos + framesRead));
+        }
+    }
+
+    for (int ch = 0; ch < channels; ch++)
+    {
+        int start = (ch < m_channels) ? framesRead : 0;
+        memset(data[ch] + start, 0, (frames - start) * sizeof(float));
+    }
+    return framesRead;
+}
+
+int SharedAudioRing::getFramesQueued() const
+{
+    if (!m_header) return 0;
+    quint32 writePos = (quint32)m_header->writePos.fetchAndAddOrdered(0);
+    quint32 readPos = (quint32)m_header->readPos.fetchAndAddOrdered(0);
+    return (int)(writePos - readPos);
+}
+
+bool SharedAudioRing::map(int fd, size_t bytes)
+{
+    void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the object open
+    if (mem == MAP_FAILED)
+    {
+        qWarning("SharedAudioRing::map couldn't map shared memory %s: %s", m_name.constData(), strerror(errno));
+        return false;
+    }
+    m_header = (SharedAudioRingHeader*)mem;
+    m_bytes = bytes;
+    return true;
+}
+
+void SharedAudioRing::unmap()
+{
+    if (m_header)
+    {
+        munmap(m_header, m_bytes);
+        m_header = NULL;
+    }
+    m_samples = NULL;
+    m_bytes = 0;
+    m_channels = 0;
+    m_capacity = 0;
+    m_bufferSize = 0;
+    m_primed = false;
+}
+
+} // end of namespace sam
@@ -0,0 +1,221 @@
+/**
+ * @file shared_audio_ring.h
+ * Shared-memory audio transport between clients and SAM on the same host
+ * @author agent
+ * @date October 2026
+ * @license 
+ * This software is Copyright 2011-2014 The Regents of the University of California. 
+ * All Rights Reserved.
+ *
+ * Permission to copy, modify, and distribute this software and its documentation for 
+ * educational, research and non-profit purposes by non-profit entities, without fee, 
+ * and without a written agreement is hereby granted, provided that the above copyright
+ * notice, this paragraph and the following three paragraphs appear in all copies.
+ *
+ * Permission to make commercial use of this software may be obtained by contacting:
+ * Technology Transfer Office
+ * 9500 Gilman Drive, Mail Code 0910
+ * University of California
+ * La Jolla, CA 92093-0910
+ * (858) 534-5815
+ * invent@ucsd.edu
+ *
+ * This software program and documentation are copyrighted by The Regents of the 
+ * University of California. The software program and documentation are supplied 
+ * "as is", without any accompanying services from The Regents. The Regents does 
+ * not warrant that the operation of the program will be uninterrupted or error-free. 
+ * The end-user understands that the program was developed for research purposes and 
+ * is advised not to rely exclusively on the program for any reason.
+ *
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO
+ * ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR
+ * CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+ * OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+ * EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. THE UNIVERSITY OF
+ * CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ * THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, 
+ * AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ */
+
+#ifndef SHARED_AUDIO_RING_H
+#define SHARED_AUDIO_RING_H
+
+#include <QByteArray>
+
+namespace sam
+{
+
+struct SharedAudioRingHeader;
+
+/**
+ * @class SharedAudioRing
+ * @author agent
+ * @date October 2026
+ *
+ * This class is a lock-free single-producer, single-consumer ring of audio frames in POSIX shared memory.
+ * It carries audio from a client to SAM when both run on the same host, in place of RTP over the loopback
+ * interface: the client's audio thread writes float samples straight into the ring and SAM's audio thread
+ * reads them straight out again, with no encoding, no sockets and no jitter buffer.
+ *
+ * SAM creates the ring when an app registers and sends its name to the client, which attaches to it as the
+ * writer.  Samples are stored planar (one region per channel) and the read and write positions are frame
+ * counters that are only ever advanced, each by one side.
+ */
+class SharedAudioRing
+{
+public:
+
+    /**
+     * SharedAudioRing constructor.
+     */
+    SharedAudioRing();
+
+    /**
+     * SharedAudioRing destructor.
+     * Closes the ring (see close()).
+     */
+    ~SharedAudioRing();
+
+    /**
+     * Copy constructor (not used).
+     */
+    SharedAudioRing(const SharedAudioRing&);
+
+    /**
+     * Assignment operator (not used).
+     */
+    SharedAudioRing& operator=(const SharedAudioRing&);
+
+    /**
+     * Create a new ring as its reader.
+     * The ring is only accessible to this process's user, or also to one group if given.  Since another
+     * user in that group could attach first, the name should be unguessable and only sent to the client.
+     * @param name the shared memory object name (starting with '/'), which must not exist yet
+     * @param channels the number of audio channels
+     * @param bufferSize the number of frames the reader reads at a time (the ring holds several times this many)
+     * @param sampleRate the audio sample rate
+     * @param group the id of a group whose members may also attach, or -1 for this process's user only
+     * @return true on success, false on failure
+     */
+    bool create(const char* name, int channels, int bufferSize, int sampleRate, int group = -1);
+
+    /**
+     * Attach to an existing ring as its writer.
+     * @param name the shared memory object name
+     * @param channels the number of audio channels (must match the ring)
+     * @param sampleRate the audio sample rate (must match the ring)
+     * @return true on success, false if the ring doesn't exist, doesn't match or already has a writer
+     */
+    bool attach(const char* name, int channels, int sampleRate);
+
+    /**
+     * Detach from the ring, and remove it if this is the side that created it.
+     */
+    void close();
+
+    /**
+     * Check if the ring is open.
+     * @return true if created or attached, false otherwise
+     */
+    bool isOpen() const { return m_header != NULL; }
+
+    /**
+     * Check if a writer is attached to the ring.
+     * @return true if a writer is attached, false otherwise
+     */
+    bool isWriterAttached() const;
+
+    /**
+     * Write frames into the ring (writer only, real-time safe).
+     * If there isn't room for all of the frames none are written, so the reader never sees part of a period.
+     * @param data the audio samples in the form data[ch][frame]
+     * @param channels the number of channels in data
+     * @param frames the number of frames to write
+     * @return true on success, false if the ring was full
+     */
+    bool write(float** data, int channels, int frames);
+
+    /**
+     * Read frames from the ring (reader only, real-time safe).
+     * Reading doesn't begin until a full buffer of frames has been written, and missing frames are read as silence.
+     * If the writer has got ahead (e.g. after the reader missed a period) the oldest frames are skipped so the
+     * latency stays at no more than two buffers.
+     * @param data the buffers to read into, in the form data[ch][frame]
+     * @param channels the number of channels in data
+     * @param frames the number of frames to read
+     * @return the number of frames read from the ring (the rest of data is silence)
+     */
+    int read(float** data, int channels, int frames);
+
+    /**
+     * Get the name of the ring.
+     * @return the shared memory object name, or NULL if the ring isn't open
+     */
+    const char* getName() const { return m_header ? m_name.constData() : NULL; }
+
+    /**
+     * Get the number of frames written but not yet read.
+     * @return the number of frames queued
+     */
+    int getFramesQueued() const;
+
+    /**
+     * Get the number of channels.
+     * @return the number of channels, or 0 if the ring isn't open
+     */
+    int getNumChannels() const { return m_channels; }
+
+    /**
+     * Get the capacity of the ring.
+     * @return the number of frames the ring can hold, or 0 if the ring isn't open
+     */
+    int getCapacity() const { return m_capacity; }
+
+    quint32 getUnderruns() const { return m_underruns; }    ///< @return number of reads that came up short (reader only)
+    quint32 getOverruns() const { return m_overruns; }      ///< @return number of writes dropped because the ring was full (writer only)
+    quint32 getFramesSkipped() const { return m_skipped; }  ///< @return number of frames skipped to limit latency (reader only)
+
+protected:
+
+    /**
+     * Map the shared memory object.
+     * @param fd the shared memory file descriptor
+     * @param bytes the size of the object
+     * @return true on success, false on failure
+     */
+    bool map(int fd, size_t bytes);
+
+    /**
+     * Unmap the shared memory object (without detaching or removing it).
+     */
+    void unmap();
+
+    /**
+     * Get the samples of a channel.
+     * @param ch the channel
+     * @return the first sample of the channel's region
+     */
+    float* channel(int ch) const { return m_samples + (size_t)ch * m_capacity; }
+
+    QByteArray m_name;              ///< shared memory object name
+    SharedAudioRingHeader* m_header; ///< start of the mapping (NULL if not open)
+    float* m_samples;               ///< first channel's samples within the mapping
+    size_t m_bytes;                 ///< size of the mapping
+    bool m_owner;                   ///< true on the side that created the ring (which removes it on close)
+    int m_channels;                 ///< number of channels
+    int m_capacity;                 ///< number of frames the ring holds (a power of two)
+    int m_bufferSize;               ///< number of frames the reader reads at a time
+    bool m_primed;                  ///< true once the reader has seen a full buffer of frames
+    quint32 m_underruns;            ///< number of reads that came up short
+    quint32 m_overruns;             ///< number of writes dropped because the ring was full
+    quint32 m_skipped;              ///< number of frames skipped to limit latency
+};
+
+} // end of namespace sam
+
+#endif // SHARED_AUDIO_RING_H